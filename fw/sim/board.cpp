@@ -0,0 +1,91 @@
+#include "board.h"
+#include "dma.h"
+#include "gpio.h"
+#include "pio.h"
+#include "multicore.h"
+#include "app.h"
+
+SimBoard* SimBoard::_current = nullptr;
+
+SimBoard::SimBoard(uint32_t flashId)
+    : _flash(flashId), _matrix(Board::Rows::PIN, Board::MAX_ROW, Board::Cols::PIN, Board::MAX_COL),
+      _rebooted(false), _sck(false)
+{
+    // --> a new board starts a new timeline.
+    SimMulticore::join();
+    SimClock::reset();
+    SimGpio::reset();
+    SimSpi::reset();
+    SimDma::reset();
+    SimPio::reset();
+
+    _matrix.attach();
+    SimSpi::attach(0, EGPIO_SPI0_CSn, &_flash);
+
+    // --> SCK toggles as a pin only when the PIO drives it, MOSI and MISO are IO0 and IO1.
+    SimGpio::attachOutput(EGPIO_SPI0_SCK, [this](bool level) {
+        if (_sck && !level) {
+            _flash.clock();
+        }
+
+        _sck = level;
+    });
+
+    SimGpio::attachInput(EGPIO_SPI0_TX, [this]() { return _flash.io(0); });
+    SimGpio::attachInput(EGPIO_SPI0_RX, [this]() { return _flash.io(1); });
+
+    // --> the wiring to the flash carries 40 MHz, the RP2040 drives up to 62.5 MHz.
+    SimSpi::setMaxBaudrate(0, 40 * 1000 * 1000);
+
+    _current = this;
+}
+
+SimBoard::~SimBoard() {
+    SimMulticore::join();
+    SimGpio::reset();
+    SimSpi::reset();
+
+    if (_current == this) {
+        _current = nullptr;
+    }
+}
+
+void SimBoard::wireFlashIo(uint8_t io2, uint8_t io3) {
+    SimGpio::attachInput(io2, [this]() { return _flash.io(2); });
+    SimGpio::attachInput(io3, [this]() { return _flash.io(3); });
+}
+
+void SimBoard::run(uint64_t duration) {
+    App* app = nullptr;
+
+    // --> power-on: the firmware starts from scratch.
+    run(duration, [&app]() {
+        app = new App();
+        app->runApp();
+    });
+
+    // --> after the core 1 joined, it runs on the App.
+    delete app;
+}
+
+void SimBoard::run(uint64_t duration, const std::function<void()>& main) {
+    _rebooted = false;
+    _flash.powerOn();
+    SimGpio::resetIrqs();
+    SimClock::start(now() + duration);
+
+    try {
+        main();
+    }
+
+    catch (const SimHalt&) {
+    }
+
+    SimClock::stop();
+    SimMulticore::join();
+}
+
+void SimBoard::reboot() {
+    _rebooted = true;
+    SimClock::stop();
+}
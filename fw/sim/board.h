@@ -0,0 +1,74 @@
+#ifndef __SIM_BOARD_H__
+#define __SIM_BOARD_H__
+
+#include "clock.h"
+#include "flash.h"
+#include "matrix.h"
+#include "usbhost.h"
+#include <functional>
+
+/**
+ * Simulated shortcut-pd board: the key matrix, the W25Qxx on SPI0
+ * (and its IO lines to the PIO) and the USB host, wired like `main.h` and `Board`. Only one board can exist at a time,
+ * and its clocks start from zero.
+ * --
+ * Usage:
+ *  SimBoard board;
+ *  board.matrix().tap(EKEY_00, 100 * SimClock::MS, 30 * SimClock::MS);
+ *  board.run(500 * SimClock::MS);
+ *
+ *  for(const SSimHidReport& each : board.host().reports()) { ... }
+ */
+class SimBoard {
+private:
+    static SimBoard* _current;
+
+    SimFlash _flash;
+    SimMatrix _matrix;
+    SimUsbHost _host;
+
+    bool _rebooted;
+    bool _sck;                  // --> last level of SCK, the PIO clocks it.
+
+public:
+    SimBoard(uint32_t flashId = 0xef4016);
+    ~SimBoard();
+
+public:
+    /* get the board that the stand-ins are wired to. */
+    static SimBoard* current() { return _current; }
+
+    SimFlash& flash() { return _flash; }
+    SimMatrix& matrix() { return _matrix; }
+    SimUsbHost& host() { return _host; }
+
+    /* get the core 0 clock. */
+    uint64_t now() const { return SimClock::now(0); }
+
+    /**
+     * Wire IO2 (/WP) and IO3 (/HOLD) of the flash to the pins, for the 1-1-4 reads.
+     * `main.h` leaves them unwired: IO0 and IO1 (MOSI, MISO) are wired only.
+     */
+    void wireFlashIo(uint8_t io2, uint8_t io3);
+
+public:
+    /**
+     * Power on and run the firmware for the duration.
+     * The clock keeps running across runs, and the flash keeps its contents.
+     */
+    void run(uint64_t duration);
+
+    /**
+     * Power on and run `main` instead of the App, to drive a module alone.
+     * The run ends when `main` returns, at the duration or by a power cut.
+     */
+    void run(uint64_t duration, const std::function<void()>& main);
+
+    /* test whether the last run ended by a reboot request or not. */
+    bool rebooted() const { return _rebooted; }
+
+    /* end the run by a reboot request, called by the stand-ins. */
+    void reboot();
+};
+
+#endif
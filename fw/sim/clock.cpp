@@ -0,0 +1,224 @@
+#include "clock.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * State of the simulated core.
+ * Only the owner thread writes the counters, atomics are for the readers.
+ */
+struct SSimCore {
+    std::atomic<uint64_t> clock;
+    std::atomic<uint64_t> busy;
+    std::atomic<uint64_t> idle;
+    std::atomic<uint64_t> waited;   // --> idle, waiting for an interrupt.
+    std::atomic<bool> active;
+    std::atomic<uint64_t> wakeAt;   // --> waiting for the other core to reach this.
+};
+
+static SSimCore g_simCores[SimClock::MAX_CORES];
+static std::atomic<bool> g_simStop(true);
+static std::atomic<uint64_t> g_simDeadline(0);
+static thread_local uint8_t t_simCore = 0;
+
+static std::mutex g_simLock;
+static std::condition_variable g_simCond;
+
+/**
+ * Wake the other core up if it waits for the calling core.
+ */
+static void simNotify(uint64_t now) {
+    SSimCore& other = g_simCores[t_simCore ^ 1];
+
+    // --> seq_cst: pairs with the store of `wakeAt` then the load of the clock.
+    if (now >= other.wakeAt.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> guard(g_simLock);
+        g_simCond.notify_all();
+    }
+}
+
+/**
+ * Wake all cores up, for the state changes other than clocks.
+ */
+static void simNotifyAll() {
+    std::lock_guard<std::mutex> guard(g_simLock);
+    g_simCond.notify_all();
+}
+
+void SimClock::bind(uint8_t core) {
+    t_simCore = core;
+}
+
+uint8_t SimClock::core() {
+    return t_simCore;
+}
+
+uint64_t SimClock::now() {
+    return g_simCores[t_simCore].clock.load(std::memory_order_relaxed);
+}
+
+uint64_t SimClock::now(uint8_t core) {
+    return g_simCores[core].clock.load(std::memory_order_acquire);
+}
+
+uint64_t SimClock::busy(uint8_t core) {
+    return g_simCores[core].busy.load(std::memory_order_acquire);
+}
+
+uint64_t SimClock::idle(uint8_t core) {
+    return g_simCores[core].idle.load(std::memory_order_acquire);
+}
+
+uint64_t SimClock::waited(uint8_t core) {
+    return g_simCores[core].waited.load(std::memory_order_acquire);
+}
+
+void SimClock::reset() {
+    for(SSimCore& each : g_simCores) {
+        each.clock.store(0);
+        each.busy.store(0);
+        each.idle.store(0);
+        each.waited.store(0);
+        each.active.store(false);
+        each.wakeAt.store(UINT64_MAX);
+    }
+
+    g_simStop.store(true);
+    g_simDeadline.store(0);
+}
+
+void SimClock::start(uint64_t deadline) {
+    t_simCore = 0;
+
+    g_simDeadline.store(deadline);
+    g_simStop.store(false);
+    g_simCores[0].active.store(true);
+}
+
+void SimClock::launch(uint8_t core, uint64_t at) {
+    SSimCore& target = g_simCores[core];
+
+    // --> the core starts fresh at the time: counters are kept.
+    if (target.clock.load() < at) {
+        target.clock.store(at);
+    }
+
+    target.active.store(true);
+}
+
+void SimClock::stop() {
+    g_simStop.store(true);
+    simNotifyAll();
+}
+
+bool SimClock::stopped() {
+    return g_simStop.load(std::memory_order_relaxed);
+}
+
+uint64_t SimClock::deadline() {
+    return g_simDeadline.load(std::memory_order_relaxed);
+}
+
+void SimClock::spend(uint64_t ns) {
+    SSimCore& self = g_simCores[t_simCore];
+    const uint64_t now = self.clock.load(std::memory_order_relaxed) + ns;
+
+    self.busy.store(self.busy.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    self.clock.store(now, std::memory_order_seq_cst);
+
+    simNotify(now);
+    lockstep(now);
+}
+
+void SimClock::sleep(uint64_t ns) {
+    SSimCore& self = g_simCores[t_simCore];
+    const uint64_t now = self.clock.load(std::memory_order_relaxed) + ns;
+
+    self.idle.store(self.idle.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    self.clock.store(now, std::memory_order_seq_cst);
+
+    simNotify(now);
+    lockstep(now);
+}
+
+void SimClock::sleepUntil(uint64_t at) {
+    const uint64_t now = SimClock::now();
+    if (at > now) {
+        sleep(at - now);
+    }
+}
+
+void SimClock::waitUntil(uint64_t at) {
+    SSimCore& self = g_simCores[t_simCore];
+    const uint64_t now = SimClock::now();
+
+    if (at > now) {
+        self.waited.store(self.waited.load(std::memory_order_relaxed) + (at - now), std::memory_order_relaxed);
+        sleep(at - now);
+    }
+}
+
+void SimClock::checkpoint() {
+    SSimCore& self = g_simCores[t_simCore];
+
+    if (g_simStop.load(std::memory_order_relaxed)) {
+        self.active.store(false);
+        simNotifyAll();
+        throw SimHalt();
+    }
+
+    if (self.clock.load(std::memory_order_relaxed) >= deadline()) {
+        // --> the core 0 owns the run.
+        if (t_simCore == 0) {
+            g_simStop.store(true);
+        }
+
+        self.active.store(false);
+        simNotifyAll();
+        throw SimHalt();
+    }
+}
+
+void SimClock::park() {
+    g_simCores[t_simCore].active.store(false);
+    simNotifyAll();
+}
+
+void SimClock::unpark(uint64_t at) {
+    SSimCore& self = g_simCores[t_simCore];
+    const uint64_t now = self.clock.load(std::memory_order_relaxed);
+
+    if (at > now) {
+        self.idle.store(self.idle.load(std::memory_order_relaxed) + (at - now));
+        self.clock.store(at);
+    }
+
+    self.active.store(true);
+}
+
+void SimClock::lockstep(uint64_t now) {
+    SSimCore& self = g_simCores[t_simCore];
+    const SSimCore& other = g_simCores[t_simCore ^ 1];
+
+    auto behind = [&](uint64_t at) {
+        return !g_simStop.load(std::memory_order_relaxed)
+            && other.active.load(std::memory_order_acquire)
+            && other.clock.load(std::memory_order_seq_cst) < at;
+    };
+
+    if (now <= QUANTUM || !behind(now - QUANTUM)) {
+        return;
+    }
+
+    // --> sleep until the other core catches up completely,
+    //   : then both cores run a quantum before the next switch.
+    std::unique_lock<std::mutex> guard(g_simLock);
+    self.wakeAt.store(now, std::memory_order_seq_cst);
+
+    while (behind(now)) {
+        g_simCond.wait_for(guard, std::chrono::milliseconds(1));
+    }
+
+    self.wakeAt.store(UINT64_MAX, std::memory_order_release);
+}
@@ -0,0 +1,97 @@
+#ifndef __SIM_CLOCK_H__
+#define __SIM_CLOCK_H__
+
+#include <stdint.h>
+
+/**
+ * Thrown by the stand-ins to unwind the firmware's endless loops.
+ * This is thrown only from the calls that never run in destructors,
+ * (timer reads, tud_task, FIFO pops) so unwinding is always safe.
+ */
+struct SimHalt { };
+
+/**
+ * Virtual clocks of the simulated cores.
+ * Each core has its own clock that advances by the cost of the stand-in
+ * calls it makes (see `SimCost`), and the two host threads are kept
+ * within `QUANTUM` of each other. A parked core (blocked on the FIFO
+ * or halted) doesn't hold the other core back.
+ */
+class SimClock {
+public:
+    static constexpr uint8_t MAX_CORES = 2;
+    static constexpr uint64_t QUANTUM = 20 * 1000;
+
+    static constexpr uint64_t US = 1000;
+    static constexpr uint64_t MS = 1000 * 1000;
+    static constexpr uint64_t SEC = 1000 * 1000 * 1000;
+
+public:
+    /* bind the calling host thread to the core. */
+    static void bind(uint8_t core);
+
+    /* get the core number of the calling thread. */
+    static uint8_t core();
+
+    /* get the calling core's clock. */
+    static uint64_t now();
+
+    /* get the core's clock. */
+    static uint64_t now(uint8_t core);
+
+    /* get the busy time of the core. */
+    static uint64_t busy(uint8_t core);
+
+    /* get the idle time of the core. */
+    static uint64_t idle(uint8_t core);
+
+    /* get the idle time of the core spent waiting for an interrupt, a part of `idle()`. */
+    static uint64_t waited(uint8_t core);
+
+public:
+    /* reset all clocks and counters to zero, no core may be running. */
+    static void reset();
+
+    /* start a run of the core 0, which halts at the deadline. */
+    static void start(uint64_t deadline);
+
+    /* start the other core at the time, then it runs until the deadline. */
+    static void launch(uint8_t core, uint64_t at);
+
+    /* stop the run: every core halts at its next checkpoint. */
+    static void stop();
+
+    /* test whether the run is stopped or not. */
+    static bool stopped();
+
+    /* get the deadline of the current run. */
+    static uint64_t deadline();
+
+public:
+    /* spend busy time on the calling core. */
+    static void spend(uint64_t ns);
+
+    /* spend idle time on the calling core. */
+    static void sleep(uint64_t ns);
+
+    /* move the calling core's clock to the time as idle, if it is behind. */
+    static void sleepUntil(uint64_t at);
+
+    /* same with `sleepUntil()`, counted as waiting for an interrupt as well. */
+    static void waitUntil(uint64_t at);
+
+    /* throw `SimHalt` if the run is over for the calling core. */
+    static void checkpoint();
+
+    /* park the calling core: the other core runs freely meanwhile. */
+    static void park();
+
+    /* unpark the calling core, at least at the time. */
+    static void unpark(uint64_t at);
+
+private:
+    /* wait for the other core to catch up. */
+    static void lockstep(uint64_t now);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __SIM_COST_H__
+#define __SIM_COST_H__
+
+#include <stdint.h>
+
+/**
+ * Virtual time charged to the calling core by the SDK stand-ins, in nanoseconds.
+ * These approximate a RP2040 at 125 MHz, and only the stand-in calls are charged:
+ * plain firmware code runs for free, so the numbers are deterministic.
+ */
+struct SimCost {
+    static constexpr uint64_t GPIO = 24;          // --> gpio_put, gpio_get.
+    static constexpr uint64_t GPIO_INIT = 200;    // --> gpio_init, gpio_set_*.
+    static constexpr uint64_t TIMER = 40;         // --> time_us_*, board_millis.
+    static constexpr uint64_t WAKE = 400;         // --> out of wfe: the interrupt entry and exit.
+    static constexpr uint64_t FIFO = 40;          // --> multicore_fifo_*.
+    static constexpr uint64_t SPI_CALL = 250;     // --> per spi_*_blocking call.
+    static constexpr uint64_t SPI_INIT = 2000;    // --> spi_init, spi_set_*.
+    static constexpr uint64_t DMA = 60;           // --> per dma_* call, a few register accesses.
+    static constexpr uint64_t DMA_READ = 24;      // --> a channel register read.
+    static constexpr uint64_t PIO = 24;           // --> pio_sm_put, pio_sm_get and the FIFO tests.
+    static constexpr uint64_t PIO_INIT = 400;     // --> loading a program, pio_sm_init, pio_sm_set_*.
+    static constexpr uint64_t TUD_TASK = 1500;    // --> tud_task without events.
+    static constexpr uint64_t TUD_CALL = 800;     // --> other tud_* calls.
+    static constexpr uint64_t TUD_EVENT = 40;     // --> tud_task_event_ready, a queue test.
+    static constexpr uint64_t TUD_BYTE = 8;       // --> per byte copied by tud_cdc_*.
+};
+
+#endif
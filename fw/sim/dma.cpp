@@ -0,0 +1,161 @@
+#include "dma.h"
+#include "clock.h"
+#include "spi.h"
+#include "pio.h"
+#include <string.h>
+
+static SSimDmaChannel g_simDma[SimDma::MAX_CHANNELS];
+static uint64_t g_simDmaTransfers = 0;
+
+void SimDma::reset() {
+    memset(g_simDma, 0, sizeof(g_simDma));
+    g_simDmaTransfers = 0;
+}
+
+SSimDmaChannel* SimDma::get(uint channel) {
+    if (channel >= MAX_CHANNELS) {
+        return nullptr;
+    }
+
+    return &g_simDma[channel];
+}
+
+void SimDma::trigger(uint32_t mask) {
+    for(uint8_t i = 0; i < MAX_CHANNELS; ++i) {
+        if (mask & (1u << i)) {
+            g_simDma[i].armed = true;
+        }
+    }
+
+    // --> paced by a PIO: runs along the state machine, see `sync()`.
+    for(SSimDmaChannel& each : g_simDma) {
+        PIO pio;
+
+        if (each.armed && SimPio::byRxDreq(each.config.dreq, &pio)) {
+            each.armed = false;
+            each.paced = each.count > 0;
+            g_simDmaTransfers++;
+        }
+    }
+
+    // --> pair TX and RX channels of the same SPI.
+    for(SSimDmaChannel& tx : g_simDma) {
+        if (!tx.armed) {
+            continue;
+        }
+
+        spi_inst_t* spi = SimSpi::findByData(tx.write);
+        if (!spi) {
+            // --> memory to memory.
+            if (!SimSpi::findByData(tx.read)) {
+                run(&tx, nullptr);
+            }
+
+            continue;
+        }
+
+        SSimDmaChannel* rx = nullptr;
+        for(SSimDmaChannel& each : g_simDma) {
+            if (each.armed && each.read == &spi->hw.dr) {
+                rx = &each;
+                break;
+            }
+        }
+
+        run(&tx, rx);
+    }
+}
+
+void SimDma::sync(uint channel) {
+    SSimDmaChannel* ch = get(channel);
+    if (!ch) {
+        return;
+    }
+
+    PIO pio;
+    SSimPioSm* sm = SimPio::byRxDreq(ch->config.dreq, &pio);
+    const uint64_t now = SimClock::now();
+
+    while (ch->paced && sm) {
+        SimPio::run(pio, sm, [sm, now]() { return sm->rxCount > 0 || sm->time >= now * 256; });
+
+        if (!sm->rxCount || sm->rxAt[sm->rxHead] > now) {
+            break;
+        }
+
+        // --> popped as soon as pushed: the FIFO never fills.
+        const uint32_t data = sm->rx[sm->rxHead];
+        const uint32_t unit = 1u << ch->config.size;
+
+        sm->popAt[sm->pops++ & 3] = sm->rxAt[sm->rxHead];
+        sm->rxHead = uint8_t((sm->rxHead + 1) & 3);
+        sm->rxCount--;
+
+        memcpy((void*) ch->write, &data, unit);
+
+        if (ch->config.write_incr) {
+            uintptr_t next = uintptr_t(ch->write) + unit;
+
+            if (ch->config.ring_write && ch->config.ring_bits) {
+                const uintptr_t mask = (uintptr_t(1) << ch->config.ring_bits) - 1;
+                next = (uintptr_t(ch->write) & ~mask) | (next & mask);
+            }
+
+            ch->write = (volatile void*) next;
+        }
+
+        ch->paced = --ch->count > 0;
+    }
+
+    ch->hw.read_addr = uintptr_t(ch->read);
+    ch->hw.write_addr = uintptr_t(ch->write);
+    ch->hw.transfer_count = ch->count;
+}
+
+uint64_t SimDma::transfers() {
+    return g_simDmaTransfers;
+}
+
+void SimDma::run(SSimDmaChannel* tx, SSimDmaChannel* rx) {
+    const uint32_t unit = 1u << tx->config.size;
+    const uint8_t* src = (const uint8_t*) tx->read;
+    spi_inst_t* spi = SimSpi::findByData(tx->write);
+
+    uint64_t duration = tx->count * 8;
+    if (!spi) {
+        // --> memory to memory.
+        for(uint32_t i = 0; i < tx->count; ++i) {
+            const uint32_t from = tx->config.read_incr ? i * unit : 0;
+            const uint32_t to = tx->config.write_incr ? i * unit : 0;
+
+            memcpy((uint8_t*) tx->write + to, src + from, unit);
+        }
+    }
+
+    else {
+        uint8_t* dst = rx ? (uint8_t*) rx->write : nullptr;
+
+        for(uint32_t i = 0; i < tx->count; ++i) {
+            const uint8_t data = src[tx->config.read_incr ? i : 0];
+            const uint8_t read = SimSpi::exchange(spi, data);
+
+            if (dst && i < rx->count) {
+                dst[rx->config.write_incr ? i : 0] = read;
+            }
+        }
+
+        duration = tx->count * SimSpi::byteTime(spi);
+        spi->bytes += tx->count;
+        spi->dmaBytes += tx->count;
+    }
+
+    tx->armed = false;
+    tx->busyUntil = SimClock::now() + duration;
+
+    if (rx) {
+        rx->armed = false;
+        rx->busyUntil = tx->busyUntil;
+    }
+
+    g_simDmaTransfers++;
+}
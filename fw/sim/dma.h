@@ -0,0 +1,59 @@
+#ifndef __SIM_DMA_H__
+#define __SIM_DMA_H__
+
+#include <stdint.h>
+#include <hardware/dma.h>
+
+/**
+ * Simulated DMA channel.
+ */
+struct SSimDmaChannel {
+    bool claimed;
+    dma_channel_config config;
+    volatile void* write;
+    const volatile void* read;
+    uint32_t count;
+    bool armed;             // --> triggered, waiting for its peer.
+    uint64_t busyUntil;     // --> on the triggering core's clock.
+    bool paced;             // --> triggered, paced by a PIO RX FIFO until the count runs out.
+    dma_channel_hw_t hw;
+};
+
+/**
+ * Simulated DMA controller.
+ * --
+ * Only the transfers the firmware uses are modeled:
+ * 1. a channel writing to a SPI data register (TX) paced with
+ *    a channel reading from the same register (RX), if triggered together.
+ *    the bytes are exchanged with the device at the trigger, and both channels
+ *    stay busy for the time to shift them. the CPU is charged for the calls only.
+ * 2. memory to memory, 8 ns per transfer.
+ * 3. a channel reading a PIO RX FIFO at its DREQ: the state machine runs up to
+ *    the core's time when the channel is read, and each word pushed is written
+ *    at once, wrapping in the ring if configured. the CPU is never charged.
+ */
+class SimDma {
+public:
+    static constexpr uint8_t MAX_CHANNELS = NUM_DMA_CHANNELS;
+
+public:
+    /* release all channels and reset the statistics. */
+    static void reset();
+
+    /* get the channel. */
+    static SSimDmaChannel* get(uint channel);
+
+    /* arm the channel, and run all transfers ready. */
+    static void trigger(uint32_t mask);
+
+    /* run the channel paced by a PIO up to now, and update its registers. */
+    static void sync(uint channel);
+
+    /* get the count of the transfers run. */
+    static uint64_t transfers();
+
+private:
+    static void run(SSimDmaChannel* tx, SSimDmaChannel* rx);
+};
+
+#endif
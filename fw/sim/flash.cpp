@@ -0,0 +1,627 @@
+#include "flash.h"
+#include "clock.h"
+#include <string.h>
+
+const SSimFlashTiming SimFlash::TIMING_TYP = {
+    10 * SimClock::MS,          // --> tW.
+    30 * SimClock::US,          // --> tBP1.
+    2500,                       // --> tBP2.
+    400 * SimClock::US,         // --> tPP.
+    45 * SimClock::MS,          // --> tSE.
+    120 * SimClock::MS,         // --> tBE1.
+    150 * SimClock::MS,         // --> tBE2.
+    2500 * SimClock::MS,        // --> tCE, per MB (10 s for 4 MB).
+    20 * SimClock::US,          // --> tSUS.
+    20 * SimClock::US,          // --> tRS.
+};
+
+const SSimFlashTiming SimFlash::TIMING_MAX = {
+    15 * SimClock::MS,
+    50 * SimClock::US,
+    12 * SimClock::US,
+    3 * SimClock::MS,
+    400 * SimClock::MS,
+    1600 * SimClock::MS,
+    2000 * SimClock::MS,
+    12500 * SimClock::MS,
+    20 * SimClock::US,
+    20 * SimClock::US,
+};
+
+SimFlash::SimFlash(uint32_t jedecId)
+    : _id(jedecId), _uid(0xd16355f18c7a2b19ull ^ jedecId),
+      _mem(size_t(1) << (jedecId & 0xff), 0xff),
+      _erases(_mem.size() / SECTOR_SIZE, 0),
+      _timing(TIMING_TYP), _wel(false), _addr4(false), _busyFrom(0), _busyUntil(0),
+      _busyTotal(0), _suspendable(false), _suspended(false), _suspendLeft(0), _resumedAt(0), _off(false), _undoAddr(0),
+      _sel(false), _cmd(0), _pos(0), _alen(0), _addr(0), _latchCount(0),
+      _wide(0), _wideClocks(0), _wideByte(0xff), _io(0), _ioDriven(0)
+{
+    memset(_sr, 0, sizeof(_sr));
+    memset(_latch, 0xff, sizeof(_latch));
+    memset(_latched, 0, sizeof(_latched));
+
+    _sfdp = makeSfdp(winbond(capacity()));
+    resetStats();
+}
+
+SSimSfdpDesc SimFlash::winbond(uint32_t capacity) {
+    SSimSfdpDesc desc = {
+        capacity, 8,
+        { 12, 15, 16, 0 }, { 0x20, 0x52, 0xd8, 0 }, { 0, 0, 0, 0 },
+        true, true, false
+    };
+
+    // --> W25Q256 and larger: the 4-byte opcodes, and 0xb7.
+    if (capacity > 0x1000000) {
+        desc.eraseOp4[0] = 0x21;
+        desc.eraseOp4[1] = 0x5c;
+        desc.eraseOp4[2] = 0xdc;
+        desc.enter4B = true;
+    }
+
+    return desc;
+}
+
+/* put the DWORD, little endian. */
+static void putDword(std::vector<uint8_t>& buf, uint32_t at, uint32_t val) {
+    for(uint32_t i = 0; i < 4; ++i) {
+        buf[at + i] = uint8_t(val >> (8 * i));
+    }
+}
+
+std::vector<uint8_t> SimFlash::makeSfdp(const SSimSfdpDesc& desc) {
+    constexpr uint32_t BFPT = 0x30, BFPT_DWORDS = 16;
+    constexpr uint32_t FOURB = BFPT + BFPT_DWORDS * 4;
+
+    const bool fourb = desc.eraseOp4[0] || desc.eraseOp4[1] || desc.eraseOp4[2] || desc.eraseOp4[3];
+    std::vector<uint8_t> buf(FOURB + 8, 0xff);
+
+    // --> the header: signature, rev 1.6, NPH (zero-based), access protocol.
+    putDword(buf, 0, 0x50444653);
+    buf[4] = 6; buf[5] = 1; buf[6] = fourb ? 1 : 0; buf[7] = 0xff;
+
+    // --> parameter headers: ID LSB, minor, major, length in DWORDs, PTP, ID MSB.
+    const uint8_t bfpt[8] = { 0x00, 6, 1, BFPT_DWORDS, BFPT, 0, 0, 0xff };
+    const uint8_t fourbHead[8] = { 0x84, 0, 1, 2, FOURB, 0, 0, 0xff };
+
+    memcpy(buf.data() + 8, bfpt, 8);
+    if (fourb) {
+        memcpy(buf.data() + 16, fourbHead, 8);
+    }
+
+    // --> DWORD 1: 4K erase [15:8] if any, address bytes [18:17], fast reads.
+    uint32_t dw1 = 0xff8000e4 | (desc.capacity > 0x1000000 ? (1 << 17) : 0);
+    for(uint32_t i = 0; i < 4; ++i) {
+        if (desc.eraseShift[i] == 12) {
+            dw1 = (dw1 & ~0xff03u) | 0x01 | (desc.eraseOp[i] << 8);
+        }
+    }
+
+    if (desc.dual) dw1 |= (1 << 16) | (1 << 20);
+    if (desc.quad) dw1 |= (1 << 21) | (1 << 22);
+
+    // --> DWORD 2: density, as 2 ^ N bits.
+    uint32_t bits = 0;
+    while ((uint64_t(1) << bits) < uint64_t(desc.capacity) * 8) {
+        bits++;
+    }
+
+    putDword(buf, BFPT + 0, dw1);
+    putDword(buf, BFPT + 4, 0x80000000 | bits);
+
+    // --> DWORD 3, 4: 1-4-4 (0xeb, 4 + 2), 1-1-4 (0x6b, 8), 1-1-2 (0x3b, 8), 1-2-2 (0xbb, 0 + 4).
+    putDword(buf, BFPT + 8, desc.quad ? 0x6b08eb44 : 0);
+    putDword(buf, BFPT + 12, desc.dual ? 0xbb803b08 : 0);
+
+    // --> DWORD 5 ~ 7: no 2-2-2 and 4-4-4.
+    putDword(buf, BFPT + 16, 0xffffffee);
+    putDword(buf, BFPT + 20, 0x0000ffff);
+    putDword(buf, BFPT + 24, 0x0000ffff);
+
+    // --> DWORD 8, 9: erase types.
+    for(uint32_t i = 0; i < 4; ++i) {
+        const uint32_t at = BFPT + 28 + (i / 2) * 4 + (i % 2) * 2;
+
+        buf[at] = desc.eraseShift[i];
+        buf[at + 1] = desc.eraseShift[i] ? desc.eraseOp[i] : 0;
+    }
+
+    // --> DWORD 10 ~ 16: page size [7:4] of DWORD 11, 0xb7 [24] of DWORD 16.
+    for(uint32_t i = 9; i < BFPT_DWORDS; ++i) {
+        putDword(buf, BFPT + i * 4, 0);
+    }
+
+    putDword(buf, BFPT + 40, uint32_t(desc.pageShift) << 4);
+    putDword(buf, BFPT + 60, desc.enter4B ? (1 << 24) : 0);
+
+    // --> 4BAIT: 0x13, 0x0c, 0x12, the dual and quad reads and the erase types.
+    if (fourb) {
+        uint32_t support = 0x03 | (1 << 6);
+
+        if (desc.dual) support |= (1 << 2) | (1 << 3);
+        if (desc.quad) support |= (1 << 4) | (1 << 5);
+        uint32_t opcodes = 0;
+
+        for(uint32_t i = 0; i < 4; ++i) {
+            if (desc.eraseShift[i] && desc.eraseOp4[i]) {
+                support |= 1 << (9 + i);
+                opcodes |= uint32_t(desc.eraseOp4[i]) << (8 * i);
+            }
+        }
+
+        putDword(buf, FOURB, support);
+        putDword(buf, FOURB + 4, opcodes);
+    }
+
+    return buf;
+}
+
+void SimFlash::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t SimFlash::erases(uint32_t sector) const {
+    if (sector >= _erases.size()) {
+        return 0;
+    }
+
+    return _erases[sector];
+}
+
+uint32_t SimFlash::maxErases() const {
+    uint32_t max = 0;
+    for(uint32_t each : _erases) {
+        if (max < each) {
+            max = each;
+        }
+    }
+
+    return max;
+}
+
+uint64_t SimFlash::totalErases() const {
+    uint64_t sum = 0;
+    for(uint32_t each : _erases) {
+        sum += each;
+    }
+
+    return sum;
+}
+
+bool SimFlash::busy() const {
+    return SimClock::now() < _busyUntil;
+}
+
+void SimFlash::select() {
+    if (_off) {
+        return;
+    }
+
+    _sel = true;
+    _cmd = 0;
+    _pos = 0;
+    _alen = 0;
+    _addr = 0;
+    _latchCount = 0;
+    memset(_latched, 0, sizeof(_latched));
+    _wide = 0;
+    _ioDriven = 0;
+
+    _stats.frames++;
+}
+
+void SimFlash::deselect() {
+    if (!_sel) {
+        return;
+    }
+
+    _sel = false;
+    _wide = 0;
+    _ioDriven = 0;
+
+    if (_pos == 0 || !isAccepted(_cmd)) {
+        return;
+    }
+
+    const bool addressed = _pos > _alen;
+    switch(_cmd) {
+        case 0x06: _wel = true; break;
+        case 0x04: _wel = false; break;
+        case 0xb7: _addr4 = true; break;
+        case 0xe9: _addr4 = false; break;
+        case 0x75: suspend(); break;
+        case 0x7a: resume(); break;
+
+        case 0x01: case 0x31: case 0x11:
+            if (_pos >= 2) {
+                // --> nothing to tear.
+                _undo.clear();
+                setBusy(_timing.tW);
+            }
+            _wel = false;
+            break;
+
+        case 0x02: case 0x12:
+            if (addressed && _latchCount) {
+                program();
+            }
+            _wel = false;
+            break;
+
+        case 0x20: case 0x21:
+            if (addressed) {
+                _stats.sectorErases++;
+                erase(_addr & ~(SECTOR_SIZE - 1), SECTOR_SIZE);
+                setBusy(_timing.tSE, true);
+            }
+            _wel = false;
+            break;
+
+        case 0x52: case 0x5c:
+            if (addressed) {
+                _stats.halfBlockErases++;
+                erase(_addr & ~(BLOCK_SIZE / 2 - 1), BLOCK_SIZE / 2);
+                setBusy(_timing.tBE1, true);
+            }
+            _wel = false;
+            break;
+
+        case 0xd8: case 0xdc:
+            if (addressed) {
+                _stats.blockErases++;
+                erase(_addr & ~(BLOCK_SIZE - 1), BLOCK_SIZE);
+                setBusy(_timing.tBE2, true);
+            }
+            _wel = false;
+            break;
+
+        case 0xc7: case 0x60:
+            _stats.chipErases++;
+            erase(0, capacity());
+            setBusy(_timing.tCE * (capacity() >> 20));
+            _wel = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint8_t SimFlash::xfer(uint8_t data) {
+    if (!_sel) {
+        return 0xff;
+    }
+
+    const uint32_t pos = _pos++;
+    if (pos == 0) {
+        _cmd = data;
+        _alen = addressBytes(data);
+
+        if (!isAccepted(data)) {
+            _stats.ignored++;
+        }
+
+        else if (data == 0x03 || data == 0x13 || data == 0x0b || data == 0x0c
+              || data == 0x3b || data == 0x3c || data == 0x6b || data == 0x6c) {
+            _stats.reads++;
+        }
+
+        return 0xff;
+    }
+
+    // --> ignored: DO stays high-Z.
+    if (!isAccepted(_cmd)) {
+        return 0xff;
+    }
+
+    if (pos <= _alen) {
+        _addr = (_addr << 8) | data;
+
+        // --> the dummy clocks and the data follow on the IO lines.
+        if (pos == _alen && (_cmd == 0x3b || _cmd == 0x3c || _cmd == 0x6b || _cmd == 0x6c)) {
+            _wide = (_cmd & 0xf0) == 0x60 ? 4 : 2;
+            _wideClocks = 0;
+        }
+
+        return 0xff;
+    }
+
+    // --> clocked by the SPI: the data isn't on MISO alone.
+    if (_wide) {
+        for(uint32_t i = 0; i < 8; ++i) {
+            clock();
+        }
+
+        return 0xff;
+    }
+
+    const uint32_t n = pos - 1 - _alen;    // --> bytes after the address.
+    switch(_cmd) {
+        case 0x9f: // --> JEDEC ID.
+            return n < 3 ? uint8_t(_id >> (8 * (2 - n))) : 0xff;
+
+        case 0x05: return status(0);
+        case 0x35: return status(1);
+        case 0x15: return status(2);
+
+        case 0x01: case 0x31: case 0x11:
+            if (n == 0) {
+                _sr[_cmd == 0x01 ? 0 : (_cmd == 0x31 ? 1 : 2)] = data;
+            }
+            return 0xff;
+
+        case 0x5a: // --> a dummy byte, then the SFDP.
+            if (n < 1 || _addr + n - 1 >= _sfdp.size()) {
+                return 0xff;
+            }
+            return _sfdp[_addr + n - 1];
+
+        case 0x4b: // --> 4 dummy bytes, then 64-bit unique ID.
+            if (n < 4 || n >= 12) {
+                return 0xff;
+            }
+            return uint8_t(_uid >> (8 * (11 - n)));
+
+        case 0x03: case 0x13:
+            _stats.readBytes++;
+            return cell((_addr + n) % capacity());
+
+        case 0x0b: case 0x0c:
+            if (n < 1) {
+                return 0xff;
+            }
+
+            _stats.readBytes++;
+            return cell((_addr + n - 1) % capacity());
+
+        case 0x02: case 0x12: {
+            // --> more than a page wraps and overwrites the latch.
+            const uint32_t at = (_addr + n) & (PAGE_SIZE - 1);
+
+            if (!_latched[at]) {
+                _latched[at] = true;
+                _latchCount++;
+            }
+
+            _latch[at] = data;
+            return 0xff;
+        }
+
+        default:
+            return 0xff;
+    }
+}
+
+uint8_t SimFlash::status(uint8_t n) const {
+    if (n == 0) {
+        return (_sr[0] & 0xfc)
+            | (_wel ? 0x02 : 0x00)
+            | (busy() ? 0x01 : 0x00);
+    }
+
+    // --> SR2.SUS (bit 7): suspended, after tSUS.
+    if (n == 1) {
+        return (_sr[1] & 0x7f) | ((_suspended && !busy()) ? 0x80 : 0x00);
+    }
+
+    // --> SR3.ADS (bit 0): 4-byte address mode.
+    if (n == 2) {
+        return (_sr[2] & 0xfe) | (_addr4 ? 0x01 : 0x00);
+    }
+
+    // --> no such register: the bus floats high.
+    return 0xff;
+}
+
+uint8_t SimFlash::addressBytes(uint8_t cmd) const {
+    switch(cmd) {
+        case 0x02: case 0x03: case 0x0b:
+        case 0x3b: case 0x6b:
+        case 0x20: case 0x52: case 0xd8:
+            return _addr4 ? 4 : 3;
+
+        case 0x5a:
+            return 3;
+
+        case 0x12: case 0x13: case 0x0c:
+        case 0x3c: case 0x6c:
+        case 0x21: case 0x5c: case 0xdc:
+            return 4;
+
+        default:
+            return 0;
+    }
+}
+
+bool SimFlash::isAccepted(uint8_t cmd) const {
+    // --> only status reads and the suspend while BUSY.
+    if (busy()) {
+        return cmd == 0x05 || cmd == 0x35 || cmd == 0x15
+            || (cmd == 0x75 && _suspendable && !_suspended);
+    }
+
+    switch(cmd) {
+        case 0x7a:
+            return _suspended;
+
+        case 0x01: case 0x31: case 0x11:
+        case 0x02: case 0x12:
+        case 0x20: case 0x21:
+        case 0x52: case 0x5c:
+        case 0xd8: case 0xdc:
+        case 0xc7: case 0x60:
+            // --> never while suspended: reads only.
+            return _wel && !_suspended;
+
+        default:
+            return true;
+    }
+}
+
+void SimFlash::clock() {
+    if (!_sel || !_wide || _off) {
+        return;
+    }
+
+    // --> 8 dummy clocks, then the data from the falling edge after them.
+    const uint32_t n = _wideClocks++;
+    if (n < 8) {
+        return;
+    }
+
+    const uint32_t perByte = 8 / _wide;
+    const uint32_t at = (n - 8) % perByte;
+
+    if (at == 0) {
+        _wideByte = cell(_addr++ % capacity());
+        _stats.readBytes++;
+    }
+
+    _io = uint8_t((_wideByte >> (8 - _wide * (at + 1))) & ((1u << _wide) - 1));
+
+    // --> IO2 and IO3 are /WP and /HOLD unless SR2.QE.
+    _ioDriven = (_wide == 4 && (_sr[1] & 0x02)) ? 0x0f : 0x03;
+}
+
+bool SimFlash::io(uint8_t line) const {
+    if (!_sel || line >= 4 || !(_ioDriven & (1u << line))) {
+        return true;
+    }
+
+    return (_io >> line) & 1;
+}
+
+void SimFlash::powerCut() {
+    const uint64_t now = SimClock::now();
+
+    const uint64_t left = busyLeft(now);
+
+    // --> restore the part which is not done yet.
+    if (left && !_undo.empty()) {
+        const uint32_t done = uint32_t((_busyTotal - left) * _undo.size() / _busyTotal);
+
+        memcpy(_mem.data() + _undoAddr + done, _undo.data() + done, _undo.size() - done);
+    }
+
+    _undo.clear();
+    _busyUntil = 0;
+    _suspended = false;
+    _suspendLeft = 0;
+    _wel = false;
+    _addr4 = false;
+    _sel = false;
+    _off = true;
+}
+
+void SimFlash::keepUndo(uint32_t addr, uint32_t len) {
+    _undoAddr = addr;
+    _undo.assign(_mem.begin() + addr, _mem.begin() + addr + len);
+}
+
+uint8_t SimFlash::cell(uint32_t addr) {
+    if (!_suspended || addr < _undoAddr || addr - _undoAddr >= _undo.size()) {
+        return _mem[addr];
+    }
+
+    // --> neither the contents before nor after: the cells are half-way.
+    _stats.undefined++;
+    return uint8_t((addr * 0x9e3779b1u) >> 24) ^ 0xa5;
+}
+
+void SimFlash::setBusy(uint64_t duration, bool suspendable) {
+    _busyFrom = SimClock::now();
+    _busyUntil = _busyFrom + duration;
+    _busyTotal = duration;
+    _suspendable = suspendable;
+    _stats.busyTime += duration;
+}
+
+uint64_t SimFlash::busyLeft(uint64_t now) const {
+    const uint64_t left = now < _busyUntil ? _busyUntil - now : 0;
+    return _suspended ? left + _suspendLeft : left;
+}
+
+void SimFlash::suspend() {
+    const uint64_t now = SimClock::now();
+    const uint64_t at = now + _timing.tSUS;
+
+    // --> too early after the resume, or completes before suspended.
+    if (now < _resumedAt + _timing.tRS || at >= _busyUntil) {
+        _stats.ignored++;
+        return;
+    }
+
+    _suspendLeft = _busyUntil - at;
+    _busyUntil = at;
+    _suspended = true;
+
+    _stats.suspends++;
+    _stats.busyTime -= _suspendLeft;
+}
+
+void SimFlash::resume() {
+    const uint64_t now = SimClock::now();
+
+    _busyUntil = now + _suspendLeft;
+    _suspendLeft = 0;
+    _suspended = false;
+    _resumedAt = now;
+
+    _stats.busyTime += _busyUntil - now;
+}
+
+void SimFlash::program() {
+    const uint32_t base = _addr & ~(PAGE_SIZE - 1);
+    if (base >= capacity()) {
+        return;
+    }
+
+    // --> a torn program leaves the latched bytes half-done.
+    uint32_t first = PAGE_SIZE, last = 0;
+    for(uint32_t i = 0; i < PAGE_SIZE; ++i) {
+        if (_latched[i]) {
+            first = first < i ? first : i;
+            last = i;
+        }
+    }
+
+    keepUndo(base + first, last - first + 1);
+    for(uint32_t i = 0; i < PAGE_SIZE; ++i) {
+        if (!_latched[i]) {
+            continue;
+        }
+
+        uint8_t& cell = _mem[base + i];
+
+        // --> program can only clear bits.
+        _stats.stuckBits += __builtin_popcount(uint8_t(~cell & _latch[i]));
+        cell &= _latch[i];
+    }
+
+    uint64_t duration = _timing.tBP1 + (_latchCount - 1) * _timing.tBP2;
+    if (duration > _timing.tPP) {
+        duration = _timing.tPP;
+    }
+
+    _stats.programs++;
+    _stats.programBytes += _latchCount;
+
+    setBusy(duration, true);
+}
+
+void SimFlash::erase(uint32_t addr, uint32_t len) {
+    if (addr >= capacity()) {
+        return;
+    }
+
+    if (len > capacity() - addr) {
+        len = capacity() - addr;
+    }
+
+    keepUndo(addr, len);
+    memset(_mem.data() + addr, 0xff, len);
+    for(uint32_t i = 0; i < len; i += SECTOR_SIZE) {
+        _erases[(addr + i) / SECTOR_SIZE]++;
+    }
+}
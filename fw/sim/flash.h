@@ -0,0 +1,213 @@
+#ifndef __SIM_FLASH_H__
+#define __SIM_FLASH_H__
+
+#include "spi.h"
+#include <vector>
+
+/**
+ * W25Qxx timing, in nanoseconds.
+ * --
+ * Datasheet: W25Q32JV, 7.7 AC Electrical Characteristics.
+ */
+struct SSimFlashTiming {
+    uint64_t tW;        // --> write status register.
+    uint64_t tBP1;      // --> byte program, first byte.
+    uint64_t tBP2;      // --> byte program, additional byte.
+    uint64_t tPP;       // --> page program, upper bound of tBP1 + n * tBP2.
+    uint64_t tSE;       // --> sector erase, 4 KB.
+    uint64_t tBE1;      // --> block erase, 32 KB.
+    uint64_t tBE2;      // --> block erase, 64 KB.
+    uint64_t tCE;       // --> chip erase, per MB.
+    uint64_t tSUS;      // --> suspend to the suspended state.
+    uint64_t tRS;       // --> resume to the next suspend.
+};
+
+/**
+ * Statistics of the simulated flash.
+ */
+struct SSimFlashStats {
+    uint64_t frames;        // --> chip select assertions.
+    uint64_t reads;         // --> read commands.
+    uint64_t readBytes;
+    uint64_t programs;      // --> page program commands.
+    uint64_t programBytes;
+    uint64_t sectorErases;
+    uint64_t halfBlockErases;   // --> 32 KB erases.
+    uint64_t blockErases;
+    uint64_t chipErases;
+    uint64_t ignored;       // --> commands ignored because BUSY or !WEL.
+    uint64_t suspends;      // --> erases and programs suspended.
+    uint64_t undefined;     // --> bytes read from the region of the suspended program or erase.
+    uint64_t stuckBits;     // --> bits that a program tried to raise 0 -> 1.
+    uint64_t busyTime;      // --> total time spent BUSY.
+};
+
+/**
+ * Description of a part, to build its SFDP tables.
+ */
+struct SSimSfdpDesc {
+    uint32_t capacity;          // --> bytes.
+    uint8_t pageShift;          // --> page size, 2 ^ N.
+    uint8_t eraseShift[4];      // --> erase types, 2 ^ N bytes, 0 if not.
+    uint8_t eraseOp[4];
+    uint8_t eraseOp4[4];        // --> 4-byte opcodes, the 4BAIT if any.
+    bool dual;                  // --> 1-1-2 and 1-2-2 reads.
+    bool quad;                  // --> 1-1-4 and 1-4-4 reads.
+    bool enter4B;               // --> enters the 4-byte address mode by 0xb7.
+};
+
+/**
+ * Simulated W25Qxx flash chip, RAM-backed.
+ * --
+ * 1. decodes the commands `W25QXX` issues: 0x9f, 0x05/0x35/0x15, 0x01/0x31/0x11,
+ *    0x06/0x04, 0x02/0x12, 0x03/0x0b/0x13/0x0c, 0x3b/0x3c/0x6b/0x6c, 0x20/0x21, 0x52/0x5c, 0xd8/0xdc, 0xc7, 0x4b,
+ *    0x5a (SFDP), 0xb7/0xe9 (4-byte address mode) and 0x75/0x7a (suspend, resume).
+ * 2. program only clears bits (erase-before-program), and wraps in the page.
+ * 3. program and erase start at the chip select rising, and set BUSY
+ *    for the datasheet duration. commands other than status reads are ignored while BUSY.
+ * 4. counts erase cycles per sector.
+ * 5. a program or erase suspends tSUS after 0x75, then reads are accepted
+ *    until 0x7a resumes it. a suspend earlier than tRS after the resume is ignored.
+ *    reads of the region under the suspended program or erase return undefined bytes.
+ * 6. a power cut tears the program or erase in progress: only the elapsed
+ *    fraction of it is applied, and the chip ignores everything after.
+ * 7. 0x3b/0x3c (1-1-2) and 0x6b/0x6c (1-1-4, SR2.QE required) take the opcode and
+ *    the address from `xfer`, then 8 dummy clocks and the data on IO0 ~ IO3 by `clock`:
+ *    the next bits are driven at each falling edge of SCK, MSB first on the highest line.
+ * The capacity is derived from the JEDEC ID (2 ^ low byte).
+ */
+class SimFlash : public SimSpiDevice {
+public:
+    static constexpr uint32_t PAGE_SIZE = 256;
+    static constexpr uint32_t SECTOR_SIZE = 0x1000;
+    static constexpr uint32_t BLOCK_SIZE = 0x10000;
+
+    /* typical and maximum timings of W25Q32JV. */
+    static const SSimFlashTiming TIMING_TYP;
+    static const SSimFlashTiming TIMING_MAX;
+
+private:
+    uint32_t _id;
+    uint64_t _uid;
+    std::vector<uint8_t> _mem;
+    std::vector<uint32_t> _erases;      // --> erase cycles per sector.
+
+    SSimFlashTiming _timing;
+    SSimFlashStats _stats;
+
+    std::vector<uint8_t> _sfdp;     // --> empty if the part has no SFDP.
+
+    uint8_t _sr[3];             // --> status registers, BUSY, WEL and ADS are computed.
+    bool _wel;
+    bool _addr4;                // --> 4-byte address mode.
+    uint64_t _busyFrom;
+    uint64_t _busyUntil;
+    uint64_t _busyTotal;        // --> duration of the program or erase, suspensions excluded.
+    bool _suspendable;          // --> the program or erase in progress can be suspended.
+    bool _suspended;
+    uint64_t _suspendLeft;      // --> time left when resumed.
+    uint64_t _resumedAt;
+    bool _off;
+
+    // --> contents before the program or erase in progress, to tear it.
+    uint32_t _undoAddr;
+    std::vector<uint8_t> _undo;
+
+    // --> frame state.
+    bool _sel;
+    uint8_t _cmd;
+    uint32_t _pos;
+    uint8_t _alen;              // --> address bytes of the command.
+    uint32_t _addr;
+    uint8_t _latch[PAGE_SIZE];  // --> page buffer of the program.
+    bool _latched[PAGE_SIZE];
+    uint32_t _latchCount;
+
+    // --> dual and quad output reads: lines, clocks after the address and the IO levels.
+    uint8_t _wide;
+    uint32_t _wideClocks;
+    uint8_t _wideByte;
+    uint8_t _io;                // --> driven levels, IO0 at bit 0.
+    uint8_t _ioDriven;          // --> driven lines, the others float high.
+
+public:
+    SimFlash(uint32_t jedecId = 0xef4016);
+
+public:
+    /* get the JEDEC ID. */
+    uint32_t id() const { return _id; }
+
+    /* get the capacity in bytes. */
+    uint32_t capacity() const { return uint32_t(_mem.size()); }
+
+    /* get the sector count. */
+    uint32_t sectors() const { return capacity() / SECTOR_SIZE; }
+
+    /* direct access to the array, for scenarios. */
+    uint8_t* data() { return _mem.data(); }
+    const uint8_t* data() const { return _mem.data(); }
+
+    /* set the timing model. */
+    void setTiming(const SSimFlashTiming& timing) { _timing = timing; }
+
+    /* set the SFDP tables, empty if the part has none. */
+    void setSfdp(const std::vector<uint8_t>& sfdp) { _sfdp = sfdp; }
+
+    /* describe a W25Qxx part of the capacity. */
+    static SSimSfdpDesc winbond(uint32_t capacity);
+
+    /* build the SFDP tables of the part: the BFPT (JESD216B) and the 4BAIT if any. */
+    static std::vector<uint8_t> makeSfdp(const SSimSfdpDesc& desc);
+
+    /* get the statistics. */
+    const SSimFlashStats& stats() const { return _stats; }
+
+    /* reset the statistics, erase counts are kept. */
+    void resetStats();
+
+    /* get the erase cycles of the sector. */
+    uint32_t erases(uint32_t sector) const;
+
+    /* get the max erase cycles of all sectors. */
+    uint32_t maxErases() const;
+
+    /* get the total erase cycles of all sectors. */
+    uint64_t totalErases() const;
+
+    /* test whether the chip is busy at the calling core's time. */
+    bool busy() const;
+
+    /* power on again after a power cut. */
+    void powerOn() { _off = false; }
+
+public:
+    void select() override;
+    void deselect() override;
+    uint8_t xfer(uint8_t data) override;
+    void powerCut() override;
+
+    /* a falling edge of SCK, clocked by the PIO: the next bits of the dual or quad read. */
+    void clock();
+
+    /* get the level of the IO line: 0 ~ 3, high if not driven. */
+    bool io(uint8_t line) const;
+
+private:
+    uint8_t status(uint8_t n) const;
+    uint8_t addressBytes(uint8_t cmd) const;
+    bool isAccepted(uint8_t cmd) const;
+
+    void setBusy(uint64_t duration, bool suspendable = false);
+    uint64_t busyLeft(uint64_t now) const;
+    void suspend();
+    void resume();
+    void keepUndo(uint32_t addr, uint32_t len);
+
+    /* read the byte at the address: undefined if under the suspended program or erase. */
+    uint8_t cell(uint32_t addr);
+
+    void program();
+    void erase(uint32_t addr, uint32_t len);
+};
+
+#endif
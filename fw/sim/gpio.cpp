@@ -0,0 +1,210 @@
+#include "gpio.h"
+#include "clock.h"
+#include <atomic>
+
+static std::atomic<bool> g_simGpioLevel[SimGpio::MAX_PINS];
+static std::atomic<bool> g_simGpioOut[SimGpio::MAX_PINS];
+static std::atomic<uint8_t> g_simGpioFunc[SimGpio::MAX_PINS];
+static SimGpio::Input g_simGpioInputs[SimGpio::MAX_PINS];
+static SimGpio::Output g_simGpioOutputs[SimGpio::MAX_PINS];
+static SimGpio::Next g_simGpioNexts[SimGpio::MAX_PINS];
+
+// --> interrupts: the events armed per pin, owned by the core that armed them.
+static std::atomic<uint32_t> g_simGpioArmed(0);
+static uint32_t g_simGpioIrq[SimGpio::MAX_PINS];
+static uint8_t g_simGpioIrqCore[SimGpio::MAX_PINS];
+static bool g_simGpioLast[SimGpio::MAX_PINS];
+static SimGpio::Irq g_simGpioIrqFn[SimClock::MAX_CORES];
+static bool g_simGpioEvent[SimClock::MAX_CORES];
+static thread_local bool t_simGpioInIrq = false;
+static thread_local uint64_t t_simGpioSampleAt = 0;
+
+void SimGpio::reset() {
+    for(uint8_t i = 0; i < MAX_PINS; ++i) {
+        g_simGpioLevel[i].store(false);
+        g_simGpioOut[i].store(false);
+        g_simGpioFunc[i].store(0x1f);
+        g_simGpioInputs[i] = nullptr;
+        g_simGpioOutputs[i] = nullptr;
+        g_simGpioNexts[i] = nullptr;
+    }
+
+    resetIrqs();
+}
+
+void SimGpio::attachInput(uint8_t pin, const Input& fn, const Next& next) {
+    if (pin < MAX_PINS) {
+        g_simGpioInputs[pin] = fn;
+        g_simGpioNexts[pin] = next;
+    }
+}
+
+void SimGpio::attachOutput(uint8_t pin, const Output& fn) {
+    if (pin < MAX_PINS) {
+        g_simGpioOutputs[pin] = fn;
+    }
+}
+
+bool SimGpio::level(uint8_t pin) {
+    if (pin >= MAX_PINS) {
+        return false;
+    }
+
+    return g_simGpioLevel[pin].load(std::memory_order_acquire);
+}
+
+bool SimGpio::isOutput(uint8_t pin) {
+    if (pin >= MAX_PINS) {
+        return false;
+    }
+
+    return g_simGpioOut[pin].load(std::memory_order_acquire);
+}
+
+uint8_t SimGpio::function(uint8_t pin) {
+    if (pin >= MAX_PINS) {
+        return 0x1f;
+    }
+
+    return g_simGpioFunc[pin].load(std::memory_order_acquire);
+}
+
+void SimGpio::setFunction(uint8_t pin, uint8_t fn) {
+    if (pin < MAX_PINS) {
+        g_simGpioFunc[pin].store(fn);
+    }
+}
+
+void SimGpio::setDir(uint8_t pin, bool out) {
+    if (pin < MAX_PINS) {
+        g_simGpioOut[pin].store(out);
+    }
+}
+
+void SimGpio::put(uint8_t pin, bool value) {
+    if (pin >= MAX_PINS) {
+        return;
+    }
+
+    g_simGpioLevel[pin].store(value, std::memory_order_release);
+    if (g_simGpioOutputs[pin]) {
+        g_simGpioOutputs[pin](value);
+    }
+}
+
+bool SimGpio::get(uint8_t pin) {
+    if (pin >= MAX_PINS) {
+        return false;
+    }
+
+    if (g_simGpioInputs[pin] && !isOutput(pin)) {
+        return g_simGpioInputs[pin]();
+    }
+
+    return level(pin);
+}
+
+void SimGpio::setSampleTime(uint64_t at) {
+    t_simGpioSampleAt = at;
+}
+
+uint64_t SimGpio::sampleTime() {
+    return t_simGpioSampleAt ? t_simGpioSampleAt : SimClock::now();
+}
+
+void SimGpio::resetIrqs() {
+    for(uint8_t i = 0; i < MAX_PINS; ++i) {
+        g_simGpioIrq[i] = 0;
+    }
+
+    for(uint8_t i = 0; i < SimClock::MAX_CORES; ++i) {
+        g_simGpioIrqFn[i] = nullptr;
+        g_simGpioEvent[i] = false;
+    }
+
+    g_simGpioArmed.store(0);
+}
+
+void SimGpio::setIrq(uint8_t pin, uint32_t events, bool enabled) {
+    if (pin >= MAX_PINS) {
+        return;
+    }
+
+    const uint32_t prev = g_simGpioIrq[pin];
+    events &= IRQ_EDGE_FALL | IRQ_EDGE_RISE;
+
+    g_simGpioIrq[pin] = enabled ? (prev | events) : (prev & ~events);
+    g_simGpioIrqCore[pin] = SimClock::core();
+
+    // --> the edges before enabling are acknowledged, like the SDK does.
+    g_simGpioLast[pin] = get(pin);
+
+    if (!prev && g_simGpioIrq[pin]) {
+        g_simGpioArmed.fetch_add(1);
+    }
+
+    else if (prev && !g_simGpioIrq[pin]) {
+        g_simGpioArmed.fetch_sub(1);
+    }
+}
+
+void SimGpio::setIrqCallback(Irq fn) {
+    g_simGpioIrqFn[SimClock::core()] = fn;
+}
+
+void SimGpio::poll() {
+    if (!g_simGpioArmed.load(std::memory_order_relaxed) || t_simGpioInIrq) {
+        return;
+    }
+
+    const uint8_t core = SimClock::core();
+    t_simGpioInIrq = true;
+
+    for(uint8_t i = 0; i < MAX_PINS; ++i) {
+        if (!g_simGpioIrq[i] || g_simGpioIrqCore[i] != core) {
+            continue;
+        }
+
+        const bool level = get(i);
+        const bool last = g_simGpioLast[i];
+
+        if (level == last) {
+            continue;
+        }
+
+        g_simGpioLast[i] = level;
+
+        const uint32_t events = g_simGpioIrq[i] & (level ? IRQ_EDGE_RISE : IRQ_EDGE_FALL);
+        if (events && g_simGpioIrqFn[core]) {
+            g_simGpioIrqFn[core](i, events);
+            g_simGpioEvent[core] = true;
+        }
+    }
+
+    t_simGpioInIrq = false;
+}
+
+bool SimGpio::takeEvent() {
+    const uint8_t core = SimClock::core();
+    const bool event = g_simGpioEvent[core];
+
+    g_simGpioEvent[core] = false;
+    return event;
+}
+
+uint64_t SimGpio::nextChange() {
+    uint64_t next = UINT64_MAX;
+
+    for(uint8_t i = 0; i < MAX_PINS; ++i) {
+        if (!g_simGpioIrq[i] || !g_simGpioNexts[i]) {
+            continue;
+        }
+
+        const uint64_t at = g_simGpioNexts[i]();
+        if (at < next) {
+            next = at;
+        }
+    }
+
+    return next;
+}
@@ -0,0 +1,96 @@
+#ifndef __SIM_GPIO_H__
+#define __SIM_GPIO_H__
+
+#include <stdint.h>
+#include <functional>
+
+/**
+ * Simulated GPIO bank.
+ * Input pins can be driven by a board model (e.g. the key matrix),
+ * and output pins can notify a board model (e.g. SPI chip select).
+ *
+ * --
+ * Edge interrupts are sampled by `poll()`, which the timer and TinyUSB
+ * stand-ins call: the firmware sees the edge by its next call of them,
+ * as if the interrupt was taken between two statements. Level events
+ * are not modelled.
+ */
+class SimGpio {
+public:
+    static constexpr uint8_t MAX_PINS = 30;
+
+    typedef std::function<bool()> Input;
+    typedef std::function<void(bool)> Output;
+    typedef std::function<uint64_t()> Next;
+    typedef void (*Irq)(unsigned int pin, uint32_t events);
+
+    // --> `gpio_irq_level` bits.
+    static constexpr uint32_t IRQ_EDGE_FALL = 0x4;
+    static constexpr uint32_t IRQ_EDGE_RISE = 0x8;
+
+public:
+    /* detach all models and reset all levels. */
+    static void reset();
+
+    /**
+     * attach a model that drives the input pin.
+     * `next` tells the time the level may change next, UINT64_MAX if never:
+     * a core waiting for an interrupt sleeps until then.
+     */
+    static void attachInput(uint8_t pin, const Input& fn, const Next& next = nullptr);
+
+    /* attach a model that listens the output pin. */
+    static void attachOutput(uint8_t pin, const Output& fn);
+
+public:
+    /* get the level that the firmware drove last. */
+    static bool level(uint8_t pin);
+
+    /* test whether the pin is an output or not. */
+    static bool isOutput(uint8_t pin);
+
+    /* get the function of the pin, `gpio_function`. */
+    static uint8_t function(uint8_t pin);
+
+    /* set the function of the pin. */
+    static void setFunction(uint8_t pin, uint8_t fn);
+
+    /* set the pin direction. */
+    static void setDir(uint8_t pin, bool out);
+
+    /* drive the output pin. */
+    static void put(uint8_t pin, bool value);
+
+    /* sample the pin. */
+    static bool get(uint8_t pin);
+
+    /**
+     * set the time the input models sample at, on the calling core: a PIO state machine
+     * runs behind or ahead of the core. zero to sample at the core's time.
+     */
+    static void setSampleTime(uint64_t at);
+
+    /* get the time the input models sample at. */
+    static uint64_t sampleTime();
+
+public:
+    /* disarm all interrupts, on a power-on. */
+    static void resetIrqs();
+
+    /* enable or disable the edge events of the pin, delivered to the calling core. */
+    static void setIrq(uint8_t pin, uint32_t events, bool enabled);
+
+    /* set the interrupt callback of the calling core. */
+    static void setIrqCallback(Irq fn);
+
+    /* deliver the edges of the armed pins since the last poll, on the calling core. */
+    static void poll();
+
+    /* test whether an interrupt was taken since the last call, and clear it: the event register. */
+    static bool takeEvent();
+
+    /* get the earliest time an armed pin may change, UINT64_MAX if never. */
+    static uint64_t nextChange();
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "keytrace.h"
+#include "clock.h"
+
+SimTraceScanner::SimTraceScanner(const SimKeyTrace& trace)
+    : _play(&trace), _pos(0), _source(nullptr), _record(nullptr), _busy(0)
+{
+}
+
+SimTraceScanner::SimTraceScanner(KeyScanner* source, SimKeyTrace& trace)
+    : _play(nullptr), _pos(0), _source(source), _record(&trace), _busy(0)
+{
+}
+
+void SimTraceScanner::start(uint32_t period) {
+    if (_source) {
+        const uint64_t from = SimClock::busy(0);
+
+        _source->start(period);
+        _busy += SimClock::busy(0) - from;
+        return;
+    }
+
+    const uint64_t now = SimClock::now() / SimClock::US;
+    while (_pos < _play->size() && (*_play)[_pos].at < now) {
+        _pos++;
+    }
+}
+
+void SimTraceScanner::stop() {
+    if (_source) {
+        const uint64_t from = SimClock::busy(0);
+
+        _source->stop();
+        _busy += SimClock::busy(0) - from;
+    }
+}
+
+bool SimTraceScanner::take(SKeyScan& scan, uint64_t now) {
+    if (_source) {
+        const uint64_t from = SimClock::busy(0);
+        const bool taken = _source->take(scan, now);
+
+        _busy += SimClock::busy(0) - from;
+        if (taken) {
+            _record->push_back(scan);
+        }
+
+        return taken;
+    }
+
+    if (_pos >= _play->size() || (*_play)[_pos].at > now) {
+        return false;
+    }
+
+    scan = (*_play)[_pos++];
+    return true;
+}
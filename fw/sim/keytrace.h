@@ -0,0 +1,48 @@
+#ifndef __SIM_KEYTRACE_H__
+#define __SIM_KEYTRACE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "drivers/keyscan.h"
+
+/**
+ * Recorded matrix trace: the snapshots of a scanner, in time order.
+ */
+typedef std::vector<SKeyScan> SimKeyTrace;
+
+/**
+ * Key scanner stand-in, for the `Keyboard` on the host.
+ * --
+ * 1. replays a trace: a snapshot is taken once its time comes, so the keyboard
+ *    sees the recorded matrix without the GPIO or the PIO. a start skips the
+ *    snapshots before it, like a scanner stopped meanwhile.
+ * 2. records another scanner: the snapshots taken pass through, appended to
+ *    the trace, and the busy time of the core 0 in the scanner is counted.
+ */
+class SimTraceScanner : public KeyScanner {
+private:
+    const SimKeyTrace* _play;
+    size_t _pos;
+
+    KeyScanner* _source;
+    SimKeyTrace* _record;
+    uint64_t _busy;             // --> nanoseconds in the source.
+
+public:
+    /* replay the trace. */
+    SimTraceScanner(const SimKeyTrace& trace);
+
+    /* record the snapshots of the source into the trace. */
+    SimTraceScanner(KeyScanner* source, SimKeyTrace& trace);
+
+public:
+    void start(uint32_t period) override;
+    void stop() override;
+    bool take(SKeyScan& scan, uint64_t now) override;
+
+    /* get the busy time of the core 0 in the source, nanoseconds. */
+    uint64_t busy() const { return _busy; }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "scenarios/scenarios.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Scenario entry.
+ */
+struct SSimScenario {
+    const char* name;
+    const char* desc;
+    int (*run)();
+};
+
+static const SSimScenario SCENARIOS[] = {
+    { "typing",     "scan-to-report latency while typing",          simTyping },
+    { "cdc",        "CDC echo round-trip time and throughput",      simCdc },
+    { "save",       "main-loop stalls and flash wear of config saves", simSave },
+    { "journal",    "wrap-around and mount time of the config journal", simJournal },
+    { "powercut",   "config store against power cuts at every SPI transaction", simPowerCut },
+    { "dma",        "CPU cost per KB of blocking vs DMA flash transfers", simDma },
+    { "framing",    "per-transaction overhead of the W25QXX command framing", simFraming },
+    { "clock",      "SPI clock tuning of the flash on the wirings", simClock },
+    { "sfdp",       "flash geometry discovery from the SFDP tables", simSfdp },
+    { "erase",      "erase time of the storage regions, sector by sector vs planned", simErase },
+    { "suspend",    "read latency under a running erase or program, suspended vs waited", simSuspend },
+    { "update",     "erases avoided by compare-and-program over edit sessions", simUpdate },
+    { "cache",      "read latency of access traces with and without the page cache", simCache },
+    { "pio",        "read throughput on the SPI and on the PIO, dual and quad", simPio },
+    { "fs",         "filesystem throughput and mount time on the capacities, wear and power cuts", simFs },
+    { "scrub",      "HID latency under the flash scrubber, its detection and repair of bit rot", simScrub },
+    { "stream",     "underruns of the macro playback streamed from the flash vs blocking reads", simStream },
+    { "idle",       "idle duty cycle and first-press latency, matrix polled vs interrupt wait", simIdle },
+    { "scanrate",   "scan-to-report latency at the scan periods set over CDC", simScanRate },
+    { "scanpio",    "CPU cost and timestamps of the matrix scanned by the CPU vs the PIO", simScanPio },
+    { "debounce",   "added latency and false events of the debounce algorithms on noisy traces", simDebounce },
+    { "calibrate",  "per-key debounce windows calibrated from the bounces, read over CDC", simCalibrate },
+    { "keystate",   "update cost per scan of the bitset key states vs the linear ones, matrix scaled up", simKeyState },
+    { "scansize",   "CPU cost of a scan of the matrix as it grows, a read per column vs per row", simScanSize },
+    { "events",     "bursts of key events read on both cores, and fast taps seen by the host once each", simKeyEvents },
+};
+
+static void usage(const char* self) {
+    printf("usage: %s <scenario | all>\n\n", self);
+
+    for(const SSimScenario& each : SCENARIOS) {
+        printf("  %-14s %s\n", each.name, each.desc);
+    }
+}
+
+static int run(const SSimScenario& scenario) {
+    printf("== %s: %s\n", scenario.name, scenario.desc);
+
+    const int retval = scenario.run();
+    printf("== %s: %s\n\n", scenario.name, retval ? "FAIL" : "OK");
+
+    return retval;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int failed = 0;
+    bool found = false;
+
+    for(const SSimScenario& each : SCENARIOS) {
+        if (strcmp(argv[1], "all") && strcmp(argv[1], each.name)) {
+            continue;
+        }
+
+        found = true;
+        if (run(each)) {
+            failed++;
+        }
+    }
+
+    if (!found) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+#include "matrix.h"
+#include "clock.h"
+#include "gpio.h"
+#include <string.h>
+#include <algorithm>
+
+SimMatrix::SimMatrix(const uint8_t* rows, uint8_t nrows, const uint8_t* cols, uint8_t ncols)
+    : _rows(rows), _cols(cols), _nrows(nrows), _ncols(ncols), _next(0)
+{
+    memset(_state, 0, sizeof(_state));
+}
+
+void SimMatrix::attach() {
+    for(uint8_t i = 0; i < _ncols; ++i) {
+        SimGpio::attachInput(_cols[i], [this, i]() { return sample(i); }, [this]() { return nextEdge(); });
+    }
+}
+
+void SimMatrix::press(uint8_t key, uint64_t at) {
+    edge(key, at, 1);
+}
+
+void SimMatrix::release(uint8_t key, uint64_t at) {
+    edge(key, at, 0);
+}
+
+void SimMatrix::tap(uint8_t key, uint64_t at, uint64_t hold) {
+    edge(key, at, 1);
+    edge(key, at + hold, 0);
+}
+
+bool SimMatrix::pressed(uint8_t key) {
+    if (key >= MAX_KEYS) {
+        return false;
+    }
+
+    advance();
+    return _state[key];
+}
+
+uint64_t SimMatrix::nextEdge() {
+    advance();
+
+    if (_next < _edges.size()) {
+        return _edges[_next].at;
+    }
+
+    return UINT64_MAX;
+}
+
+void SimMatrix::edge(uint8_t key, uint64_t at, uint8_t down) {
+    if (key >= keys()) {
+        return;
+    }
+
+    SSimKeyEdge edge = { at, key, down };
+
+    // --> keep edges in time order, stable for the same time.
+    auto pos = std::upper_bound(_edges.begin() + _next, _edges.end(), edge,
+        [](const SSimKeyEdge& a, const SSimKeyEdge& b) { return a.at < b.at; });
+
+    _edges.insert(pos, edge);
+}
+
+void SimMatrix::advance() {
+    const uint64_t now = SimClock::now();
+
+    while (_next < _edges.size() && _edges[_next].at <= now) {
+        const SSimKeyEdge& edge = _edges[_next++];
+        _state[edge.key] = edge.down != 0;
+    }
+}
+
+bool SimMatrix::sample(uint8_t col) {
+    const uint64_t at = SimGpio::sampleTime();
+    advance();
+
+    for(uint8_t row = 0; row < _nrows; ++row) {
+        if (SimGpio::level(_rows[row]) && stateAt(row * _ncols + col, at)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SimMatrix::stateAt(uint8_t key, uint64_t at) {
+    bool state = _state[key];
+
+    // --> behind: undo the edges after it, the presses and releases alternate.
+    for(size_t i = _next; i-- > 0 && _edges[i].at > at; ) {
+        if (_edges[i].key == key) {
+            state = _edges[i].down == 0;
+        }
+    }
+
+    // --> ahead: apply the edges until it.
+    for(size_t i = _next; i < _edges.size() && _edges[i].at <= at; ++i) {
+        if (_edges[i].key == key) {
+            state = _edges[i].down != 0;
+        }
+    }
+
+    return state;
+}
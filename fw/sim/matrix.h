@@ -0,0 +1,73 @@
+#ifndef __SIM_MATRIX_H__
+#define __SIM_MATRIX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Key edge, scripted by a scenario.
+ */
+struct SSimKeyEdge {
+    uint64_t at;        // --> virtual time of the edge.
+    uint8_t key;        // --> row * cols + col.
+    uint8_t down;       // --> 1: pressed, 0: released.
+};
+
+/**
+ * Simulated key matrix.
+ * A column reads high while its row is driven high and the key is pressed,
+ * the switches themselves are ideal (no bounce).
+ */
+class SimMatrix {
+public:
+    static constexpr uint8_t MAX_KEYS = 128;
+
+private:
+    const uint8_t* _rows;
+    const uint8_t* _cols;
+    uint8_t _nrows, _ncols;
+
+    std::vector<SSimKeyEdge> _edges;
+    size_t _next;
+    bool _state[MAX_KEYS];
+
+public:
+    SimMatrix(const uint8_t* rows, uint8_t nrows, const uint8_t* cols, uint8_t ncols);
+
+public:
+    /* attach the matrix to the GPIO bank. */
+    void attach();
+
+    /* get the number of keys. */
+    uint8_t keys() const { return _nrows * _ncols; }
+
+    /* get all scripted edges, in time order. */
+    const std::vector<SSimKeyEdge>& edges() const { return _edges; }
+
+public:
+    /* script a press. */
+    void press(uint8_t key, uint64_t at);
+
+    /* script a release. */
+    void release(uint8_t key, uint64_t at);
+
+    /* script a press and a release. */
+    void tap(uint8_t key, uint64_t at, uint64_t hold);
+
+    /* test whether the key is pressed at the calling core's time. */
+    bool pressed(uint8_t key);
+
+    /* get the time of the next scripted edge, UINT64_MAX if none. */
+    uint64_t nextEdge();
+
+private:
+    void edge(uint8_t key, uint64_t at, uint8_t down);
+    void advance();
+    bool sample(uint8_t col);
+
+    /* the key state at the time, before or after the calling core's. */
+    bool stateAt(uint8_t key, uint64_t at);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "multicore.h"
+#include "clock.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+static std::mutex g_simFifoLock;
+static std::condition_variable g_simFifoCond;
+
+// --> [n]: words sent to the core n, with the push time.
+static std::deque<std::pair<uint32_t, uint64_t>> g_simFifo[SimClock::MAX_CORES];
+static std::thread g_simCore1;
+
+void SimMulticore::launch(void (*entry)(void)) {
+    join();
+
+    const uint64_t at = SimClock::now();
+    SimClock::launch(1, at);
+
+    g_simCore1 = std::thread([entry]() {
+        SimClock::bind(1);
+
+        try {
+            entry();
+        }
+
+        catch (const SimHalt&) {
+        }
+
+        SimClock::park();
+    });
+}
+
+void SimMulticore::join() {
+    if (g_simCore1.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(g_simFifoLock);
+            g_simFifoCond.notify_all();
+        }
+
+        g_simCore1.join();
+    }
+
+    std::lock_guard<std::mutex> guard(g_simFifoLock);
+    for(auto& each : g_simFifo) {
+        each.clear();
+    }
+}
+
+void SimMulticore::push(uint32_t data) {
+    const uint8_t other = SimClock::core() ^ 1;
+
+    std::lock_guard<std::mutex> guard(g_simFifoLock);
+    g_simFifo[other].push_back(std::make_pair(data, SimClock::now()));
+    g_simFifoCond.notify_all();
+}
+
+uint32_t SimMulticore::pop() {
+    auto& fifo = g_simFifo[SimClock::core()];
+    std::unique_lock<std::mutex> guard(g_simFifoLock);
+
+    SimClock::park();
+    while (fifo.empty() && !SimClock::stopped()) {
+        g_simFifoCond.wait_for(guard, std::chrono::milliseconds(10));
+    }
+
+    if (fifo.empty()) {
+        guard.unlock();
+        SimClock::checkpoint();
+        return 0;
+    }
+
+    const auto word = fifo.front();
+    fifo.pop_front();
+    guard.unlock();
+
+    // --> the word can not be seen before it is pushed.
+    SimClock::unpark(word.second);
+    return word.first;
+}
+
+bool SimMulticore::readable() {
+    std::lock_guard<std::mutex> guard(g_simFifoLock);
+    return !g_simFifo[SimClock::core()].empty();
+}
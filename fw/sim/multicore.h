@@ -0,0 +1,27 @@
+#ifndef __SIM_MULTICORE_H__
+#define __SIM_MULTICORE_H__
+
+#include <stdint.h>
+
+/**
+ * Simulated inter-core FIFOs and the core 1 thread.
+ */
+class SimMulticore {
+public:
+    /* launch the core 1 thread. */
+    static void launch(void (*entry)(void));
+
+    /* wait for the core 1 thread to halt, then clear both FIFOs. */
+    static void join();
+
+    /* push a word to the other core. */
+    static void push(uint32_t data);
+
+    /* pop a word from the other core, the calling core is parked while waiting. */
+    static uint32_t pop();
+
+    /* test whether the calling core can pop or not. */
+    static bool readable();
+};
+
+#endif
@@ -0,0 +1,438 @@
+#include "pio.h"
+#include "clock.h"
+#include "gpio.h"
+#include <hardware/gpio.h>
+#include <string.h>
+
+static sim_pio g_simPio[NUM_PIOS];
+static uint64_t g_simPioExecuted = 0;
+
+pio_hw_t* const sim_pio0 = &g_simPio[0];
+pio_hw_t* const sim_pio1 = &g_simPio[1];
+
+/* get the mask of the pins from the base, wrapping at 32. */
+static uint32_t SimPio_Mask(uint8_t base, uint8_t count) {
+    const uint32_t bits = count >= 32 ? 0xffffffff : ((1u << count) - 1);
+    base &= 31;
+
+    return base ? ((bits << base) | (bits >> (32 - base))) : bits;
+}
+
+/* rotate the value to the pins from the base. */
+static uint32_t SimPio_Rotate(uint32_t value, uint8_t base) {
+    base &= 31;
+    return base ? ((value << base) | (value >> (32 - base))) : value;
+}
+
+/* reverse the bits. */
+static uint32_t SimPio_Reverse(uint32_t value) {
+    uint32_t out = 0;
+
+    for(uint32_t i = 0; i < 32; ++i) {
+        out = (out << 1) | ((value >> i) & 1);
+    }
+
+    return out;
+}
+
+void SimPio::reset() {
+    memset(g_simPio, 0, sizeof(g_simPio));
+    g_simPioExecuted = 0;
+
+    for(uint8_t i = 0; i < NUM_PIOS; ++i) {
+        g_simPio[i].index = i;
+
+        for(SSimPioSm& each : g_simPio[i].sm) {
+            each.osrCount = 32;
+        }
+    }
+}
+
+PIO SimPio::get(uint8_t index) {
+    if (index >= NUM_PIOS) {
+        return nullptr;
+    }
+
+    return &g_simPio[index];
+}
+
+SSimPioSm* SimPio::sm(PIO pio, uint index) {
+    if (!pio || index >= NUM_PIO_STATE_MACHINES) {
+        return nullptr;
+    }
+
+    return &pio->sm[index];
+}
+
+void SimPio::route(uint8_t pin) {
+    const uint8_t fn = SimGpio::function(pin);
+    if (fn != GPIO_FUNC_PIO0 && fn != GPIO_FUNC_PIO1) {
+        return;
+    }
+
+    const PIO pio = &g_simPio[fn - GPIO_FUNC_PIO0];
+    const bool out = (pio->dirs >> pin) & 1;
+
+    SimGpio::setDir(pin, out);
+    if (out) {
+        SimGpio::put(pin, (pio->levels >> pin) & 1);
+    }
+}
+
+void SimPio::drive(PIO pio, uint32_t values, uint32_t mask) {
+    pio->levels = (pio->levels & ~mask) | (values & mask);
+
+    for(uint8_t pin = 0; pin < SimGpio::MAX_PINS; ++pin) {
+        if (!((mask >> pin) & 1) || !((pio->dirs >> pin) & 1)) {
+            continue;
+        }
+
+        if (SimGpio::function(pin) == GPIO_FUNC_PIO0 + pio->index) {
+            SimGpio::put(pin, (pio->levels >> pin) & 1);
+        }
+    }
+}
+
+void SimPio::direct(PIO pio, uint32_t dirs, uint32_t mask) {
+    pio->dirs = (pio->dirs & ~mask) | (dirs & mask);
+
+    for(uint8_t pin = 0; pin < SimGpio::MAX_PINS; ++pin) {
+        if ((mask >> pin) & 1) {
+            if (SimGpio::function(pin) == GPIO_FUNC_PIO0 + pio->index) {
+                route(pin);
+            }
+        }
+    }
+}
+
+void SimPio::run(PIO pio, SSimPioSm* sm, const std::function<bool()>& done) {
+    const uint64_t deadline = SimClock::deadline() * 256;
+
+    // --> a program that never stalls runs until the end of the run.
+    while (!done() && sm->enabled && sm->time < deadline) {
+        if (!step(pio, sm)) {
+            return;
+        }
+    }
+}
+
+SSimPioSm* SimPio::byRxDreq(uint dreq, PIO* pio) {
+    // --> 4 TX, then 4 RX per block.
+    if (dreq >= NUM_PIOS * NUM_PIO_STATE_MACHINES * 2 || (dreq & 4) == 0) {
+        return nullptr;
+    }
+
+    *pio = &g_simPio[dreq / 8];
+    return &(*pio)->sm[dreq & 3];
+}
+
+uint64_t SimPio::executed() {
+    return g_simPioExecuted;
+}
+
+bool SimPio::step(PIO pio, SSimPioSm* sm) {
+    const pio_sm_config& c = sm->config;
+    const uint16_t op = pio->code[sm->pc];
+    const uint8_t kind = uint8_t(op >> 13);
+    const uint8_t field = uint8_t((op >> 8) & 0x1f);
+    const uint8_t delay = uint8_t(field & ((1u << (5 - c.sideset_bits)) - 1));
+
+    // --> through the synchronizers: the levels before this instruction drives.
+    uint32_t pins = 0;
+    if (kind == 2 && ((op >> 5) & 7) == 0) {
+        pins = sample(c.in_base, (op & 0x1f) ? (op & 0x1f) : 32, sm->time / 256);
+    }
+
+    else if ((kind == 5 && (op & 7) == 0) || (kind == 1 && ((op >> 5) & 3) == 1)) {
+        pins = sample(c.in_base, 32, sm->time / 256);
+    }
+
+    // --> the side-set applies even if the instruction stalls.
+    const uint8_t sideBits = uint8_t(c.sideset_bits - (c.sideset_optional ? 1 : 0));
+    if (sideBits && (!c.sideset_optional || (field & 0x10))) {
+        const uint32_t value = (field >> (5 - c.sideset_bits)) & ((1u << sideBits) - 1);
+        drive(pio, SimPio_Rotate(value, c.sideset_base), SimPio_Mask(c.sideset_base, sideBits));
+    }
+
+    uint8_t next = sm->pc == c.wrap ? c.wrap_target : uint8_t((sm->pc + 1) & 31);
+    const uint8_t count = (op & 0x1f) ? (op & 0x1f) : 32;
+
+    switch(kind) {
+        case 0: { // --> JMP.
+            bool take = false;
+
+            switch((op >> 5) & 7) {
+                case 0: take = true; break;
+                case 1: take = sm->x == 0; break;
+                case 2: take = sm->x != 0; sm->x--; break;
+                case 3: take = sm->y == 0; break;
+                case 4: take = sm->y != 0; sm->y--; break;
+                case 5: take = sm->x != sm->y; break;
+                case 6: take = SimGpio::get(c.jmp_pin); break;
+                default: take = sm->osrCount < (c.pull_threshold ? c.pull_threshold : 32); break;
+            }
+
+            if (take) {
+                next = uint8_t(op & 0x1f);
+            }
+            break;
+        }
+
+        case 1: { // --> WAIT.
+            const bool polarity = (op >> 7) & 1;
+            const uint8_t index = op & 0x1f;
+            bool level;
+
+            switch((op >> 5) & 3) {
+                case 0: level = SimGpio::get(index); break;
+                case 1: level = (pins >> index) & 1; break;
+                default: return false;
+            }
+
+            if (level != polarity) {
+                return false;
+            }
+            break;
+        }
+
+        case 2: { // --> IN.
+            uint32_t data = 0;
+
+            switch((op >> 5) & 7) {
+                case 0: data = pins; break;
+                case 1: data = sm->x; break;
+                case 2: data = sm->y; break;
+                case 6: data = sm->isr; break;
+                case 7: data = sm->osr; break;
+                default: break;
+            }
+
+            if (count < 32) {
+                data &= (1u << count) - 1;
+            }
+
+            if (!shiftIn(sm, data, count)) {
+                return false;
+            }
+            break;
+        }
+
+        case 3: { // --> OUT.
+            uint32_t data;
+
+            if (((op >> 5) & 7) == 7 || !shiftOut(sm, count, &data)) {
+                return false;
+            }
+
+            switch((op >> 5) & 7) {
+                case 0: drive(pio, SimPio_Rotate(data, c.out_base), SimPio_Mask(c.out_base, c.out_count)); break;
+                case 1: sm->x = data; break;
+                case 2: sm->y = data; break;
+                case 4: direct(pio, SimPio_Rotate(data, c.out_base), SimPio_Mask(c.out_base, c.out_count)); break;
+                case 5: next = uint8_t(data & 31); break;
+                case 6: sm->isr = data; sm->isrCount = count; break;
+                default: break;
+            }
+            break;
+        }
+
+        case 4: { // --> PUSH, PULL.
+            const bool conditional = (op >> 6) & 1;
+            const bool block = (op >> 5) & 1;
+
+            if (op & 0x80) {
+                if (conditional && sm->osrCount < (c.pull_threshold ? c.pull_threshold : 32)) {
+                    break;
+                }
+
+                if (!pull(sm, block)) {
+                    return false;
+                }
+            }
+
+            else {
+                if (conditional && sm->isrCount < (c.push_threshold ? c.push_threshold : 32)) {
+                    break;
+                }
+
+                if (!push(sm, block)) {
+                    return false;
+                }
+            }
+            break;
+        }
+
+        case 5: { // --> MOV.
+            uint32_t data = 0;
+
+            switch(op & 7) {
+                case 0: data = pins; break;
+                case 1: data = sm->x; break;
+                case 2: data = sm->y; break;
+                case 6: data = sm->isr; break;
+                case 7: data = sm->osr; break;
+                default: break;
+            }
+
+            switch((op >> 3) & 3) {
+                case 1: data = ~data; break;
+                case 2: data = SimPio_Reverse(data); break;
+                default: break;
+            }
+
+            switch((op >> 5) & 7) {
+                case 0: drive(pio, SimPio_Rotate(data, c.out_base), SimPio_Mask(c.out_base, c.out_count)); break;
+                case 1: sm->x = data; break;
+                case 2: sm->y = data; break;
+                case 5: next = uint8_t(data & 31); break;
+                case 6: sm->isr = data; sm->isrCount = 0; break;
+                case 7: sm->osr = data; sm->osrCount = 0; break;
+                case 4: return false;
+                default: break;
+            }
+            break;
+        }
+
+        case 6: // --> IRQ.
+            break;
+
+        default: { // --> SET.
+            const uint32_t data = op & 0x1f;
+
+            switch((op >> 5) & 7) {
+                case 0: drive(pio, SimPio_Rotate(data, c.set_base), SimPio_Mask(c.set_base, c.set_count)); break;
+                case 1: sm->x = data; break;
+                case 2: sm->y = data; break;
+                case 4: direct(pio, SimPio_Rotate(data, c.set_base), SimPio_Mask(c.set_base, c.set_count)); break;
+                default: break;
+            }
+            break;
+        }
+    }
+
+    // --> 8 ns per cycle of the system clock, times the divider (16.8).
+    sm->pc = next;
+    sm->time += uint64_t(1 + delay) * c.clkdiv * 8;
+    g_simPioExecuted++;
+    return true;
+}
+
+uint32_t SimPio::sample(uint8_t base, uint8_t count, uint64_t at) {
+    uint32_t pins = 0;
+
+    // --> the models see the time of the state machine, behind or ahead of the core.
+    SimGpio::setSampleTime(at);
+
+    for(uint8_t i = 0; i < count; ++i) {
+        if (SimGpio::get(uint8_t((base + i) & 31))) {
+            pins |= 1u << i;
+        }
+    }
+
+    SimGpio::setSampleTime(0);
+    return pins;
+}
+
+bool SimPio::shiftIn(SSimPioSm* sm, uint32_t data, uint8_t count) {
+    const pio_sm_config& c = sm->config;
+    const uint8_t threshold = c.push_threshold ? c.push_threshold : 32;
+
+    // --> stalls before shifting if the autopush can't.
+    if (c.autopush && sm->isrCount + count >= threshold && sm->rxCount >= 4) {
+        return false;
+    }
+
+    if (count >= 32) {
+        sm->isr = data;
+    }
+
+    else if (c.in_shift_right) {
+        sm->isr = (sm->isr >> count) | (data << (32 - count));
+    }
+
+    else {
+        sm->isr = (sm->isr << count) | data;
+    }
+
+    sm->isrCount = uint8_t(sm->isrCount + count > 32 ? 32 : sm->isrCount + count);
+
+    if (c.autopush && sm->isrCount >= threshold) {
+        push(sm, true);
+    }
+
+    return true;
+}
+
+bool SimPio::shiftOut(SSimPioSm* sm, uint8_t count, uint32_t* data) {
+    const pio_sm_config& c = sm->config;
+    const uint8_t threshold = c.pull_threshold ? c.pull_threshold : 32;
+
+    if (c.autopull && sm->osrCount >= threshold && !pull(sm, true)) {
+        return false;
+    }
+
+    if (c.out_shift_right) {
+        *data = count >= 32 ? sm->osr : (sm->osr & ((1u << count) - 1));
+        sm->osr = count >= 32 ? 0 : (sm->osr >> count);
+    }
+
+    else {
+        *data = count >= 32 ? sm->osr : (sm->osr >> (32 - count));
+        sm->osr = count >= 32 ? 0 : (sm->osr << count);
+    }
+
+    sm->osrCount = uint8_t(sm->osrCount + count > 32 ? 32 : sm->osrCount + count);
+    return true;
+}
+
+bool SimPio::push(SSimPioSm* sm, bool block) {
+    if (sm->rxCount >= 4) {
+        if (block) {
+            return false;
+        }
+
+        // --> dropped, the ISR is cleared anyway.
+        sm->isr = 0;
+        sm->isrCount = 0;
+        return true;
+    }
+
+    // --> the FIFO was full until the word 4 before it was popped.
+    if (sm->pushes >= 4 && sm->time < sm->popAt[sm->pushes & 3] * 256) {
+        sm->time = sm->popAt[sm->pushes & 3] * 256;
+    }
+
+    const uint8_t at = uint8_t((sm->rxHead + sm->rxCount) & 3);
+
+    sm->rx[at] = sm->isr;
+    sm->rxAt[at] = sm->time / 256;
+    sm->rxCount++;
+    sm->pushes++;
+
+    sm->isr = 0;
+    sm->isrCount = 0;
+    return true;
+}
+
+bool SimPio::pull(SSimPioSm* sm, bool block) {
+    if (!sm->txCount) {
+        if (block) {
+            return false;
+        }
+
+        // --> copies X instead.
+        sm->osr = sm->x;
+        sm->osrCount = 0;
+        return true;
+    }
+
+    if (sm->time < sm->txAt[sm->txHead] * 256) {
+        sm->time = sm->txAt[sm->txHead] * 256;
+    }
+
+    sm->osr = sm->tx[sm->txHead];
+    sm->osrCount = 0;
+    sm->txHead = uint8_t((sm->txHead + 1) & 3);
+    sm->txCount--;
+    return true;
+}
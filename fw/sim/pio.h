@@ -0,0 +1,71 @@
+#ifndef __SIM_PIO_H__
+#define __SIM_PIO_H__
+
+#include <stdint.h>
+#include <functional>
+#include <hardware/pio.h>
+
+/**
+ * Simulated PIO blocks.
+ * --
+ * The state machines run the loaded programs instruction by instruction,
+ * at the clock divider of the system clock (125 MHz), on the pins routed to the block:
+ * 1. the side-set and the outputs drive `SimGpio`, and the inputs sample it.
+ *    inputs are sampled before the instruction drives anything, like through
+ *    the input synchronizers, and at the time of the state machine.
+ * 2. a state machine runs lazily, when the CPU waits on its FIFOs: the CPU
+ *    spins until the word is pushed, and is charged for the FIFO accesses.
+ *    a state machine pacing a DMA channel runs when the channel is read, see `SimDma`.
+ * 3. JMP, WAIT (GPIO, PIN), IN, OUT, PUSH, PULL, MOV and SET are modeled.
+ *    IRQ is a no-op, EXEC destinations stall the state machine forever.
+ */
+class SimPio {
+public:
+    static constexpr uint32_t CLK_SYS = 125 * 1000 * 1000;
+
+public:
+    /* unload all programs, release all state machines and reset the statistics. */
+    static void reset();
+
+    /* get the block. */
+    static PIO get(uint8_t index);
+
+    /* get the state machine. */
+    static SSimPioSm* sm(PIO pio, uint index);
+
+    /* apply the outputs of the block to the pin, just routed to it. */
+    static void route(uint8_t pin);
+
+    /* set the outputs of the block, and drive the pins routed to it. */
+    static void drive(PIO pio, uint32_t values, uint32_t mask);
+
+    /* set the directions of the block, and apply to the pins routed to it. */
+    static void direct(PIO pio, uint32_t dirs, uint32_t mask);
+
+    /* run the state machine until `done` returns true, or it stalls. */
+    static void run(PIO pio, SSimPioSm* sm, const std::function<bool()>& done);
+
+    /* get the state machine paced by the DREQ, null if not a RX FIFO. */
+    static SSimPioSm* byRxDreq(uint dreq, PIO* pio);
+
+    /* get the count of the instructions run. */
+    static uint64_t executed();
+
+private:
+    /* run an instruction, returns false if stalled. */
+    static bool step(PIO pio, SSimPioSm* sm);
+
+    /* sample the pins from the base, at the time. */
+    static uint32_t sample(uint8_t base, uint8_t count, uint64_t at);
+
+    /* shift bits into the ISR, and push if the threshold reached. */
+    static bool shiftIn(SSimPioSm* sm, uint32_t data, uint8_t count);
+
+    /* shift bits out of the OSR, pulling first if empty. */
+    static bool shiftOut(SSimPioSm* sm, uint8_t count, uint32_t* data);
+
+    static bool push(SSimPioSm* sm, bool block);
+    static bool pull(SSimPioSm* sm, bool block);
+};
+
+#endif
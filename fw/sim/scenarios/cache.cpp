@@ -0,0 +1,168 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Result of an access trace.
+ */
+struct SSimCacheRun {
+    SimStats latency;       // --> per read.
+    uint64_t busy;          // --> total time spent by the reads.
+    uint32_t hits;
+    uint32_t misses;
+    bool matched;
+};
+
+// --> the regions: the config journal, profiles and macro bodies.
+static constexpr uint32_t CONF_ADDR = 0x000000;
+static constexpr uint32_t CONF_SLOT = 64;
+static constexpr uint32_t PROFILE_ADDR = 0x020000;
+static constexpr uint32_t PROFILE_LEN = 1024;
+static constexpr uint32_t MACRO_ADDR = 0x040000;
+static constexpr uint32_t MACRO_SLOT = 256;
+static constexpr uint32_t MACROS = 32;
+static constexpr uint32_t MACRO_STEP = 16;
+
+// --> reads of each trace, and a macro rewritten every this many macro plays.
+static constexpr uint32_t ACCESSES = 2000;
+static constexpr uint32_t REWRITE_EVERY = 97;
+
+/* deterministic random numbers for the traces. */
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* read through the driver, time and check it. */
+static void measureRead(SSimCacheRun& run, W25QXX& flash, SimFlash& sim, uint32_t addr, uint32_t len) {
+    uint8_t buf[PROFILE_LEN];
+
+    const uint64_t begin = SimClock::busy(0);
+    flash.read(addr, buf, len);
+
+    const uint64_t spent = SimClock::busy(0) - begin;
+    run.latency.add(spent);
+    run.busy += spent;
+    run.matched = run.matched && !memcmp(buf, sim.data() + addr, len);
+}
+
+/* replay the trace: 0 = config lookups, 1 = profile switches, 2 = macro plays. */
+static SSimCacheRun runTrace(uint32_t trace, bool cached) {
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    SSimCacheRun run;
+
+    run.busy = 0;
+    run.hits = run.misses = 0;
+    run.matched = true;
+
+    for(uint32_t i = 0; i < 0x60000; ++i) {
+        sim.data()[i] = uint8_t(i * 11 + (i >> 10));
+    }
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        uint8_t macro[MACRO_SLOT];
+        uint32_t seed = 0x2545f491, plays = 0;
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enableCache(cached);
+
+        for(uint32_t n = 0; n < ACCESSES; ) {
+            const uint32_t random = nextRandom(seed);
+
+            switch(trace) {
+                case 0: {
+                    // --> the binary search over the slot headers, then the record.
+                    uint32_t lo = 0, hi = W25QXX::SECTOR_SIZE / CONF_SLOT;
+                    while (lo < hi && n < ACCESSES) {
+                        const uint32_t mid = (lo + hi) / 2;
+
+                        measureRead(run, flash, sim, CONF_ADDR + mid * CONF_SLOT, 12);
+                        n++;
+
+                        if (mid < 40) lo = mid + 1;
+                        else hi = mid;
+                    }
+
+                    measureRead(run, flash, sim, CONF_ADDR + 39 * CONF_SLOT, CONF_SLOT);
+                    n++;
+                    break;
+                }
+
+                case 1: {
+                    // --> between two profiles mostly, the others sometimes.
+                    const uint32_t profile = (random % 8) < 6 ? (n & 1) : 2 + random % 6;
+
+                    measureRead(run, flash, sim, PROFILE_ADDR + profile * W25QXX::SECTOR_SIZE, PROFILE_LEN);
+                    n++;
+                    break;
+                }
+
+                default: {
+                    // --> a few favorite macros, played a step at a time.
+                    const uint32_t pick = random % 16;
+                    const uint32_t index = pick < 10 ? pick % 4 : random % MACROS;
+                    const uint32_t addr = MACRO_ADDR + index * MACRO_SLOT;
+
+                    for(uint32_t step = 0; step < MACRO_SLOT && n < ACCESSES; step += MACRO_STEP) {
+                        measureRead(run, flash, sim, addr + step, MACRO_STEP);
+                        n++;
+                    }
+
+                    // --> edited by the host: the cache must follow the chip.
+                    if ((++plays % REWRITE_EVERY) == 0) {
+                        for(uint32_t i = 0; i < MACRO_SLOT; ++i) {
+                            macro[i] = uint8_t(random + i);
+                        }
+
+                        flash.eraseSector(addr / W25QXX::SECTOR_SIZE);
+                        flash.write(addr, macro, MACRO_SLOT);
+                    }
+                    break;
+                }
+            }
+        }
+
+        run.hits = flash.cacheHits();
+        run.misses = flash.cacheMisses();
+    });
+
+    return run;
+}
+
+int simCache() {
+    static const char* TRACES[] = { "config", "profile", "macro" };
+    bool ok = true;
+
+    for(uint32_t i = 0; i < 3; ++i) {
+        const SSimCacheRun direct = runTrace(i, false);
+        const SSimCacheRun cached = runTrace(i, true);
+        char key[48];
+
+        snprintf(key, sizeof(key), "%s-direct", TRACES[i]);
+        direct.latency.print(key);
+
+        snprintf(key, sizeof(key), "%s-cached", TRACES[i]);
+        cached.latency.print(key);
+
+        snprintf(key, sizeof(key), "%s-hit-rate", TRACES[i]);
+        simReport(key, 100.0 * cached.hits / (cached.hits + cached.misses), "%");
+
+        snprintf(key, sizeof(key), "%s-speedup", TRACES[i]);
+        simReport(key, double(direct.busy) / cached.busy, "x");
+
+        // --> coherent, and never slower over the trace.
+        ok = ok && direct.matched && cached.matched && cached.busy < direct.busy;
+    }
+
+    simReport("matched", ok, "");
+    return ok ? 0 : 1;
+}
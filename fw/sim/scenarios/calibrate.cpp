@@ -0,0 +1,229 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyboard.h"
+#include "drivers/debounce.h"
+#include "drivers/usbd/cdc.h"
+#include "drivers/usbd/hid_kc.h"
+#include <stdio.h>
+#include <string.h>
+
+// --> bounces of the first keys, the ones tapped: good ones, and a worn one chattering past the default window.
+static const uint64_t BOUNCE_US[] = { 200, 600, 1200, 2000, 3500, 9000 };
+static constexpr uint8_t KEYS = sizeof(BOUNCE_US) / sizeof(BOUNCE_US[0]);
+
+static_assert(KEYS <= EKEY_MAX, "the board has fewer keys than tapped.");
+
+/**
+ * Calibrated or fixed run of the bouncing taps on the App.
+ */
+struct SSimCalibRun {
+    SimStats release[KEYS];     // --> the contacts parted to the report without the key.
+    uint32_t presses[KEYS];     // --> reports the key appeared in, after the calibration.
+    SDebounceStats stats[KEYS];
+    bool replied[KEYS];
+    uint8_t calibrating;
+};
+
+static constexpr uint64_t REQUEST = 50 * SimClock::MS;
+static constexpr uint64_t BEGIN = 100 * SimClock::MS;
+static constexpr uint64_t PERIOD = 35 * SimClock::MS;
+static constexpr uint32_t TAPS = 20;                // --> per key.
+static constexpr uint64_t END = BEGIN + TAPS * KEYS * PERIOD + 100 * SimClock::MS;
+
+// --> the taps after the windows are picked: each key recorded its edges twice over.
+static constexpr uint32_t SETTLED = DEBOUNCE_CALIB_EDGES;
+
+/* deterministic random numbers for the bounces. */
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* random microseconds in the range, as nanoseconds. */
+static uint64_t randomUs(uint32_t& seed, uint32_t from, uint32_t to) {
+    return (from + nextRandom(seed) % (to - from)) * SimClock::US;
+}
+
+/* script a bouncing edge: a flurry in the first quarter, and the contacts touching again at the end. */
+static void scriptEdge(SimMatrix& matrix, uint8_t key, uint64_t at, bool down, uint32_t& seed) {
+    const uint64_t bounce = BOUNCE_US[key] * SimClock::US;
+    const uint64_t late = at + bounce - randomUs(seed, 300, 600) * bounce / (bounce + 600 * SimClock::US);
+
+    auto level = [&](bool val, uint64_t when) {
+        if (val) {
+            matrix.press(key, when);
+        }
+
+        else {
+            matrix.release(key, when);
+        }
+    };
+
+    level(down, at);
+
+    for(uint64_t x = at + randomUs(seed, 40, 300); x < at + bounce / 4; x += randomUs(seed, 40, 300)) {
+        level(!down, x);
+        x += randomUs(seed, 30, 120);
+        level(down, x);
+    }
+
+    level(!down, late);
+    level(down, at + bounce);
+}
+
+/* find the key in the report. */
+static bool hasKey(const SSimHidReport& report, uint8_t kc) {
+    for(uint8_t code : report.keycodes) {
+        if (code == kc) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* type the bouncing taps on the App, calibrating or not, then read the statistics over the CDC. */
+static SSimCalibRun runApp(bool calibrate) {
+    SimBoard board;
+    SimUsbHost& host = board.host();
+    SSimCalibRun run;
+    uint32_t seed = 0x6b43a9b5;
+
+    memset(run.presses, 0, sizeof(run.presses));
+    memset(run.stats, 0, sizeof(run.stats));
+    memset(run.replied, 0, sizeof(run.replied));
+    run.calibrating = 0;
+
+    if (calibrate) {
+        const uint8_t data[2] = { 0, 1 };
+        host.sendCdc(ECDCM_DEBOUNCE_STATS, data, sizeof(data), REQUEST);
+    }
+
+    // --> held 20 ~ 26ms: the bounces settle before the release, the worn key's too.
+    std::vector<uint64_t> presses, releases;
+    for(uint32_t i = 0; i < TAPS * KEYS; ++i) {
+        const uint8_t key = uint8_t(i % KEYS);
+        const uint64_t at = BEGIN + i * PERIOD;
+        const uint64_t hold = randomUs(seed, 20000, 26000);
+
+        scriptEdge(board.matrix(), key, at, true, seed);
+        scriptEdge(board.matrix(), key, at + hold, false, seed);
+
+        presses.push_back(at);
+        releases.push_back(at + hold);
+    }
+
+    for(uint8_t i = 0; i < KEYS; ++i) {
+        host.sendCdc(ECDCM_DEBOUNCE_STATS, &i, 1, END - 50 * SimClock::MS + i * 2 * SimClock::MS);
+    }
+
+    board.run(END);
+
+    for(const SSimCdcMessage& msg : host.cdcMessages()) {
+        if (!msg.valid || msg.opcode != ECDCM_DEBOUNCE_STATS || msg.length < 2 || msg.data[0] >= KEYS) {
+            continue;
+        }
+
+        run.calibrating = msg.data[1];
+        if (msg.length == 2 + sizeof(SDebounceStats)) {
+            memcpy(&run.stats[msg.data[0]], msg.data + 2, sizeof(SDebounceStats));
+            run.replied[msg.data[0]] = true;
+        }
+    }
+
+    // --> the taps after the calibration, until the key is tapped again: the keys appeared, and the releases.
+    for(uint32_t i = SETTLED * KEYS; i < TAPS * KEYS; ++i) {
+        const uint8_t key = uint8_t(i % KEYS);
+        const uint8_t kc = simKeyCode(key);
+        const uint64_t until = i + KEYS < TAPS * KEYS ? presses[i + KEYS] : END;
+
+        bool down = false;
+        bool released = false;
+
+        for(const SSimHidReport& each : host.reports()) {
+            if (each.queued < presses[i] || each.queued >= until) {
+                continue;
+            }
+
+            const bool now = hasKey(each, kc);
+            if (now && !down) {
+                run.presses[key]++;
+            }
+
+            // --> the first report without the key, after the contacts parted.
+            if (!now && down && !released && each.queued >= releases[i]) {
+                run.release[key].add(each.queued - releases[i]);
+                released = true;
+            }
+
+            down = now;
+        }
+    }
+
+    return run;
+}
+
+int simCalibrate() {
+    SSimCalibRun fixed = runApp(false);
+    SSimCalibRun calib = runApp(true);
+
+    const uint32_t taps = TAPS - SETTLED;
+    const uint64_t period = KEYBOARD_SCAN_US;
+    char name[48];
+    bool converged = calib.calibrating != 0;
+    bool faster = true;
+
+    for(uint8_t i = 0; i < KEYS; ++i) {
+        const SDebounceStats& stats = calib.stats[i];
+
+        snprintf(name, sizeof(name), "key%u-bounce", i);
+        simReport(name, double(BOUNCE_US[i]), "us");
+
+        snprintf(name, sizeof(name), "key%u-edges", i);
+        simReport(name, stats.edges, "");
+
+        snprintf(name, sizeof(name), "key%u-glitches", i);
+        simReport(name, stats.glitches, "");
+
+        snprintf(name, sizeof(name), "key%u-longest", i);
+        simReport(name, stats.longest, "us");
+
+        snprintf(name, sizeof(name), "key%u-window", i);
+        simReport(name, stats.window, "us");
+
+        snprintf(name, sizeof(name), "key%u-fixed-release", i);
+        fixed.release[i].print(name);
+
+        snprintf(name, sizeof(name), "key%u-calib-release", i);
+        calib.release[i].print(name);
+
+        snprintf(name, sizeof(name), "key%u-fixed-presses", i);
+        simReport(name, fixed.presses[i], "");
+
+        snprintf(name, sizeof(name), "key%u-calib-presses", i);
+        simReport(name, calib.presses[i], "");
+
+        // --> every edge timed, the window above the bounce and a bin or so from it.
+        converged = converged && calib.replied[i]
+            && stats.edges == 2 * TAPS && !stats.glitches
+            && stats.longest <= BOUNCE_US[i] + period
+            && stats.window > BOUNCE_US[i] && stats.window > stats.longest
+            && stats.window <= BOUNCE_US[i] + period + 2 * DEBOUNCE_CALIB_BIN_US
+            && calib.presses[i] == taps;
+
+        // --> the good keys release sooner than the default window lets.
+        if (BOUNCE_US[i] + 2 * DEBOUNCE_CALIB_BIN_US < DEBOUNCE_RELEASE_US) {
+            faster = faster && calib.release[i].max() < fixed.release[i].min();
+        }
+    }
+
+    // --> the worn key chatters past the default window: the release is followed by a false press.
+    const bool chatters = fixed.presses[KEYS - 1] > taps;
+    const bool fixedQuiet = !fixed.calibrating && fixed.replied[0] && !fixed.stats[0].edges;
+
+    return (converged && faster && chatters && fixedQuiet) ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/usbd/cdc.h"
+#include <string.h>
+
+int simCdc() {
+    constexpr uint64_t BEGIN = 100 * SimClock::MS;
+    constexpr uint64_t PING = 5 * SimClock::MS;
+    constexpr uint32_t PINGS = 20;
+    constexpr uint32_t BURST = 200;
+    constexpr uint8_t PAYLOAD = 48;
+
+    SimBoard board;
+    SimUsbHost& host = board.host();
+
+    uint8_t data[PAYLOAD];
+    for(uint8_t i = 0; i < PAYLOAD; ++i) {
+        data[i] = i;
+    }
+
+    // --> ping-pong first, then a burst, back-to-back.
+    for(uint32_t i = 0; i < PINGS; ++i) {
+        data[0] = uint8_t(i);
+        host.sendCdc(ECDCM_ECHO, data, PAYLOAD, BEGIN + i * PING);
+    }
+
+    const uint64_t burst = BEGIN + PINGS * PING;
+    for(uint32_t i = 0; i < BURST; ++i) {
+        data[0] = uint8_t(PINGS + i);
+        host.sendCdc(ECDCM_ECHO, data, PAYLOAD, burst);
+    }
+
+    board.run(burst + 200 * SimClock::MS);
+
+    SimStats rtt;
+    uint32_t echoed = 0, corrupted = 0;
+    uint64_t last = 0;
+
+    for(const SSimCdcMessage& msg : host.cdcMessages()) {
+        if (!msg.valid || msg.opcode != ECDCM_ECHO || msg.length != PAYLOAD) {
+            corrupted++;
+            continue;
+        }
+
+        const uint32_t n = msg.data[0];
+        if (n < PINGS) {
+            rtt.add(msg.at - (BEGIN + n * PING));
+        }
+
+        echoed++;
+        last = msg.at;
+    }
+
+    const uint32_t frame = 3 + PAYLOAD;
+    const double elapsed = double(last - burst) / SimClock::SEC;
+
+    rtt.print("echo-rtt");
+    simReport("echoed", echoed, "");
+    simReport("corrupted", corrupted, "");
+    simReport("burst-throughput", elapsed > 0 ? (BURST * frame) / elapsed / 1024.0 : 0, "KB/s");
+
+    return (echoed != PINGS + BURST || corrupted) ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * A wiring and the clock expected to be tuned on it.
+ */
+struct SSimClockCase {
+    const char* name;
+    uint32_t wiring;        // --> max clock of the wiring, 0 if unlimited.
+    uint32_t expected;      // --> the tuned clock.
+};
+
+int simClock() {
+    constexpr uint32_t MHZ = 1000 * 1000;
+
+    // --> the SSP clocks: 125 MHz / even divisors, 62.5 MHz at most.
+    const SSimClockCase cases[] = {
+        { "unlimited",  0,          62500000 },
+        { "board",      40 * MHZ,   31250000 },
+        { "between",    30 * MHZ,   20833333 },      // --> 31.25 MHz fails.
+        { "poor",       3 * MHZ,    2155172 },
+        { "broken",     MHZ / 2,    0 },             // --> even the safe clock fails.
+    };
+
+    int result = 0;
+    for(const SSimClockCase& each : cases) {
+        SimBoard board;
+        bool ready = false;
+        uint32_t tuned = 0;
+        uint64_t init = 0, load = 0;
+
+        // --> a pattern at the start, the tuning reads it back.
+        for(uint32_t i = 0; i < W25QXX::SECTOR_SIZE; ++i) {
+            board.flash().data()[i] = uint8_t(i * 13 + 7);
+        }
+
+        SimSpi::setMaxBaudrate(0, each.wiring);
+        board.run(SimClock::SEC, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+            uint8_t buf[W25QXX::SECTOR_SIZE];
+
+            uint64_t begin = SimClock::now();
+            ready = flash.init() && flash.fastMode(true);
+            init = SimClock::now() - begin;
+
+            if (!ready) {
+                return;
+            }
+
+            // --> a sector read, and it must match at the tuned clock.
+            begin = SimClock::now();
+            flash.read(0, buf, sizeof(buf));
+            load = SimClock::now() - begin;
+
+            ready = memcmp(buf, board.flash().data(), sizeof(buf)) == 0;
+            tuned = flash.baudrate();
+        });
+
+        char key[48];
+        snprintf(key, sizeof(key), "%s-clock", each.name);
+        simReport(key, double(tuned) / MHZ, "MHz");
+
+        if (ready) {
+            snprintf(key, sizeof(key), "%s-init", each.name);
+            simReport(key, double(init) / SimClock::US, "us");
+
+            snprintf(key, sizeof(key), "%s-read-4k", each.name);
+            simReport(key, double(load) / SimClock::US, "us");
+        }
+
+        // --> a broken wiring fails the init, never a wrong clock.
+        if (ready != (each.expected != 0) || tuned != each.expected) {
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,255 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../keytrace.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyboard.h"
+#include "drivers/debounce.h"
+#include "drivers/usbd/hid.h"
+#include "drivers/usbd/hid_kc.h"
+#include <tusb.h>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Tap of the noisy trace, the times the switch settled at.
+ */
+struct SSimDebounceTap {
+    uint8_t key;
+    uint64_t press;         // --> microseconds, the first contact.
+    uint64_t release;       // --> microseconds, the contacts parted first.
+};
+
+/**
+ * Level change of a key, seen by the keyboard.
+ */
+struct SSimDebounceEvent {
+    uint8_t key;
+    bool down;
+    uint64_t at;            // --> microseconds, `Keyboard::getKeyTime()`.
+};
+
+/**
+ * Debounced run of the noisy trace.
+ */
+struct SSimDebounceRun {
+    SimStats press;         // --> the first contact to the key down.
+    SimStats release;       // --> the contacts parted to the key up, the last one.
+    uint32_t falses;        // --> events besides a press and a release of each tap.
+    uint32_t missed;        // --> taps never down.
+    uint32_t reports;       // --> HID reports queued.
+};
+
+// --> snapshots at the shortest scan period: the chatter is sampled finely.
+static constexpr uint64_t SCAN_US = KEYBOARD_SCAN_MIN_US;
+static constexpr uint64_t BEGIN_US = 20 * 1000;
+static constexpr uint64_t TAP_US = 60 * 1000;
+static constexpr uint32_t TAPS = 60;
+static constexpr uint64_t END_US = BEGIN_US + TAPS * TAP_US + 20 * 1000;
+
+// --> the contacts bounce up to 2.5ms on each edge, and a spike flips a sample now and then.
+static constexpr uint64_t BOUNCE_MIN_US = 300;
+static constexpr uint64_t BOUNCE_MAX_US = 2500;
+static constexpr uint32_t SPIKE_EVERY = 1500;
+
+static constexpr uint32_t WINDOW_US = 5000;
+
+/* deterministic random numbers for the traces. */
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* generate the taps of the switches, and the snapshots of their bouncing contacts. */
+static SimKeyTrace generateTrace(std::vector<SSimDebounceTap>& taps) {
+    SimKeyTrace trace;
+    uint32_t seed = 0x2545f491;
+
+    // --> held 15 ~ 45ms, a key at a time.
+    for(uint32_t i = 0; i < TAPS; ++i) {
+        SSimDebounceTap tap;
+
+        tap.key = uint8_t(i % EKEY_MAX);
+        tap.press = BEGIN_US + i * TAP_US + nextRandom(seed) % 1000;
+        tap.release = tap.press + 15000 + nextRandom(seed) % 30000;
+        taps.push_back(tap);
+    }
+
+    // --> the bounces of each edge: the sampled level is random until settled.
+    std::vector<uint64_t> settle(taps.size() * 2);
+    for(size_t i = 0; i < settle.size(); ++i) {
+        settle[i] = BOUNCE_MIN_US + nextRandom(seed) % (BOUNCE_MAX_US - BOUNCE_MIN_US);
+    }
+
+    for(uint64_t at = 0; at < END_US; at += SCAN_US) {
+        SKeyScan scan;
+
+        scan.at = at;
+        memset(scan.rows, 0, sizeof(scan.rows));
+
+        for(size_t i = 0; i < taps.size(); ++i) {
+            const SSimDebounceTap& tap = taps[i];
+            bool level = at >= tap.press && at < tap.release;
+
+            // --> the first contact and the parting read their new levels.
+            if (at > tap.press && at < tap.press + settle[i * 2]) {
+                level = nextRandom(seed) & 1;
+            }
+
+            else if (at > tap.release && at < tap.release + settle[i * 2 + 1]) {
+                level = nextRandom(seed) & 1;
+            }
+
+            if (level) {
+                scan.rows[tap.key / Board::MAX_COL] |= Board::row_t(1u << (tap.key % Board::MAX_COL));
+            }
+        }
+
+        // --> a spike on any key, pressed or not.
+        if (nextRandom(seed) % SPIKE_EVERY == 0) {
+            const uint8_t key = uint8_t(nextRandom(seed) % EKEY_MAX);
+            scan.rows[key / Board::MAX_COL] ^= Board::row_t(1u << (key % Board::MAX_COL));
+        }
+
+        trace.push_back(scan);
+    }
+
+    return trace;
+}
+
+/* replay the trace on the keyboard and the HID, record the level changes of the keys. */
+static SSimDebounceRun runTrace(const SimKeyTrace& trace, const std::vector<SSimDebounceTap>& taps, EDebounce algo) {
+    SimBoard board;
+    SSimDebounceRun run;
+    std::vector<SSimDebounceEvent> events;
+
+    board.run(END_US * SimClock::US, [&]() {
+        Keyboard kbd;
+        UsbHid hid;
+        SimTraceScanner player(trace);
+        bool down[EKEY_MAX] = { false, };
+
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            kbd.getKeyPtr(EKey(i))->kc = KC_0 + i;
+        }
+
+        kbd.setDebounce(algo, WINDOW_US, WINDOW_US);
+        kbd.setScanner(&player);
+        hid.init(&kbd);
+        tud_init(0);
+
+        // --> the loop is faster than the snapshots: each one is seen.
+        while (true) {
+            kbd.scanOnce();
+            hid.transmitOnce();
+            tud_task();
+
+            for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+                const EKeyState state = kbd.getKeyState(EKey(i));
+                const bool now = state == EKSL_RISE || state == EKSL_HIGH;
+
+                if (now != down[i]) {
+                    down[i] = now;
+                    events.push_back({ i, now, kbd.getKeyTime(EKey(i)) });
+                }
+            }
+        }
+    });
+
+    run.missed = 0;
+    run.reports = uint32_t(board.host().reports().size());
+
+    // --> the events of each tap: the first down while held, the last up while the contacts part.
+    uint32_t matched = 0;
+    for(const SSimDebounceTap& tap : taps) {
+        const uint64_t parted = tap.release + BOUNCE_MAX_US + WINDOW_US + 2 * SCAN_US;
+
+        const SSimDebounceEvent* press = nullptr;
+        const SSimDebounceEvent* release = nullptr;
+        bool early = false;     // --> down by a spike before the first contact.
+
+        for(const SSimDebounceEvent& each : events) {
+            if (each.key != tap.key) {
+                continue;
+            }
+
+            if (each.at < tap.press) {
+                early = each.down;
+            }
+
+            else if (each.down && !press && each.at < tap.release) {
+                press = &each;
+            }
+
+            else if (!each.down && each.at >= tap.release && each.at < parted) {
+                release = &each;
+            }
+        }
+
+        if ((!press && !early) || !release) {
+            run.missed++;
+            continue;
+        }
+
+        matched++;
+        run.press.add(press ? (press->at - tap.press) * SimClock::US : 0);
+        run.release.add((release->at - tap.release) * SimClock::US);
+    }
+
+    // --> the chatter of the taps, and the spikes of any key.
+    run.falses = uint32_t(events.size()) - 2 * matched;
+    return run;
+}
+
+int simDebounce() {
+    static const EDebounce ALGOS[] = { EDBC_NONE, EDBC_EAGER, EDBC_DEFER, EDBC_INTEGRATE };
+    static const char* NAMES[] = { "none", "eager", "defer", "integrate" };
+
+    std::vector<SSimDebounceTap> taps;
+    const SimKeyTrace trace = generateTrace(taps);
+
+    SSimDebounceRun runs[4];
+    char name[48];
+
+    for(uint32_t i = 0; i < 4; ++i) {
+        runs[i] = runTrace(trace, taps, ALGOS[i]);
+
+        snprintf(name, sizeof(name), "%s-press-latency", NAMES[i]);
+        runs[i].press.print(name);
+
+        snprintf(name, sizeof(name), "%s-release-latency", NAMES[i]);
+        runs[i].release.print(name);
+    }
+
+    for(uint32_t i = 0; i < 4; ++i) {
+        snprintf(name, sizeof(name), "%s-false-events", NAMES[i]);
+        simReport(name, runs[i].falses, "");
+
+        snprintf(name, sizeof(name), "%s-hid-reports", NAMES[i]);
+        simReport(name, runs[i].reports, "");
+    }
+
+    const SSimDebounceRun& none = runs[0];
+    const SSimDebounceRun& eager = runs[1];
+    const SSimDebounceRun& defer = runs[2];
+    const SSimDebounceRun& integrate = runs[3];
+
+    simReport("eager-added-press", (eager.press.avg() - none.press.avg()) / SimClock::US, "us");
+    simReport("defer-added-press", (defer.press.avg() - none.press.avg()) / SimClock::US, "us");
+    simReport("integrate-added-press", (integrate.press.avg() - none.press.avg()) / SimClock::US, "us");
+
+    // --> the raw levels chatter. the eager press is as fast as the raw one,
+    //   : the deferred ones wait for the window, and none of them chatters.
+    const bool noisy = none.falses > TAPS;
+    const bool eagerFast = eager.press.max() == none.press.max() && eager.falses < none.falses / 10;
+    const bool deferClean = !defer.falses && !integrate.falses
+        && defer.press.min() >= WINDOW_US * SimClock::US && integrate.press.min() >= WINDOW_US * SimClock::US;
+
+    const bool fewer = eager.reports < none.reports && defer.reports == 2 * TAPS && integrate.reports == 2 * TAPS;
+    const bool missed = none.missed || eager.missed || defer.missed || integrate.missed;
+
+    return (noisy && eagerFast && deferClean && fewer && !missed) ? 0 : 1;
+}
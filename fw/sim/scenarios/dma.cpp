@@ -0,0 +1,176 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Result of a transfer mode.
+ */
+struct SSimXferRun {
+    uint64_t cpu;           // --> time spent in the driver calls.
+    uint64_t wall;          // --> time until all transferred.
+    uint64_t work;          // --> other work done meanwhile.
+    bool matched;
+};
+
+// --> bytes transferred by each mode, and other work between the polls.
+//   : the status is polled less often, a poll is a blocking transfer.
+static constexpr uint32_t BYTES = 16 * 1024;
+static constexpr uint32_t CHUNK = 1024;
+static constexpr uint64_t WORK = 10 * SimClock::US;
+static constexpr uint64_t STATUS_WORK = 100 * SimClock::US;
+static constexpr uint64_t RUN = 10 * SimClock::SEC;
+
+/* measure the calling core's busy time spent by `fn`. */
+template<typename Fn>
+static void measure(uint64_t& cpu, Fn fn) {
+    const uint64_t begin = SimClock::busy(0);
+    fn();
+    cpu += SimClock::busy(0) - begin;
+}
+
+/* read the flash in chunks, blocking or by DMA. */
+static void runRead(SSimXferRun& result, W25QXX& flash, const uint8_t* image, bool dma) {
+    static uint8_t buf[BYTES];
+    const uint64_t begin = SimClock::now();
+
+    memset(buf, 0, sizeof(buf));
+    for(uint32_t addr = 0; addr < BYTES; addr += CHUNK) {
+        if (!dma) {
+            measure(result.cpu, [&]() { flash.read(addr, buf + addr, CHUNK); });
+            continue;
+        }
+
+        bool busy = true;
+        measure(result.cpu, [&]() { flash.readAsync(addr, buf + addr, CHUNK); });
+
+        while (busy) {
+            SimClock::spend(WORK);
+            result.work += WORK;
+
+            measure(result.cpu, [&]() { busy = flash.updateOnce(); });
+        }
+    }
+
+    result.wall = SimClock::now() - begin;
+    result.matched = memcmp(buf, image, BYTES) == 0;
+}
+
+/* program the erased flash page by page, blocking or by DMA. */
+static void runProgram(SSimXferRun& result, W25QXX& flash, const uint8_t* image, bool dma) {
+    const uint64_t begin = SimClock::now();
+
+    for(uint32_t page = 0; page < BYTES / W25QXX::PAGE_SIZE; ++page) {
+        const uint8_t* src = image + page * W25QXX::PAGE_SIZE;
+
+        if (!dma) {
+            measure(result.cpu, [&]() { flash.writePage(page, 0, src, W25QXX::PAGE_SIZE); });
+            continue;
+        }
+
+        bool busy = true;
+        measure(result.cpu, [&]() { flash.writePageAsync(page, 0, src, W25QXX::PAGE_SIZE); });
+
+        while (busy) {
+            SimClock::spend(WORK);
+            result.work += WORK;
+
+            measure(result.cpu, [&]() { busy = flash.updateOnce(); });
+        }
+
+        // --> then the program time of the chip.
+        busy = true;
+        while (busy) {
+            SimClock::spend(STATUS_WORK);
+            result.work += STATUS_WORK;
+
+            measure(result.cpu, [&]() { busy = flash.isBusy(); });
+        }
+    }
+
+    result.wall = SimClock::now() - begin;
+}
+
+/* print the result per KB. */
+static void report(const char* name, const SSimXferRun& run) {
+    constexpr double KB = BYTES / 1024.0;
+    char key[48];
+
+    snprintf(key, sizeof(key), "%s-cpu", name);
+    simReport(key, double(run.cpu) / SimClock::US / KB, "us/KB");
+
+    // --> 125 MHz: 8 ns per cycle.
+    snprintf(key, sizeof(key), "%s-cycles", name);
+    simReport(key, double(run.cpu) / 8 / KB, "cycles/KB");
+
+    snprintf(key, sizeof(key), "%s-wall", name);
+    simReport(key, double(run.wall) / SimClock::US / KB, "us/KB");
+}
+
+int simDma() {
+    static uint8_t image[BYTES];
+    SSimXferRun runs[4];
+    bool dma = false;
+
+    SimBoard board;
+    memset(runs, 0, sizeof(runs));
+
+    for(uint32_t i = 0; i < BYTES; ++i) {
+        image[i] = uint8_t(i * 7 + (i >> 8));
+    }
+
+    // --> reads: blocking, then DMA.
+    memcpy(board.flash().data(), image, BYTES);
+    board.run(RUN, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+        runRead(runs[0], flash, image, false);
+
+        dma = flash.enableDma();
+        runRead(runs[1], flash, image, true);
+    });
+
+    // --> page programs: blocking, then DMA, each to the erased flash.
+    for(uint32_t i = 0; i < 2; ++i) {
+        memset(board.flash().data(), 0xff, BYTES);
+
+        board.run(RUN, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+            flash.init();
+            flash.fastMode(true);
+
+            if (i) {
+                flash.enableDma();
+            }
+
+            runProgram(runs[2 + i], flash, image, i != 0);
+        });
+
+        runs[2 + i].matched = memcmp(board.flash().data(), image, BYTES) == 0;
+    }
+
+    report("read-blocking", runs[0]);
+    report("read-dma", runs[1]);
+    report("program-blocking", runs[2]);
+    report("program-dma", runs[3]);
+
+    simReport("dma-bytes", double(SimSpi::get(0)->dmaBytes), "");
+    simReport("read-dma-work", double(runs[1].work) / SimClock::US, "us");
+    simReport("program-dma-work", double(runs[3].work) / SimClock::US, "us");
+
+    bool matched = dma;
+    for(const SSimXferRun& each : runs) {
+        matched = matched && each.matched;
+    }
+
+    simReport("matched", matched, "");
+
+    // --> DMA must free the CPU for the most of the transfer.
+    return (!matched || runs[1].cpu * 4 > runs[0].cpu) ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * A storage region to erase.
+ */
+struct SSimEraseCase {
+    const char* name;
+    uint32_t addr;
+    uint32_t len;
+};
+
+/**
+ * Result of erasing a region.
+ */
+struct SSimEraseRun {
+    uint64_t wall;
+    uint64_t commands;      // --> erase commands issued.
+    bool erased;            // --> the covering sectors erased, the others kept.
+};
+
+// --> the job is stepped at this period, like the main loop does.
+static constexpr uint64_t STEP_PERIOD = SimClock::MS;
+
+/* test the covering sectors erased and the other bytes kept. */
+static bool isErased(const uint8_t* mem, uint32_t capacity, const SSimEraseCase& each) {
+    const uint32_t begin = each.addr & ~(W25QXX::SECTOR_SIZE - 1);
+    const uint32_t end = each.len ? (each.addr + each.len + W25QXX::SECTOR_SIZE - 1) & ~(W25QXX::SECTOR_SIZE - 1) : begin;
+
+    for(uint32_t i = 0; i < capacity; ++i) {
+        if (mem[i] != ((i >= begin && i < end) ? 0xff : 0x00)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* erase the region sector by sector, or by the planned erases. */
+static SSimEraseRun runErase(const SSimEraseCase& each, bool planned, bool& progressed) {
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    SSimEraseRun result = { 0, 0, false };
+
+    memset(sim.data(), 0x00, sim.capacity());
+    progressed = true;
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        sim.resetStats();
+
+        const uint64_t begin = SimClock::now();
+
+        if (!planned) {
+            const uint32_t first = each.addr / W25QXX::SECTOR_SIZE;
+            const uint32_t last = (each.addr + each.len - 1) / W25QXX::SECTOR_SIZE;
+
+            for(uint32_t sector = first; each.len && sector <= last; ) {
+                if (flash.startEraseSector(sector)) {
+                    sector++;
+                }
+
+                SimClock::sleep(STEP_PERIOD);
+            }
+
+            while (flash.isBusy()) {
+                SimClock::sleep(STEP_PERIOD);
+            }
+        }
+
+        else {
+            uint32_t erased = 0;
+
+            flash.eraseRange(each.addr, each.len);
+            while (flash.stepJob() == EW25J_ERASE) {
+                progressed = progressed && flash.jobErased() >= erased;
+                erased = flash.jobErased();
+
+                SimClock::sleep(STEP_PERIOD);
+            }
+
+            progressed = progressed && flash.jobState() == EW25J_DONE
+                && flash.jobErased() == flash.jobEraseTotal();
+        }
+
+        result.wall = SimClock::now() - begin;
+    });
+
+    const SSimFlashStats& stats = sim.stats();
+
+    result.commands = stats.sectorErases + stats.halfBlockErases + stats.blockErases;
+    result.erased = isErased(sim.data(), sim.capacity(), each);
+    return result;
+}
+
+int simErase() {
+    // --> profile records are a few sectors, macros span blocks; some unaligned.
+    //   : an empty range within a sector erases nothing.
+    const SSimEraseCase cases[] = {
+        { "empty",          0x00a800,   0 },
+        { "profile-4k",     0x010000,   4 * 1024 },
+        { "profile-10k",    0x021800,   10000 },
+        { "macro-96k",      0x038000,   96 * 1024 },
+        { "macro-256k",     0x100000,   256 * 1024 },
+        { "macro-300k",     0x1a3000,   300 * 1024 },
+        { "macro-1m",       0x200000,   1024 * 1024 },
+    };
+
+    int result = 0;
+    for(const SSimEraseCase& each : cases) {
+        bool progressed = false;
+
+        const SSimEraseRun sectors = runErase(each, false, progressed);
+        const SSimEraseRun planned = runErase(each, true, progressed);
+
+        char key[48];
+        snprintf(key, sizeof(key), "%s-sectors", each.name);
+        simReport(key, double(sectors.wall) / SimClock::MS, "ms");
+
+        snprintf(key, sizeof(key), "%s-planned", each.name);
+        simReport(key, double(planned.wall) / SimClock::MS, "ms");
+
+        snprintf(key, sizeof(key), "%s-commands", each.name);
+        simReport(key, double(planned.commands), "");
+
+        snprintf(key, sizeof(key), "%s-ok", each.name);
+        const bool ok = sectors.erased && planned.erased && progressed
+            && planned.commands <= sectors.commands && planned.wall <= sectors.wall;
+
+        simReport(key, ok, "");
+
+        if (!ok) {
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,232 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyevents.h"
+#include "drivers/usbd/hid_kc.h"
+#include <pico/multicore.h>
+#include <stdio.h>
+
+// --> key codes of `App::defaultKeyConf()`.
+static const uint8_t SIM_EVENTS_KC[6] = {
+    KC_0, KC_1, KC_2, KC_3, KC_4, KC_5
+};
+
+// --> a small ring: the bursts overrun it.
+typedef KeyEvents<32> SimEventRing;
+
+// --> edges of a burst, pushed back to back: within, at and over the ring.
+static const uint32_t BURSTS[] = { 8, 24, 31, 32, 33, 48, 1, 64, 96, 16, 200, 3, 128, 30 };
+static constexpr uint32_t ROUNDS = 40;
+
+// --> a push each 2 us: a burst spans the quanta of the cores, so they interleave.
+//   : the fast reader keeps up but for the drift of the cores, the slow one falls behind by the long bursts.
+static constexpr uint64_t PUSH_COST = 2 * SimClock::US;
+static constexpr uint64_t FAST_COST = 40;
+static constexpr uint64_t SLOW_COST = 6 * SimClock::US;
+static constexpr uint64_t GAP = 200 * SimClock::US;
+
+/**
+ * Events read by a reader of the ring.
+ */
+struct SSimEventRead {
+    uint32_t seen;
+    uint32_t torn;          // --> the key or the edge doesn't match the sequence.
+    uint32_t misplaced;     // --> not the next of the sequence, lost ones counted.
+};
+
+static SimEventRing* g_simRing = nullptr;
+static SimEventRing::Reader g_simFast, g_simSlow;
+static SSimEventRead g_simFastRead, g_simSlowRead;
+
+/* get the key of the N'th event: the edge is the lowest bit of N. */
+static uint16_t keyOf(uint32_t n) {
+    return uint16_t((n * 37u) % 128u);
+}
+
+/* check the event read against its sequence, the time of the event. */
+static void check(const SKeyEvent& event, const SimEventRing::Reader& reader, SSimEventRead& read) {
+    if (event.key != keyOf(event.at) || event.edge != (event.at & 1)) {
+        read.torn++;
+    }
+
+    // --> taken: every event before was read or counted as lost, once.
+    if (event.at != read.seen + reader.lost()) {
+        read.misplaced++;
+    }
+
+    read.seen++;
+}
+
+/* the core 1: a fast reader draining all, and a slow one taking an event a loop. */
+static void readCore() {
+    while(1) {
+        SKeyEvent event;
+
+        while (g_simFast.next(event)) {
+            check(event, g_simFast, g_simFastRead);
+            SimClock::spend(FAST_COST);
+        }
+
+        if (g_simSlow.next(event)) {
+            check(event, g_simSlow, g_simSlowRead);
+            SimClock::spend(SLOW_COST);
+        }
+
+        SimClock::spend(FAST_COST);
+        SimClock::checkpoint();
+    }
+}
+
+/* push the bursts on the core 0 and read them on both cores, returns true if all accounted. */
+static bool runRing() {
+    SimBoard board;
+    SimEventRing ring;
+    SimEventRing::Reader own;
+    SSimEventRead ownRead = { 0, 0, 0 };
+    uint32_t pushed = 0, expected = 0;
+
+    g_simRing = &ring;
+    g_simFastRead = g_simSlowRead = ownRead;
+
+    board.run(200 * SimClock::MS, [&]() {
+        // --> attached before the launch: no handshake, the core 1 starts in step.
+        g_simFast.attach(&ring);
+        g_simSlow.attach(&ring);
+        own.attach(&ring);
+
+        multicore_launch_core1(readCore);
+
+        for(uint32_t round = 0; round < ROUNDS; ++round) {
+            const uint32_t burst = BURSTS[round % (sizeof(BURSTS) / sizeof(BURSTS[0]))];
+
+            for(uint32_t i = 0; i < burst; ++i, ++pushed) {
+                ring.push(keyOf(pushed), EKeyEdge(pushed & 1), pushed);
+                SimClock::spend(PUSH_COST);
+            }
+
+            // --> drained after the burst: `SIZE - 1` kept, the rest lost.
+            expected += burst >= 32 ? burst - 31 : 0;
+
+            SKeyEvent event;
+            while (own.next(event)) {
+                check(event, own, ownRead);
+            }
+
+            SimClock::sleep(GAP);
+        }
+
+        // --> the slow reader catches up.
+        SimClock::sleep(5 * SimClock::MS);
+    });
+
+    const SSimEventRead* reads[] = { &ownRead, &g_simFastRead, &g_simSlowRead };
+    const SimEventRing::Reader* readers[] = { &own, &g_simFast, &g_simSlow };
+    const char* names[] = { "core0-drain", "core1-fast", "core1-slow" };
+    bool ok = true;
+    char name[48];
+
+    simReport("pushed", pushed, "");
+
+    for(uint32_t i = 0; i < 3; ++i) {
+        snprintf(name, sizeof(name), "%s-seen", names[i]);
+        simReport(name, reads[i]->seen, "");
+
+        snprintf(name, sizeof(name), "%s-lost", names[i]);
+        simReport(name, readers[i]->lost(), "");
+
+        snprintf(name, sizeof(name), "%s-torn", names[i]);
+        simReport(name, reads[i]->torn + reads[i]->misplaced, "");
+
+        ok = ok && !reads[i]->torn && !reads[i]->misplaced
+            && reads[i]->seen + readers[i]->lost() == pushed;
+    }
+
+    // --> the reader of the bursts loses the overrun exactly, the slow one the most.
+    return ok && own.lost() == expected && g_simFast.lost() < g_simSlow.lost();
+}
+
+/* test whether the report carries the key code. */
+static bool hasKey(const SSimHidReport& report, uint8_t kc) {
+    for(uint8_t code : report.keycodes) {
+        if (code == kc) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* tap the keys in bursts faster than the HID polls, returns the taps the host missed. */
+static uint32_t runTaps(SimStats& sent, uint32_t& taps, uint32_t& dropped) {
+    constexpr uint64_t BEGIN = 100 * SimClock::MS;
+    constexpr uint64_t PERIOD = 60 * SimClock::MS;
+    constexpr uint64_t STAGGER = 700 * SimClock::US;
+    constexpr uint64_t HOLD = 1 * SimClock::MS;
+    constexpr uint32_t TAP_BURSTS = 20;
+
+    SimBoard board;
+    const uint8_t keys = EKEY_MAX < 6 ? EKEY_MAX : 6;
+
+    // --> each burst taps the keys in a row, a press every 0.7 ms: a HID poll is 5 ms.
+    for(uint32_t i = 0; i < TAP_BURSTS; ++i) {
+        for(uint8_t key = 0; key < keys; ++key) {
+            board.matrix().tap(key, BEGIN + i * PERIOD + key * STAGGER, HOLD);
+        }
+    }
+
+    board.run(BEGIN + TAP_BURSTS * PERIOD + 100 * SimClock::MS);
+
+    const std::vector<SSimHidReport>& reports = board.host().reports();
+    uint32_t missed = 0;
+
+    taps = TAP_BURSTS * keys;
+    dropped = board.host().hidDropped();
+
+    // --> each tap: the key comes in a report and goes in a later one, once each.
+    for(uint8_t key = 0; key < keys; ++key) {
+        const uint8_t kc = SIM_EVENTS_KC[key];
+        uint32_t presses = 0;
+        bool down = false;
+
+        for(const SSimHidReport& report : reports) {
+            if (hasKey(report, kc) != down) {
+                down = !down;
+                presses += down ? 1 : 0;
+            }
+        }
+
+        missed += TAP_BURSTS > presses ? TAP_BURSTS - presses : presses - TAP_BURSTS;
+    }
+
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        for(const SSimHidReport& report : reports) {
+            if (report.queued >= edge.at && report.sent && hasKey(report, SIM_EVENTS_KC[edge.key])) {
+                sent.add(report.sent - edge.at);
+                break;
+            }
+        }
+    }
+
+    return missed;
+}
+
+int simKeyEvents() {
+    const bool ring = runRing();
+
+    SimStats sent;
+    uint32_t taps = 0, dropped = 0;
+    const uint32_t missed = runTaps(sent, taps, dropped);
+
+    sent.print("tap-to-host");
+    simReport("taps", taps, "");
+    simReport("taps-missed", missed, "");
+    simReport("hid-dropped", dropped, "");
+    simReport("ring-accounted", ring ? 1 : 0, "");
+
+    return (ring && !missed && !dropped) ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * Overhead of a kind of the transactions.
+ */
+struct SSimFraming {
+    const char* name;
+    uint64_t calls;         // --> spi_*_blocking calls.
+    uint64_t frames;        // --> chip select assertions.
+    uint64_t overhead;      // --> time spent but the bytes on the wire.
+    uint32_t count;
+};
+
+// --> transactions of each kind, the erases take long.
+static constexpr uint32_t COUNT = 256;
+static constexpr uint32_t ERASES = 16;
+
+/* run the transaction `count` times and measure it, `wait` runs before each and isn't measured. */
+template<typename Fn, typename Wait>
+static SSimFraming measure(const char* name, Fn fn, Wait wait, uint32_t count = COUNT) {
+    spi_inst_t* spi = SimSpi::get(0);
+    const uint64_t byteTime = SimSpi::byteTime(spi);
+    SSimFraming result = { name, 0, 0, 0, count };
+
+    for(uint32_t i = 0; i < count; ++i) {
+        wait();
+
+        const uint64_t calls = spi->calls;
+        const uint64_t frames = spi->frames;
+        const uint64_t bytes = spi->bytes;
+        const uint64_t begin = SimClock::busy(0);
+
+        fn(i);
+
+        result.calls += spi->calls - calls;
+        result.frames += spi->frames - frames;
+        result.overhead += SimClock::busy(0) - begin - (spi->bytes - bytes) * byteTime;
+    }
+
+    return result;
+}
+
+template<typename Fn>
+static SSimFraming measure(const char* name, Fn fn) {
+    return measure(name, fn, []() { });
+}
+
+int simFraming() {
+    std::vector<SSimFraming> results;
+    uint8_t buf[W25QXX::PAGE_SIZE];
+    bool matched = true;
+
+    SimBoard board;
+    for(uint32_t i = 0; i < W25QXX::SECTOR_SIZE; ++i) {
+        board.flash().data()[i] = uint8_t(i ^ (i >> 8));
+    }
+
+    board.run(10 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+
+        results.push_back(measure("status", [&](uint32_t) {
+            flash.isBusy();
+        }));
+
+        results.push_back(measure("status-write", [&](uint32_t) {
+            flash.writeStatus(3, 0x60);
+        }));
+
+        results.push_back(measure("unique-id", [&](uint32_t) {
+            flash.readUniqueId(buf, 8);
+        }));
+
+        results.push_back(measure("read-byte", [&](uint32_t i) {
+            uint8_t val = 0;
+            matched = matched && flash.readByte(i, &val) && val == uint8_t(i);
+        }));
+
+        results.push_back(measure("read-16", [&](uint32_t i) {
+            flash.read(i * 16, buf, 16);
+            matched = matched && !memcmp(buf, board.flash().data() + i * 16, 16);
+        }));
+
+        results.push_back(measure("read-256", [&](uint32_t i) {
+            flash.read(i * 256, buf, 256);
+            matched = matched && !memcmp(buf, board.flash().data() + i * 256, 256);
+        }));
+
+        // --> to the erased sectors after the first one.
+        for(uint32_t i = 0; i < W25QXX::PAGE_SIZE; ++i) {
+            buf[i] = uint8_t(i * 3);
+        }
+
+        // --> `start*` tests the status once.
+        auto ready = [&]() { while (flash.isBusy()); };
+
+        results.push_back(measure("program-start", [&](uint32_t i) {
+            flash.startWritePage(16 + i, 0, buf, 16);
+        }, ready));
+
+        results.push_back(measure("erase-start", [&](uint32_t i) {
+            flash.startEraseSector(64 + i);
+        }, ready, ERASES));
+    });
+
+    printf("%-16s %10s %10s %14s\n", "transaction", "calls", "frames", "overhead");
+    for(const SSimFraming& each : results) {
+        printf("%-16s %10.2f %10.2f %11.0f ns\n", each.name,
+            double(each.calls) / each.count, double(each.frames) / each.count,
+            double(each.overhead) / each.count);
+    }
+
+    // --> the header and the payload: two calls at most.
+    uint64_t calls = 0, frames = 0;
+    bool batched = results.size() == 8;
+
+    for(const SSimFraming& each : results) {
+        calls += each.calls;
+        frames += each.frames;
+        batched = batched && each.calls <= 2 * each.frames;
+    }
+
+    simReport("calls-per-frame", double(calls) / frames, "");
+    simReport("batched", batched, "");
+    simReport("matched", matched, "");
+
+    return (!matched || !batched) ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "storage/confstore.h"
+#include "storage/flashfs.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Result of the workload on a capacity.
+ */
+struct SSimFsRun {
+    uint32_t sectors;       // --> data sectors.
+    uint64_t mountEmpty;
+    uint64_t mountFull;
+    double replaceRate;     // --> KB/s.
+    double appendRate;
+    double readRate;
+    bool matched;
+};
+
+// --> the sectors after the configuration ring, like the App.
+static constexpr uint32_t FS_FIRST = CONFSTORE_MAX_SECTORS;
+
+static constexpr uint32_t PROFILES = 6;
+static constexpr uint32_t PROFILE_LEN = 1024;
+static constexpr uint32_t MACROS = 4;
+static constexpr uint32_t MACRO_LEN = 4096;
+static constexpr uint32_t DUMP_LEN = 65536;
+static constexpr uint32_t LOG_RECORD = 64;
+static constexpr uint32_t LOG_RECORDS = 512;
+
+typedef std::map<std::string, std::vector<uint8_t>> SimFsFiles;
+
+/* test whether the files read same as the expected ones. */
+static bool isSame(FlashFs& fs, const SimFsFiles& files) {
+    static uint8_t buf[DUMP_LEN];
+
+    for(const auto& each : files) {
+        const uint32_t len = uint32_t(each.second.size());
+
+        if (fs.size(each.first.c_str()) != len || fs.read(each.first.c_str(), 0, buf, len) != len) {
+            return false;
+        }
+
+        if (memcmp(buf, each.second.data(), len) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void simSettleFs(FlashFs& fs) {
+    while (fs.isBusy()) {
+        fs.step();
+    }
+}
+
+std::vector<uint8_t> simMakeBytes(uint32_t len, uint32_t seed) {
+    std::vector<uint8_t> bytes(len);
+
+    for(uint32_t i = 0; i < len; ++i) {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = uint8_t(seed >> 16);
+    }
+
+    return bytes;
+}
+
+/* time the operation, in nanoseconds. */
+template<typename F>
+static uint64_t timed(F&& op) {
+    const uint64_t begin = SimClock::now();
+    op();
+    return SimClock::now() - begin;
+}
+
+/* write the profiles, macros, a dump and a log, then mount again. */
+static SSimFsRun runWorkload(uint32_t flashId) {
+    static uint8_t buf[DUMP_LEN];
+    SimBoard board(flashId);
+    SSimFsRun run;
+
+    memset(&run, 0, sizeof(run));
+
+    board.run(600 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        FlashFs fs(&flash);
+        SimFsFiles files;
+        uint64_t replaced = 0, replaceTime = 0, appendTime = 0, readTime = 0;
+        char name[FLASHFS_NAME_MAX];
+
+        flash.init();
+        flash.fastMode(true);
+
+        run.mountEmpty = timed([&]() { fs.mount(FS_FIRST, flash.sectorMax()); });
+        run.sectors = fs.sectors();
+        run.matched = true;
+
+        // --> the profiles twice: created, then edited.
+        for(uint32_t round = 0; round < 2; ++round) {
+            for(uint32_t i = 0; i < PROFILES; ++i) {
+                snprintf(name, sizeof(name), "profile%lu", (unsigned long) i);
+                files[name] = simMakeBytes(PROFILE_LEN, i * 7 + round);
+
+                replaceTime += timed([&]() {
+                    run.matched = fs.replace(name, files[name].data(), PROFILE_LEN) && run.matched;
+                    simSettleFs(fs);
+                });
+
+                replaced += PROFILE_LEN;
+            }
+        }
+
+        for(uint32_t i = 0; i < MACROS; ++i) {
+            snprintf(name, sizeof(name), "macro%lu", (unsigned long) i);
+            files[name] = simMakeBytes(MACRO_LEN, 100 + i);
+
+            replaceTime += timed([&]() {
+                run.matched = fs.replace(name, files[name].data(), MACRO_LEN) && run.matched;
+                simSettleFs(fs);
+            });
+
+            replaced += MACRO_LEN;
+        }
+
+        files["dump"] = simMakeBytes(DUMP_LEN, 200);
+        replaceTime += timed([&]() {
+            run.matched = fs.replace("dump", files["dump"].data(), DUMP_LEN) && run.matched;
+            simSettleFs(fs);
+        });
+
+        replaced += DUMP_LEN;
+
+        // --> the log: a record at a time.
+        std::vector<uint8_t>& log = files["log"];
+        for(uint32_t i = 0; i < LOG_RECORDS; ++i) {
+            const std::vector<uint8_t> record = simMakeBytes(LOG_RECORD, 300 + i);
+
+            log.insert(log.end(), record.begin(), record.end());
+            appendTime += timed([&]() {
+                run.matched = fs.append("log", record.data(), LOG_RECORD) == LOG_RECORD && run.matched;
+                simSettleFs(fs);
+            });
+        }
+
+        uint64_t readBytes = 0;
+        for(const auto& each : files) {
+            const uint32_t len = uint32_t(each.second.size());
+
+            readTime += timed([&]() { fs.read(each.first.c_str(), 0, buf, len); });
+            readBytes += len;
+        }
+
+        run.replaceRate = double(replaced) / 1024 / (double(replaceTime) / SimClock::SEC);
+        run.appendRate = double(LOG_RECORDS * LOG_RECORD) / 1024 / (double(appendTime) / SimClock::SEC);
+        run.readRate = double(readBytes) / 1024 / (double(readTime) / SimClock::SEC);
+
+        // --> mount again: the chains of the live files only.
+        FlashFs again(&flash);
+        run.mountFull = timed([&]() { again.mount(FS_FIRST, flash.sectorMax()); });
+        run.matched = run.matched && isSame(again, files);
+    });
+
+    return run;
+}
+
+/* replace a profile over and over: returns the max erases of a data sector. */
+static uint32_t runWear(uint32_t replaces, uint32_t& sectors, uint32_t& catalog, bool& matched) {
+    SimBoard board(0xef4014);
+    SimFlash& sim = board.flash();
+
+    board.run(600 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        FlashFs fs(&flash);
+        SimFsFiles files;
+
+        flash.init();
+        flash.fastMode(true);
+        fs.mount(FS_FIRST, flash.sectorMax());
+        sectors = fs.sectors();
+
+        files["macro"] = simMakeBytes(MACRO_LEN * 4, 1);
+        matched = fs.replace("macro", files["macro"].data(), MACRO_LEN * 4);
+        simSettleFs(fs);
+
+        for(uint32_t i = 0; i < replaces; ++i) {
+            files["profile"] = simMakeBytes(PROFILE_LEN, i);
+            matched = fs.replace("profile", files["profile"].data(), PROFILE_LEN) && matched;
+            simSettleFs(fs);
+        }
+
+        FlashFs again(&flash);
+        again.mount(FS_FIRST, flash.sectorMax());
+        matched = matched && isSame(again, files);
+    });
+
+    uint32_t most = 0;
+    for(uint32_t i = FS_FIRST + FLASHFS_CATALOG_SECTORS; i < sim.sectors(); ++i) {
+        most = sim.erases(i) > most ? sim.erases(i) : most;
+    }
+
+    catalog = 0;
+    for(uint32_t i = FS_FIRST; i < FS_FIRST + FLASHFS_CATALOG_SECTORS; ++i) {
+        catalog = sim.erases(i) > catalog ? sim.erases(i) : catalog;
+    }
+
+    return most;
+}
+
+/* the image: a log near the end of its sector and a profile of 2 sectors. */
+static void runImage(FlashFs& fs, const SimFsFiles& files) {
+    for(const auto& each : files) {
+        fs.replace(each.first.c_str(), each.second.data(), uint32_t(each.second.size()));
+        simSettleFs(fs);
+    }
+}
+
+/* append to the log across the sector, and replace the profile. */
+static void runEdits(FlashFs& fs, const std::vector<uint8_t>& record, const std::vector<uint8_t>& profile) {
+    fs.append("log", record.data(), uint32_t(record.size()));
+    simSettleFs(fs);
+
+    fs.replace("profile", profile.data(), uint32_t(profile.size()));
+    simSettleFs(fs);
+}
+
+/* cut the power at every SPI transaction of the edits, returns the broken boots. */
+static uint32_t runCuts(uint32_t& cuts, SimStats& mount) {
+    SimFsFiles image;
+    std::vector<uint8_t> mem;
+
+    image["log"] = simMakeBytes(FlashFs::DATA_SIZE - 100, 1);
+    image["profile"] = simMakeBytes(5000, 2);
+
+    const std::vector<uint8_t> record = simMakeBytes(300, 3);
+    const std::vector<uint8_t> profile = simMakeBytes(5000, 4);
+    const std::vector<uint8_t> more = simMakeBytes(150, 5);
+    uint64_t begin = 0, frames = 0;
+
+    // --> the reference: the image, then the edits.
+    {
+        SimBoard board(0xef4014);
+
+        board.run(60 * SimClock::SEC, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+            FlashFs fs(&flash);
+
+            flash.init();
+            flash.fastMode(true);
+            fs.mount(FS_FIRST, flash.sectorMax());
+            runImage(fs, image);
+        });
+
+        mem.assign(board.flash().data(), board.flash().data() + board.flash().capacity());
+        begin = SimSpi::get(0)->frames;
+
+        board.run(60 * SimClock::SEC, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+            FlashFs fs(&flash);
+
+            flash.init();
+            flash.fastMode(true);
+            fs.mount(FS_FIRST, flash.sectorMax());
+            runEdits(fs, record, profile);
+        });
+
+        frames = SimSpi::get(0)->frames - begin;
+    }
+
+    uint32_t broken = 0;
+    cuts = uint32_t(frames);
+
+    for(uint64_t cut = 1; cut <= frames; ++cut) {
+        SimBoard board(0xef4014);
+        memcpy(board.flash().data(), mem.data(), mem.size());
+        SimSpi::setPowerCut(0, cut);
+
+        board.run(60 * SimClock::SEC, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+            FlashFs fs(&flash);
+
+            flash.init();
+            flash.fastMode(true);
+            fs.mount(FS_FIRST, flash.sectorMax());
+            runEdits(fs, record, profile);
+        });
+
+        bool ok = false;
+        board.run(60 * SimClock::SEC, [&]() {
+            W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+            FlashFs fs(&flash);
+            SimFsFiles files = image;
+
+            flash.init();
+            flash.fastMode(true);
+            mount.add(timed([&]() { fs.mount(FS_FIRST, flash.sectorMax()); }));
+
+            // --> each edit is done or not, never a mix.
+            std::vector<uint8_t>& log = files["log"];
+            if (fs.size("log") != log.size()) {
+                log.insert(log.end(), record.begin(), record.end());
+            }
+
+            if (fs.size("profile") == profile.size()) {
+                uint8_t head[16];
+
+                fs.read("profile", 0, head, sizeof(head));
+                if (!memcmp(head, profile.data(), sizeof(head))) {
+                    files["profile"] = profile;
+                }
+            }
+
+            ok = isSame(fs, files);
+
+            // --> and it keeps working: the torn tail is moved.
+            log.insert(log.end(), more.begin(), more.end());
+            ok = ok && fs.append("log", more.data(), uint32_t(more.size())) == more.size();
+            simSettleFs(fs);
+
+            FlashFs again(&flash);
+            again.mount(FS_FIRST, flash.sectorMax());
+            ok = ok && isSame(again, files);
+        });
+
+        broken += !ok;
+    }
+
+    return broken;
+}
+
+/**
+ * Result of a change committed while the configuration store saves.
+ */
+struct SSimFsShared {
+    bool started;           // --> the store owned the flash job at the change.
+    bool refused;           // --> the next change waited for the commit.
+    uint32_t steps;         // --> main loop steps to both landed.
+    bool landed;            // --> both read back after a mount.
+};
+
+/* replace a file while the store programs its record, both stepped like the main loop. */
+static SSimFsShared runShared() {
+    SimBoard board(0xef4014);
+    SSimFsShared run = { false, false, 0, false };
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        ConfStore store(&flash);
+        FlashFs fs(&flash);
+        SimFsFiles files;
+        uint8_t conf[64];
+
+        flash.init();
+        flash.fastMode(true);
+        store.mount(0, CONFSTORE_MAX_SECTORS, sizeof(conf));
+        fs.mount(FS_FIRST, flash.sectorMax());
+
+        // --> the record is being programmed: the store owns the flash job.
+        memset(conf, 0x5a, sizeof(conf));
+        store.save(conf);
+        store.step();
+        run.started = store.isSaving() && flash.isJobRunning();
+
+        files["profile"] = simMakeBytes(PROFILE_LEN, 11);
+        const bool changed = fs.replace("profile", files["profile"].data(), PROFILE_LEN);
+        run.refused = !fs.remove("profile") && fs.isBusy();
+
+        // --> neither waits for the other: the catalog takes the job once the record's done.
+        while (run.steps < 10000 && (store.isSaving() || fs.isBusy())) {
+            store.step();
+            fs.step();
+
+            SimClock::sleep(100 * SimClock::US);
+            run.steps++;
+        }
+
+        ConfStore storeAgain(&flash);
+        FlashFs again(&flash);
+        uint8_t loaded[sizeof(conf)];
+
+        again.mount(FS_FIRST, flash.sectorMax());
+        run.landed = changed && !store.isSaving() && !fs.isBusy()
+            && storeAgain.mount(0, CONFSTORE_MAX_SECTORS, sizeof(conf)) && storeAgain.load(loaded)
+            && !memcmp(loaded, conf, sizeof(conf)) && isSame(again, files);
+    });
+
+    return run;
+}
+
+int simFs() {
+    static const uint32_t IDS[] = { 0xef4014, 0xef4017, 0xef401a };
+    bool ok = true;
+    char key[48];
+
+    for(uint32_t id : IDS) {
+        const SSimFsRun run = runWorkload(id);
+        const uint32_t mb = (1u << (id & 0xff)) >> 20;
+
+        snprintf(key, sizeof(key), "%luM-sectors", (unsigned long) mb);
+        simReport(key, run.sectors, "");
+
+        snprintf(key, sizeof(key), "%luM-mount-empty", (unsigned long) mb);
+        simReport(key, double(run.mountEmpty) / SimClock::US, "us");
+
+        snprintf(key, sizeof(key), "%luM-mount", (unsigned long) mb);
+        simReport(key, double(run.mountFull) / SimClock::US, "us");
+
+        snprintf(key, sizeof(key), "%luM-replace", (unsigned long) mb);
+        simReport(key, run.replaceRate, "KB/s");
+
+        snprintf(key, sizeof(key), "%luM-append", (unsigned long) mb);
+        simReport(key, run.appendRate, "KB/s");
+
+        snprintf(key, sizeof(key), "%luM-read", (unsigned long) mb);
+        simReport(key, run.readRate, "KB/s");
+
+        ok = ok && run.matched;
+    }
+
+    // --> a profile replaced over and over: the cursor spreads the erases.
+    constexpr uint32_t REPLACES = 1000;
+    uint32_t sectors = 0, catalog = 0;
+    bool matched = false;
+    const uint32_t most = runWear(REPLACES, sectors, catalog, matched);
+    const uint32_t spread = (REPLACES + sectors - 1) / sectors + 1;
+
+    simReport("wear-replaces", REPLACES, "");
+    simReport("wear-max-erases", most, "");
+    simReport("wear-catalog-erases", catalog, "");
+    ok = ok && matched && most <= spread;
+
+    uint32_t cuts = 0;
+    SimStats mount;
+    const uint32_t broken = runCuts(cuts, mount);
+
+    mount.print("cut-mount");
+    simReport("cut-points", cuts, "");
+    simReport("cut-broken", broken, "");
+    ok = ok && cuts && !broken;
+
+    // --> a change while the store saves: committed once the store's job is done, never hangs.
+    const SSimFsShared shared = runShared();
+
+    simReport("shared-steps", shared.steps, "");
+    simReport("shared-landed", shared.landed, "");
+    ok = ok && shared.started && shared.refused && shared.landed;
+
+    simReport("matched", ok, "");
+    return ok ? 0 : 1;
+}
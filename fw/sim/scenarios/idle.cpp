@@ -0,0 +1,187 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "app.h"
+#include "drivers/keyboard.h"
+#include "drivers/usbd/hid.h"
+#include "drivers/usbd/hid_kc.h"
+#include <pico/time.h>
+#include <tusb.h>
+
+/**
+ * Duty cycle and first-press latency of a run.
+ */
+struct SSimIdleRun {
+    SimStats queued;        // --> press to the report queued.
+    SimStats sent;          // --> press to the report polled by the host.
+    double duty;            // --> busy percents of the core 0 while no key is pressed.
+    uint32_t missed;
+};
+
+// --> presses far apart: each one is the first after the keys were quiet.
+static constexpr uint64_t BEGIN = 1200 * SimClock::MS;
+static constexpr uint64_t PERIOD = 250 * SimClock::MS;
+static constexpr uint64_t JITTER = 173 * SimClock::US;
+static constexpr uint64_t HOLD = 40 * SimClock::MS;
+static constexpr uint32_t PRESSES = 20;
+static constexpr uint64_t END = BEGIN + PRESSES * PERIOD;
+
+// --> the duty cycle is measured before the first press, after the mount.
+static constexpr uint64_t IDLE_FROM = 200 * SimClock::MS;
+
+uint8_t simKeyCode(uint8_t key) {
+    if (key == 0) {
+        return KC_0;
+    }
+
+    else if (key < 10) {
+        return uint8_t(KC_1 + key - 1);
+    }
+
+    else if (key < 36) {
+        return uint8_t(KC_A + key - 10);
+    }
+
+    return KC_NONE;
+}
+
+/* script the presses, off the millisecond ticks. */
+static void scriptPresses(SimBoard& board) {
+    for(uint32_t i = 0; i < PRESSES; ++i) {
+        board.matrix().tap(i % EKEY_MAX, BEGIN + i * PERIOD + i * JITTER, HOLD);
+    }
+}
+
+/* match the presses to the reports. */
+static void measurePresses(SimBoard& board, SSimIdleRun& run) {
+    run.missed = 0;
+
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        const SSimHidReport* found = nullptr;
+        for(const SSimHidReport& each : board.host().reports()) {
+            if (each.queued < edge.at) {
+                continue;
+            }
+
+            for(uint8_t code : each.keycodes) {
+                if (code == simKeyCode(edge.key)) {
+                    found = &each;
+                }
+            }
+
+            if (found) {
+                break;
+            }
+        }
+
+        if (!found || !found->sent) {
+            run.missed++;
+            continue;
+        }
+
+        run.queued.add(found->queued - edge.at);
+        run.sent.add(found->sent - edge.at);
+    }
+}
+
+/* the keyboard and the HID alone, scanned always or waiting for the interrupt. */
+static SSimIdleRun runLoop(bool wait) {
+    SimBoard board;
+    SSimIdleRun run;
+
+    scriptPresses(board);
+
+    uint64_t busyFrom = 0, busyTo = 0;
+    board.run(END, [&]() {
+        Keyboard kbd;
+        UsbHid hid;
+
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            kbd.getKeyPtr(EKey(i))->kc = simKeyCode(i);
+        }
+
+        hid.init(&kbd);
+        tud_init(0);
+        kbd.enableWait(wait);
+
+        while (true) {
+            const uint64_t now = SimClock::now();
+
+            // --> the busy time of the idle window.
+            if (!busyFrom && now >= IDLE_FROM) {
+                busyFrom = SimClock::busy(0);
+            }
+
+            if (!busyTo && now >= BEGIN) {
+                busyTo = SimClock::busy(0);
+            }
+
+            kbd.scanOnce();
+            hid.transmitOnce();
+            tud_task();
+
+            if (kbd.isWaiting() && !tud_task_event_ready()) {
+                best_effort_wfe_or_timeout(make_timeout_time_ms(APP_IDLE_WAKE_MS));
+            }
+        }
+    });
+
+    run.duty = 100.0 * (busyTo - busyFrom) / (BEGIN - IDLE_FROM);
+    measurePresses(board, run);
+    return run;
+}
+
+/* get the busy time of the core 0 by the App, after the time without presses. */
+static uint64_t appBusy(uint64_t at) {
+    SimBoard quiet;
+
+    quiet.run(at);
+    return SimClock::busy(0);
+}
+
+/* the App: the duty cycle of the runs without presses, then the presses. */
+static SSimIdleRun runApp() {
+    SSimIdleRun run;
+
+    // --> the boots are same: the difference is the idle window.
+    run.duty = 100.0 * (appBusy(BEGIN) - appBusy(IDLE_FROM)) / (BEGIN - IDLE_FROM);
+
+    SimBoard board;
+    scriptPresses(board);
+    board.run(END);
+
+    measurePresses(board, run);
+    return run;
+}
+
+int simIdle() {
+    SSimIdleRun poll = runLoop(false);
+    SSimIdleRun wait = runLoop(true);
+    SSimIdleRun app = runApp();
+
+    poll.queued.print("poll-first-press-queue");
+    wait.queued.print("wait-first-press-queue");
+    app.queued.print("app-first-press-queue");
+    poll.sent.print("poll-first-press-host");
+    wait.sent.print("wait-first-press-host");
+    app.sent.print("app-first-press-host");
+
+    simReport("poll-idle-duty", poll.duty, "%");
+    simReport("wait-idle-duty", wait.duty, "%");
+    simReport("app-idle-duty", app.duty, "%");
+    simReport("missed", poll.missed + wait.missed + app.missed, "");
+
+    // --> the wake-up scans at once: never later than the next tick.
+    const bool faster = wait.queued.max() < poll.queued.avg()
+        && app.queued.max() < poll.queued.avg()
+        && wait.sent.max() <= poll.sent.max();
+
+    const bool sleeps = wait.duty < poll.duty / 10 && app.duty < poll.duty / 10;
+
+    return (faster && sleeps && !poll.missed && !wait.missed && !app.missed) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "app.h"
+#include "drivers/usbd/cdc.h"
+#include "drivers/usbd/hid_kc.h"
+#include <string.h>
+
+static constexpr uint32_t SLOT = SIM_CONF_SLOT;
+
+void simPutConf(SimFlash& flash, uint32_t addr, uint32_t seq, const AppConf& conf) {
+    SConfRecord rec;
+
+    rec.magic = ConfStore::MAGIC;
+    rec.len = sizeof(conf);
+    rec.seq = seq;
+    rec.crc = ConfStore::checksum(&rec, (const uint8_t*) &conf);
+
+    memcpy(flash.data() + addr, &rec, sizeof(rec));
+    memcpy(flash.data() + addr + sizeof(rec), &conf, sizeof(conf));
+}
+
+uint32_t simFindConf(const SimFlash& flash, AppConf* conf, uint32_t* at) {
+    uint32_t newest = 0;
+
+    for(uint32_t addr = 0; addr < CONFSTORE_MAX_SECTORS * W25QXX::SECTOR_SIZE; addr += SLOT) {
+        SConfRecord rec;
+        memcpy(&rec, flash.data() + addr, sizeof(rec));
+
+        if (rec.magic != ConfStore::MAGIC || rec.len != sizeof(AppConf) || rec.seq <= newest) {
+            continue;
+        }
+
+        if (ConfStore::checksum(&rec, flash.data() + addr + sizeof(rec)) != rec.crc) {
+            continue;
+        }
+
+        memcpy(conf, flash.data() + addr + sizeof(rec), sizeof(AppConf));
+        newest = rec.seq;
+        *at = addr;
+    }
+
+    return newest;
+}
+
+int simJournal() {
+    constexpr uint32_t SLOTS = W25QXX::SECTOR_SIZE / SLOT;
+    constexpr uint32_t RECORDS = CONFSTORE_MAX_SECTORS * SLOTS;
+    constexpr uint64_t EDIT = 1300 * SimClock::MS;
+    constexpr uint32_t EDITS = 2;
+    constexpr uint64_t END = (EDITS + 2) * EDIT;
+
+    SimBoard board;
+    SimFlash& flash = board.flash();
+
+    // --> the ring is full: the newest record at the last slot,
+    //   : so the next save wraps to the first sector.
+    AppConf conf;
+
+    memset(&conf, 0, sizeof(conf));
+    conf.ver = 1;
+
+    for(uint32_t i = 0; i < EKEY_MAX; ++i) {
+        conf.keys[i] = { EKCM_NONE, uint8_t(KC_0 + i), KM_NONE, uint8_t(i) };
+    }
+
+    for(uint32_t i = 0; i < RECORDS; ++i) {
+        conf.keys[EKEY_01].kc = (i == RECORDS - 1) ? KC_Z : KC_Y;
+        simPutConf(flash, i * SLOT, i + 1, conf);
+    }
+
+    for(uint32_t i = 0; i < EDITS; ++i) {
+        const uint8_t edit[5] = { EKEY_00, 0, uint8_t(KC_A + i), 0, 0 };
+        board.host().sendCdc(ECDCM_SET_KEYS, edit, sizeof(edit), (i + 1) * EDIT);
+    }
+
+    board.run(END);
+
+    SimStats loop;
+    for(uint64_t each : board.host().taskAwake()) {
+        loop.add(each);
+    }
+
+    uint32_t at = 0;
+    const uint32_t newest = simFindConf(flash, &conf, &at);
+    const SSimFlashStats& stats = flash.stats();
+
+    // --> loaded the newest one, then appended the edits after the wrap.
+    const bool stored = newest == RECORDS + EDITS && at == (EDITS - 1) * SLOT
+        && conf.keys[EKEY_01].kc == KC_Z && conf.keys[EKEY_00].kc == KC_A + EDITS - 1;
+
+    loop.print("main-loop");
+    simReport("boot-to-loop", double(board.host().firstTaskAt()) / SimClock::MS, "ms");
+    simReport("records", newest - RECORDS, "");
+    simReport("sector-erases", flash.totalErases(), "");
+    simReport("max-sector-wear", flash.maxErases(), "cycles");
+    simReport("ignored-commands", stats.ignored, "");
+    simReport("stored", stored, "");
+
+    return (stats.ignored || !stored || flash.maxErases() != 1) ? 1 : 0;
+}
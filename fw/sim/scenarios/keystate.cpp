@@ -0,0 +1,233 @@
+#include "scenarios.h"
+#include "../stats.h"
+#include "drivers/keyboard.h"
+#include "drivers/keystate.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+/**
+ * Key states before the bitmasks: a `SKey` of each key walked at every update,
+ * a linear order set, and the orders copied to all keys. Kept here as the baseline.
+ */
+template<uint32_t KEYS>
+class SimLegacyKeys {
+private:
+    struct SLegacyKey {
+        uint8_t ls;
+        uint8_t ko;
+        uint32_t lt;
+        uint8_t cm, kc, km, ts, id;
+        uint64_t data;
+    };
+
+    SLegacyKey _state[KEYS];
+    uint16_t _orders[KEYS];
+    uint16_t _ordered;
+
+public:
+    SimLegacyKeys() : _ordered(0) {
+        memset(_state, 0, sizeof(_state));
+    }
+
+public:
+    void update(const uint32_t* levels, uint32_t now) {
+        for(uint32_t key = 0; key < KEYS; ++key) {
+            const bool prev = _state[key].ls == EKSL_RISE || _state[key].ls == EKSL_HIGH;
+            const bool next = (levels[key >> 5] >> (key & 31)) & 1;
+
+            if (prev != next) {
+                if (next) {
+                    _state[key].ls = EKSL_RISE;
+                    addOrder(uint16_t(key));
+                }
+
+                else {
+                    _state[key].ls = EKSL_FALL;
+                    removeOrder(uint16_t(key));
+                }
+
+                _state[key].lt = now;
+                continue;
+            }
+
+            if (_state[key].ls == EKSL_HIGH || _state[key].ls == EKSL_LOW) {
+                continue;
+            }
+
+            _state[key].ls = _state[key].ls == EKSL_RISE ? EKSL_HIGH : EKSL_LOW;
+            _state[key].lt = now;
+        }
+
+        for(uint32_t i = 0; i < KEYS; ++i) {
+            _state[i].ko = 0xff;
+        }
+
+        for(uint32_t i = 0; i < _ordered; ++i) {
+            _state[_orders[i]].ko = uint8_t(i);
+        }
+    }
+
+    uint16_t ordered() const { return _ordered; }
+    uint16_t order(uint32_t i) const { return _orders[i]; }
+
+private:
+    int32_t findOrder(uint16_t key) const {
+        for(uint32_t i = 0; i < _ordered; ++i) {
+            if (_orders[i] == key) {
+                return int32_t(i);
+            }
+        }
+
+        return -1;
+    }
+
+    void addOrder(uint16_t key) {
+        removeOrder(key);
+        _orders[_ordered++] = key;
+    }
+
+    void removeOrder(uint16_t key) {
+        const int32_t n = findOrder(key);
+        if (n < 0) {
+            return;
+        }
+
+        memmove(&_orders[n], &_orders[n + 1], (_ordered - n - 1) * sizeof(uint16_t));
+        _ordered--;
+    }
+};
+
+// --> scans of the trace: a press every 40 scans or so, held 20 ~ 120 scans, 6 keys down at most.
+static constexpr uint32_t SCANS = 40000;
+static constexpr uint32_t ROUNDS = 5;
+
+/* deterministic random numbers for the traces. */
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* generate the levels of the keys at each scan, `words` words a scan. */
+static std::vector<uint32_t> generateLevels(uint32_t keys, uint32_t words) {
+    std::vector<uint32_t> levels(size_t(SCANS) * words, 0);
+    std::vector<uint32_t> until(keys, 0);
+    uint32_t seed = 0x1d872b41 ^ keys;
+    uint32_t down = 0;
+
+    for(uint32_t scan = 0; scan < SCANS; ++scan) {
+        uint32_t* each = &levels[size_t(scan) * words];
+
+        if (down < 6 && nextRandom(seed) % 40 == 0) {
+            const uint32_t key = nextRandom(seed) % keys;
+
+            if (until[key] <= scan) {
+                until[key] = scan + 20 + nextRandom(seed) % 100;
+                down++;
+            }
+        }
+
+        for(uint32_t key = 0; key < keys; ++key) {
+            if (until[key] > scan) {
+                each[key >> 5] |= 1u << (key & 31);
+            }
+
+            else if (until[key] == scan && scan) {
+                down--;
+            }
+        }
+    }
+
+    return levels;
+}
+
+/* run the trace on the state, returns the best nanoseconds of the rounds. */
+template<typename T>
+static uint64_t timeUpdates(const std::vector<uint32_t>& levels, uint32_t words) {
+    uint64_t best = UINT64_MAX;
+
+    for(uint32_t round = 0; round < ROUNDS; ++round) {
+        T* state = new T();
+
+        const auto begin = std::chrono::steady_clock::now();
+        for(uint32_t scan = 0; scan < SCANS; ++scan) {
+            state->update(&levels[size_t(scan) * words], scan * 100);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const uint64_t took = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+
+        best = took < best ? took : best;
+        delete state;
+    }
+
+    return best;
+}
+
+/* test whether both hold the same keys in the same order, after each scan. */
+template<uint32_t KEYS>
+static bool isSameOrder(const std::vector<uint32_t>& levels) {
+    constexpr uint32_t WORDS = KeyState<KEYS>::WORDS;
+
+    KeyState<KEYS>* state = new KeyState<KEYS>();
+    SimLegacyKeys<KEYS>* legacy = new SimLegacyKeys<KEYS>();
+    bool same = true;
+
+    for(uint32_t scan = 0; scan < SCANS && same; ++scan) {
+        state->update(&levels[size_t(scan) * WORDS], scan);
+        legacy->update(&levels[size_t(scan) * WORDS], scan);
+
+        uint32_t i = 0;
+        for(uint32_t key = state->first(); key != KeyState<KEYS>::NONE; key = state->after(key)) {
+            same = same && i < legacy->ordered() && legacy->order(i) == key;
+            i++;
+        }
+
+        same = same && i == legacy->ordered() && i == state->count();
+    }
+
+    delete state;
+    delete legacy;
+    return same;
+}
+
+/* time both on the matrix of the size, and report the nanoseconds per update. */
+template<uint32_t KEYS>
+static bool runSize(double& speedup) {
+    constexpr uint32_t WORDS = KeyState<KEYS>::WORDS;
+    const std::vector<uint32_t> levels = generateLevels(KEYS, WORDS);
+
+    const uint64_t legacy = timeUpdates<SimLegacyKeys<KEYS>>(levels, WORDS);
+    const uint64_t bits = timeUpdates<KeyState<KEYS>>(levels, WORDS);
+    char name[48];
+
+    snprintf(name, sizeof(name), "%u-keys-legacy-per-scan", KEYS);
+    simReport(name, double(legacy) / SCANS, "ns (host)");
+
+    snprintf(name, sizeof(name), "%u-keys-bitset-per-scan", KEYS);
+    simReport(name, double(bits) / SCANS, "ns (host)");
+
+    speedup = double(legacy) / double(bits ? bits : 1);
+    snprintf(name, sizeof(name), "%u-keys-speedup", KEYS);
+    simReport(name, speedup, "x");
+
+    return isSameOrder<KEYS>(levels);
+}
+
+int simKeyState() {
+    double speedup[4];
+
+    // --> the board's matrix, then scaled up to a full keyboard and beyond.
+    bool same = runSize<EKEY_MAX>(speedup[0]);
+    same = runSize<32>(speedup[1]) && same;
+    same = runSize<128>(speedup[2]) && same;
+    same = runSize<256>(speedup[3]) && same;
+
+    simReport("same-orders", same ? 1 : 0, "");
+
+    // --> host timings are noisy: only the large matrices, where the walk dominates, are checked.
+    return (same && speedup[2] > 2 && speedup[3] > 2) ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../pio.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Transport of the reads.
+ */
+enum ESimPioMode {
+    ESIM_PIO_SPI = 0,       // --> 1-1-1 fast read on the SPI.
+    ESIM_PIO_DUAL,          // --> 1-1-2 on MOSI and MISO.
+    ESIM_PIO_QUAD,          // --> 1-1-4, IO2 and IO3 wired.
+    ESIM_PIO_MODE_MAX
+};
+
+/**
+ * Result of the reads of a transport.
+ */
+struct SSimPioRun {
+    uint8_t lines;          // --> `W25QXX::readLines()` after enabling.
+    double rate[3];         // --> KB/s for each size.
+    bool matched;
+};
+
+// --> the spare pins for IO2 and IO3 of the quad case.
+static constexpr uint8_t IO2_PIN = 20;
+static constexpr uint8_t IO3_PIN = 21;
+
+static constexpr uint32_t SIZES[3] = { 256, 4096, 65536 };
+static constexpr uint32_t READS = 4;
+
+/* fill the chip with the data to read, from the first sector. */
+static void fillChip(SimFlash& sim, uint32_t len) {
+    uint32_t state = 0x9e3779b9;
+
+    for(uint32_t i = 0; i < len; ++i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        sim.data()[i] = uint8_t(state);
+    }
+}
+
+/* read the sizes by the transport, rates in KB/s. */
+static SSimPioRun runReads(uint8_t mode) {
+    static uint8_t buf[65536];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    SSimPioRun run;
+
+    memset(&run, 0, sizeof(run));
+    run.matched = true;
+
+    fillChip(sim, 0x40000);
+    if (mode == ESIM_PIO_QUAD) {
+        board.wireFlashIo(IO2_PIN, IO3_PIN);
+    }
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+
+        if (mode == ESIM_PIO_DUAL) {
+            flash.enablePio(pio0);
+        }
+
+        else if (mode == ESIM_PIO_QUAD) {
+            flash.enablePio(pio0, IO2_PIN, IO3_PIN);
+        }
+
+        run.lines = flash.readLines();
+
+        for(uint32_t i = 0; i < 3; ++i) {
+            const uint32_t len = SIZES[i];
+            uint64_t spent = 0;
+
+            for(uint32_t n = 0; n < READS; ++n) {
+                const uint32_t addr = (n * 0x9100 + i * 0x40) % (0x40000 - len);
+                const uint64_t begin = SimClock::now();
+
+                flash.read(addr, buf, len);
+                spent += SimClock::now() - begin;
+                run.matched = run.matched && !memcmp(buf, sim.data() + addr, len);
+            }
+
+            run.rate[i] = double(len) * READS / 1024 / (double(spent) / SimClock::SEC);
+        }
+    });
+
+    return run;
+}
+
+/* enable on a part or a board the PIO can't read, returns the lines and whether the reads matched. */
+static uint8_t runFallback(uint32_t kind, bool& matched) {
+    static uint8_t buf[4096];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    uint8_t lines = 0;
+
+    matched = true;
+    if (kind != 2) {
+        fillChip(sim, 0x10000);
+    }
+
+    // --> 0: IO2 and IO3 not wired, 1: no dual and quad reads in the SFDP, 2: blank chip.
+    if (kind == 1) {
+        SSimSfdpDesc desc = SimFlash::winbond(sim.capacity());
+
+        desc.dual = desc.quad = false;
+        sim.setSfdp(SimFlash::makeSfdp(desc));
+    }
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enablePio(pio0, IO2_PIN, IO3_PIN);
+        lines = flash.readLines();
+
+        flash.read(0x100, buf, sizeof(buf));
+        matched = !memcmp(buf, sim.data() + 0x100, sizeof(buf));
+    });
+
+    return lines;
+}
+
+/* enable on a blank chip, then save a record: returns the lines before and after, and whether the reads matched. */
+static uint8_t runBlank(uint8_t& before, bool& matched) {
+    constexpr uint32_t RECORD_ADDR = 0x123440;
+    static uint8_t buf[4096];
+    uint8_t record[64];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    uint8_t lines = 0;
+
+    for(uint32_t i = 0; i < sizeof(record); ++i) {
+        record[i] = uint8_t(0x5a ^ (i * 29));
+    }
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enablePio(pio0);
+        before = flash.readLines();
+
+        // --> the first record on the erased chip, as the store appends it.
+        flash.startJob(RECORD_ADDR, record, sizeof(record), false);
+        while (flash.stepJob() != EW25J_DONE) {
+            SimClock::sleep(100 * SimClock::US);
+        }
+
+        lines = flash.readLines();
+
+        flash.read(RECORD_ADDR & ~0xfffu, buf, sizeof(buf));
+        matched = !memcmp(buf, sim.data() + (RECORD_ADDR & ~0xfffu), sizeof(buf))
+            && !memcmp(sim.data() + RECORD_ADDR, record, sizeof(record));
+    });
+
+    return lines;
+}
+
+/* short reads stay on the SPI: returns the PIO instructions run by them. */
+static uint64_t runShort(bool& matched) {
+    uint8_t buf[W25QXX_PIO_MIN - 1];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    uint64_t executed = 0;
+
+    fillChip(sim, 0x10000);
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enablePio(pio0);
+
+        const uint64_t begin = SimPio::executed();
+        matched = flash.readLines() == 2;
+
+        for(uint32_t i = 0; i < 64; ++i) {
+            flash.read(i * 97, buf, sizeof(buf));
+            matched = matched && !memcmp(buf, sim.data() + i * 97, sizeof(buf));
+        }
+
+        executed = SimPio::executed() - begin;
+    });
+
+    return executed;
+}
+
+int simPio() {
+    static const char* MODES[] = { "spi", "dual", "quad" };
+    SSimPioRun runs[ESIM_PIO_MODE_MAX];
+    bool ok = true;
+    char key[48];
+
+    for(uint8_t mode = 0; mode < ESIM_PIO_MODE_MAX; ++mode) {
+        runs[mode] = runReads(mode);
+        ok = ok && runs[mode].matched && runs[mode].lines == (mode == ESIM_PIO_SPI ? 1 : 2 * mode);
+
+        snprintf(key, sizeof(key), "%s-lines", MODES[mode]);
+        simReport(key, runs[mode].lines, "");
+
+        for(uint32_t i = 0; i < 3; ++i) {
+            snprintf(key, sizeof(key), "%s-%lu", MODES[mode], (unsigned long) SIZES[i]);
+            simReport(key, runs[mode].rate[i], "KB/s");
+        }
+    }
+
+    // --> the streaming reads gain, the page reads at least don't lose.
+    for(uint8_t mode = ESIM_PIO_DUAL; mode < ESIM_PIO_MODE_MAX; ++mode) {
+        snprintf(key, sizeof(key), "%s-speedup", MODES[mode]);
+        simReport(key, runs[mode].rate[2] / runs[ESIM_PIO_SPI].rate[2], "x");
+
+        ok = ok && runs[mode].rate[2] > runs[ESIM_PIO_SPI].rate[2]
+            && runs[mode].rate[0] >= runs[ESIM_PIO_SPI].rate[0] * 0.9;
+    }
+
+    // --> each falls back, and reads the same.
+    static const char* FALLBACKS[] = { "unwired-lines", "no-dual-lines", "blank-lines" };
+    static const uint8_t EXPECTED[] = { 2, 1, 1 };
+
+    for(uint32_t kind = 0; kind < 3; ++kind) {
+        bool matched = false;
+        const uint8_t lines = runFallback(kind, matched);
+
+        simReport(FALLBACKS[kind], lines, "");
+        ok = ok && matched && lines == EXPECTED[kind];
+    }
+
+    // --> a blank chip reads on the SPI until the first record, then checks and moves to the PIO.
+    uint8_t before = 0;
+    bool matched = false;
+    const uint8_t after = runBlank(before, matched);
+
+    simReport("blank-lines-before", before, "");
+    simReport("blank-lines-after-record", after, "");
+    ok = ok && matched && before == 1 && after == 2;
+
+    const uint64_t executed = runShort(matched);
+
+    simReport("short-pio-instructions", double(executed), "");
+    ok = ok && matched && executed == 0;
+
+    simReport("matched", ok, "");
+    return ok ? 0 : 1;
+}
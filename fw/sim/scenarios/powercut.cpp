@@ -0,0 +1,161 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "app.h"
+#include "drivers/usbd/hid_kc.h"
+#include <string.h>
+
+/**
+ * Result of a run of the store.
+ */
+struct SSimStoreRun {
+    bool loaded;
+    AppConf conf;           // --> the configuration loaded.
+    uint64_t mountTime;
+    uint64_t saved[2];      // --> SPI frames until each save verified.
+};
+
+// --> a step per main loop, about a status poll at 1 MHz.
+static constexpr uint64_t STEP_PERIOD = 25 * SimClock::US;
+
+/* run the store alone: mount, load, then save the edits one by one. */
+static void runStore(SSimStoreRun& result, const uint8_t* edits, uint32_t count) {
+    W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+    ConfStore store(&flash);
+    AppConf conf;
+
+    memset(&result, 0, sizeof(result));
+    memset(&conf, 0, sizeof(conf));
+    flash.init();
+    flash.fastMode(true);
+
+    const uint64_t begin = SimClock::now();
+    result.loaded = store.mount(0, CONFSTORE_MAX_SECTORS, sizeof(conf)) && store.load(&conf);
+    result.mountTime = SimClock::now() - begin;
+
+    if (result.loaded) {
+        result.conf = conf;
+    }
+
+    for(uint32_t i = 0; i < count; ++i) {
+        conf.keys[EKEY_00].kc = edits[i];
+        store.save(&conf);
+
+        // --> the main loop does other work between the steps.
+        while (store.isSaving()) {
+            store.step();
+            SimClock::spend(STEP_PERIOD);
+        }
+
+        result.saved[i] = SimSpi::get(0)->frames;
+    }
+}
+
+/* make the configuration with the key code of EKEY_00. */
+static AppConf makeConf(uint8_t kc) {
+    AppConf conf;
+
+    memset(&conf, 0, sizeof(conf));
+    conf.ver = 1;
+
+    for(uint32_t i = 0; i < EKEY_MAX; ++i) {
+        conf.keys[i] = { EKCM_NONE, uint8_t(KC_0 + i), KM_NONE, uint8_t(i) };
+    }
+
+    conf.keys[EKEY_00].kc = kc;
+    return conf;
+}
+
+/* test whether the run loaded the configuration or not. */
+static bool isLoaded(const SSimStoreRun& run, uint8_t kc) {
+    const AppConf conf = makeConf(kc);
+    return run.loaded && memcmp(&run.conf, &conf, sizeof(conf)) == 0;
+}
+
+/* the image: sector 0 has a free slot at the end, sector 1 holds older records. */
+static void putImage(SimFlash& flash) {
+    constexpr uint32_t SLOTS = W25QXX::SECTOR_SIZE / SIM_CONF_SLOT;
+    AppConf conf = makeConf(KC_X);
+
+    for(uint32_t i = 0; i < SLOTS; ++i) {
+        simPutConf(flash, W25QXX::SECTOR_SIZE + i * SIM_CONF_SLOT, 100 - SLOTS + i, conf);
+    }
+
+    for(uint32_t i = 0; i < SLOTS - 1; ++i) {
+        conf.keys[EKEY_00].kc = (i == SLOTS - 2) ? KC_Z : KC_Y;
+        simPutConf(flash, i * SIM_CONF_SLOT, 100 + i, conf);
+    }
+}
+
+int simPowerCut() {
+    constexpr uint64_t RUN = 500 * SimClock::MS;
+    const uint8_t edits[2] = { KC_A, KC_B };
+    const uint8_t again = KC_C;
+
+    // --> the reference: the 1st edit fills the sector 0,
+    //   : the 2nd one waits for the sector 1 to be erased.
+    SSimStoreRun ref;
+    uint64_t frames = 0;
+    {
+        SimBoard board;
+        putImage(board.flash());
+
+        board.run(RUN, [&]() { runStore(ref, edits, 2); });
+        frames = SimSpi::get(0)->frames;
+    }
+
+    if (!isLoaded(ref, KC_Z) || !ref.saved[1]) {
+        simReport("reference", 0, "");
+        return 1;
+    }
+
+    SimStats mount;
+    uint32_t kept[3] = { 0, }, lost = 0, rolled = 0, broken = 0;
+
+    // --> cut the power at every SPI transaction of the reference,
+    //   : then boot on the torn image and save once more.
+    for(uint64_t cut = 1; cut <= frames; ++cut) {
+        SimBoard board;
+        SSimStoreRun torn, boot, check;
+
+        putImage(board.flash());
+        SimSpi::setPowerCut(0, cut);
+
+        board.run(RUN, [&]() { runStore(torn, edits, 2); });
+        board.run(RUN, [&]() { runStore(boot, &again, 1); });
+        board.run(RUN, [&]() { runStore(check, nullptr, 0); });
+
+        mount.add(boot.mountTime);
+
+        // --> exactly one of them, never a mix or the defaults.
+        const bool old = isLoaded(boot, KC_Z);
+        const bool first = isLoaded(boot, KC_A);
+        const bool second = isLoaded(boot, KC_B);
+
+        kept[0] += old;
+        kept[1] += first;
+        kept[2] += second;
+        lost += !old && !first && !second;
+
+        // --> once verified, a save never rolls back.
+        if ((cut > ref.saved[1] && !second) || (cut > ref.saved[0] && old)) {
+            rolled++;
+        }
+
+        // --> the store keeps working after the cut.
+        if (!isLoaded(check, again)) {
+            broken++;
+        }
+    }
+
+    mount.print("mount");
+    simReport("cut-points", double(frames), "");
+    simReport("kept-old", kept[0], "");
+    simReport("kept-1st", kept[1], "");
+    simReport("kept-2nd", kept[2], "");
+    simReport("lost", lost, "");
+    simReport("rolled-back", rolled, "");
+    simReport("unwritable", broken, "");
+
+    return (lost || rolled || broken) ? 1 : 0;
+}
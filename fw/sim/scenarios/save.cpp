@@ -0,0 +1,84 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "app.h"
+#include <string.h>
+#include "drivers/usbd/cdc.h"
+#include "drivers/usbd/hid_kc.h"
+
+int simSave() {
+    constexpr uint64_t EDIT = 1300 * SimClock::MS;
+    constexpr uint32_t EDITS = 3;
+    constexpr uint64_t TAP = 17300 * SimClock::US;
+    constexpr uint64_t STALL = 1 * SimClock::MS;
+    constexpr uint64_t END = (EDITS + 2) * EDIT;
+
+    SimBoard board;
+    SimFlash& flash = board.flash();
+
+    // --> remap EKEY_00 again and again: each edit saves 1 s later.
+    //   : the default config is saved 1 s after the boot too.
+    for(uint32_t i = 0; i < EDITS; ++i) {
+        const uint8_t conf[5] = { EKEY_00, 0, uint8_t(KC_A + i), 0, 0 };
+        board.host().sendCdc(ECDCM_SET_KEYS, conf, sizeof(conf), (i + 1) * EDIT);
+    }
+
+    // --> keep typing EKEY_11 meanwhile.
+    for(uint64_t at = 100 * SimClock::MS; at + TAP < END; at += TAP) {
+        board.matrix().tap(EKEY_11, at, TAP / 2);
+    }
+
+    board.run(END);
+
+    SimStats loop, stalls, latency;
+    for(uint64_t each : board.host().taskAwake()) {
+        loop.add(each);
+
+        if (each >= STALL) {
+            stalls.add(each);
+        }
+    }
+
+    // --> press to the first report which carries the key.
+    const std::vector<SSimHidReport>& reports = board.host().reports();
+    size_t n = 0;
+
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        while (n < reports.size() && (reports[n].queued < edge.at || reports[n].keycodes[0] != KC_4)) {
+            n++;
+        }
+
+        if (n < reports.size() && reports[n].sent) {
+            latency.add(reports[n].sent - edge.at);
+        }
+    }
+
+    const SSimFlashStats& stats = flash.stats();
+    const uint32_t saves = EDITS + 1;
+
+    loop.print("main-loop");
+    stalls.print("main-loop-stalls");
+    latency.print("scan-to-host");
+    simReport("saves", saves, "");
+    simReport("erases-per-save", double(flash.totalErases()) / saves, "sectors");
+    simReport("programs-per-save", double(stats.programs) / saves, "pages");
+    simReport("max-sector-wear", flash.maxErases(), "cycles");
+    simReport("flash-busy", double(stats.busyTime) / SimClock::MS, "ms");
+    simReport("ignored-commands", stats.ignored, "");
+    simReport("stuck-bits", stats.stuckBits, "");
+
+    // --> the last edit should be the newest record of the store.
+    AppConf conf;
+    uint32_t at = 0;
+
+    memset(&conf, 0, sizeof(conf));
+    simFindConf(flash, &conf, &at);
+    const bool stored = conf.ver == 1 && conf.keys[EKEY_00].kc == KC_A + EDITS - 1;
+    simReport("stored", stored, "");
+
+    return (stats.stuckBits || stats.ignored || !stored) ? 1 : 0;
+}
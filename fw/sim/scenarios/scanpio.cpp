@@ -0,0 +1,239 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../keytrace.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyboard.h"
+#include "drivers/keyscan.h"
+#include "drivers/usbd/hid.h"
+#include "drivers/usbd/hid_kc.h"
+#include <hardware/pio.h>
+#include <tusb.h>
+#include <vector>
+
+/**
+ * A run of the keyboard and the HID alone, on a scanner.
+ */
+struct SSimScanPioRun {
+    SimStats stamp;         // --> press to the time of the first snapshot with it.
+    SimKeyTrace trace;      // --> the snapshots taken.
+    std::vector<uint8_t> keys;  // --> the keys reported, in order.
+    uint64_t busy;          // --> core 0 in the scanner, nanoseconds.
+    uint32_t missed;        // --> presses no snapshot saw.
+    uint32_t overruns;
+    bool fitted;            // --> the scanner initialized: the PIO's fails if the matrix doesn't fit.
+};
+
+static constexpr uint64_t BEGIN = 20 * SimClock::MS;
+static constexpr uint64_t PERIOD = 9700 * SimClock::US;
+static constexpr uint64_t JITTER = 37 * SimClock::US;
+static constexpr uint32_t TAPS = 48;
+static constexpr uint64_t END = BEGIN + TAPS * PERIOD + 20 * SimClock::MS;
+
+// --> taps of 400us: shorter than the stall of the busy loop, every other one.
+static constexpr uint64_t HOLD = 6 * SimClock::MS;
+static constexpr uint64_t SHORT_HOLD = 400 * SimClock::US;
+static constexpr uint64_t STALL = 700 * SimClock::US;
+
+/* find the keys of the reports: a key is counted when it appears. */
+static void collectKeys(SimBoard& board, SSimScanPioRun& run) {
+    uint8_t prev[6] = { 0, };
+
+    for(const SSimHidReport& each : board.host().reports()) {
+        for(uint8_t code : each.keycodes) {
+            bool found = false;
+
+            for(uint8_t old : prev) {
+                found = found || (code && old == code);
+            }
+
+            if (code && !found) {
+                run.keys.push_back(code);
+            }
+        }
+
+        for(uint32_t i = 0; i < 6; ++i) {
+            prev[i] = each.keycodes[i];
+        }
+    }
+}
+
+/* match the presses to the snapshots of the trace. */
+static void measureStamps(SimBoard& board, SSimScanPioRun& run) {
+    run.missed = 0;
+
+    const std::vector<SSimKeyEdge>& edges = board.matrix().edges();
+
+    for(size_t i = 0; i < edges.size(); ++i) {
+        const SSimKeyEdge& edge = edges[i];
+        if (!edge.down) {
+            continue;
+        }
+
+        const uint8_t row = edge.key / Board::MAX_COL;
+        const uint32_t mask = 1u << (edge.key % Board::MAX_COL);
+
+        // --> until the release.
+        uint64_t release = UINT64_MAX;
+        for(size_t j = i + 1; j < edges.size(); ++j) {
+            if (edges[j].key == edge.key && !edges[j].down) {
+                release = edges[j].at;
+                break;
+            }
+        }
+
+        // --> a PIO snapshot is stamped at its start: the row is sampled a few cycles later.
+        const SKeyScan* found = nullptr;
+        for(const SKeyScan& each : run.trace) {
+            const uint64_t at = each.at * SimClock::US;
+
+            if (at + 10 * SimClock::US >= edge.at && at < release && (each.rows[row] & mask)) {
+                found = &each;
+                break;
+            }
+        }
+
+        if (!found) {
+            run.missed++;
+            continue;
+        }
+
+        const uint64_t at = found->at * SimClock::US;
+        run.stamp.add(at > edge.at ? at - edge.at : 0);
+    }
+}
+
+/* run on the CPU's scanner or the PIO's, the loop stalls after each iteration. */
+static SSimScanPioRun runScan(bool pio, uint64_t stall) {
+    SimBoard board;
+    SSimScanPioRun run;
+
+    // --> every other tap is short.
+    for(uint32_t i = 0; i < TAPS; ++i) {
+        board.matrix().tap(i % EKEY_MAX, BEGIN + i * PERIOD + i * JITTER, (i % 2) ? SHORT_HOLD : HOLD);
+    }
+
+    run.busy = 0;
+    run.overruns = 0;
+    run.fitted = !pio;
+
+    board.run(END, [&]() {
+        Keyboard kbd;
+        UsbHid hid;
+        PioScanner scanner;
+        SimTraceScanner recorder(pio ? (KeyScanner*) &scanner : kbd.scanner(), run.trace);
+
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            kbd.getKeyPtr(EKey(i))->kc = simKeyCode(i);
+        }
+
+        if (pio && !scanner.init(pio1)) {
+            return;
+        }
+
+        run.fitted = true;
+
+        kbd.setScanner(&recorder);
+        hid.init(&kbd);
+        tud_init(0);
+
+        while (true) {
+            kbd.scanOnce();
+            hid.transmitOnce();
+            tud_task();
+
+            run.busy = recorder.busy();
+            run.overruns = scanner.overruns();
+            SimClock::spend(stall);
+        }
+    });
+
+    measureStamps(board, run);
+    collectKeys(board, run);
+    return run;
+}
+
+/* replay the trace on a board without presses. */
+static SSimScanPioRun runReplay(const SimKeyTrace& trace) {
+    SimBoard board;
+    SSimScanPioRun run;
+
+    run.busy = 0;
+    run.overruns = 0;
+    run.missed = 0;
+    run.fitted = true;
+
+    board.run(END, [&]() {
+        Keyboard kbd;
+        UsbHid hid;
+        SimTraceScanner player(trace);
+
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            kbd.getKeyPtr(EKey(i))->kc = simKeyCode(i);
+        }
+
+        kbd.setScanner(&player);
+        hid.init(&kbd);
+        tud_init(0);
+
+        while (true) {
+            kbd.scanOnce();
+            hid.transmitOnce();
+            tud_task();
+        }
+    });
+
+    collectKeys(board, run);
+    return run;
+}
+
+int simScanPio() {
+    SSimScanPioRun gpio = runScan(false, 0);
+    SSimScanPioRun gpioStall = runScan(false, STALL);
+
+    const uint64_t period = KEYBOARD_SCAN_US * SimClock::US;
+    const bool stalls = gpioStall.missed > 0 && gpioStall.stamp.max() > period;
+
+    gpio.stamp.print("gpio-press-to-stamp");
+    gpioStall.stamp.print("gpio-stalled-press-to-stamp");
+
+    simReport("gpio-cpu-per-scan", double(gpio.busy) / gpio.trace.size(), "ns");
+    simReport("gpio-scans", gpio.trace.size(), "");
+    simReport("gpio-stalled-scans", gpioStall.trace.size(), "");
+    simReport("gpio-stalled-missed", gpioStall.missed, "");
+
+    SSimScanPioRun pio = runScan(true, 0);
+    simReport("pio-fitted", pio.fitted, "");
+
+    // --> the matrix doesn't fit the PIO program: the CPU's scanner only.
+    if (!pio.fitted) {
+        return (stalls && !gpio.missed) ? 0 : 1;
+    }
+
+    SSimScanPioRun pioStall = runScan(true, STALL);
+
+    pio.stamp.print("pio-press-to-stamp");
+    pioStall.stamp.print("pio-stalled-press-to-stamp");
+
+    simReport("pio-cpu-per-scan", double(pio.busy) / pio.trace.size(), "ns");
+    simReport("pio-scans", pio.trace.size(), "");
+    simReport("pio-stalled-scans", pioStall.trace.size(), "");
+    simReport("pio-stalled-missed", pioStall.missed, "");
+    simReport("pio-overruns", pio.overruns + pioStall.overruns, "");
+
+    // --> the recorded matrix replayed: the same keys reported, without a press.
+    SSimScanPioRun replay = runReplay(pio.trace);
+    simReport("recorded-keys", pio.keys.size(), "");
+    simReport("replayed-keys", replay.keys.size(), "");
+
+    // --> the PIO scans at its own pace: the stalls don't delay nor lose a press,
+    //   : only the snapshots of the last stall aren't taken.
+    const bool cheap = pio.busy * 4 < gpio.busy;
+    const bool paced = pio.stamp.max() <= period && pioStall.stamp.max() <= period
+        && !pio.missed && !pioStall.missed && !pio.overruns && !pioStall.overruns
+        && pioStall.trace.size() + STALL / period + 1 >= pio.trace.size();
+
+    const bool replayed = replay.keys == pio.keys && !replay.keys.empty();
+
+    return (cheap && paced && stalls && replayed && !gpio.missed) ? 0 : 1;
+}
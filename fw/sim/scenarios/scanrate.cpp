@@ -0,0 +1,133 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyboard.h"
+#include "drivers/usbd/cdc.h"
+#include "drivers/usbd/hid_kc.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Latency of a typing run at the scan period.
+ */
+struct SSimScanRun {
+    SimStats queued;        // --> press to the report queued.
+    SimStats sent;          // --> press to the report polled by the host.
+    uint32_t period;        // --> the period replied, microseconds.
+    uint32_t missed;
+};
+
+static constexpr uint64_t REQUEST = 50 * SimClock::MS;
+static constexpr uint64_t BEGIN = 100 * SimClock::MS;
+static constexpr uint64_t PERIOD = 37300 * SimClock::US;
+static constexpr uint64_t HOLD = 23 * SimClock::MS;
+static constexpr uint32_t TAPS = 36;
+
+// --> key codes of `App::defaultKeyConf()`.
+static const uint8_t SIM_SCAN_KC[EKEY_MAX] = {
+    KC_0, KC_1, KC_2, KC_3, KC_4, KC_5
+};
+
+/* set the period over the CDC, then type on the App. */
+static SSimScanRun runTyping(uint32_t period) {
+    SimBoard board;
+    SimUsbHost& host = board.host();
+    SSimScanRun run;
+
+    uint8_t data[4];
+    memcpy(data, &period, sizeof(data));
+    host.sendCdc(ECDCM_SCAN_PERIOD, data, sizeof(data), REQUEST);
+
+    for(uint32_t i = 0; i < TAPS; ++i) {
+        board.matrix().tap(i % EKEY_MAX, BEGIN + i * PERIOD, HOLD);
+    }
+
+    board.run(BEGIN + TAPS * PERIOD + 100 * SimClock::MS);
+
+    run.period = 0;
+    run.missed = 0;
+
+    for(const SSimCdcMessage& msg : host.cdcMessages()) {
+        if (msg.valid && msg.opcode == ECDCM_SCAN_PERIOD && msg.length == sizeof(run.period)) {
+            memcpy(&run.period, msg.data, sizeof(run.period));
+        }
+    }
+
+    bool first = true;
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        // --> woken by the interrupt: scanned at once, whatever the period.
+        if (first) {
+            first = false;
+            continue;
+        }
+
+        const SSimHidReport* found = nullptr;
+        for(const SSimHidReport& each : host.reports()) {
+            if (each.queued < edge.at) {
+                continue;
+            }
+
+            for(uint8_t code : each.keycodes) {
+                if (code == SIM_SCAN_KC[edge.key]) {
+                    found = &each;
+                }
+            }
+
+            if (found) {
+                break;
+            }
+        }
+
+        if (!found || !found->sent) {
+            run.missed++;
+            continue;
+        }
+
+        run.queued.add(found->queued - edge.at);
+        run.sent.add(found->sent - edge.at);
+    }
+
+    return run;
+}
+
+int simScanRate() {
+    static const uint32_t PERIODS[] = { 1000, 500, 250, 125 };
+    SSimScanRun runs[sizeof(PERIODS) / sizeof(PERIODS[0])];
+    char name[48];
+    bool ok = true;
+
+    for(uint32_t i = 0; i < sizeof(PERIODS) / sizeof(PERIODS[0]); ++i) {
+        runs[i] = runTyping(PERIODS[i]);
+
+        snprintf(name, sizeof(name), "%luus-scan-to-queue", (unsigned long) PERIODS[i]);
+        runs[i].queued.print(name);
+
+        snprintf(name, sizeof(name), "%luus-scan-to-host", (unsigned long) PERIODS[i]);
+        runs[i].sent.print(name);
+
+        ok = ok && runs[i].period == PERIODS[i] && !runs[i].missed;
+    }
+
+    // --> out of range: kept as the default.
+    const SSimScanRun rejected = runTyping(KEYBOARD_SCAN_MIN_US - 1);
+    simReport("rejected-period", rejected.period, "us");
+
+    const SSimScanRun& tick = runs[0];
+    const SSimScanRun& fast = runs[sizeof(PERIODS) / sizeof(PERIODS[0]) - 1];
+
+    simReport("queue-avg-reduction", (tick.queued.avg() - fast.queued.avg()) / SimClock::US, "us");
+    simReport("queue-max-reduction", (double(tick.queued.max()) - double(fast.queued.max())) / SimClock::US, "us");
+    simReport("host-avg-reduction", (tick.sent.avg() - fast.sent.avg()) / SimClock::US, "us");
+
+    // --> the latency is a period at most, so it scales with the period.
+    ok = ok && rejected.period == KEYBOARD_SCAN_US
+        && fast.queued.avg() < tick.queued.avg() && fast.queued.max() < tick.queued.max()
+        && fast.queued.max() <= PERIODS[sizeof(PERIODS) / sizeof(PERIODS[0]) - 1] * SimClock::US + 20 * SimClock::US;
+
+    return ok ? 0 : 1;
+}
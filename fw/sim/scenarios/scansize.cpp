@@ -0,0 +1,149 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/keyscan.h"
+#include <hardware/gpio.h>
+#include <stdio.h>
+#include <string.h>
+
+// --> the matrices between the pad and the largest, off the flash pins.
+typedef SBoard<SPins<0, 1, 2, 3>, SPins<4, 5, 6, 7, 8, 9, 10, 11>, SLeds<>> SimBoard4x8;
+typedef SBoard<SPins<0, 1, 2, 3, 4, 5, 6, 7>, SPins<8, 9, 10, 11, 12, 13, 14, 15>, SLeds<>> SimBoard8x8;
+
+static constexpr uint32_t SCANS = 400;
+static constexpr uint64_t BEGIN = 1 * SimClock::MS;
+static constexpr uint64_t END = BEGIN + (SCANS + 1) * SimClock::MS;
+
+/**
+ * Scan cost of a matrix, nanoseconds of the core.
+ */
+struct SSimScanSize {
+    uint64_t legacy;        // --> per scan, a read per column.
+    uint64_t unrolled;      // --> per scan, a read per row.
+    uint32_t seen;          // --> keys read down, by both.
+    bool same;
+};
+
+/* deterministic random numbers for the taps. */
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* scan the matrix as before the board description: the loops at run time, a `gpio_get` per column. */
+template<typename B>
+static void scanLegacy(typename B::row_t* rows) {
+    memset(rows, 0, sizeof(typename B::row_t) * B::MAX_ROW);
+
+    for(uint8_t i = 0; i < B::MAX_ROW; ++i) {
+        const uint8_t row = B::Rows::PIN[i];
+
+        gpio_put(row, 1);
+        KeyScanner::delayNs();
+
+        for(uint8_t j = 0; j < B::MAX_COL; ++j) {
+            if (gpio_get(B::Cols::PIN[j])) {
+                rows[i] |= typename B::row_t(1u << j);
+            }
+        }
+
+        gpio_put(row, 0);
+        KeyScanner::delayNs();
+    }
+}
+
+/* scan the matrix of the board both ways, a millisecond apart, the keys tapped between the scans. */
+template<typename B>
+static SSimScanSize runSize() {
+    SimBoard board;
+    SimMatrix matrix(B::Rows::PIN, B::MAX_ROW, B::Cols::PIN, B::MAX_COL);
+    SSimScanSize run = { 0, 0, 0, true };
+    uint32_t seed = 0x2f6b1c93 ^ B::MAX_KEY;
+
+    // --> between the scans: both read the same levels.
+    for(uint32_t i = 0; i < SCANS; ++i) {
+        const uint64_t at = BEGIN + i * SimClock::MS + 500 * SimClock::US;
+        matrix.tap(uint8_t(nextRandom(seed) % B::MAX_KEY), at, (1 + nextRandom(seed) % 8) * SimClock::MS);
+    }
+
+    matrix.attach();
+
+    board.run(END, [&]() {
+        for(uint8_t i = 0; i < B::MAX_ROW; ++i) {
+            gpio_init(B::Rows::PIN[i]);
+            gpio_set_dir(B::Rows::PIN[i], GPIO_OUT);
+        }
+
+        for(uint8_t i = 0; i < B::MAX_COL; ++i) {
+            gpio_init(B::Cols::PIN[i]);
+        }
+
+        for(uint32_t i = 0; i < SCANS; ++i) {
+            typename B::row_t legacy[B::MAX_ROW], unrolled[B::MAX_ROW];
+            SimClock::sleepUntil(BEGIN + i * SimClock::MS);
+
+            const uint64_t t0 = SimClock::now();
+            scanLegacy<B>(legacy);
+
+            const uint64_t t1 = SimClock::now();
+            MatrixScan<B>::scan(unrolled);
+
+            const uint64_t t2 = SimClock::now();
+
+            run.legacy += t1 - t0;
+            run.unrolled += t2 - t1;
+            run.same = run.same && memcmp(legacy, unrolled, sizeof(legacy)) == 0;
+
+            for(uint8_t j = 0; j < B::MAX_ROW; ++j) {
+                run.seen += __builtin_popcount(legacy[j]);
+            }
+        }
+    });
+
+    run.legacy /= SCANS;
+    run.unrolled /= SCANS;
+    return run;
+}
+
+/* report the run of the size. */
+static void report(const char* size, const SSimScanSize& run) {
+    char name[48];
+
+    snprintf(name, sizeof(name), "%s-legacy-per-scan", size);
+    simReport(name, double(run.legacy), "ns");
+
+    snprintf(name, sizeof(name), "%s-unrolled-per-scan", size);
+    simReport(name, double(run.unrolled), "ns");
+
+    snprintf(name, sizeof(name), "%s-keys-seen", size);
+    simReport(name, run.seen, "");
+}
+
+int simScanSize() {
+    const SSimScanSize pad = runSize<SBoardLayout<EBRD_PAD_2X3>::Type>();
+    const SSimScanSize pad4x4 = runSize<SBoardLayout<EBRD_PAD_4X4>::Type>();
+    const SSimScanSize pad4x8 = runSize<SimBoard4x8>();
+    const SSimScanSize pad8x8 = runSize<SimBoard8x8>();
+    const SSimScanSize pad8x16 = runSize<SBoardLayout<EBRD_PAD_8X16>::Type>();
+
+    report("2x3", pad);
+    report("4x4", pad4x4);
+    report("4x8", pad4x8);
+    report("8x8", pad8x8);
+    report("8x16", pad8x16);
+
+    const SSimScanSize* runs[] = { &pad, &pad4x4, &pad4x8, &pad8x8, &pad8x16 };
+    bool ok = true;
+
+    for(const SSimScanSize* each : runs) {
+        ok = ok && each->same && each->seen > 0 && each->unrolled < each->legacy;
+    }
+
+    // --> a read per row: the columns cost nothing more, the 8x16 same with the 8x8.
+    ok = ok && pad8x16.unrolled == pad8x8.unrolled && pad4x8.unrolled == pad4x4.unrolled;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#ifndef __SIM_SCENARIOS_SCENARIOS_H__
+#define __SIM_SCENARIOS_SCENARIOS_H__
+
+/**
+ * Simulator scenarios.
+ * Each scenario runs the firmware on a fresh `SimBoard`, prints its report
+ * and returns non-zero if an expectation of the scenario failed.
+ */
+
+#include <stdint.h>
+#include <vector>
+
+class SimFlash;
+class FlashFs;
+struct AppConf;
+
+/* scan-to-report latency while typing. */
+int simTyping();
+
+/* CDC echo round-trip time and throughput. */
+int simCdc();
+
+/* main-loop stalls and flash wear of the config saves. */
+int simSave();
+
+/* wrap-around and mount time of the config journal. */
+int simJournal();
+
+/* config store against power cuts at every SPI transaction. */
+int simPowerCut();
+
+/* CPU cost per KB of blocking and DMA flash transfers. */
+int simDma();
+
+/* per-transaction overhead of the W25QXX command framing. */
+int simFraming();
+
+/* SPI clock tuning of the flash on the wirings. */
+int simClock();
+
+/* flash geometry discovery from the SFDP tables. */
+int simSfdp();
+
+/* erase time of the storage regions, sector by sector and planned. */
+int simErase();
+
+/* read latency under a running erase or program, suspended or waited out. */
+int simSuspend();
+
+/* erases avoided by the compare-and-program updates over the edit sessions. */
+int simUpdate();
+
+/* read latency of the access traces, with and without the page cache. */
+int simCache();
+
+/* read throughput on the SPI and on the PIO, dual and quad, and the fallbacks. */
+int simPio();
+
+/* throughput and mount time of the filesystem on the capacities, its wear and power cuts. */
+int simFs();
+
+/* HID latency with the background scrubber, and its repair of the rotten records. */
+int simScrub();
+
+/* underruns of the macro playback streamed from the flash, and the blocking reads. */
+int simStream();
+
+/* idle duty cycle and first-press latency, the matrix scanned always vs waiting for the interrupt. */
+int simIdle();
+
+/* scan-to-report latency at the scan periods set over the CDC. */
+int simScanRate();
+
+/* CPU cost and timestamps of the matrix scanned by the CPU and by the PIO, and a trace replayed. */
+int simScanPio();
+
+/* added latency and false events of the debounce algorithms, on a trace of bouncing switches. */
+int simDebounce();
+
+/* convergence of the debounce calibration on the bounce profiles of the keys, read over the CDC. */
+int simCalibrate();
+
+/* update cost per scan of the bitset key states and the linear ones, the matrix scaled up. */
+int simKeyState();
+
+/* CPU cost of a scan of the matrix as it grows, a read per column vs a read of the bank per row. */
+int simScanSize();
+
+/* bursts of key events through the ring, read on both cores, and fast taps seen by the host once each. */
+int simKeyEvents();
+
+/* get the slot of a record of the size, as the store picks it: a power of two from 16. */
+constexpr uint32_t simSlotOf(uint32_t size) {
+    uint32_t slot = 16;
+    while (slot < size) {
+        slot <<= 1;
+    }
+
+    return slot;
+}
+
+// --> slot of the `AppConf` record in the store: 64 bytes on the pad.
+#define SIM_CONF_SLOT simSlotOf(sizeof(SConfRecord) + sizeof(AppConf))
+
+/* write a record of the configuration to the flash directly. */
+void simPutConf(SimFlash& flash, uint32_t addr, uint32_t seq, const AppConf& conf);
+
+/* find the newest valid record of the configuration, returns its sequence. */
+uint32_t simFindConf(const SimFlash& flash, AppConf* conf, uint32_t* at);
+
+/* step the filesystem until its change is committed, as the main loop does. */
+void simSettleFs(FlashFs& fs);
+
+/* make the contents of a file, pseudo-random from the seed. */
+std::vector<uint8_t> simMakeBytes(uint32_t len, uint32_t seed);
+
+/* get the key code of `App::defaultKeyConf()`: the digits, then the letters, then none. */
+uint8_t simKeyCode(uint8_t key);
+
+#endif
@@ -0,0 +1,290 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "drivers/usbd/cdc.h"
+#include "drivers/usbd/hid_kc.h"
+#include "storage/scrubber.h"
+#include "app.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// --> the sectors after the configuration ring, like the App.
+static constexpr uint32_t FS_FIRST = CONFSTORE_MAX_SECTORS;
+
+static constexpr uint32_t MACRO_LEN = 3 * FlashFs::DATA_SIZE;
+static constexpr uint32_t DUMP_LEN = 65536;
+static constexpr uint32_t LOG_RECORD = 64;
+static constexpr uint32_t LOG_RECORDS = 160;
+
+// --> key codes of `App::defaultKeyConf()`.
+static const uint8_t SIM_SCRUB_KC[EKEY_MAX] = {
+    KC_0, KC_1, KC_2, KC_3, KC_4, KC_5
+};
+
+/**
+ * Latency of a typing run.
+ */
+struct SSimScrubRun {
+    SimStats sent;
+    SimStats loop;
+    uint32_t missed;
+    SScrubReport report;
+    bool reported;
+};
+
+/* write the files: replaced ones sealed by `extend`, the log by the appends. */
+static void writeFiles(FlashFs& fs) {
+    const std::vector<uint8_t> macro = simMakeBytes(MACRO_LEN, 1);
+    const std::vector<uint8_t> dump = simMakeBytes(DUMP_LEN, 2);
+    const std::vector<uint8_t> log = simMakeBytes(LOG_RECORD * LOG_RECORDS, 3);
+
+    fs.replace("profile0", macro.data(), 1024);
+    simSettleFs(fs);
+
+    fs.replace("macro0", macro.data(), MACRO_LEN);
+    simSettleFs(fs);
+
+    fs.replace("dump", dump.data(), DUMP_LEN);
+    simSettleFs(fs);
+
+    for(uint32_t i = 0; i < LOG_RECORDS; ++i) {
+        fs.append("log", log.data() + i * LOG_RECORD, LOG_RECORD);
+        simSettleFs(fs);
+    }
+}
+
+/* run the scrubber until the pass ends. */
+static void runPass(Scrubber& scrubber) {
+    scrubber.request();
+
+    do {
+        scrubber.step();
+    } while (scrubber.isRunning());
+}
+
+/* flip a bit of the cells, like the bit rot. */
+static void rot(SimBoard& board, uint32_t addr) {
+    board.flash().data()[addr] ^= 0x10;
+}
+
+/* find the sector of the file by the index. */
+static uint16_t sectorOf(FlashFs& fs, const char* name, uint32_t index) {
+    for(uint32_t slot = 0; slot < FLASHFS_MAX_FILES; ++slot) {
+        const SFsEntry* file = fs.entry(slot);
+
+        if (!file || strcmp(file->name, name) != 0) {
+            continue;
+        }
+
+        uint16_t sector = file->first;
+        while (index-- > 0) {
+            sector = fs.nextSector(sector);
+        }
+
+        return sector;
+    }
+
+    return FlashFs::NONE;
+}
+
+/* rot the records and the files, then verify the detection and the repair. */
+static bool runIntegrity() {
+    SimBoard board(0xef4017);
+    bool ok = false;
+
+    board.run(600 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        ConfStore store(&flash);
+        FlashFs fs(&flash);
+        Scrubber scrubber(&flash);
+        AppConf conf, loaded;
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enableDma();
+
+        memset(&conf, 0, sizeof(conf));
+        conf.ver = 1;
+        conf.keys[3].kc = KC_A;
+
+        store.mount(0, CONFSTORE_MAX_SECTORS, sizeof(AppConf));
+        store.save(&conf);
+
+        while (store.isSaving()) {
+            store.step();
+        }
+
+        fs.mount(FS_FIRST, flash.sectorMax());
+        writeFiles(fs);
+
+        // --> the cache holds the good copies: the scrubber must see the cells.
+        flash.enableCache();
+        uint8_t warm[W25QXX::PAGE_SIZE];
+        flash.read(store.recordAddress(), warm, sizeof(warm));
+
+        scrubber.addStore(&store);
+        scrubber.addStore(fs.catalog());
+        scrubber.setFs(&fs);
+
+        runPass(scrubber);
+        const SScrubReport clean = scrubber.report();
+
+        // --> a record of each store, a sealed sector by `extend` and by `append`.
+        const uint32_t confSeq = store.sequence();
+        const uint32_t catSeq = fs.catalog()->sequence();
+
+        rot(board, store.recordAddress() + sizeof(SConfRecord) + 13);
+        rot(board, fs.catalog()->recordAddress() + sizeof(SConfRecord) + 40);
+        rot(board, fs.addressOf(sectorOf(fs, "macro0", 1)) + FlashFs::HEADER_SIZE + 777);
+        rot(board, fs.addressOf(sectorOf(fs, "log", 0)) + FlashFs::HEADER_SIZE + 4000);
+
+        runPass(scrubber);
+        const SScrubReport rotten = scrubber.report();
+
+        runPass(scrubber);
+        const SScrubReport after = scrubber.report();
+
+        // --> mounted again: the repaired records are the newest.
+        ConfStore again(&flash);
+        FlashFs fsAgain(&flash);
+
+        const bool confOk = again.mount(0, CONFSTORE_MAX_SECTORS, sizeof(AppConf))
+            && again.load(&loaded) && memcmp(&loaded, &conf, sizeof(conf)) == 0
+            && again.sequence() == confSeq + 1;
+
+        fsAgain.mount(FS_FIRST, flash.sectorMax());
+        const bool catOk = fs.catalog()->sequence() == catSeq + 1
+            && fsAgain.size("dump") == DUMP_LEN && fsAgain.size("log") == LOG_RECORD * LOG_RECORDS;
+
+        // --> the headers of 1 + 3 + 17 + 3 sectors, 3 + 16 + 2 of them sealed.
+        simReport("clean-regions", clean.regions / clean.passes, "");
+        simReport("clean-found", clean.found, "");
+        simReport("rotten-found", rotten.found, "");
+        simReport("repaired", rotten.repaired, "");
+        simReport("lost", rotten.lost, "");
+        simReport("found-after-repair", after.found, "");
+        simReport("slice-max-step", after.maxStepUs, "us");
+        simReport("conf-remounted", confOk ? 1 : 0, "");
+        simReport("catalog-remounted", catOk ? 1 : 0, "");
+
+        ok = clean.found == 0 && clean.regions == 2 + 24
+            && rotten.found == 4 && rotten.repaired == 2 && rotten.lost == 2
+            && after.found == 2 && after.repaired == 2 && confOk && catOk
+            && after.maxStepUs <= SCRUBBER_BUDGET_US;
+    });
+
+    return ok;
+}
+
+/* type on the App, with the passes requested back-to-back or not. */
+static void runTyping(SSimScrubRun& run, bool scrub) {
+    constexpr uint64_t BEGIN = 100 * SimClock::MS;
+    constexpr uint64_t PERIOD = 37300 * SimClock::US;
+    constexpr uint64_t HOLD = 23 * SimClock::MS;
+    constexpr uint64_t REQUEST = 10 * SimClock::MS;
+    constexpr uint32_t TAPS = 36;
+
+    SimBoard board(0xef4017);
+    SimUsbHost& host = board.host();
+
+    // --> the files first, then the App on them.
+    board.run(600 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        FlashFs fs(&flash);
+
+        flash.init();
+        fs.mount(FS_FIRST, flash.sectorMax());
+        writeFiles(fs);
+    });
+
+    const uint64_t base = SimClock::now();
+    const uint64_t end = BEGIN + TAPS * PERIOD + 100 * SimClock::MS;
+    const uint8_t start = scrub ? 1 : 0;
+
+    for(uint32_t i = 0; i < TAPS; ++i) {
+        board.matrix().tap(i % EKEY_MAX, base + BEGIN + i * PERIOD, HOLD);
+    }
+
+    // --> a pass requested while the previous one runs starts right after it.
+    for(uint64_t at = BEGIN; at < end - 50 * SimClock::MS; at += REQUEST) {
+        host.sendCdc(ECDCM_SCRUB_REPORT, &start, 1, base + at);
+    }
+
+    board.run(end);
+
+    run.missed = 0;
+    run.reported = false;
+
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        const SSimHidReport* found = nullptr;
+        for(const SSimHidReport& each : host.reports()) {
+            if (each.queued < edge.at) {
+                continue;
+            }
+
+            for(uint8_t code : each.keycodes) {
+                if (code == SIM_SCRUB_KC[edge.key]) {
+                    found = &each;
+                }
+            }
+
+            if (found) {
+                break;
+            }
+        }
+
+        if (!found || !found->sent) {
+            run.missed++;
+            continue;
+        }
+
+        run.sent.add(found->sent - edge.at);
+    }
+
+    for(uint64_t each : host.taskAwake()) {
+        run.loop.add(each);
+    }
+
+    // --> the newest report of the scrubber.
+    for(const SSimCdcMessage& msg : host.cdcMessages()) {
+        if (msg.valid && msg.opcode == ECDCM_SCRUB_REPORT && msg.length == sizeof(SScrubReport)) {
+            memcpy(&run.report, msg.data, sizeof(SScrubReport));
+            run.reported = true;
+        }
+    }
+}
+
+int simScrub() {
+    const bool integrity = runIntegrity();
+
+    SSimScrubRun idle, scrub;
+    runTyping(idle, false);
+    runTyping(scrub, true);
+
+    idle.sent.print("idle-scan-to-host");
+    scrub.sent.print("scrub-scan-to-host");
+    idle.loop.print("idle-main-loop");
+    scrub.loop.print("scrub-main-loop");
+
+    simReport("scrub-passes", scrub.report.passes, "");
+    simReport("scrub-bytes", scrub.report.bytes / 1024.0, "KB");
+    simReport("scrub-max-step", scrub.report.maxStepUs, "us");
+    simReport("budget", SCRUBBER_BUDGET_US, "us");
+    simReport("missed", idle.missed + scrub.missed, "");
+
+    // --> the latency grows by the budget at most.
+    const uint64_t budget = SCRUBBER_BUDGET_US * SimClock::US;
+    const bool bounded = scrub.report.maxStepUs <= SCRUBBER_BUDGET_US
+        && scrub.sent.max() <= idle.sent.max() + budget
+        && scrub.loop.max() <= idle.loop.max() + budget;
+
+    return (integrity && bounded && scrub.reported && scrub.report.passes > 0
+        && !idle.missed && !scrub.missed) ? 0 : 1;
+}
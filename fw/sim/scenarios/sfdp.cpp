@@ -0,0 +1,147 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * A simulated part and the geometry expected to be discovered.
+ */
+struct SSimSfdpCase {
+    const char* name;
+    uint32_t id;                // --> JEDEC ID, the capacity is 2 ^ low byte.
+    int8_t sfdp;                // --> 1: the description, 0: none, -1: a broken signature.
+    SSimSfdpDesc desc;
+
+    // --> expected.
+    bool ready;
+    uint32_t capacity;
+    uint8_t addrMode;
+    uint8_t blockErase;         // --> opcode used to erase a 64 KB block, 0 if by sectors.
+};
+
+/* test the part: erase, program and read back a page at the end of the flash. */
+static bool testCase(const SSimSfdpCase& each) {
+    SimBoard board(each.id);
+    SimFlash& sim = board.flash();
+
+    if (each.sfdp > 0) {
+        sim.setSfdp(SimFlash::makeSfdp(each.desc));
+    }
+
+    else if (each.sfdp == 0) {
+        sim.setSfdp(std::vector<uint8_t>());
+    }
+
+    else {
+        std::vector<uint8_t> broken = SimFlash::makeSfdp(each.desc);
+        broken[0] ^= 0xff;
+        sim.setSfdp(broken);
+    }
+
+    bool ready = false, matched = false;
+    SW25QGeometry geo;
+    uint64_t sectors = 0, blocks = 0;
+
+    memset(&geo, 0, sizeof(geo));
+    board.run(10 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        uint8_t page[W25QXX::PAGE_SIZE];
+        uint8_t back[W25QXX::PAGE_SIZE];
+
+        ready = flash.init();
+        geo = flash.geometry();
+
+        if (!ready) {
+            return;
+        }
+
+        // --> the last block: above 16 MB for the large parts.
+        const uint32_t block = flash.blockMax() - 1;
+        const uint32_t addr = block * W25QXX::BLOCK_SIZE + W25QXX::SECTOR_SIZE;
+
+        for(uint32_t i = 0; i < sizeof(page); ++i) {
+            page[i] = uint8_t(i * 5 + block);
+        }
+
+        memset(sim.data() + block * W25QXX::BLOCK_SIZE, 0x00, W25QXX::BLOCK_SIZE);
+
+        const uint64_t sector0 = sim.stats().sectorErases;
+        const uint64_t block0 = sim.stats().blockErases;
+
+        flash.eraseBlock(block);
+        sectors = sim.stats().sectorErases - sector0;
+        blocks = sim.stats().blockErases - block0;
+
+        flash.write(addr, page, sizeof(page));
+        flash.read(addr, back, sizeof(back));
+
+        matched = memcmp(page, back, sizeof(page)) == 0
+            && memcmp(sim.data() + addr, page, sizeof(page)) == 0
+            && sim.data()[block * W25QXX::BLOCK_SIZE] == 0xff;
+    });
+
+    const bool byBlock = each.blockErase != 0;
+    bool ok = ready == each.ready;
+
+    if (ready) {
+        ok = ok && matched && geo.capacity == each.capacity && geo.addrMode == each.addrMode;
+        ok = ok && (byBlock ? (blocks == 1 && sectors == 0) : (blocks == 0 && sectors == 16));
+    }
+
+    char key[48];
+    snprintf(key, sizeof(key), "%s-capacity", each.name);
+    simReport(key, double(geo.capacity) / (1024 * 1024), "MB");
+
+    snprintf(key, sizeof(key), "%s-erases", each.name);
+    simReport(key, double(geo.erases[0].shift * 10000 + geo.erases[1].shift * 100 + geo.erases[2].shift), "shifts");
+
+    snprintf(key, sizeof(key), "%s-quad-read", each.name);
+    simReport(key, geo.reads[EW25R_QUAD_IO].opcode, "opcode");
+
+    snprintf(key, sizeof(key), "%s-ok", each.name);
+    simReport(key, ok, "");
+
+    return ok;
+}
+
+int simSfdp() {
+    SSimSfdpDesc w32 = SimFlash::winbond(4 << 20);
+    SSimSfdpDesc w256 = SimFlash::winbond(32 << 20);
+
+    // --> another vendor: 4K and 64K erases, no 32K, dual reads only.
+    SSimSfdpDesc other = { 4 << 20, 8, { 16, 12, 0, 0 }, { 0xd8, 0x20, 0, 0 }, { 0, 0, 0, 0 }, true, false, false };
+
+    // --> 32 MB without the 4BAIT: the 4-byte address mode by 0xb7.
+    SSimSfdpDesc mode4 = w256;
+    memset(mode4.eraseOp4, 0, sizeof(mode4.eraseOp4));
+
+    // --> 4K erases only.
+    SSimSfdpDesc small = { 1 << 20, 8, { 12, 0, 0, 0 }, { 0x20, 0, 0, 0 }, { 0, 0, 0, 0 }, false, false, false };
+
+    // --> no 4K erase: the store can't work on it.
+    SSimSfdpDesc coarse = other;
+    coarse.eraseShift[1] = 0;
+
+    // --> the table knows the memory type 0x40 only, of any vendor.
+    const SSimSfdpCase cases[] = {
+        { "w25q32",     0xef4016, 1,  w32,    true,  4 << 20,  EW25A_3B,         0xd8 },
+        { "w25q256",    0xef4019, 1,  w256,   true,  32 << 20, EW25A_4B_OPCODES, 0xdc },
+        { "mode-4b",    0xc22019, 1,  mode4,  true,  32 << 20, EW25A_4B_MODE,    0xd8 },
+        { "other",      0xc84016, 1,  other,  true,  4 << 20,  EW25A_3B,         0xd8 },
+        { "sectors",    0x1f4014, 1,  small,  true,  1 << 20,  EW25A_3B,         0 },
+        { "no-4k",      0xc22816, 1,  coarse, false, 0,        EW25A_3B,         0 },
+        { "legacy",     0xef4016, 0,  w32,    true,  4 << 20,  EW25A_3B,         0xd8 },
+        { "unknown",    0xc22816, 0,  other,  false, 0,        EW25A_3B,         0 },
+        { "broken",     0xc22816, -1, other,  false, 0,        EW25A_3B,         0 },
+    };
+
+    bool ok = true;
+    for(const SSimSfdpCase& each : cases) {
+        ok = testCase(each) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "storage/confstore.h"
+#include "storage/flashstream.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * Result of a playback.
+ */
+struct SSimStreamRun {
+    SimStats step;          // --> main-loop iterations.
+    uint64_t maxLag;        // --> the longest delay of an event due.
+    uint32_t underruns;
+    uint32_t saves;
+    bool matched;
+};
+
+// --> the sequence, 16 times of the SRAM.
+static constexpr uint32_t SEQ_ADDR = 0x100000;
+static constexpr uint32_t SEQ_LEN = 4 * 1024 * 1024;
+static constexpr uint32_t FILE_LEN = 256 * 1024;
+
+// --> an event per 8 bytes, and the main-loop works meanwhile.
+static constexpr uint32_t EVENT = 8;
+static constexpr uint64_t LOOP = 20 * SimClock::US;
+static constexpr uint64_t SAVE_PERIOD = 100 * SimClock::MS;
+
+/* the byte of the sequence at the offset. */
+static inline uint8_t seqByte(uint32_t at) {
+    return uint8_t(at * 131 + (at >> 8) * 7 + (at >> 16));
+}
+
+/**
+ * Play the sequence at the rate, bytes per second: streamed or read synchronously when needed.
+ * The config store saves a record periodically, so the chip is shared.
+ */
+static SSimStreamRun runPlayback(uint32_t rate, bool stream, bool file) {
+    SimBoard board(0xef4017);
+    SSimStreamRun run;
+    const uint32_t len = file ? FILE_LEN : SEQ_LEN;
+
+    run.maxLag = 0;
+    run.underruns = run.saves = 0;
+    run.matched = true;
+
+    for(uint32_t i = 0; i < SEQ_LEN; ++i) {
+        board.flash().data()[SEQ_ADDR + i] = seqByte(i);
+    }
+
+    board.run(600 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        ConfStore store(&flash);
+        FlashFs fs(&flash);
+        FlashStream seq(&flash);
+        uint8_t conf[64];
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enableDma();
+
+        store.mount(0, CONFSTORE_MAX_SECTORS, sizeof(conf));
+
+        if (file) {
+            std::vector<uint8_t> bytes(FILE_LEN);
+            for(uint32_t i = 0; i < FILE_LEN; ++i) {
+                bytes[i] = seqByte(i);
+            }
+
+            fs.mount(CONFSTORE_MAX_SECTORS, SEQ_ADDR / W25QXX::SECTOR_SIZE - CONFSTORE_MAX_SECTORS);
+            fs.replace("macro", bytes.data(), FILE_LEN);
+            simSettleFs(fs);
+        }
+
+        flash.enableCache();
+
+        // --> sync: a chunk read when the previous one is consumed.
+        uint8_t chunk[FLASHSTREAM_CHUNK];
+        uint32_t chunkPos = sizeof(chunk);
+
+        if (stream) {
+            run.matched = file ? seq.open(&fs, "macro") : seq.open(SEQ_ADDR, SEQ_LEN);
+
+            // --> the playback starts a buffer ahead.
+            while (run.matched && !seq.isReady()) {
+                seq.update();
+                SimClock::spend(LOOP);
+            }
+        }
+
+        const uint64_t begin = SimClock::now();
+        uint64_t lastSave = begin;
+        uint32_t consumed = 0;
+
+        while (consumed < len && run.matched) {
+            const uint64_t at = SimClock::now();
+            uint64_t due = (at - begin) * rate / SimClock::SEC;
+
+            due -= due % EVENT;
+            if (due > len) {
+                due = len;
+            }
+
+            while (consumed < due) {
+                uint8_t ev[EVENT];
+
+                if (stream) {
+                    if (!seq.read(ev, EVENT)) {
+                        break;
+                    }
+                }
+
+                else {
+                    if (chunkPos >= sizeof(chunk)) {
+                        flash.read(SEQ_ADDR + consumed, chunk, sizeof(chunk));
+                        chunkPos = 0;
+                    }
+
+                    memcpy(ev, chunk + chunkPos, EVENT);
+                    chunkPos += EVENT;
+                }
+
+                for(uint32_t i = 0; i < EVENT; ++i) {
+                    run.matched = run.matched && ev[i] == seqByte(consumed + i);
+                }
+
+                consumed += EVENT;
+            }
+
+            // --> the oldest event due but not played yet.
+            if (consumed < due) {
+                const uint64_t lag = SimClock::now() - (begin + uint64_t(consumed + EVENT) * SimClock::SEC / rate);
+
+                if (lag > run.maxLag) {
+                    run.maxLag = lag;
+                }
+            }
+
+            // --> the rest of the main-loop: the store shares the chip.
+            if (SimClock::now() - lastSave >= SAVE_PERIOD) {
+                memset(conf, uint8_t(run.saves++), sizeof(conf));
+                store.save(conf);
+                lastSave = SimClock::now();
+            }
+
+            store.step();
+
+            if (stream) {
+                seq.update();
+            }
+
+            SimClock::spend(LOOP);
+            run.step.add(SimClock::now() - at);
+        }
+
+        run.underruns = seq.underruns();
+        run.matched = run.matched && consumed == len;
+    });
+
+    return run;
+}
+
+/**
+ * Stream the file while the other one is replaced, then while the file itself is.
+ * Returns true if the former streamed to the end, and the latter aborted.
+ */
+static bool runReplaced() {
+    SimBoard board(0xef4017);
+    bool others = true, aborted = false;
+    uint32_t replaced = 0;
+
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        FlashFs fs(&flash);
+        FlashStream seq(&flash);
+        std::vector<uint8_t> bytes(FILE_LEN / 4);
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enableDma();
+
+        for(uint32_t i = 0; i < bytes.size(); ++i) {
+            bytes[i] = seqByte(i);
+        }
+
+        fs.mount(CONFSTORE_MAX_SECTORS, SEQ_ADDR / W25QXX::SECTOR_SIZE - CONFSTORE_MAX_SECTORS);
+        fs.replace("macro", bytes.data(), uint32_t(bytes.size()));
+        simSettleFs(fs);
+
+        for(uint32_t round = 0; round < 2; ++round) {
+            const bool own = round != 0;
+            uint32_t consumed = 0, next = FlashFs::DATA_SIZE;
+
+            others = others && seq.open(&fs, "macro");
+
+            while (!seq.isEnd() && !seq.isAborted()) {
+                uint8_t ev[EVENT];
+
+                // --> a sector's data consumed: the profile replaced, the macro itself at the last round.
+                if (consumed >= next) {
+                    const std::vector<uint8_t> profile = simMakeBytes(1024, consumed);
+
+                    if (own) {
+                        fs.replace("macro", bytes.data(), uint32_t(bytes.size()));
+                    }
+
+                    else {
+                        fs.replace("profile", profile.data(), uint32_t(profile.size()));
+                        replaced++;
+                    }
+
+                    simSettleFs(fs);
+                    next += 4 * FlashFs::DATA_SIZE;
+                }
+
+                if (!seq.read(ev, EVENT)) {
+                    seq.update();
+                    SimClock::spend(LOOP);
+                    continue;
+                }
+
+                for(uint32_t i = 0; i < EVENT; ++i) {
+                    others = others && (own || ev[i] == seqByte(consumed + i));
+                }
+
+                consumed += EVENT;
+            }
+
+            if (own) {
+                aborted = seq.isAborted() && !seq.isEnd() && !seq.read(bytes.data(), EVENT);
+            }
+
+            else {
+                others = others && seq.isEnd() && !seq.isAborted() && consumed == bytes.size();
+            }
+
+            seq.close();
+        }
+    });
+
+    simReport("replaced-others", replaced, "");
+    simReport("replaced-others-streamed", others, "");
+    simReport("replaced-own-aborted", aborted, "");
+    return others && aborted && replaced > 0;
+}
+
+int simStream() {
+    static const uint32_t RATES[] = { 1, 2, 3 };
+    char name[48];
+    bool ok = true;
+
+    // --> blocking reads: the iteration stalls each chunk.
+    SSimStreamRun sync = runPlayback(2 * 1024 * 1024, false, false);
+    sync.step.print("sync-2MB/s-loop");
+    simReport("sync-2MB/s-lag", sync.maxLag / double(SimClock::US), "us");
+    ok = ok && sync.matched;
+
+    for(uint32_t rate : RATES) {
+        SSimStreamRun each = runPlayback(rate * 1024 * 1024, true, false);
+
+        snprintf(name, sizeof(name), "stream-%luMB/s-loop", (unsigned long) rate);
+        each.step.print(name);
+
+        snprintf(name, sizeof(name), "stream-%luMB/s-underruns", (unsigned long) rate);
+        simReport(name, each.underruns, "");
+
+        snprintf(name, sizeof(name), "stream-%luMB/s-lag", (unsigned long) rate);
+        simReport(name, each.maxLag / double(SimClock::US), "us");
+
+        // --> the chip reads ~3.8MB/s: the rates up to 2MB/s never starve.
+        ok = ok && each.matched && (rate > 2 || !each.underruns);
+    }
+
+    // --> a file: the chunks split at the sector data.
+    SSimStreamRun file = runPlayback(1024 * 1024, true, true);
+    file.step.print("file-1MB/s-loop");
+    simReport("file-1MB/s-underruns", file.underruns, "");
+    simReport("sequence", SEQ_LEN / 1024, "KB");
+
+    ok = runReplaced() && ok;
+    return (ok && file.matched && !file.underruns) ? 0 : 1;
+}
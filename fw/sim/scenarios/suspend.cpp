@@ -0,0 +1,209 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Result of reads under a job.
+ */
+struct SSimSuspendRun {
+    uint64_t job;           // --> time until the job done.
+    uint64_t maxLatency;
+    uint64_t sumLatency;
+    uint32_t reads;
+    uint64_t suspends;
+    bool matched;
+};
+
+// --> reads of a profile record while the job runs, the job is stepped meanwhile.
+static constexpr uint32_t READ_LEN = 256;
+static constexpr uint64_t READ_PERIOD = 2 * SimClock::MS;
+static constexpr uint64_t STEP_PERIOD = 100 * SimClock::US;
+
+// --> the job region, and the region read.
+static constexpr uint32_t JOB_ADDR = 0x100000;
+static constexpr uint32_t JOB_LEN = 64 * 1024;
+static constexpr uint32_t READ_ADDR = 0x010000;
+
+/* run the job with the reads: by suspending it, or waiting for the chip. */
+static SSimSuspendRun runJob(bool erase, bool suspend, bool reads) {
+    static uint8_t image[JOB_LEN];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    SSimSuspendRun result;
+
+    memset(&result, 0, sizeof(result));
+    result.matched = true;
+
+    for(uint32_t i = 0; i < sizeof(image); ++i) {
+        image[i] = uint8_t(i * 7 + (i >> 9));
+    }
+
+    for(uint32_t i = 0; i < READ_LEN * 64; ++i) {
+        sim.data()[READ_ADDR + i] = uint8_t(i ^ 0x5a);
+    }
+
+    // --> a programmed region to erase, or the erased one to program.
+    memset(sim.data() + JOB_ADDR, erase ? 0x00 : 0xff, JOB_LEN);
+
+    board.run(30 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        uint8_t buf[READ_LEN];
+
+        flash.init();
+        flash.fastMode(true);
+        sim.resetStats();
+
+        const uint64_t begin = SimClock::now();
+        uint64_t next = begin + READ_PERIOD;
+
+        if (erase) {
+            flash.eraseRange(JOB_ADDR, JOB_LEN);
+        }
+
+        else {
+            flash.startJob(JOB_ADDR, image, 4 * 1024, false);
+        }
+
+        while (flash.stepJob() != EW25J_DONE) {
+            SimClock::sleep(STEP_PERIOD);
+
+            if (!reads || SimClock::now() < next) {
+                continue;
+            }
+
+            const uint32_t addr = READ_ADDR + (result.reads % 64) * READ_LEN;
+            const uint64_t at = SimClock::now();
+
+            // --> the reader without suspend: waits out the erase or program.
+            if (!suspend) {
+                while (flash.isBusy()) {
+                    SimClock::sleep(10 * SimClock::US);
+                }
+            }
+
+            flash.read(addr, buf, READ_LEN);
+
+            const uint64_t latency = SimClock::now() - at;
+            result.sumLatency += latency;
+            result.maxLatency = latency > result.maxLatency ? latency : result.maxLatency;
+            result.reads++;
+
+            result.matched = result.matched && !memcmp(buf, sim.data() + addr, READ_LEN);
+            next = SimClock::now() + READ_PERIOD;
+        }
+
+        result.job = SimClock::now() - begin;
+    });
+
+    // --> the job must complete after all the suspensions.
+    const uint8_t* region = sim.data() + JOB_ADDR;
+    for(uint32_t i = 0; i < (erase ? JOB_LEN : 4 * 1024); ++i) {
+        result.matched = result.matched && region[i] == (erase ? 0xff : image[i]);
+    }
+
+    result.suspends = sim.stats().suspends;
+    return result;
+}
+
+/* read the sector under erase, and elsewhere meanwhile: only the latter suspends it. */
+static bool runUnder() {
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    bool ok = true;
+
+    memset(sim.data() + JOB_ADDR, 0x00, W25QXX::SECTOR_SIZE);
+    for(uint32_t i = 0; i < READ_LEN; ++i) {
+        sim.data()[READ_ADDR + i] = uint8_t(i ^ 0x5a);
+    }
+
+    board.run(5 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        uint8_t buf[READ_LEN];
+        uint8_t blank[READ_LEN];
+
+        flash.init();
+        flash.fastMode(true);
+        flash.enableCache(true);
+        memset(blank, 0xff, sizeof(blank));
+
+        // --> the first page cached before the erase.
+        flash.read(JOB_ADDR, buf, READ_LEN);
+        sim.resetStats();
+
+        ok = ok && flash.startEraseSector(JOB_ADDR / W25QXX::SECTOR_SIZE);
+        SimClock::sleep(SimClock::MS);
+
+        flash.read(READ_ADDR, buf, READ_LEN);
+        ok = ok && !memcmp(buf, sim.data() + READ_ADDR, READ_LEN);
+        ok = ok && sim.stats().suspends > 0;
+
+        // --> waited out: erased, never the half-way cells nor the cached ones.
+        SimClock::sleep(SimClock::MS);
+
+        const uint64_t at = SimClock::now();
+        flash.read(JOB_ADDR + W25QXX::SECTOR_SIZE / 2, buf, READ_LEN);
+        simReport("under-erase-read", double(SimClock::now() - at) / SimClock::US, "us");
+
+        ok = ok && !memcmp(buf, blank, READ_LEN);
+        ok = ok && !flash.isBusy();
+
+        flash.read(JOB_ADDR, buf, READ_LEN);
+        ok = ok && !memcmp(buf, blank, READ_LEN);
+    });
+
+    simReport("under-erase-undefined", double(sim.stats().undefined), "");
+    return ok && sim.stats().undefined == 0;
+}
+
+/* print the result of the kind. */
+static void report(const char* name, const SSimSuspendRun& run) {
+    char key[48];
+
+    snprintf(key, sizeof(key), "%s-read-max", name);
+    simReport(key, double(run.maxLatency) / SimClock::US, "us");
+
+    snprintf(key, sizeof(key), "%s-read-avg", name);
+    simReport(key, run.reads ? double(run.sumLatency) / run.reads / SimClock::US : 0, "us");
+
+    snprintf(key, sizeof(key), "%s-job", name);
+    simReport(key, double(run.job) / SimClock::MS, "ms");
+
+    snprintf(key, sizeof(key), "%s-suspends", name);
+    simReport(key, double(run.suspends), "");
+}
+
+int simSuspend() {
+    bool ok = true;
+
+    for(uint32_t i = 0; i < 2; ++i) {
+        const bool erase = i == 0;
+        const char* kind = erase ? "erase-64k" : "program-4k";
+        char name[32];
+
+        const SSimSuspendRun alone = runJob(erase, true, false);
+        const SSimSuspendRun waiting = runJob(erase, false, true);
+        const SSimSuspendRun suspended = runJob(erase, true, true);
+
+        snprintf(name, sizeof(name), "%s-alone", kind);
+        simReport(name, double(alone.job) / SimClock::MS, "ms");
+
+        snprintf(name, sizeof(name), "%s-wait", kind);
+        report(name, waiting);
+
+        snprintf(name, sizeof(name), "%s-suspend", kind);
+        report(name, suspended);
+
+        // --> the reads bounded by tRS + tSUS and the read itself, and fewer reads never lost.
+        ok = ok && alone.matched && waiting.matched && suspended.matched;
+        ok = ok && suspended.suspends > 0 && suspended.reads >= waiting.reads;
+        ok = ok && suspended.maxLatency < 200 * SimClock::US;
+    }
+
+    ok = runUnder() && ok;
+    simReport("bounded", ok, "");
+    return ok ? 0 : 1;
+}
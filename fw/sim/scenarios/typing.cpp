@@ -0,0 +1,74 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "main.h"
+#include "drivers/usbd/hid_kc.h"
+
+// --> key codes of `App::defaultKeyConf()`.
+static const uint8_t SIM_TYPING_KC[EKEY_MAX] = {
+    KC_0, KC_1, KC_2, KC_3, KC_4, KC_5
+};
+
+static const SSimHidReport* simFindReport(const SimUsbHost& host, uint64_t after, uint8_t kc) {
+    for(const SSimHidReport& each : host.reports()) {
+        if (each.queued < after) {
+            continue;
+        }
+
+        for(uint8_t code : each.keycodes) {
+            if (code == kc) {
+                return &each;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+int simTyping() {
+    constexpr uint64_t BEGIN = 100 * SimClock::MS;
+    constexpr uint64_t PERIOD = 37300 * SimClock::US;
+    constexpr uint64_t HOLD = 23 * SimClock::MS;
+    constexpr uint32_t TAPS = 36;
+
+    SimBoard board;
+
+    // --> taps of all keys, the default config is saved in the middle.
+    for(uint32_t i = 0; i < TAPS; ++i) {
+        board.matrix().tap(i % EKEY_MAX, BEGIN + i * PERIOD, HOLD);
+    }
+
+    board.run(BEGIN + TAPS * PERIOD + 100 * SimClock::MS);
+
+    SimStats queued, sent, loop;
+    uint32_t missed = 0;
+
+    for(const SSimKeyEdge& edge : board.matrix().edges()) {
+        if (!edge.down) {
+            continue;
+        }
+
+        const SSimHidReport* report = simFindReport(board.host(), edge.at, SIM_TYPING_KC[edge.key]);
+        if (!report || !report->sent) {
+            missed++;
+            continue;
+        }
+
+        queued.add(report->queued - edge.at);
+        sent.add(report->sent - edge.at);
+    }
+
+    for(uint64_t each : board.host().taskAwake()) {
+        loop.add(each);
+    }
+
+    queued.print("scan-to-queue");
+    sent.print("scan-to-host");
+    loop.print("main-loop");
+    simReport("presses", TAPS, "");
+    simReport("missed", missed, "");
+    simReport("hid-dropped", board.host().hidDropped(), "");
+    simReport("core0-busy", 100.0 * SimClock::busy(0) / SimClock::now(0), "%");
+
+    return missed ? 1 : 0;
+}
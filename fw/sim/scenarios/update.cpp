@@ -0,0 +1,266 @@
+#include "scenarios.h"
+#include "../board.h"
+#include "../stats.h"
+#include "drivers/w25qxx.h"
+#include "storage/confstore.h"
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Kind of the edit on a profile.
+ */
+enum ESimEdit {
+    ESIM_REWRITE = 0,   // --> the host sends the same profile again.
+    ESIM_FLAG,          // --> clears a flag bit.
+    ESIM_APPEND,        // --> appends a macro step to the blank tail.
+    ESIM_REMAP,         // --> changes a key code.
+    ESIM_EDIT_MAX
+};
+
+/**
+ * Result of replaying the session.
+ */
+struct SSimUpdateRun {
+    uint64_t erases;        // --> erase commands.
+    uint64_t programs;
+    uint64_t readBytes;     // --> bytes read by the compares.
+    uint64_t time;          // --> time spent by the jobs.
+    uint32_t decisions[4];  // --> EW25QUpdate.
+    bool matched;
+};
+
+// --> a profile of key codes, flags and macro steps in a sector.
+static constexpr uint32_t PROFILE_ADDR = 0x40000;
+static constexpr uint32_t PROFILE_LEN = W25QXX::SECTOR_SIZE;
+static constexpr uint32_t KEYS_LEN = 256;
+static constexpr uint32_t FLAGS_AT = KEYS_LEN;
+static constexpr uint32_t FLAGS_LEN = 64;
+static constexpr uint32_t MACRO_AT = FLAGS_AT + FLAGS_LEN;
+
+static constexpr uint64_t STEP_PERIOD = 100 * SimClock::US;
+
+// --> slot of the records saved to the store: the pad's, a page holds four.
+static constexpr uint32_t STORE_SLOT = 64;
+
+// --> an editing session: mostly re-sends and small changes.
+static const uint8_t SESSION[] = {
+    ESIM_REWRITE, ESIM_FLAG, ESIM_REWRITE, ESIM_APPEND, ESIM_APPEND,
+    ESIM_REWRITE, ESIM_REMAP, ESIM_REWRITE, ESIM_FLAG, ESIM_APPEND,
+    ESIM_REWRITE, ESIM_REWRITE, ESIM_APPEND, ESIM_REMAP, ESIM_FLAG,
+    ESIM_APPEND, ESIM_REWRITE, ESIM_APPEND, ESIM_FLAG, ESIM_REWRITE,
+};
+
+static constexpr uint32_t ROUNDS = 4;
+
+/* apply the edit to the profile. */
+static void applyEdit(uint8_t* image, uint8_t kind, uint32_t n, uint32_t& macroLen) {
+    switch(kind) {
+        case ESIM_FLAG:
+            image[FLAGS_AT + n % FLAGS_LEN] &= uint8_t(~(1u << (n % 8)));
+            break;
+
+        case ESIM_APPEND:
+            for(uint32_t i = 0; i < 8 && MACRO_AT + macroLen < PROFILE_LEN; ++i) {
+                image[MACRO_AT + macroLen++] = uint8_t(0x04 + (n + i) % 40);
+            }
+            break;
+
+        case ESIM_REMAP:
+            image[n % KEYS_LEN] = uint8_t(image[n % KEYS_LEN] + 0x11);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* replay the session: erase and program each time, or the update job. */
+static SSimUpdateRun runSession(bool update) {
+    static uint8_t image[PROFILE_LEN];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    SSimUpdateRun result;
+
+    memset(&result, 0, sizeof(result));
+    result.matched = true;
+
+    // --> the stored profile: key codes, all flags set and no macro.
+    memset(image, 0xff, sizeof(image));
+    for(uint32_t i = 0; i < KEYS_LEN; ++i) {
+        image[i] = uint8_t(0x04 + i % 64);
+    }
+
+    memcpy(sim.data() + PROFILE_ADDR, image, PROFILE_LEN);
+
+    board.run(120 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        uint32_t macroLen = 0, n = 0;
+
+        flash.init();
+        flash.fastMode(true);
+        sim.resetStats();
+
+        for(uint32_t round = 0; round < ROUNDS; ++round) {
+            for(uint8_t kind : SESSION) {
+                applyEdit(image, kind, n++, macroLen);
+
+                const uint64_t begin = SimClock::now();
+
+                if (update) {
+                    flash.startUpdate(PROFILE_ADDR, image, PROFILE_LEN);
+                }
+
+                else {
+                    flash.startJob(PROFILE_ADDR, image, PROFILE_LEN);
+                }
+
+                while (flash.stepJob() != EW25J_DONE) {
+                    SimClock::sleep(STEP_PERIOD);
+                }
+
+                result.time += SimClock::now() - begin;
+                result.decisions[flash.updateResult()]++;
+                result.matched = result.matched && !memcmp(sim.data() + PROFILE_ADDR, image, PROFILE_LEN);
+            }
+        }
+    });
+
+    const SSimFlashStats& stats = sim.stats();
+
+    result.erases = stats.sectorErases + stats.halfBlockErases + stats.blockErases;
+    result.readBytes = stats.readBytes;
+    result.programs = stats.programs;
+    return result;
+}
+
+/* update a range across two sectors: in place, then needing the erase. the bytes around it kept. */
+static bool runUnaligned() {
+    static uint8_t before[2 * PROFILE_LEN];
+    static uint8_t image[PROFILE_LEN];
+    SimBoard board;
+    SimFlash& sim = board.flash();
+    bool ok = true;
+
+    // --> the range starts in the profile, and ends in the next sector.
+    const uint32_t at = PROFILE_LEN / 2;
+
+    for(uint32_t i = 0; i < sizeof(before); ++i) {
+        before[i] = uint8_t(0x80 | (i * 13 + (i >> 8)));
+    }
+
+    memcpy(sim.data() + PROFILE_ADDR, before, sizeof(before));
+
+    board.run(10 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+
+        flash.init();
+        flash.fastMode(true);
+
+        for(uint32_t kind = 0; kind < 2; ++kind) {
+            const bool erase = kind != 0;
+
+            // --> clears a bit in place, or raises one: then the erase is needed.
+            memcpy(image, sim.data() + PROFILE_ADDR + at, PROFILE_LEN);
+            image[PROFILE_LEN / 2] = erase ? 0xff : 0x00;
+
+            flash.startUpdate(PROFILE_ADDR + at, image, PROFILE_LEN);
+            while (flash.isJobRunning()) {
+                flash.stepJob();
+                SimClock::sleep(STEP_PERIOD);
+            }
+
+            const uint8_t* chip = sim.data() + PROFILE_ADDR;
+            if (erase) {
+                ok = ok && flash.jobState() == EW25J_FAIL && flash.updateResult() == EW25U_ERASE;
+                ok = ok && !memcmp(chip + at, before + at, PROFILE_LEN);
+            }
+
+            else {
+                ok = ok && flash.jobState() == EW25J_DONE && flash.updateResult() == EW25U_PROGRAM;
+                ok = ok && !memcmp(chip + at, image, PROFILE_LEN);
+                memcpy(before + at, image, PROFILE_LEN);
+            }
+
+            ok = ok && !memcmp(chip, before, at);
+            ok = ok && !memcmp(chip + at + PROFILE_LEN, before + at + PROFILE_LEN, PROFILE_LEN - at);
+        }
+    });
+
+    return ok;
+}
+
+/* save the same and changed payloads to the store, returns records appended. */
+static uint64_t runStore(uint32_t& saves) {
+    SimBoard board;
+    SimFlash& sim = board.flash();
+
+    saves = 0;
+    board.run(60 * SimClock::SEC, [&]() {
+        W25QXX flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX);
+        ConfStore store(&flash);
+        uint8_t conf[STORE_SLOT - sizeof(SConfRecord)];
+
+        flash.init();
+        store.mount(0, 8, sizeof(conf));
+        sim.resetStats();
+
+        memset(conf, 0x00, sizeof(conf));
+        for(uint8_t kind : SESSION) {
+            if (kind == ESIM_REMAP || kind == ESIM_FLAG) {
+                conf[saves % sizeof(conf)]++;
+            }
+
+            store.save(conf);
+            saves++;
+
+            while (store.isSaving()) {
+                store.step();
+                SimClock::sleep(STEP_PERIOD);
+            }
+        }
+    });
+
+    return sim.stats().programs;
+}
+
+int simUpdate() {
+    const SSimUpdateRun always = runSession(false);
+    const SSimUpdateRun update = runSession(true);
+
+    simReport("edits", double(sizeof(SESSION) * ROUNDS), "");
+
+    simReport("always-erases", double(always.erases), "");
+    simReport("always-programs", double(always.programs), "");
+    simReport("always-time", double(always.time) / SimClock::MS, "ms");
+
+    simReport("update-erases", double(update.erases), "");
+    simReport("update-programs", double(update.programs), "");
+    simReport("update-time", double(update.time) / SimClock::MS, "ms");
+    simReport("update-read", double(update.readBytes) / 1024, "KB");
+
+    simReport("update-skipped", update.decisions[EW25U_SKIP], "");
+    simReport("update-in-place", update.decisions[EW25U_PROGRAM], "");
+    simReport("update-erased", update.decisions[EW25U_ERASE], "");
+    simReport("erases-avoided", double(always.erases - update.erases), "");
+
+    uint32_t saves = 0;
+    const uint64_t appended = runStore(saves);
+
+    simReport("store-saves", saves, "");
+    simReport("store-appended", double(appended), "");
+
+    const bool unaligned = runUnaligned();
+    simReport("unaligned-kept", unaligned, "");
+
+    // --> only the remaps need erases, the store writes the changes only.
+    //   : the compare reads the profile once, the program reads nothing more.
+    const uint32_t remaps = 2 * ROUNDS;
+    const bool ok = always.matched && update.matched
+        && update.erases == remaps && update.decisions[EW25U_ERASE] == remaps
+        && update.readBytes <= uint64_t(sizeof(SESSION)) * ROUNDS * PROFILE_LEN
+        && appended < saves && unaligned;
+
+    simReport("matched", ok, "");
+    return ok ? 0 : 1;
+}
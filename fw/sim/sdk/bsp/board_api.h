@@ -0,0 +1,13 @@
+#ifndef __SIM_SDK_BSP_BOARD_API_H__
+#define __SIM_SDK_BSP_BOARD_API_H__
+
+#include "../pico.h"
+
+SIM_SDK_BEGIN
+
+/* milliseconds of the calling core's virtual clock. */
+uint32_t board_millis(void);
+
+SIM_SDK_END
+
+#endif
@@ -0,0 +1,13 @@
+#include <hardware/clocks.h>
+#include "../pio.h"
+#include "../spi.h"
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    switch(clk_index) {
+        case clk_sys: return SimPio::CLK_SYS;
+        case clk_peri: return SimSpi::CLK_PERI;
+        case clk_usb: return 48 * 1000 * 1000;
+        case clk_ref: return 12 * 1000 * 1000;
+        default: return 0;
+    }
+}
@@ -0,0 +1,144 @@
+#include <hardware/dma.h>
+#include "../clock.h"
+#include "../cost.h"
+#include "../dma.h"
+
+int dma_claim_unused_channel(bool required) {
+    (void) required;
+    SimClock::spend(SimCost::DMA);
+
+    for(uint i = 0; i < SimDma::MAX_CHANNELS; ++i) {
+        SSimDmaChannel* ch = SimDma::get(i);
+
+        if (!ch->claimed) {
+            ch->claimed = true;
+            return int(i);
+        }
+    }
+
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    if (SSimDmaChannel* ch = SimDma::get(channel)) {
+        ch->claimed = false;
+    }
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config config;
+    (void) channel;
+
+    config.size = DMA_SIZE_32;
+    config.read_incr = true;
+    config.write_incr = false;
+    config.dreq = 0x3f;
+    config.ring_write = false;
+    config.ring_bits = 0;
+
+    return config;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    c->size = uint8_t(size);
+}
+
+void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+    c->read_incr = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+    c->write_incr = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits) {
+    c->ring_write = write;
+    c->ring_bits = uint8_t(size_bits);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config,
+    volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+    SimClock::spend(SimCost::DMA);
+
+    if (SSimDmaChannel* ch = SimDma::get(channel)) {
+        ch->config = *config;
+        ch->write = write_addr;
+        ch->read = read_addr;
+        ch->count = transfer_count;
+        ch->paced = false;
+    }
+
+    if (trigger) {
+        SimDma::trigger(1u << channel);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    SimClock::spend(SimCost::DMA);
+
+    // --> the addresses continue from the last transfer.
+    if (SSimDmaChannel* ch = SimDma::get(channel)) {
+        SimDma::sync(channel);
+        ch->count = trans_count;
+    }
+
+    if (trigger) {
+        SimDma::trigger(1u << channel);
+    }
+}
+
+dma_channel_hw_t* dma_channel_hw_addr(uint channel) {
+    SimClock::spend(SimCost::DMA_READ);
+
+    SSimDmaChannel* ch = SimDma::get(channel);
+    if (!ch) {
+        return nullptr;
+    }
+
+    // --> the registers as of now: the paced transfers run up to here.
+    SimDma::sync(channel);
+    return &ch->hw;
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    SimClock::spend(SimCost::DMA);
+    SimDma::trigger(chan_mask);
+}
+
+bool dma_channel_is_busy(uint channel) {
+    SimClock::spend(SimCost::DMA);
+
+    SimDma::sync(channel);
+
+    const SSimDmaChannel* ch = SimDma::get(channel);
+    return ch && (ch->armed || ch->paced || SimClock::now() < ch->busyUntil);
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    const SSimDmaChannel* ch = SimDma::get(channel);
+
+    // --> the core spins: an armed channel without its peer never finishes.
+    while (ch && ch->armed) {
+        SimClock::spend(SimCost::DMA);
+        SimClock::checkpoint();
+    }
+
+    if (ch && SimClock::now() < ch->busyUntil) {
+        SimClock::spend(ch->busyUntil - SimClock::now());
+    }
+}
+
+void dma_channel_abort(uint channel) {
+    SimClock::spend(SimCost::DMA);
+
+    if (SSimDmaChannel* ch = SimDma::get(channel)) {
+        ch->armed = false;
+        ch->paced = false;
+        ch->busyUntil = 0;
+    }
+}
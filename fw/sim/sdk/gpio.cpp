@@ -0,0 +1,59 @@
+#include <hardware/gpio.h>
+#include "../clock.h"
+#include "../cost.h"
+#include "../gpio.h"
+#include "../pio.h"
+
+void gpio_init(uint gpio) {
+    SimClock::spend(SimCost::GPIO_INIT);
+    SimGpio::setFunction(gpio, GPIO_FUNC_SIO);
+    SimGpio::setDir(gpio, false);
+    SimGpio::put(gpio, false);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    SimClock::spend(SimCost::GPIO_INIT);
+    SimGpio::setDir(gpio, out);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    SimClock::spend(SimCost::GPIO_INIT);
+    SimGpio::setFunction(gpio, uint8_t(fn));
+
+    // --> the PIO drives the pin from now.
+    SimPio::route(gpio);
+}
+
+void gpio_put(uint gpio, bool value) {
+    SimClock::spend(SimCost::GPIO);
+    SimGpio::put(gpio, value);
+}
+
+bool gpio_get(uint gpio) {
+    SimClock::spend(SimCost::GPIO);
+    return SimGpio::get(gpio);
+}
+
+uint32_t gpio_get_all(void) {
+    SimClock::spend(SimCost::GPIO);
+
+    uint32_t bits = 0;
+    for(uint8_t i = 0; i < SimGpio::MAX_PINS; ++i) {
+        if (SimGpio::get(i)) {
+            bits |= 1u << i;
+        }
+    }
+
+    return bits;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+    SimClock::spend(SimCost::GPIO_INIT);
+    SimGpio::setIrq(uint8_t(gpio), events, enabled);
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {
+    // --> a callback per core, like the SDK.
+    SimGpio::setIrqCallback(callback);
+    gpio_set_irq_enabled(gpio, events, enabled);
+}
@@ -0,0 +1,27 @@
+#ifndef __SIM_SDK_HARDWARE_CLOCKS_H__
+#define __SIM_SDK_HARDWARE_CLOCKS_H__
+
+#include "../pico.h"
+
+enum clock_index {
+    clk_gpout0 = 0,
+    clk_gpout1,
+    clk_gpout2,
+    clk_gpout3,
+    clk_ref,
+    clk_sys,
+    clk_peri,
+    clk_usb,
+    clk_adc,
+    clk_rtc,
+    CLK_COUNT
+};
+
+SIM_SDK_BEGIN
+
+/* the clocks of the default setup: 125 MHz system, 48 MHz USB. */
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+SIM_SDK_END
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __SIM_SDK_HARDWARE_DMA_H__
+#define __SIM_SDK_HARDWARE_DMA_H__
+
+#include "../pico.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+/**
+ * Channel configuration, unlike the SDK's `ctrl` word, this keeps fields.
+ */
+typedef struct {
+    uint8_t size;
+    bool read_incr;
+    bool write_incr;
+    uint dreq;
+    bool ring_write;
+    uint8_t ring_bits;      // --> the address wraps at 1 << bits bytes, 0 if not.
+} dma_channel_config;
+
+/**
+ * Channel registers the firmware reads, updated when `dma_channel_hw_addr()` is called.
+ * The addresses are the host's pointers.
+ */
+typedef struct {
+    volatile uintptr_t read_addr;
+    volatile uintptr_t write_addr;
+    volatile uint32_t transfer_count;
+} dma_channel_hw_t;
+
+SIM_SDK_BEGIN
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config* c, bool incr);
+void channel_config_set_write_increment(dma_channel_config* c, bool incr);
+void channel_config_set_dreq(dma_channel_config* c, uint dreq);
+void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits);
+
+void dma_channel_configure(uint channel, const dma_channel_config* config,
+    volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger);
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+dma_channel_hw_t* dma_channel_hw_addr(uint channel);
+
+void dma_start_channel_mask(uint32_t chan_mask);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+void dma_channel_abort(uint channel);
+
+SIM_SDK_END
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef __SIM_SDK_HARDWARE_PIO_H__
+#define __SIM_SDK_HARDWARE_PIO_H__
+
+#include "../pico.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+
+// --> DREQ of the FIFOs: `pio_get_dreq()`.
+#define DREQ_PIO0_TX0 0
+#define DREQ_PIO0_RX0 4
+#define DREQ_PIO1_TX0 8
+#define DREQ_PIO1_RX0 12
+
+/**
+ * Program to load, the instructions are copied at loading.
+ */
+typedef struct pio_program {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;          // --> -1 if relocatable.
+} pio_program_t;
+
+/**
+ * State machine configuration, unlike the SDK's register words, this keeps fields.
+ */
+typedef struct {
+    uint32_t clkdiv;        // --> 16.8 fixed point.
+    uint8_t wrap_target;
+    uint8_t wrap;
+    uint8_t sideset_bits;   // --> including the enable bit if optional.
+    bool sideset_optional;
+    uint8_t sideset_base;
+    uint8_t in_base;
+    uint8_t out_base;
+    uint8_t out_count;
+    uint8_t set_base;
+    uint8_t set_count;
+    uint8_t jmp_pin;
+    bool in_shift_right;
+    bool autopush;
+    uint8_t push_threshold;
+    bool out_shift_right;
+    bool autopull;
+    uint8_t pull_threshold;
+} pio_sm_config;
+
+/**
+ * Simulated PIO state machine.
+ */
+struct SSimPioSm {
+    bool claimed;
+    bool enabled;
+    pio_sm_config config;
+
+    uint8_t pc;
+    uint32_t x, y;
+    uint32_t isr, osr;
+    uint8_t isrCount;           // --> bits shifted into the ISR.
+    uint8_t osrCount;           // --> bits shifted out of the OSR, 32 if empty.
+
+    // --> FIFOs, 4 deep each: the TX words keep the time they were put.
+    uint32_t tx[4];
+    uint64_t txAt[4];
+    uint8_t txHead, txCount;
+    uint32_t rx[4];
+    uint64_t rxAt[4];
+    uint8_t rxHead, rxCount;
+
+    // --> a push waits for the pop of the word 4 before it, if the RX FIFO is full.
+    uint64_t pushes, pops;
+    uint64_t popAt[4];
+
+    uint64_t time;              // --> the next instruction, 1/256 ns of the core clock.
+};
+
+/**
+ * PIO block, `pio_hw_t` of the stand-in SDK.
+ * The firmware takes the addresses of the FIFO registers only, for the DMA:
+ * the words are kept by the state machines, see `SimDma`.
+ */
+struct sim_pio {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+    volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+
+    uint8_t index;
+    uint16_t code[PIO_INSTRUCTION_COUNT];
+    uint32_t used;              // --> instruction memory in use.
+    SSimPioSm sm[NUM_PIO_STATE_MACHINES];
+
+    // --> outputs of the block, on the pins routed to it.
+    uint32_t levels;
+    uint32_t dirs;
+
+    uint64_t executed;          // --> instructions run.
+};
+
+typedef struct sim_pio pio_hw_t;
+typedef pio_hw_t* PIO;
+
+SIM_SDK_BEGIN
+
+extern pio_hw_t* const sim_pio0;
+extern pio_hw_t* const sim_pio1;
+
+#define pio0 sim_pio0
+#define pio1 sim_pio1
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program);
+uint pio_add_program(PIO pio, const pio_program_t* program);
+void pio_remove_program(PIO pio, const pio_program_t* program, uint loaded_offset);
+
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+void pio_gpio_init(PIO pio, uint pin);
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap);
+void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs);
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base);
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base);
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count);
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count);
+void sm_config_set_jmp_pin(pio_sm_config* c, uint pin);
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_clkdiv_int_frac(pio_sm_config* c, uint16_t div_int, uint8_t div_frac);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+
+SIM_SDK_END
+
+#endif
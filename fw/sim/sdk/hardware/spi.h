@@ -0,0 +1,59 @@
+#ifndef __SIM_SDK_HARDWARE_SPI_H__
+#define __SIM_SDK_HARDWARE_SPI_H__
+
+#include "../pico.h"
+
+typedef enum {
+    SPI_CPHA_0 = 0,
+    SPI_CPHA_1 = 1
+} spi_cpha_t;
+
+typedef enum {
+    SPI_CPOL_0 = 0,
+    SPI_CPOL_1 = 1
+} spi_cpol_t;
+
+typedef enum {
+    SPI_LSB_FIRST = 0,
+    SPI_MSB_FIRST = 1
+} spi_order_t;
+
+// --> defined by `sim/spi.h`.
+typedef struct spi_inst spi_inst_t;
+
+/**
+ * Registers of the SSP, only the data register is used: as DMA addresses.
+ */
+typedef struct {
+    volatile uint32_t dr;
+} spi_hw_t;
+
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+
+SIM_SDK_BEGIN
+
+extern spi_inst_t* const sim_spi0;
+extern spi_inst_t* const sim_spi1;
+
+#define spi0 sim_spi0
+#define spi1 sim_spi1
+
+uint spi_init(spi_inst_t* spi, uint baudrate);
+void spi_deinit(spi_inst_t* spi);
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate);
+uint spi_get_baudrate(const spi_inst_t* spi);
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+
+int spi_write_read_blocking(spi_inst_t* spi, const uint8_t* src, uint8_t* dst, size_t len);
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len);
+int spi_read_blocking(spi_inst_t* spi, uint8_t repeated_tx_data, uint8_t* dst, size_t len);
+
+spi_hw_t* spi_get_hw(spi_inst_t* spi);
+uint spi_get_dreq(spi_inst_t* spi, bool is_tx);
+
+SIM_SDK_END
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __SIM_SDK_HARDWARE_TIMER_H__
+#define __SIM_SDK_HARDWARE_TIMER_H__
+
+#include "../pico.h"
+
+SIM_SDK_BEGIN
+
+/* microseconds of the calling core's virtual clock. */
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+SIM_SDK_END
+
+#endif
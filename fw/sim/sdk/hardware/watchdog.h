@@ -0,0 +1,13 @@
+#ifndef __SIM_SDK_HARDWARE_WATCHDOG_H__
+#define __SIM_SDK_HARDWARE_WATCHDOG_H__
+
+#include "../pico.h"
+
+SIM_SDK_BEGIN
+
+/* ends the simulation run, see `SimBoard::rebooted()`. */
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+
+SIM_SDK_END
+
+#endif
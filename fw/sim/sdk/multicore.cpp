@@ -0,0 +1,29 @@
+#include <pico/multicore.h>
+#include "../clock.h"
+#include "../cost.h"
+#include "../multicore.h"
+
+void multicore_launch_core1(void (*entry)(void)) {
+    SimClock::spend(SimCost::FIFO);
+    SimMulticore::launch(entry);
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    SimClock::spend(SimCost::FIFO);
+    SimMulticore::push(data);
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    SimClock::spend(SimCost::FIFO);
+    return SimMulticore::pop();
+}
+
+bool multicore_fifo_rvalid(void) {
+    SimClock::spend(SimCost::FIFO);
+    return SimMulticore::readable();
+}
+
+bool multicore_fifo_wready(void) {
+    SimClock::spend(SimCost::FIFO);
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef __SIM_SDK_PICO_H__
+#define __SIM_SDK_PICO_H__
+
+/**
+ * Host-side stand-in for the pico SDK.
+ * Only the subset used by the firmware is provided, and all calls are
+ * routed to the simulated board (see `sim/board.h`).
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#ifdef __cplusplus
+#define SIM_SDK_BEGIN extern "C" {
+#define SIM_SDK_END }
+#else
+#define SIM_SDK_BEGIN
+#define SIM_SDK_END
+#endif
+
+#endif
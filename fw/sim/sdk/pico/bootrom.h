@@ -0,0 +1,13 @@
+#ifndef __SIM_SDK_PICO_BOOTROM_H__
+#define __SIM_SDK_PICO_BOOTROM_H__
+
+#include "../pico.h"
+
+SIM_SDK_BEGIN
+
+/* ends the simulation run, see `SimBoard::rebooted()`. */
+void reset_usb_boot(uint32_t gpio_activity_pin_mask, uint32_t disable_interface_mask);
+
+SIM_SDK_END
+
+#endif
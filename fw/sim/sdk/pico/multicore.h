@@ -0,0 +1,18 @@
+#ifndef __SIM_SDK_PICO_MULTICORE_H__
+#define __SIM_SDK_PICO_MULTICORE_H__
+
+#include "../pico.h"
+
+SIM_SDK_BEGIN
+
+/* run the entry on the core 1, which is a host thread. */
+void multicore_launch_core1(void (*entry)(void));
+
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+bool multicore_fifo_rvalid(void);
+bool multicore_fifo_wready(void);
+
+SIM_SDK_END
+
+#endif
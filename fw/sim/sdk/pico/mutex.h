@@ -0,0 +1,8 @@
+#ifndef __SIM_SDK_PICO_MUTEX_H__
+#define __SIM_SDK_PICO_MUTEX_H__
+
+#include "../pico.h"
+
+// --> included by the firmware, but nothing is used yet.
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __SIM_SDK_PICO_STDLIB_H__
+#define __SIM_SDK_PICO_STDLIB_H__
+
+#include "../pico.h"
+#include "../hardware/gpio.h"
+#include "time.h"
+
+#endif
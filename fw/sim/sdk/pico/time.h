@@ -0,0 +1,30 @@
+#ifndef __SIM_SDK_PICO_TIME_H__
+#define __SIM_SDK_PICO_TIME_H__
+
+#include "../pico.h"
+#include "../hardware/timer.h"
+
+// --> microseconds since the boot, like `to_us_since_boot()`.
+typedef uint64_t absolute_time_t;
+
+SIM_SDK_BEGIN
+
+/* sleep the calling core, idle time is not counted as busy. */
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+/* get the time after the milliseconds. */
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+
+/**
+ * sleep the calling core until an interrupt or the time, as idle.
+ * Returns true if timed out. The interrupts are the GPIO edges armed and
+ * the USB events (see `SimUsbHost::nextEvent()`), taken since the last
+ * wait or during this one: like the event register, one taken before
+ * returns at once.
+ */
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+SIM_SDK_END
+
+#endif
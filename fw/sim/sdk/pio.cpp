@@ -0,0 +1,295 @@
+#include <hardware/pio.h>
+#include <hardware/gpio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../clock.h"
+#include "../cost.h"
+#include "../pio.h"
+
+/* find the offset to load the program at, -1 if no space. */
+static int sim_pio_find_offset(PIO pio, const pio_program_t* program) {
+    const uint32_t mask = (1u << program->length) - 1;
+
+    if (program->origin >= 0) {
+        const uint32_t at = uint32_t(program->origin);
+
+        if (at + program->length > PIO_INSTRUCTION_COUNT || (pio->used & (mask << at))) {
+            return -1;
+        }
+
+        return int(at);
+    }
+
+    // --> from the top, like the SDK.
+    for(int at = PIO_INSTRUCTION_COUNT - program->length; at >= 0; --at) {
+        if (!(pio->used & (mask << at))) {
+            return at;
+        }
+    }
+
+    return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program) {
+    return sim_pio_find_offset(pio, program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program) {
+    SimClock::spend(SimCost::PIO_INIT);
+
+    const int at = sim_pio_find_offset(pio, program);
+    if (at < 0) {
+        // --> the SDK panics.
+        fprintf(stderr, "pio_add_program: no program space.\n");
+        abort();
+    }
+
+    for(uint32_t i = 0; i < program->length; ++i) {
+        uint16_t instr = program->instructions[i];
+
+        // --> JMP targets are relocated.
+        if ((instr & 0xe000) == 0) {
+            instr = uint16_t(instr + at);
+        }
+
+        pio->code[at + i] = instr;
+    }
+
+    pio->used |= ((1u << program->length) - 1) << at;
+    return uint(at);
+}
+
+void pio_remove_program(PIO pio, const pio_program_t* program, uint loaded_offset) {
+    SimClock::spend(SimCost::PIO_INIT);
+    pio->used &= ~(((1u << program->length) - 1) << loaded_offset);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    SimClock::spend(SimCost::PIO);
+
+    for(uint i = 0; i < NUM_PIO_STATE_MACHINES; ++i) {
+        if (!pio->sm[i].claimed) {
+            pio->sm[i].claimed = true;
+            return int(i);
+        }
+    }
+
+    if (required) {
+        fprintf(stderr, "pio_claim_unused_sm: no state machine.\n");
+        abort();
+    }
+
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+    if (SSimPioSm* each = SimPio::sm(pio, sm)) {
+        each->claimed = false;
+        each->enabled = false;
+    }
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    gpio_set_function(pin, pio->index ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0);
+}
+
+pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = pio_sm_config();
+
+    c.clkdiv = 1 << 8;
+    c.wrap_target = 0;
+    c.wrap = PIO_INSTRUCTION_COUNT - 1;
+    c.in_shift_right = true;
+    c.out_shift_right = true;
+    return c;
+}
+
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap) {
+    c->wrap_target = uint8_t(wrap_target);
+    c->wrap = uint8_t(wrap);
+}
+
+void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs) {
+    (void) pindirs;
+
+    c->sideset_bits = uint8_t(bit_count);
+    c->sideset_optional = optional;
+}
+
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base) {
+    c->sideset_base = uint8_t(sideset_base);
+}
+
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base) {
+    c->in_base = uint8_t(in_base);
+}
+
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count) {
+    c->out_base = uint8_t(out_base);
+    c->out_count = uint8_t(out_count);
+}
+
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count) {
+    c->set_base = uint8_t(set_base);
+    c->set_count = uint8_t(set_count);
+}
+
+void sm_config_set_jmp_pin(pio_sm_config* c, uint pin) {
+    c->jmp_pin = uint8_t(pin);
+}
+
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold) {
+    c->in_shift_right = shift_right;
+    c->autopush = autopush;
+    c->push_threshold = uint8_t(push_threshold & 31);
+}
+
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->out_shift_right = shift_right;
+    c->autopull = autopull;
+    c->pull_threshold = uint8_t(pull_threshold & 31);
+}
+
+void sm_config_set_clkdiv_int_frac(pio_sm_config* c, uint16_t div_int, uint8_t div_frac) {
+    c->clkdiv = (uint32_t(div_int) << 8) | div_frac;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config) {
+    SimClock::spend(SimCost::PIO_INIT);
+
+    SSimPioSm* each = SimPio::sm(pio, sm);
+    if (!each) {
+        return;
+    }
+
+    // --> disabled, the FIFOs and the shift counters cleared.
+    each->enabled = false;
+    each->config = *config;
+    each->pc = uint8_t(initial_pc);
+    each->x = each->y = 0;
+    each->isr = each->osr = 0;
+    each->isrCount = 0;
+    each->osrCount = 32;
+    each->txHead = each->txCount = 0;
+    each->rxHead = each->rxCount = 0;
+    each->pushes = each->pops = 0;
+    each->time = SimClock::now() * 256;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    SimClock::spend(SimCost::PIO);
+
+    SSimPioSm* each = SimPio::sm(pio, sm);
+    if (!each) {
+        return;
+    }
+
+    if (enabled && !each->enabled && each->time < SimClock::now() * 256) {
+        each->time = SimClock::now() * 256;
+    }
+
+    each->enabled = enabled;
+}
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac) {
+    SimClock::spend(SimCost::PIO);
+
+    if (SSimPioSm* each = SimPio::sm(pio, sm)) {
+        sm_config_set_clkdiv_int_frac(&each->config, div_int, div_frac);
+    }
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+    (void) sm;
+
+    SimClock::spend(SimCost::PIO_INIT);
+    SimPio::drive(pio, pin_values, pin_mask);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+    (void) sm;
+
+    const uint32_t mask = (pin_count >= 32 ? 0xffffffff : ((1u << pin_count) - 1)) << pin_base;
+
+    SimClock::spend(SimCost::PIO_INIT);
+    SimPio::direct(pio, is_out ? mask : 0, mask);
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    SimClock::spend(SimCost::PIO);
+
+    if (SSimPioSm* each = SimPio::sm(pio, sm)) {
+        each->txHead = each->txCount = 0;
+        each->rxHead = each->rxCount = 0;
+    }
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return (pio->index ? DREQ_PIO1_TX0 : DREQ_PIO0_TX0) + (is_tx ? 0 : 4) + sm;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    SSimPioSm* each = SimPio::sm(pio, sm);
+    SimClock::spend(SimCost::PIO);
+
+    // --> full: the state machine pulls meanwhile, or the CPU spins forever.
+    SimPio::run(pio, each, [each]() { return each->txCount < 4; });
+    while (each->txCount >= 4) {
+        SimClock::spend(SimCost::PIO);
+        SimClock::checkpoint();
+    }
+
+    const uint8_t at = uint8_t((each->txHead + each->txCount) & 3);
+
+    each->tx[at] = data;
+    each->txAt[at] = SimClock::now();
+    each->txCount++;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+    SSimPioSm* each = SimPio::sm(pio, sm);
+
+    // --> empty: the state machine pushes meanwhile, or the CPU spins forever.
+    SimPio::run(pio, each, [each]() { return each->rxCount > 0; });
+    while (!each->rxCount) {
+        SimClock::spend(SimCost::PIO);
+        SimClock::checkpoint();
+    }
+
+    // --> spins until pushed.
+    const uint64_t at = each->rxAt[each->rxHead];
+    if (at > SimClock::now()) {
+        SimClock::spend(at - SimClock::now());
+    }
+
+    SimClock::spend(SimCost::PIO);
+
+    const uint32_t data = each->rx[each->rxHead];
+    each->rxHead = uint8_t((each->rxHead + 1) & 3);
+    each->rxCount--;
+    each->popAt[each->pops++ & 3] = SimClock::now();
+    return data;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    SSimPioSm* each = SimPio::sm(pio, sm);
+    SimClock::spend(SimCost::PIO);
+
+    // --> the words pushed until now.
+    SimPio::run(pio, each, [each]() {
+        return each->rxCount >= 4 || each->time >= SimClock::now() * 256;
+    });
+
+    return !each->rxCount || each->rxAt[each->rxHead] > SimClock::now();
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm) {
+    SSimPioSm* each = SimPio::sm(pio, sm);
+    SimClock::spend(SimCost::PIO);
+
+    SimPio::run(pio, each, [each]() {
+        return each->txCount < 4 || each->time >= SimClock::now() * 256;
+    });
+
+    return each->txCount >= 4;
+}
@@ -0,0 +1,90 @@
+#include <hardware/spi.h>
+#include "../clock.h"
+#include "../cost.h"
+#include "../spi.h"
+
+uint spi_init(spi_inst_t* spi, uint baudrate) {
+    return spi_set_baudrate(spi, baudrate);
+}
+
+void spi_deinit(spi_inst_t* spi) {
+    spi->baud = 0;
+}
+
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate) {
+    SimClock::spend(SimCost::SPI_INIT);
+
+    spi->baud = SimSpi::actualBaudrate(baudrate);
+    return spi->baud;
+}
+
+uint spi_get_baudrate(const spi_inst_t* spi) {
+    return spi->baud;
+}
+
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void) spi; (void) data_bits;
+    (void) cpol; (void) cpha; (void) order;
+
+    SimClock::spend(SimCost::SPI_INIT);
+}
+
+/**
+ * Exchange bytes with the attached device, the calling core spins
+ * for the whole transfer like the SDK's blocking calls.
+ * This is a checkpoint, and the power cut point of `SimSpi::setPowerCut`.
+ */
+static int sim_spi_xfer(spi_inst_t* spi, const uint8_t* src, uint8_t repeated, uint8_t* dst, size_t len) {
+    const uint64_t byteTime = SimSpi::byteTime(spi);
+    const uint64_t begin = SimClock::now();
+
+    SimClock::checkpoint();
+    if (spi->cutAt && spi->frames >= spi->cutAt) {
+        spi->cutAt = 0;
+
+        if (spi->dev) {
+            spi->dev->powerCut();
+        }
+
+        throw SimHalt();
+    }
+
+    SimClock::spend(SimCost::SPI_CALL);
+    spi->calls++;
+
+    for(size_t i = 0; i < len; ++i) {
+        const uint8_t tx = src ? src[i] : repeated;
+
+        SimClock::spend(byteTime);
+        const uint8_t rx = SimSpi::exchange(spi, tx);
+
+        if (dst) {
+            dst[i] = rx;
+        }
+    }
+
+    spi->bytes += len;
+    spi->busy += SimClock::now() - begin;
+
+    return int(len);
+}
+
+int spi_write_read_blocking(spi_inst_t* spi, const uint8_t* src, uint8_t* dst, size_t len) {
+    return sim_spi_xfer(spi, src, 0, dst, len);
+}
+
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len) {
+    return sim_spi_xfer(spi, src, 0, nullptr, len);
+}
+
+int spi_read_blocking(spi_inst_t* spi, uint8_t repeated_tx_data, uint8_t* dst, size_t len) {
+    return sim_spi_xfer(spi, nullptr, repeated_tx_data, dst, len);
+}
+
+spi_hw_t* spi_get_hw(spi_inst_t* spi) {
+    return &spi->hw;
+}
+
+uint spi_get_dreq(spi_inst_t* spi, bool is_tx) {
+    return spi->bus ? (is_tx ? DREQ_SPI1_TX : DREQ_SPI1_RX) : (is_tx ? DREQ_SPI0_TX : DREQ_SPI0_RX);
+}
@@ -0,0 +1,97 @@
+#include <pico/time.h>
+#include <pico/bootrom.h>
+#include <hardware/watchdog.h>
+#include <bsp/board_api.h>
+#include "../board.h"
+#include "../cost.h"
+#include "../gpio.h"
+
+uint64_t time_us_64(void) {
+    SimClock::spend(SimCost::TIMER);
+    SimClock::checkpoint();
+    SimGpio::poll();
+
+    return SimClock::now() / SimClock::US;
+}
+
+uint32_t time_us_32(void) {
+    return uint32_t(time_us_64());
+}
+
+uint32_t board_millis(void) {
+    SimClock::spend(SimCost::TIMER);
+    SimClock::checkpoint();
+    SimGpio::poll();
+
+    return uint32_t(SimClock::now() / SimClock::MS);
+}
+
+void sleep_us(uint64_t us) {
+    SimClock::sleep(us * SimClock::US);
+    SimClock::checkpoint();
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us(uint64_t(ms) * 1000);
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return time_us_64() + uint64_t(ms) * 1000;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+    const uint64_t until = timeout_timestamp * SimClock::US;
+    SimBoard* board = SimBoard::current();
+
+    SimClock::spend(SimCost::TIMER);
+    SimClock::checkpoint();
+    SimGpio::poll();
+
+    bool timeout = false;
+    while (!SimGpio::takeEvent()) {
+        const uint64_t now = SimClock::now();
+        const uint64_t usb = board ? board->host().nextEvent() : UINT64_MAX;
+
+        if (usb <= now) {
+            break;
+        }
+
+        if (now >= until) {
+            timeout = true;
+            break;
+        }
+
+        // --> nothing happens until the earliest of them.
+        uint64_t next = SimGpio::nextChange();
+        if (usb < next) {
+            next = usb;
+        }
+
+        if (until < next) {
+            next = until;
+        }
+
+        SimClock::waitUntil(next);
+        SimClock::checkpoint();
+        SimGpio::poll();
+    }
+
+    // --> the alarm is an interrupt as well.
+    SimClock::spend(SimCost::WAKE);
+    return timeout;
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms) {
+    (void) pc; (void) sp; (void) delay_ms;
+
+    if (SimBoard* board = SimBoard::current()) {
+        board->reboot();
+    }
+
+    SimClock::stop();
+    SimClock::checkpoint();
+}
+
+void reset_usb_boot(uint32_t gpio_activity_pin_mask, uint32_t disable_interface_mask) {
+    watchdog_reboot(gpio_activity_pin_mask, disable_interface_mask, 0);
+}
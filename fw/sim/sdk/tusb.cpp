@@ -0,0 +1,110 @@
+#include <tusb.h>
+#include "../board.h"
+#include "../cost.h"
+#include "../gpio.h"
+
+static SimUsbHost* sim_host() {
+    SimBoard* board = SimBoard::current();
+    return board ? &board->host() : nullptr;
+}
+
+bool tud_init(uint8_t rhport) {
+    (void) rhport;
+    SimClock::spend(SimCost::TUD_CALL);
+
+    if (SimUsbHost* host = sim_host()) {
+        host->init();
+        return true;
+    }
+
+    return false;
+}
+
+void tud_task(void) {
+    SimClock::spend(SimCost::TUD_TASK);
+    SimClock::checkpoint();
+    SimGpio::poll();
+
+    if (SimUsbHost* host = sim_host()) {
+        host->task();
+    }
+}
+
+bool tud_task_event_ready(void) {
+    SimClock::spend(SimCost::TUD_EVENT);
+
+    SimUsbHost* host = sim_host();
+    return host && host->nextEvent() <= SimClock::now();
+}
+
+bool tud_mounted(void) {
+    SimUsbHost* host = sim_host();
+    return host && host->mounted();
+}
+
+bool tud_hid_ready(void) {
+    SimClock::spend(SimCost::TUD_CALL);
+
+    SimUsbHost* host = sim_host();
+    return host && host->hidReady();
+}
+
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6]) {
+    (void) report_id;
+    SimClock::spend(SimCost::TUD_CALL);
+
+    SimUsbHost* host = sim_host();
+    return host && host->hidReport(modifier, keycode);
+}
+
+uint32_t tud_cdc_n_available(uint8_t itf) {
+    (void) itf;
+    SimClock::spend(SimCost::TUD_CALL);
+
+    SimUsbHost* host = sim_host();
+    return host ? host->cdcAvailable() : 0;
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize) {
+    (void) itf;
+
+    SimUsbHost* host = sim_host();
+    const uint32_t len = host ? host->cdcRead((uint8_t*) buffer, bufsize) : 0;
+
+    SimClock::spend(SimCost::TUD_CALL + len * SimCost::TUD_BYTE);
+    return len;
+}
+
+void tud_cdc_n_read_flush(uint8_t itf) {
+    (void) itf;
+    SimClock::spend(SimCost::TUD_CALL);
+
+    if (SimUsbHost* host = sim_host()) {
+        host->cdcReadFlush();
+    }
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize) {
+    (void) itf;
+
+    SimUsbHost* host = sim_host();
+    const uint32_t len = host ? host->cdcWrite((const uint8_t*) buffer, bufsize) : 0;
+
+    SimClock::spend(SimCost::TUD_CALL + len * SimCost::TUD_BYTE);
+    return len;
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf) {
+    (void) itf;
+    SimClock::spend(SimCost::TUD_CALL);
+
+    // --> the host model drains the FIFO continuously.
+    return 0;
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf) {
+    (void) itf;
+
+    SimUsbHost* host = sim_host();
+    return host ? host->cdcWriteAvailable() : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef __SIM_SDK_TUSB_H__
+#define __SIM_SDK_TUSB_H__
+
+/**
+ * Host-side stand-in for the TinyUSB device stack.
+ * The other side of the bus is `SimUsbHost` (see `sim/usbhost.h`).
+ */
+#include "pico.h"
+
+#ifndef CFG_TUD_EXTERN
+#ifdef __cplusplus
+#define CFG_TUD_EXTERN extern "C"
+#else
+#define CFG_TUD_EXTERN extern
+#endif
+#endif
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+enum {
+    KEYBOARD_LED_NUMLOCK = 1 << 0,
+    KEYBOARD_LED_CAPSLOCK = 1 << 1,
+    KEYBOARD_LED_SCROLLLOCK = 1 << 2,
+    KEYBOARD_LED_COMPOSE = 1 << 3,
+    KEYBOARD_LED_KANA = 1 << 4
+};
+
+SIM_SDK_BEGIN
+
+bool tud_init(uint8_t rhport);
+void tud_task(void);
+bool tud_task_event_ready(void);
+bool tud_mounted(void);
+
+bool tud_hid_ready(void);
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6]);
+
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize);
+void tud_cdc_n_read_flush(uint8_t itf);
+uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_flush(uint8_t itf);
+uint32_t tud_cdc_n_write_available(uint8_t itf);
+
+// --> callbacks, implemented by the firmware.
+void tud_mount_cb(void);
+void tud_umount_cb(void);
+void tud_cdc_rx_cb(uint8_t itf);
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize);
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen);
+
+SIM_SDK_END
+
+#endif
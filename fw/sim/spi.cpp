@@ -0,0 +1,124 @@
+#include "spi.h"
+#include "gpio.h"
+
+static spi_inst g_simSpi[SimSpi::MAX_BUS] = {
+    { { 0 }, 0, 0, nullptr, 0, 0, 0, 0, 0, 0, 0, 0xff },
+    { { 0 }, 1, 0, nullptr, 0, 0, 0, 0, 0, 0, 0, 0xff },
+};
+
+spi_inst_t* const sim_spi0 = &g_simSpi[0];
+spi_inst_t* const sim_spi1 = &g_simSpi[1];
+
+spi_inst_t* SimSpi::get(uint8_t bus) {
+    if (bus >= MAX_BUS) {
+        return nullptr;
+    }
+
+    return &g_simSpi[bus];
+}
+
+void SimSpi::reset() {
+    for(uint8_t i = 0; i < MAX_BUS; ++i) {
+        g_simSpi[i].baud = 0;
+        g_simSpi[i].dev = nullptr;
+        g_simSpi[i].cutAt = 0;
+        g_simSpi[i].maxBaud = 0;
+        g_simSpi[i].lastRx = 0xff;
+        resetStats(i);
+    }
+}
+
+void SimSpi::attach(uint8_t bus, uint8_t csn, SimSpiDevice* dev) {
+    spi_inst_t* spi = get(bus);
+    if (!spi) {
+        return;
+    }
+
+    spi->dev = dev;
+    SimGpio::attachOutput(csn, [spi, dev](bool level) {
+        if (level) {
+            dev->deselect();
+            return;
+        }
+
+        spi->frames++;
+        dev->select();
+    });
+}
+
+void SimSpi::resetStats(uint8_t bus) {
+    if (spi_inst_t* spi = get(bus)) {
+        spi->calls = 0;
+        spi->bytes = 0;
+        spi->frames = 0;
+        spi->busy = 0;
+        spi->dmaBytes = 0;
+    }
+}
+
+void SimSpi::setPowerCut(uint8_t bus, uint64_t frame) {
+    if (spi_inst_t* spi = get(bus)) {
+        spi->cutAt = frame;
+    }
+}
+
+void SimSpi::setMaxBaudrate(uint8_t bus, uint32_t baud) {
+    if (spi_inst_t* spi = get(bus)) {
+        spi->maxBaud = baud;
+    }
+}
+
+uint8_t SimSpi::exchange(spi_inst_t* spi, uint8_t data) {
+    const uint8_t rx = spi->dev ? spi->dev->xfer(data) : 0xff;
+
+    if (spi->maxBaud && spi->baud > spi->maxBaud) {
+        // --> sampled a bit late: the last bit of the previous byte comes first.
+        const uint8_t late = uint8_t((rx >> 1) | (spi->lastRx << 7));
+
+        spi->lastRx = rx;
+        return late;
+    }
+
+    spi->lastRx = rx;
+    return rx;
+}
+
+uint32_t SimSpi::actualBaudrate(uint32_t baud) {
+    if (!baud) {
+        return 0;
+    }
+
+    // --> same search with the SDK's `spi_set_baudrate`.
+    uint32_t prescale, postdiv;
+    for (prescale = 2; prescale <= 254; prescale += 2) {
+        if (CLK_PERI < (prescale + 2) * 256 * uint64_t(baud)) {
+            break;
+        }
+    }
+
+    for (postdiv = 256; postdiv > 1; --postdiv) {
+        if (CLK_PERI / (prescale * (postdiv - 1)) > baud) {
+            break;
+        }
+    }
+
+    return CLK_PERI / (prescale * postdiv);
+}
+
+uint64_t SimSpi::byteTime(const spi_inst_t* spi) {
+    if (!spi->baud) {
+        return 0;
+    }
+
+    return (8ull * 1000 * 1000 * 1000) / spi->baud;
+}
+
+spi_inst_t* SimSpi::findByData(const volatile void* addr) {
+    for(spi_inst& each : g_simSpi) {
+        if (addr == &each.hw.dr) {
+            return &each;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,98 @@
+#ifndef __SIM_SPI_H__
+#define __SIM_SPI_H__
+
+#include <stdint.h>
+#include <hardware/spi.h>
+
+/**
+ * Simulated SPI device, attached to a bus and a chip select pin.
+ */
+class SimSpiDevice {
+public:
+    virtual ~SimSpiDevice() { }
+
+public:
+    /* called when the chip select goes low. */
+    virtual void select() = 0;
+
+    /* called when the chip select goes high. */
+    virtual void deselect() = 0;
+
+    /* exchange a byte, full-duplex. */
+    virtual uint8_t xfer(uint8_t data) = 0;
+
+    /* called when the power is cut, the device ignores everything after. */
+    virtual void powerCut() { }
+};
+
+/**
+ * SPI instance, `spi_inst_t` of the stand-in SDK.
+ */
+struct spi_inst {
+    spi_hw_t hw;            // --> DMA transfers address its `dr`.
+    uint8_t bus;
+    uint32_t baud;          // --> actual baud-rate, 0 if not initialized.
+    SimSpiDevice* dev;      // --> attached device.
+
+    // --> statistics.
+    uint64_t calls;         // --> spi_*_blocking calls.
+    uint64_t bytes;         // --> bytes exchanged.
+    uint64_t frames;        // --> chip select assertions.
+    uint64_t busy;          // --> time spent by the blocking calls.
+    uint64_t dmaBytes;      // --> bytes exchanged by DMA transfers.
+
+    // --> power cut at the first transfer of the frame, 0 if never.
+    uint64_t cutAt;
+
+    // --> the wiring: MISO is sampled a bit late above this, 0 if unlimited.
+    uint32_t maxBaud;
+    uint8_t lastRx;
+};
+
+/**
+ * Simulated SPI controllers.
+ */
+class SimSpi {
+public:
+    static constexpr uint8_t MAX_BUS = 2;
+    static constexpr uint32_t CLK_PERI = 125 * 1000 * 1000;
+
+public:
+    /* get the SPI instance. */
+    static spi_inst_t* get(uint8_t bus);
+
+    /* detach all devices and reset all statistics. */
+    static void reset();
+
+    /* attach a device to the bus and the chip select pin. */
+    static void attach(uint8_t bus, uint8_t csn, SimSpiDevice* dev);
+
+    /* reset the statistics of the bus. */
+    static void resetStats(uint8_t bus);
+
+    /**
+     * Cut the power at the first transfer of the `frame`-th chip select assertion:
+     * the device powers off and the calling core halts by `SimHalt`.
+     */
+    static void setPowerCut(uint8_t bus, uint64_t frame);
+
+    /**
+     * Set the highest clock the wiring carries, 0 if unlimited.
+     * Above this, every byte read is shifted by a bit, like a late MISO sampling.
+     */
+    static void setMaxBaudrate(uint8_t bus, uint32_t baud);
+
+    /* exchange a byte with the attached device through the wiring. */
+    static uint8_t exchange(spi_inst_t* spi, uint8_t data);
+
+    /* compute the actual baud-rate like the RP2040's SSP prescaler. */
+    static uint32_t actualBaudrate(uint32_t baud);
+
+    /* compute the time to shift a byte. */
+    static uint64_t byteTime(const spi_inst_t* spi);
+
+    /* find the SPI instance by the address of its data register. */
+    static spi_inst_t* findByData(const volatile void* addr);
+};
+
+#endif
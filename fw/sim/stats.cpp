@@ -0,0 +1,61 @@
+#include "stats.h"
+#include <stdio.h>
+#include <algorithm>
+
+uint64_t SimStats::min() const {
+    if (_samples.empty()) {
+        return 0;
+    }
+
+    return *std::min_element(_samples.begin(), _samples.end());
+}
+
+uint64_t SimStats::max() const {
+    if (_samples.empty()) {
+        return 0;
+    }
+
+    return *std::max_element(_samples.begin(), _samples.end());
+}
+
+uint64_t SimStats::sum() const {
+    uint64_t sum = 0;
+    for(uint64_t each : _samples) {
+        sum += each;
+    }
+
+    return sum;
+}
+
+double SimStats::avg() const {
+    if (_samples.empty()) {
+        return 0;
+    }
+
+    return double(sum()) / double(_samples.size());
+}
+
+uint64_t SimStats::pct(double p) const {
+    if (_samples.empty()) {
+        return 0;
+    }
+
+    std::vector<uint64_t> sorted = _samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t n = size_t((p / 100.0) * double(sorted.size() - 1) + 0.5);
+    if (n >= sorted.size()) {
+        n = sorted.size() - 1;
+    }
+
+    return sorted[n];
+}
+
+void SimStats::print(const char* name) const {
+    printf("%-28s n=%-7zu avg=%10.2f us  p50=%10.2f us  p99=%10.2f us  max=%10.2f us\n",
+        name, count(), avg() / 1000.0, pct(50) / 1000.0, pct(99) / 1000.0, max() / 1000.0);
+}
+
+void simReport(const char* name, double value, const char* unit) {
+    printf("%-28s %12.3f %s\n", name, value, unit);
+}
@@ -0,0 +1,37 @@
+#ifndef __SIM_STATS_H__
+#define __SIM_STATS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Sample set for the scenario reports.
+ */
+class SimStats {
+private:
+    std::vector<uint64_t> _samples;
+
+public:
+    void add(uint64_t value) { _samples.push_back(value); }
+    void clear() { _samples.clear(); }
+
+public:
+    size_t count() const { return _samples.size(); }
+    uint64_t min() const;
+    uint64_t max() const;
+    uint64_t sum() const;
+    double avg() const;
+
+    /* get the percentile, 0 ~ 100. */
+    uint64_t pct(double p) const;
+
+public:
+    /* print a line: `name: n=.. avg=.. p50=.. p99=.. max=..` in microseconds. */
+    void print(const char* name) const;
+};
+
+/* print a key-value line of the scenario report. */
+void simReport(const char* name, double value, const char* unit);
+
+#endif
@@ -0,0 +1,272 @@
+#include "usbhost.h"
+#include "clock.h"
+#include <tusb.h>
+#include <string.h>
+
+SimUsbHost::SimUsbHost()
+    : _mountDelay(20 * SimClock::MS), _hidInterval(5 * SimClock::MS),
+      _cdcByteTime(1 * SimClock::US), _init(false), _mounted(false), _initAt(0),
+      _hidBusy(false), _hidQueued(0), _hidDropped(0), _cdcOutAt(0), _cdcTxAt(0), _firstTask(0), _lastTask(0), _lastWaited(0)
+{
+}
+
+void SimUsbHost::sendLeds(uint8_t leds, uint64_t at) {
+    _leds.push_back(std::make_pair(at, leds));
+}
+
+void SimUsbHost::sendCdc(const uint8_t* buf, uint32_t len, uint64_t at) {
+    if (_cdcOutAt < at) {
+        _cdcOutAt = at;
+    }
+
+    for(uint32_t i = 0; i < len; ++i) {
+        _cdcOutAt += _cdcByteTime;
+        _cdcOut.push_back({ _cdcOutAt, buf[i] });
+    }
+}
+
+void SimUsbHost::sendCdc(uint8_t opcode, const uint8_t* data, uint8_t len, uint64_t at) {
+    uint8_t frame[3 + 255];
+    uint16_t sum = opcode + len;
+
+    frame[0] = opcode;
+    frame[1] = len;
+
+    for(uint8_t i = 0; i < len; ++i) {
+        frame[2 + i] = data[i];
+        sum += data[i];
+    }
+
+    // --> same with `UsbCdc::checksum`.
+    frame[2 + len] = uint8_t(((sum & 0xff) ^ 0xff) + 1);
+    sendCdc(frame, 3 + len, at);
+}
+
+std::vector<SSimCdcMessage> SimUsbHost::cdcMessages() const {
+    std::vector<SSimCdcMessage> messages;
+    size_t pos = 0;
+
+    while (pos + 3 <= _cdcIn.size()) {
+        SSimCdcMessage msg;
+        const uint8_t len = _cdcIn[pos + 1].byte;
+
+        if (pos + 3 + len > _cdcIn.size()) {
+            break;
+        }
+
+        msg.opcode = _cdcIn[pos].byte;
+        msg.length = len > sizeof(msg.data) ? sizeof(msg.data) : len;
+
+        uint16_t sum = msg.opcode + len;
+        for(uint8_t i = 0; i < len; ++i) {
+            const uint8_t each = _cdcIn[pos + 2 + i].byte;
+
+            if (i < msg.length) {
+                msg.data[i] = each;
+            }
+
+            sum += each;
+        }
+
+        msg.at = _cdcIn[pos + 2 + len].at;
+        msg.valid = _cdcIn[pos + 2 + len].byte == uint8_t(((sum & 0xff) ^ 0xff) + 1);
+        messages.push_back(msg);
+
+        pos += 3 + len;
+    }
+
+    return messages;
+}
+
+void SimUsbHost::clearStats() {
+    _reports.clear();
+    _hidDropped = 0;
+    _cdcIn.clear();
+    _taskGaps.clear();
+    _taskAwake.clear();
+    _firstTask = _lastTask = _lastWaited = 0;
+}
+
+void SimUsbHost::init() {
+    _init = true;
+    _mounted = false;
+    _initAt = SimClock::now();
+    _hidBusy = false;
+    _cdcRx.clear();
+    _cdcTx.clear();
+}
+
+void SimUsbHost::task() {
+    const uint64_t now = SimClock::now();
+    const uint64_t waited = SimClock::waited(SimClock::core());
+
+    if (_lastTask) {
+        _taskGaps.push_back(now - _lastTask);
+        _taskAwake.push_back(now - _lastTask - (waited - _lastWaited));
+    }
+
+    else if (!_firstTask) {
+        _firstTask = now;
+    }
+
+    _lastTask = now;
+    _lastWaited = waited;
+    if (!_init) {
+        return;
+    }
+
+    if (!_mounted) {
+        if (now - _initAt < _mountDelay) {
+            return;
+        }
+
+        _mounted = true;
+        tud_mount_cb();
+    }
+
+    pollHid(now);
+    moveCdc(now);
+
+    while (!_leds.empty() && _leds.front().first <= now) {
+        const uint8_t leds = _leds.front().second;
+        _leds.pop_front();
+
+        // --> report id 1: `UsbHid::REPORT_ID`.
+        tud_hid_set_report_cb(0, 1, HID_REPORT_TYPE_OUTPUT, &leds, 1);
+    }
+}
+
+bool SimUsbHost::hidReady() {
+    pollHid(SimClock::now());
+    return _mounted && !_hidBusy;
+}
+
+bool SimUsbHost::hidReport(uint8_t modifier, const uint8_t keycodes[6]) {
+    if (!hidReady()) {
+        _hidDropped++;
+        return false;
+    }
+
+    SSimHidReport report;
+    report.queued = SimClock::now();
+    report.sent = 0;
+    report.modifier = modifier;
+    memcpy(report.keycodes, keycodes, sizeof(report.keycodes));
+
+    _reports.push_back(report);
+    _hidBusy = true;
+    _hidQueued = report.queued;
+
+    return true;
+}
+
+uint32_t SimUsbHost::cdcRead(uint8_t* buf, uint32_t len) {
+    uint32_t done = 0;
+
+    while (done < len && !_cdcRx.empty()) {
+        buf[done++] = _cdcRx.front();
+        _cdcRx.pop_front();
+    }
+
+    return done;
+}
+
+void SimUsbHost::cdcReadFlush() {
+    _cdcRx.clear();
+}
+
+uint32_t SimUsbHost::cdcWrite(const uint8_t* buf, uint32_t len) {
+    const uint32_t avail = cdcWriteAvailable();
+    if (len > avail) {
+        len = avail;
+    }
+
+    if (_cdcTx.empty()) {
+        _cdcTxAt = SimClock::now();
+    }
+
+    for(uint32_t i = 0; i < len; ++i) {
+        _cdcTx.push_back(buf[i]);
+    }
+
+    return len;
+}
+
+uint64_t SimUsbHost::nextEvent() const {
+    uint64_t next = UINT64_MAX;
+
+    if (!_init) {
+        return next;
+    }
+
+    if (!_mounted) {
+        return _initAt + _mountDelay;
+    }
+
+    if (_hidBusy) {
+        next = pollAt(_hidQueued);
+    }
+
+    // --> the FIFO full: the host retries after the device read.
+    if (!_cdcOut.empty() && _cdcRx.size() < CDC_FIFO && _cdcOut.front().at < next) {
+        next = _cdcOut.front().at;
+    }
+
+    if (!_cdcTx.empty()) {
+        const uint64_t drained = _cdcTxAt + _cdcTx.size() * _cdcByteTime;
+
+        if (drained < next) {
+            next = drained;
+        }
+    }
+
+    if (!_leds.empty() && _leds.front().first < next) {
+        next = _leds.front().first;
+    }
+
+    return next;
+}
+
+uint64_t SimUsbHost::pollAt(uint64_t queued) const {
+    // --> the host polls at every interval since the mount.
+    const uint64_t base = _initAt + _mountDelay;
+    return base + ((queued - base) / _hidInterval + 1) * _hidInterval;
+}
+
+void SimUsbHost::pollHid(uint64_t now) {
+    if (!_hidBusy || !_mounted) {
+        return;
+    }
+
+    const uint64_t poll = pollAt(_hidQueued);
+
+    if (now >= poll) {
+        if (!_reports.empty() && _reports.back().queued == _hidQueued) {
+            _reports.back().sent = poll;
+        }
+
+        _hidBusy = false;
+    }
+}
+
+void SimUsbHost::moveCdc(uint64_t now) {
+    bool received = false;
+
+    // --> host to device.
+    while (!_cdcOut.empty() && _cdcOut.front().at <= now && _cdcRx.size() < CDC_FIFO) {
+        _cdcRx.push_back(_cdcOut.front().byte);
+        _cdcOut.pop_front();
+        received = true;
+    }
+
+    if (received) {
+        tud_cdc_rx_cb(0);
+    }
+
+    // --> device to host.
+    while (!_cdcTx.empty() && _cdcTxAt + _cdcByteTime <= now) {
+        _cdcTxAt += _cdcByteTime;
+        _cdcIn.push_back({ _cdcTxAt, _cdcTx.front() });
+        _cdcTx.pop_front();
+    }
+}
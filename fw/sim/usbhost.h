@@ -0,0 +1,154 @@
+#ifndef __SIM_USBHOST_H__
+#define __SIM_USBHOST_H__
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+/**
+ * HID report, as seen by the host.
+ */
+struct SSimHidReport {
+    uint64_t queued;        // --> tud_hid_keyboard_report() called.
+    uint64_t sent;          // --> polled by the host.
+    uint8_t modifier;
+    uint8_t keycodes[6];
+};
+
+/**
+ * CDC message, as seen by the host.
+ */
+struct SSimCdcMessage {
+    uint64_t at;            // --> the last byte arrived.
+    uint8_t opcode;
+    uint8_t length;
+    uint8_t data[64];
+    bool valid;             // --> checksum matched.
+};
+
+/**
+ * Simulated USB host, the other side of the TinyUSB stand-in.
+ * --
+ * 1. enumerates the device `mountDelay` after `tud_init`.
+ * 2. polls the HID endpoint every `hidInterval` (bInterval of `desc.cpp`),
+ *    a report queued while the previous one is not polled yet is dropped,
+ *    the firmware waits for `tud_hid_ready()` so none should be.
+ * 3. moves CDC bytes at `cdcByteTime` per byte in both directions,
+ *    so the bytes sent by a scenario arrive one after another.
+ */
+class SimUsbHost {
+public:
+    static constexpr uint32_t CDC_FIFO = 64;
+
+private:
+    struct SPending {
+        uint64_t at;
+        uint8_t byte;
+    };
+
+    uint64_t _mountDelay;
+    uint64_t _hidInterval;
+    uint64_t _cdcByteTime;
+
+    bool _init, _mounted;
+    uint64_t _initAt;
+
+    // --> HID.
+    std::vector<SSimHidReport> _reports;
+    bool _hidBusy;
+    uint64_t _hidQueued;
+    uint32_t _hidDropped;
+    std::deque<std::pair<uint64_t, uint8_t>> _leds;
+
+    // --> CDC, host to device.
+    std::deque<SPending> _cdcOut;
+    uint64_t _cdcOutAt;
+    std::deque<uint8_t> _cdcRx;
+
+    // --> CDC, device to host.
+    std::deque<uint8_t> _cdcTx;
+    uint64_t _cdcTxAt;
+    std::vector<SPending> _cdcIn;
+
+    // --> loop timing, measured by tud_task calls.
+    uint64_t _firstTask;
+    uint64_t _lastTask;
+    uint64_t _lastWaited;
+    std::vector<uint64_t> _taskGaps;
+    std::vector<uint64_t> _taskAwake;
+
+public:
+    SimUsbHost();
+
+public:
+    void setMountDelay(uint64_t ns) { _mountDelay = ns; }
+    void setHidInterval(uint64_t ns) { _hidInterval = ns; }
+    void setCdcByteTime(uint64_t ns) { _cdcByteTime = ns; }
+
+    /* get the time when the device is mounted, 0 if not mounted. */
+    uint64_t mountedAt() const { return _mounted ? _initAt + _mountDelay : 0; }
+
+    /* set the keyboard LED indicators at the time. */
+    void sendLeds(uint8_t leds, uint64_t at);
+
+    /* send bytes to the CDC at the time. */
+    void sendCdc(const uint8_t* buf, uint32_t len, uint64_t at);
+
+    /* send a CDC message at the time, checksum is computed. */
+    void sendCdc(uint8_t opcode, const uint8_t* data, uint8_t len, uint64_t at);
+
+public:
+    /* get all HID reports. */
+    const std::vector<SSimHidReport>& reports() const { return _reports; }
+
+    /* get the count of dropped HID reports. */
+    uint32_t hidDropped() const { return _hidDropped; }
+
+    /* get all CDC bytes received, with the arrival time. */
+    uint32_t cdcReceived() const { return uint32_t(_cdcIn.size()); }
+
+    /* parse all CDC messages received. */
+    std::vector<SSimCdcMessage> cdcMessages() const;
+
+    /* get the time of the first `tud_task` call: the end of the boot. */
+    uint64_t firstTaskAt() const { return _firstTask; }
+
+    /* get all intervals between `tud_task` calls. */
+    const std::vector<uint64_t>& taskGaps() const { return _taskGaps; }
+
+    /* get all intervals between `tud_task` calls, except the waits for an interrupt. */
+    const std::vector<uint64_t>& taskAwake() const { return _taskAwake; }
+
+    /* forget all measurements. */
+    void clearStats();
+
+public:
+    // --> called by the TinyUSB stand-in.
+    void init();
+    void task();
+    bool mounted() const { return _mounted; }
+    bool hidReady();
+    bool hidReport(uint8_t modifier, const uint8_t keycodes[6]);
+    uint32_t cdcAvailable() const { return uint32_t(_cdcRx.size()); }
+    uint32_t cdcRead(uint8_t* buf, uint32_t len);
+    void cdcReadFlush();
+    uint32_t cdcWrite(const uint8_t* buf, uint32_t len);
+    uint32_t cdcWriteAvailable() const { return CDC_FIFO - uint32_t(_cdcTx.size()); }
+
+    /**
+     * get the time of the next event `task()` handles, UINT64_MAX if none:
+     * the mount, a HID poll of the report queued, CDC bytes arrived,
+     * the CDC FIFO drained, or the LED indicators set.
+     * The device waiting for an interrupt wakes up then.
+     */
+    uint64_t nextEvent() const;
+
+private:
+    /* get the time the host polls the report queued at the time. */
+    uint64_t pollAt(uint64_t queued) const;
+
+    void pollHid(uint64_t now);
+    void moveCdc(uint64_t now);
+};
+
+#endif
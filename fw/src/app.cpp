@@ -11,25 +11,18 @@
 #include <pico/bootrom.h>
 #include <pico/multicore.h>
 #include <pico/mutex.h>
+#include <pico/time.h>
+#include <string.h>
 
-struct AppConf {
-    uint32_t ver;
-    SKeyConf keys[EKEY_MAX];
-};
+static_assert(sizeof(AppConf) <= ConfStore::MAX_PAYLOAD, "the keys of the board don't fit a record: raise CONFSTORE_MAX_RECORD.");
 
-const SKeyConf App::DEFAULT_KEYCONFS[EKEY_MAX] = {
-    { EKCM_NONE, KC_0, KM_NONE, 0 },
-    { EKCM_NONE, KC_1, KM_NONE, 1 },
-    { EKCM_NONE, KC_2, KM_NONE, 2 },
-    { EKCM_NONE, KC_3, KM_NONE, 3 },
-    { EKCM_NONE, KC_4, KM_NONE, 4 },
-    { EKCM_NONE, KC_5, KM_NONE, 5 }
-};
+App* App::_core1 = nullptr;
 
 App::App()
     : _ledctl(EGPIO_595_DAT, EGPIO_595_LAT, EGPIO_595_CLK),
       _flash(spi0, EGPIO_SPI0_CSn, EGPIO_SPI0_SCK, EGPIO_SPI0_RX, EGPIO_SPI0_TX),
-      _timer(nullptr), _blocked(false), _needSave(false), _saveTime(0)
+      _store(&_flash), _fs(&_flash), _scrubber(&_flash),
+      _timer(nullptr), _blocked(false), _needSave(false), _saveTime(0), _scrubPasses(0)
 {
     gpio_init(EGPIO_LED_CR);
     gpio_init(EGPIO_LED_CE);
@@ -39,12 +32,15 @@ App::App()
 
     gpio_put(EGPIO_LED_CR, 1);
     gpio_put(EGPIO_LED_CE, 1);
+
+    memset(_ledLevels, 0, sizeof(_ledLevels));
+    memset(_keyrpt, 0, sizeof(_keyrpt));
 }
 
 void App::onTimerCore() {
-    // --> receive `this` pointer through fifo, then run other core's main.
-    ((App*) multicore_fifo_pop_blocking())
-        ->runTimerCore();
+    // --> wait for the launch signal, then run other core's main.
+    multicore_fifo_pop_blocking();
+    _core1->runTimerCore();
 
     while(1);
 }
@@ -58,7 +54,14 @@ void App::runApp() {
     }
 
     _flash.fastMode(true);
+    _flash.enableDma();
     _hid.init(&_keyboard);
+    _keyboard.enableWait();
+
+    // --> the flash memory has the PIO0: the matrix on the PIO1, or on the CPU if no space.
+    if (_scanner.init(pio1)) {
+        _keyboard.setScanner(&_scanner);
+    }
 
     // --> TUD initialization.
     tud_init(0);
@@ -66,9 +69,25 @@ void App::runApp() {
     // --> load configurations here.
     loadConf();
 
+    // --> profiles, macros and logs: the sectors after the configuration ring.
+    _fs.mount(CONFSTORE_MAX_SECTORS, _flash.sectorMax());
+
+    // --> the records have the copies in RAM, the files are verified only.
+    _scrubber.addStore(&_store);
+    _scrubber.addStore(_fs.catalog());
+    _scrubber.setFs(&_fs);
+
+    // --> after the journal scan: the mount touches each page once.
+    _flash.enableCache();
+
+    // --> 1-1-2 reads on MOSI and MISO: IO2 and IO3 aren't wired.
+    _flash.enablePio(pio0);
+
     // --> launch the other core and, pass `this` pointer.
+    //   : not through the FIFO, a pointer doesn't fit 32 bits on the host.
+    _core1 = this;
     multicore_launch_core1(onTimerCore);
-    multicore_fifo_push_blocking(uint32_t(this));
+    multicore_fifo_push_blocking(0);
     
     // --> wait for other core, then notify about this core.
     multicore_fifo_pop_blocking();
@@ -101,11 +120,26 @@ void App::runApp() {
         }
 
         tickToSave();
+        tickToScrub();
+
+        // --> sleep until a press, a USB event or the periodic works.
+        if (isIdle()) {
+            best_effort_wfe_or_timeout(make_timeout_time_ms(APP_IDLE_WAKE_MS));
+        }
     }
 }
 
 void App::tickToSave() {
+    // --> never waits for the flash memory here.
+    _store.step();
+    _fs.step();
+
     if (_needSave) {
+        // --> the previous save is still running.
+        if (_store.isSaving()) {
+            return;
+        }
+
         uint32_t now = board_millis();
         if ((now - _saveTime) < 1000) {
             return;
@@ -118,11 +152,44 @@ void App::tickToSave() {
     }
 }
 
+void App::tickToScrub() {
+    // --> a slice within the budget, never waits for the flash memory.
+    _scrubber.step();
+
+    const SScrubReport& report = _scrubber.report();
+    if (report.passes == _scrubPasses) {
+        return;
+    }
+
+    // --> the host is told without asking, only if the pass found any.
+    _scrubPasses = report.passes;
+    if (report.found) {
+        emitScrubReport();
+    }
+}
+
 void App::reserveSave() {
     _saveTime = board_millis();
     _needSave = true;
 }
 
+bool App::isIdle() {
+    if (!_keyboard.isWaiting() || _blocked) {
+        return false;
+    }
+
+    // --> a save reserved waits a second anyway: a wake-up starts it.
+    if (!_store.isIdle() || _fs.isBusy() || _scrubber.isRunning() || _flash.isXferBusy()) {
+        return false;
+    }
+
+    if (!_cdc.isIdle() || usbdIsResetRequired()) {
+        return false;
+    }
+
+    return !tud_task_event_ready();
+}
+
 void App::checkToggle() {
     const uint8_t leds = UsbHid::leds();
     for(uint8_t i = 0; i < EKEY_MAX; ++i) {
@@ -152,6 +219,9 @@ void App::runTimerCore() {
     multicore_fifo_push_blocking(0);
     multicore_fifo_pop_blocking();
 
+    // --> the key LEDs follow the key events from here.
+    _ledEvents.attach(&_keyboard.events());
+
     uint32_t last = 0;
     while(1) {
         const uint32_t nowtick = board_millis();
@@ -257,6 +327,24 @@ bool App::unschedule(STimer* timer) {
     return false;
 }
 
+SKeyConf App::defaultKeyConf(uint8_t key) {
+    SKeyConf conf = { EKCM_NONE, KC_NONE, KM_NONE, key };
+
+    if (key == 0) {
+        conf.kc = KC_0;
+    }
+
+    else if (key < 10) {
+        conf.kc = uint8_t(KC_1 + key - 1);
+    }
+
+    else if (key < 36) {
+        conf.kc = uint8_t(KC_A + key - 10);
+    }
+
+    return conf;
+}
+
 void App::panic() {
     uint8_t n = 0;
     uint32_t systick = board_millis();
@@ -278,11 +366,19 @@ void App::panic() {
 void App::loadConf() {
     AppConf conf;
 
-    // --> read full configuration.
-    if (!_flash.read(0, &conf)) {
-        // --> flash corrupted.
-        panic();
-        return;
+    // --> find the newest record of the ring: the first sectors, the filesystem follows it.
+    if (!_store.mount(0, CONFSTORE_MAX_SECTORS, sizeof(AppConf)) || !_store.load(&conf)) {
+        // --> stored by the older firmware: sector 0 as is.
+        if (!_flash.read(0, &conf)) {
+            // --> flash corrupted.
+            panic();
+            return;
+        }
+
+        // --> move it to the store.
+        if (conf.ver == 1) {
+            reserveSave();
+        }
     }
 
     // --> not initialized: use default.
@@ -290,7 +386,9 @@ void App::loadConf() {
         conf.ver = 1;
 
         // --> copy default configurations,
-        memcpy(conf.keys, DEFAULT_KEYCONFS, sizeof(DEFAULT_KEYCONFS));
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            conf.keys[i] = defaultKeyConf(i);
+        }
 
         reserveSave();
     }
@@ -310,16 +408,17 @@ void App::loadConf() {
 }
 
 void App::saveConf() {
-    AppConf conf = { 0, };
+    AppConf conf;
 
+    memset(&conf, 0, sizeof(conf));
     conf.ver = 1;
     
-    // --> copy defaults to configurations.
-    memcpy(conf.keys, DEFAULT_KEYCONFS, sizeof(DEFAULT_KEYCONFS));
-    
     // --> get configurations from the key pointer.
     for(uint8_t i = 0; i < EKEY_MAX; ++i) {
         const EKey key = EKey(i);
+
+        // --> copy defaults to configurations.
+        conf.keys[i] = defaultKeyConf(i);
         
         if (SKey* ptr = _keyboard.getKeyPtr(key)) {
             conf.keys[i].cm = ptr->cm;
@@ -329,46 +428,76 @@ void App::saveConf() {
         }
     }
 
-    // --> store configurations to the flash memory.
-    _flash.eraseSector(0);
-    _flash.write(0, &conf);
+    // --> append configurations to the store.
+    _store.save(&conf);
 }
 
 void App::updateLeds() {
     uint8_t leds = UsbHid::leds();
+    uint32_t touched[KeyState<EKEY_MAX>::WORDS] = { 0, };
+    SKeyEvent event;
+
+    if (_ledEvents.resync()) {
+        memcpy(_ledLevels, _keyboard.levels(), sizeof(_ledLevels));
+    }
+
+    // --> each edge once, a key changes once a flush: a tap shorter than a flush lights up too.
+    while (_ledEvents.peek(event)) {
+        const uint32_t word = event.key >> 5;
+        const uint32_t bit = 1u << (event.key & 31);
+
+        if (touched[word] & bit) {
+            break;
+        }
+
+        touched[word] |= bit;
+        if (event.edge == EKED_RISE) {
+            _ledLevels[word] |= bit;
+        }
+
+        else {
+            _ledLevels[word] &= ~bit;
+        }
+
+        _ledEvents.skip();
+    }
 
     gpio_put(EGPIO_LED_CR, usbdIsMounted() == false);
     gpio_put(EGPIO_LED_CE, _blocked ? 0 : 1);
     
-    updateKeyLed(ELED_00, EKEY_00);
-    updateKeyLed(ELED_01, EKEY_01);
-    updateKeyLed(ELED_02, EKEY_02);
-    updateKeyLed(ELED_10, EKEY_10);
-    updateKeyLed(ELED_11, EKEY_11);
-    updateKeyLed(ELED_12, EKEY_12);
+    for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+        updateKeyLed(Board::ledOf(i), EKey(i));
+    }
 
-    _ledctl.bit(ELED_TL, (leds & EHLED_NUMLOCK) == 0);
-    _ledctl.bit(ELED_TR, (leds & EHLED_CAPSLOCK) == 0);
+    // --> `LED_NONE` is out of the chain: ignored.
+    _ledctl.bit(Board::LED_NUMLOCK, (leds & EHLED_NUMLOCK) == 0);
+    _ledctl.bit(Board::LED_CAPSLOCK, (leds & EHLED_CAPSLOCK) == 0);
 
     _ledctl.flush();
 }
 
 void App::updateKeyLed(uint8_t led, EKey key) {
+    if (led == LED_NONE) {
+        return;
+    }
+
     SKey* ptr = _keyboard.getKeyPtr(key);
     if (!ptr) {
         _ledctl.bit(led, 0); // --> turn on the key LED.
         return;
     }
 
+    const bool down = (_ledLevels[key >> 5] >> (key & 31)) & 1;
+
     switch(ptr->cm) {
         case EKCM_NONE:
             // --> turn off for released state.
-            _ledctl.bit(led, ptr->ls == EKSL_LOW);
+            _ledctl.bit(led, !down);
             break;
 
         case EKCM_INVERT:
             // --> turn off for pressed state.
-            _ledctl.bit(led, ptr->ls == EKSL_HIGH);
+            _ledctl.bit(led, down);
             break;
 
         case EKCM_TOGGLE_INVERT:
@@ -414,7 +543,7 @@ void App::handleMsg(const SCdcMessage& msg) {
         case ECDCM_RESET_KEYS: {
             for(uint8_t i = 0; i < EKEY_MAX; ++i) {
                 SKey* ptr = _keyboard.getKeyPtr(EKey(i));
-                SKeyConf conf = DEFAULT_KEYCONFS[i];
+                SKeyConf conf = defaultKeyConf(i);
 
                 // --> copy key configurations.
                 ptr->cm = conf.cm;
@@ -463,26 +592,69 @@ void App::handleMsg(const SCdcMessage& msg) {
 #endif
             break;
         }
+
+        case ECDCM_SCRUB_REPORT: {
+            // --> non-zero: start a pass now.
+            if (msg.length && msg.data[0]) {
+                _scrubber.request();
+            }
+
+            emitScrubReport();
+            break;
+        }
+
+        case ECDCM_SCAN_PERIOD: {
+            // --> microseconds, a little-endian word: set if given and in range.
+            if (msg.length >= sizeof(uint32_t)) {
+                uint32_t period;
+                memcpy(&period, msg.data, sizeof(period));
+                _keyboard.setScanPeriod(period);
+            }
+
+            emitScanPeriod();
+            break;
+        }
+
+        case ECDCM_DEBOUNCE_STATS: {
+            // --> the key, then the mode if given: 0 stops the calibration, 1 starts, 2 starts over.
+            const uint8_t key = msg.length ? msg.data[0] : 0;
+
+            if (msg.length >= 2) {
+                if (msg.data[1] == 2) {
+                    _keyboard.resetDebounceCalibration();
+                }
+
+                _keyboard.calibrateDebounce(msg.data[1] != 0);
+            }
+
+            emitDebounceStats(key);
+            break;
+        }
     }
 }
 
 void App::emitKeyInfo(uint8_t opcode) {
     SCdcMessage reply;
     reply.opcode = opcode;
-    reply.length = 4 * EKEY_MAX;
 
-    for(uint8_t i = 0; i < EKEY_MAX; ++i) {
-        SKey* ptr = _keyboard.getKeyPtr(EKey(i));
+    // --> the keys in order: a message per `KEYINFO_PER_MSG` keys, the last one shorter.
+    for(uint8_t first = 0; first < EKEY_MAX; first += KEYINFO_PER_MSG) {
+        const uint8_t count = EKEY_MAX - first < KEYINFO_PER_MSG ? EKEY_MAX - first : KEYINFO_PER_MSG;
+        reply.length = 4 * count;
 
-        // --> copy key configurations.
-        reply.data[i * 4 + 0] = ptr->cm;
-        reply.data[i * 4 + 1] = ptr->kc;
-        reply.data[i * 4 + 2] = ptr->km;
-        reply.data[i * 4 + 3] = ptr->id;
-    }
+        for(uint8_t i = 0; i < count; ++i) {
+            SKey* ptr = _keyboard.getKeyPtr(EKey(first + i));
 
-    reply.checksum = _cdc.checksum(reply);
-    _cdc.write(reply);
+            // --> copy key configurations.
+            reply.data[i * 4 + 0] = ptr->cm;
+            reply.data[i * 4 + 1] = ptr->kc;
+            reply.data[i * 4 + 2] = ptr->km;
+            reply.data[i * 4 + 3] = ptr->id;
+        }
+
+        reply.checksum = _cdc.checksum(reply);
+        _cdc.write(reply);
+    }
 }
 
 void App::emitCaptureState(uint8_t opcode) {
@@ -495,12 +667,45 @@ void App::emitCaptureState(uint8_t opcode) {
 }
 
 void App::emitKeyReport(bool optimised) {
-    uint8_t keyrpt[6] = {0, };
-    for(uint8_t i = 0; i < EKEY_MAX; ++i) { 
-        SKey* ptr = _keyboard.getKeyPtr(EKey(i));
+    uint8_t keyrpt[EKEY_MAX] = {0, };
+    SKeyEvent event;
+
+    // --> from the keys as they are: the edges before are not replayed.
+    if (!optimised) {
+        _rptEvents.attach(&_keyboard.events());
+    }
 
-        // --> key report.
-        keyrpt[i] = ptr->ls;
+    // --> attached, or edges lost: the keys as they are, the host sees the jump.
+    if (_rptEvents.resync()) {
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            // --> key report.
+            keyrpt[i] = _keyboard.getKeyState(EKey(i));
+        }
+    }
+
+    else {
+        // --> the edges of the last report settle.
+        for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+            keyrpt[i] = _keyrpt[i];
+
+            if (keyrpt[i] == EKSL_RISE) {
+                keyrpt[i] = EKSL_HIGH;
+            }
+
+            else if (keyrpt[i] == EKSL_FALL) {
+                keyrpt[i] = EKSL_LOW;
+            }
+        }
+
+        // --> then the edges of the next snapshot, each once: a tap between two reports too.
+        if (_rptEvents.peek(event)) {
+            const uint32_t at = event.at;
+
+            do {
+                keyrpt[event.key] = event.edge == EKED_RISE ? EKSL_RISE : EKSL_FALL;
+                _rptEvents.skip();
+            } while (_rptEvents.peek(event) && event.at == at);
+        }
     }
 
     if (!optimised || memcmp(keyrpt, _keyrpt, sizeof(_keyrpt))) {
@@ -508,11 +713,60 @@ void App::emitKeyReport(bool optimised) {
         memcpy(_keyrpt, keyrpt, sizeof(keyrpt));
 
         message.opcode = ECDCM_KEY_REPORT;
-        message.length = 6;
 
-        memcpy(message.data, keyrpt, sizeof(keyrpt));
-        message.checksum = _cdc.checksum(message);
+        // --> the keys in order: a message per `KEYRPT_PER_MSG` keys, the last one shorter.
+        for(uint8_t first = 0; first < EKEY_MAX; first += KEYRPT_PER_MSG) {
+            const uint8_t count = EKEY_MAX - first < KEYRPT_PER_MSG ? EKEY_MAX - first : KEYRPT_PER_MSG;
 
-        _cdc.write(message);
+            message.length = count;
+            memcpy(message.data, keyrpt + first, count);
+            message.checksum = _cdc.checksum(message);
+
+            _cdc.write(message);
+        }
     }
-}
\ No newline at end of file
+}
+
+void App::emitScrubReport() {
+    SCdcMessage reply;
+    const SScrubReport& report = _scrubber.report();
+
+    reply.opcode = ECDCM_SCRUB_REPORT;
+    reply.length = sizeof(report);
+
+    // --> little-endian words, same with the host.
+    memcpy(reply.data, &report, sizeof(report));
+    reply.checksum = _cdc.checksum(reply);
+    _cdc.write(reply);
+}
+
+void App::emitScanPeriod() {
+    SCdcMessage reply;
+    const uint32_t period = _keyboard.scanPeriod();
+
+    reply.opcode = ECDCM_SCAN_PERIOD;
+    reply.length = sizeof(period);
+
+    memcpy(reply.data, &period, sizeof(period));
+    reply.checksum = _cdc.checksum(reply);
+    _cdc.write(reply);
+}
+
+void App::emitDebounceStats(uint8_t key) {
+    SCdcMessage reply;
+    const SDebounceStats* stats = _keyboard.debouncer().stats(key);
+
+    reply.opcode = ECDCM_DEBOUNCE_STATS;
+    reply.length = 2;
+    reply.data[0] = key;
+    reply.data[1] = _keyboard.debouncer().isCalibrating() ? 1 : 0;
+
+    // --> no such key, or stripped out: the mode only.
+    if (stats) {
+        memcpy(reply.data + 2, stats, sizeof(SDebounceStats));
+        reply.length += sizeof(SDebounceStats);
+    }
+
+    reply.checksum = _cdc.checksum(reply);
+    _cdc.write(reply);
+}
@@ -10,27 +10,61 @@
 #include "drivers/usbd/cdc.h"
 
 #include "timers/timer.h"
+#include "storage/confstore.h"
+#include "storage/flashfs.h"
+#include "storage/scrubber.h"
+
+/**
+ * Application configurations.
+ * 1. APP_IDLE_WAKE_MS : milliseconds the core 0 sleeps at most while idle,
+ *    the periodic works (saving and scrubbing) run at this granularity then.
+ */
+#ifndef APP_IDLE_WAKE_MS
+#define APP_IDLE_WAKE_MS 10
+#endif
+
+/**
+ * Configuration stored on the flash memory.
+ */
+struct AppConf {
+    uint32_t ver;
+    SKeyConf keys[EKEY_MAX];
+};
 
 /**
  * Application. 
  */
 class App {
 private:
-    static const SKeyConf DEFAULT_KEYCONFS[EKEY_MAX];
+    // --> key infos, and key states a CDC message carries.
+    static constexpr uint8_t KEYINFO_PER_MSG = sizeof(SCdcMessage::data) / 4;
+    static constexpr uint8_t KEYRPT_PER_MSG = sizeof(SCdcMessage::data);
+
+    static App* _core1;
 
 private:
     Keyboard _keyboard;
-    HC595 _ledctl;
+    PioScanner _scanner;
+    HC595<Board::MAX_LED> _ledctl;
     W25QXX _flash;
+    ConfStore _store;
+    FlashFs _fs;
+    Scrubber _scrubber;
     UsbHid _hid;
     UsbCdc _cdc;
 
     STimer* _timer;
     bool _blocked;
 
-    uint8_t _keyrpt[6];
+    // --> the key events of the capture on the core 0, and of the LEDs on the core 1.
+    Keyboard::Events::Reader _rptEvents;
+    Keyboard::Events::Reader _ledEvents;
+    uint32_t _ledLevels[KeyState<EKEY_MAX>::WORDS];
+
+    uint8_t _keyrpt[EKEY_MAX];
     bool _needSave;
     uint32_t _saveTime;
+    uint32_t _scrubPasses;
     
 public:
     App();
@@ -42,11 +76,19 @@ public:
     void runApp();
 
 private:
+    // --> advance the store a step, and start to save if reserved.
     void tickToSave();
 
+    // --> verify a slice of the flash memory, and report the rotten regions.
+    void tickToScrub();
+
     // --> reserve to save conf.
     void reserveSave();
 
+    // --> test whether nothing runs until an interrupt: the keyboard waits,
+    //   : and no transfer or message is pending.
+    bool isIdle();
+
     // --> check toggle key mappings and, 
     //   : set toggle state from HID indicator.
     void checkToggle();
@@ -60,16 +102,19 @@ public:
     bool unschedule(STimer* timer);
     
 private:
+    /* get the default configuration of the key: the digits, then the letters, then none. */
+    static SKeyConf defaultKeyConf(uint8_t key);
+
     /* system panic. */
     void panic();
 
     /* load configuration. */
     void loadConf();
 
-    /* save configuration. */
+    /* save configuration: appended to the store in the background. */
     void saveConf();
 
-    /* update LED states. */
+    /* update LED states, the key LEDs by the key events: a key changes once a flush. */
     void updateLeds();
 
     /* update key LED state. */
@@ -78,15 +123,24 @@ private:
     /* handle the CDC message. */
     void handleMsg(const SCdcMessage& msg);
 
-    /* emit the key information. */
+    /* emit the key information, in messages of `KEYINFO_PER_MSG` keys. */
     void emitKeyInfo(uint8_t opcode = ECDCM_GET_KEYS);
 
     /* emit the capture state. */
     void emitCaptureState(uint8_t opcode = ECDCM_CHECK_CAPTURE);
 
-    /* emit the key report. */
+    /* emit the key report, in messages of `KEYRPT_PER_MSG` keys: the next edges if optimised, else the keys as they are. */
     void emitKeyReport(bool optimised);
 
+    /* emit the results of the scrubber. */
+    void emitScrubReport();
+
+    /* emit the scan period of the keyboard. */
+    void emitScanPeriod();
+
+    /* emit the bounce statistics of the key. */
+    void emitDebounceStats(uint8_t key);
+
 };
 
 #endif
\ No newline at end of file
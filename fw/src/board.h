@@ -0,0 +1,173 @@
+#ifndef __BOARD_H__
+#define __BOARD_H__
+
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Board configurations.
+ * 1. BOARD_LAYOUT : the board the firmware is built for, `EBoardLayout`.
+ *    a larger one may need `CONFSTORE_MAX_RECORD` raised to store its keys.
+ */
+#ifndef BOARD_LAYOUT
+#define BOARD_LAYOUT EBRD_PAD_2X3
+#endif
+
+enum EBoardLayout {
+    EBRD_PAD_2X3 = 0,   // --> shortcut-pd: 6 keys, a LED each and the lock LEDs.
+    EBRD_PAD_4X4,       // --> 16 keys, a LED each on three chained 74HC595s.
+    EBRD_PAD_8X16,      // --> 128 keys, no key LEDs: the 74HC595 pins are columns.
+    EBRD_MAX
+};
+
+// --> no LED, of a key or a lock.
+constexpr uint8_t LED_NONE = 0xffu;
+
+/**
+ * GPIO pins of the rows or the columns, in order.
+ */
+template<uint8_t... PINS>
+struct SPins {
+    static constexpr uint8_t COUNT = sizeof...(PINS);
+    static constexpr uint8_t PIN[COUNT > 0 ? COUNT : 1] = { PINS... };
+    static constexpr uint32_t MASK = (0u | ... | (1u << PINS));
+
+    // --> consecutive from the first pin: read and driven as a bit field.
+    static constexpr bool RUN = COUNT > 0 && COUNT < 32 && MASK == (((1u << COUNT) - 1) << PIN[0]);
+};
+
+/**
+ * Bits of the key LEDs on the 74HC595 chain, by key. Empty if no key LEDs.
+ */
+template<uint8_t... BITS>
+struct SLeds {
+    static constexpr uint8_t COUNT = sizeof...(BITS);
+    static constexpr uint8_t BIT[COUNT > 0 ? COUNT : 1] = { BITS... };
+};
+
+/**
+ * Board description: the matrix and the LEDs, all known at compile time.
+ * Key `row * MAX_COL + col` is the switch between the row and the column.
+ *
+ * --
+ * A row driven high pulls the columns of its keys pressed high, and the
+ * columns are read at once by a read of the GPIO bank: `columns()` picks
+ * their bits out of it. Consecutive columns are a shift and a mask, the
+ * others a shift each, folded at compile time.
+ */
+template<typename ROWS, typename COLS, typename LEDS, uint8_t NUMLOCK = LED_NONE, uint8_t CAPSLOCK = LED_NONE>
+struct SBoard {
+    typedef ROWS Rows;
+    typedef COLS Cols;
+    typedef LEDS Leds;
+
+    static constexpr uint8_t MAX_ROW = ROWS::COUNT;
+    static constexpr uint8_t MAX_COL = COLS::COUNT;
+    static constexpr uint8_t MAX_KEY = MAX_ROW * MAX_COL;
+
+    // --> the lock LEDs on the chain.
+    static constexpr uint8_t LED_NUMLOCK = NUMLOCK;
+    static constexpr uint8_t LED_CAPSLOCK = CAPSLOCK;
+
+    // --> column bits of a row.
+    typedef typename std::conditional<(MAX_COL <= 8), uint8_t, uint16_t>::type row_t;
+
+    static_assert(MAX_ROW >= 1 && MAX_ROW <= 8 && MAX_COL >= 1 && MAX_COL <= 16, "up to 8 rows by 16 columns.");
+    static_assert(((ROWS::MASK | COLS::MASK) >> 30) == 0, "the RP2040 has GPIO 0 ~ 29.");
+    static_assert((ROWS::MASK & COLS::MASK) == 0
+        && __builtin_popcount(ROWS::MASK) == MAX_ROW
+        && __builtin_popcount(COLS::MASK) == MAX_COL, "a pin is a row or a column, once.");
+    static_assert(LEDS::COUNT == 0 || LEDS::COUNT == MAX_KEY, "a LED for each key, or none.");
+
+private:
+    /* get the bits of the chain: one past the highest LED. */
+    static constexpr uint32_t countLeds() {
+        uint32_t bits = 0;
+
+        for(uint32_t i = 0; i < LEDS::COUNT; ++i) {
+            bits = LEDS::BIT[i] + 1u > bits ? LEDS::BIT[i] + 1u : bits;
+        }
+
+        if (NUMLOCK != LED_NONE && NUMLOCK + 1u > bits) {
+            bits = NUMLOCK + 1u;
+        }
+
+        if (CAPSLOCK != LED_NONE && CAPSLOCK + 1u > bits) {
+            bits = CAPSLOCK + 1u;
+        }
+
+        return bits;
+    }
+
+public:
+    // --> bits of the 74HC595 chain, 0 if no LEDs on it.
+    static constexpr uint32_t MAX_LED = countLeds();
+
+    /* get the LED bit of the key, `LED_NONE` if none. */
+    static constexpr uint8_t ledOf(uint8_t key) {
+        return key < LEDS::COUNT ? LEDS::BIT[key] : LED_NONE;
+    }
+
+    /* pick the columns out of a read of the GPIO bank: bit j is column j. */
+    static inline row_t columns(uint32_t bank) {
+        return gather(bank, std::make_integer_sequence<uint8_t, MAX_COL>());
+    }
+
+private:
+    template<uint8_t... J>
+    static inline row_t gather(uint32_t bank, std::integer_sequence<uint8_t, J...>) {
+        if constexpr (COLS::RUN) {
+            return row_t((bank >> COLS::PIN[0]) & ((1u << MAX_COL) - 1));
+        }
+
+        else {
+            return row_t((0u | ... | columnOf<J>(bank)));
+        }
+    }
+
+    template<uint8_t J>
+    static inline uint32_t columnOf(uint32_t bank) {
+        constexpr uint8_t pin = COLS::PIN[J];
+
+        if constexpr (pin >= J) {
+            return (bank >> (pin - J)) & (1u << J);
+        }
+
+        else {
+            return (bank << (J - pin)) & (1u << J);
+        }
+    }
+};
+
+/**
+ * Board of the layout.
+ */
+template<uint8_t LAYOUT>
+struct SBoardLayout;
+
+template<>
+struct SBoardLayout<EBRD_PAD_2X3> {
+    // --> LEDs D1 ~ D6 by key, D14 NUMLOCK and D13 CAPSLOCK.
+    typedef SBoard<SPins<5, 6>, SPins<7, 8, 9>, SLeds<7, 6, 1, 4, 3, 5>, 0, 2> Type;
+};
+
+template<>
+struct SBoardLayout<EBRD_PAD_4X4> {
+    typedef SBoard<
+        SPins<2, 3, 4, 5>, SPins<6, 7, 8, 9>,
+        SLeds<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15>, 16, 17> Type;
+};
+
+template<>
+struct SBoardLayout<EBRD_PAD_8X16> {
+    // --> all GPIOs but the flash and the status LEDs: the sense input too.
+    typedef SBoard<
+        SPins<0, 1, 2, 3, 4, 5, 6, 7>,
+        SPins<8, 9, 10, 11, 12, 13, 14, 15, 20, 21, 24, 25, 26, 27, 28, 29>, SLeds<>> Type;
+};
+
+// --> the board the firmware is built for.
+typedef SBoardLayout<BOARD_LAYOUT>::Type Board;
+
+#endif
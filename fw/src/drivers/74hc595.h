@@ -2,12 +2,19 @@
 #define __DRIVERS_74HC595_H__
 
 #include <stdint.h>
+#include <string.h>
+#include <hardware/gpio.h>
 
 /**
- * 74HC595 driver.
+ * 74HC595 driver, a chain of the chips driving `BITS` bits.
+ * The bit 0 is shifted out first, so it ends at the QH of the last chip.
+ * No bits: no chips, the pins are left as they are.
 */
+template<uint32_t BITS>
 class HC595 {
 private:
+    static constexpr uint32_t BYTES = BITS > 0 ? (BITS + 7) / 8 : 1;
+
     /**
      * generate nano seconds delay.
      * this is used to ensure GPIO pin state to be applied.
@@ -17,22 +24,92 @@ private:
     }
 
 public:
-    HC595(uint8_t dat, uint8_t lat, uint8_t clk);
-    ~HC595();
+    HC595(uint8_t dat, uint8_t lat, uint8_t clk)
+        : _dat(dat), _lat(lat), _clk(clk)
+    {
+        memset(_bits, 0, sizeof(_bits));
+        memset(_prev, 0xff, sizeof(_prev));
+
+        if (BITS == 0) {
+            return;
+        }
+
+        // --> initialize GPIO.
+        gpio_init(dat);
+        gpio_init(lat);
+        gpio_init(clk);
+
+        // --> configure direction.
+        gpio_set_dir(dat, GPIO_OUT);
+        gpio_set_dir(lat, GPIO_OUT);
+        gpio_set_dir(clk, GPIO_OUT);
+
+        // --> set low for all out pins.
+        gpio_put(dat, 0);
+        gpio_put(lat, 0);
+        gpio_put(clk, 0);
+    }
 
 private:
     uint8_t _dat, _lat, _clk;
-    uint8_t _bits, _prev;
-    
+    uint8_t _bits[BYTES], _prev[BYTES];
+
 public:
     /* get N'th bit state. */
-    uint8_t bit(uint8_t n) const;
+    uint8_t bit(uint32_t n) const {
+        if (n >= BITS) {
+            return 0;
+        }
+
+        return (_bits[n >> 3] & (1 << (n & 7))) != 0;
+    }
 
     /* set N'th bit state. */
-    void bit(uint8_t n, uint8_t value);
+    void bit(uint32_t n, uint8_t value) {
+        if (n >= BITS) {
+            return;
+        }
+
+        if (value) {
+            _bits[n >> 3] |= (1 << (n & 7));
+        }
+
+        else {
+            _bits[n >> 3] &= ~(1 << (n & 7));
+        }
+    }
 
     /* flush bits to the chipset. */
-    bool flush();
+    bool flush() {
+        if (BITS == 0 || memcmp(_prev, _bits, BYTES) == 0) {
+            return true;
+        }
+
+        memcpy(_prev, _bits, BYTES);
+
+        gpio_put(_lat, 0);
+        delayNs();
+
+        // --> the whole chips: the unused bits of the last one too.
+        for(uint32_t i = 0; i < BYTES * 8; ++i) {
+            gpio_put(_clk, 0);
+            gpio_put(_dat, bit(i));
+            delayNs();
+
+            gpio_put(_clk, 1);
+            delayNs();
+        }
+
+        gpio_put(_clk, 0);
+        delayNs();
+
+        gpio_put(_lat, 1);
+        gpio_put(_lat, 0);
+        delayNs();
+
+        gpio_put(_dat, 0);
+        return true;
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
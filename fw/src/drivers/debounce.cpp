@@ -0,0 +1,323 @@
+#include "debounce.h"
+#include <string.h>
+
+#if DEBOUNCE_CALIB_BINS > 0
+static_assert(DEBOUNCE_MAX_US <= UINT16_MAX, "the windows picked are half words.");
+static_assert(sizeof(SDebounceStats) <= 62, "the statistics must fit in a CDC reply, after the key and the mode.");
+#endif
+
+Debouncer::Debouncer()
+    : _algo(DEBOUNCE_ALGO), _press(DEBOUNCE_PRESS_US), _release(DEBOUNCE_RELEASE_US),
+      _now(0), _dt(0)
+{
+    memset(_keys, 0, sizeof(_keys));
+    memset(_raw, 0, sizeof(_raw));
+    memset(_levels, 0, sizeof(_levels));
+    memset(_busy, 0, sizeof(_busy));
+
+#if DEBOUNCE_CALIB_BINS > 0
+    _calibrating = false;
+    resetCalibration();
+#endif
+}
+
+bool Debouncer::setAlgorithm(EDebounce algo) {
+    if (algo >= EDBC_MAX) {
+        return false;
+    }
+
+    _algo = algo;
+    settle();
+    return true;
+}
+
+bool Debouncer::setWindows(uint32_t pressUs, uint32_t releaseUs) {
+    if (pressUs > DEBOUNCE_MAX_US || releaseUs > DEBOUNCE_MAX_US) {
+        return false;
+    }
+
+    _press = pressUs;
+    _release = releaseUs;
+
+#if DEBOUNCE_CALIB_BINS > 0
+    memset(_windows, 0, sizeof(_windows));
+#endif
+    return true;
+}
+
+bool Debouncer::calibrate(bool val) {
+#if DEBOUNCE_CALIB_BINS > 0
+    // --> the bounces under way are timed from the next change.
+    memset(_bounce, 0, sizeof(_bounce));
+    _calibrating = val;
+    return true;
+#else
+    (void) val;
+    return false;
+#endif
+}
+
+bool Debouncer::isCalibrating() const {
+#if DEBOUNCE_CALIB_BINS > 0
+    return _calibrating;
+#else
+    return false;
+#endif
+}
+
+void Debouncer::resetCalibration() {
+#if DEBOUNCE_CALIB_BINS > 0
+    memset(_windows, 0, sizeof(_windows));
+    memset(_bounce, 0, sizeof(_bounce));
+    memset(_bounceEnd, 0, sizeof(_bounceEnd));
+    memset(_stats, 0, sizeof(_stats));
+#endif
+}
+
+const SDebounceStats* Debouncer::stats(uint8_t key) const {
+#if DEBOUNCE_CALIB_BINS > 0
+    if (key < EKEY_MAX) {
+        return &_stats[key];
+    }
+#else
+    (void) key;
+#endif
+    return nullptr;
+}
+
+void Debouncer::settle() {
+    // --> held from now, or nothing integrated.
+    const uint32_t field = _algo == EDBC_INTEGRATE ? 0 : (_now & FIELD);
+
+    for(uint8_t i = 0; i < EKEY_MAX; ++i) {
+        _keys[i] = (_keys[i] & (LEVEL | RAW)) | field;
+        _busy[i >> 5] |= 1u << (i & 31);
+    }
+}
+
+const uint32_t* Debouncer::update(const uint32_t* raw, uint32_t now) {
+    _dt = now - _now;
+    _now = now;
+
+    for(uint32_t i = 0; i < WORDS; ++i) {
+        uint32_t visit = (raw[i] ^ _raw[i]) | _busy[i];
+        _raw[i] = raw[i];
+
+        for(; visit; visit &= visit - 1) {
+            const uint32_t bit = __builtin_ctz(visit);
+            const uint32_t mask = 1u << bit;
+            const uint8_t key = uint8_t(i * 32 + bit);
+
+            if (filter(key, (raw[i] & mask) != 0)) {
+                _levels[i] |= mask;
+            }
+
+            else {
+                _levels[i] &= ~mask;
+            }
+
+            if (isSettling(key)) {
+                _busy[i] |= mask;
+            }
+
+            else {
+                _busy[i] &= ~mask;
+            }
+        }
+    }
+
+    return _levels;
+}
+
+bool Debouncer::isPending() const {
+    uint32_t bits = 0;
+
+    for(uint32_t i = 0; i < WORDS; ++i) {
+        bits |= _raw[i] ^ _levels[i];
+    }
+
+    return bits != 0;
+}
+
+bool Debouncer::isSettling(uint8_t key) const {
+    const uint32_t word = _keys[key];
+
+    if (((word & LEVEL) != 0) != ((word & RAW) != 0)) {
+        return true;
+    }
+
+    if (_algo == EDBC_INTEGRATE && (word & FIELD)) {
+        return true;
+    }
+
+#if DEBOUNCE_CALIB_BINS > 0
+    if (_calibrating && _bounce[key]) {
+        return true;
+    }
+#endif
+    return false;
+}
+
+uint32_t Debouncer::windowOf(uint8_t key, bool raw) const {
+#if DEBOUNCE_CALIB_BINS > 0
+    if (_windows[key]) {
+        return _windows[key];
+    }
+#else
+    (void) key;
+#endif
+    return raw ? _press : _release;
+}
+
+bool Debouncer::filter(uint8_t key, bool raw) {
+    const uint32_t word = _keys[key];
+    const bool last = (word & RAW) != 0;
+
+#if DEBOUNCE_CALIB_BINS > 0
+    if (_calibrating) {
+        record(key, raw, last);
+    }
+#endif
+
+    bool level = (word & LEVEL) != 0;
+    uint32_t field = word & FIELD;
+
+    switch (_algo) {
+        case EDBC_EAGER:
+        case EDBC_DEFER: {
+            if (raw != last) {
+                field = _now & FIELD;
+            }
+
+            // --> held since the last change, wrapped at 30 bits.
+            const uint32_t held = (_now - field) & FIELD;
+
+            if (raw && !level && _algo == EDBC_EAGER) {
+                level = true;
+            }
+
+            else if (raw != level && held >= windowOf(key, raw)) {
+                level = raw;
+            }
+
+            break;
+        }
+
+        case EDBC_INTEGRATE: {
+            const uint32_t window = windowOf(key, !level);
+
+            // --> the interval since the last snapshot, by the level sampled then.
+            if (last != level) {
+                field = field + _dt < window ? field + _dt : window;
+            }
+
+            else {
+                field = field > _dt ? field - _dt : 0;
+            }
+
+            if (raw != level && field >= window) {
+                level = raw;
+                field = 0;
+            }
+
+            break;
+        }
+
+        default:
+            level = raw;
+            break;
+    }
+
+    _keys[key] = (level ? LEVEL : 0) | (raw ? RAW : 0) | field;
+    return level;
+}
+
+void Debouncer::record(uint8_t key, bool raw, bool last) {
+#if DEBOUNCE_CALIB_BINS > 0
+    constexpr uint32_t BOUNCING = 1u << 31;
+    constexpr uint32_t BEFORE = 1u << 30;
+
+    const uint32_t bounce = _bounce[key];
+
+    if (raw != last) {
+        // --> the first change: the level before is the last one.
+        if (!(bounce & BOUNCING)) {
+            _bounce[key] = BOUNCING | (last ? BEFORE : 0) | (_now & FIELD);
+        }
+
+        _bounceEnd[key] = _now;
+        return;
+    }
+
+    if (!(bounce & BOUNCING) || _now - _bounceEnd[key] < DEBOUNCE_CALIB_SETTLE_US) {
+        return;
+    }
+
+    SDebounceStats& stats = _stats[key];
+    _bounce[key] = 0;
+
+    // --> back to the level before: not an edge.
+    if (raw == ((bounce & BEFORE) != 0)) {
+        if (stats.glitches < UINT16_MAX) {
+            stats.glitches++;
+        }
+
+        return;
+    }
+
+    const uint32_t took = (_bounceEnd[key] - bounce) & FIELD;
+    const uint32_t bin = took / DEBOUNCE_CALIB_BIN_US;
+
+    // --> full: halved, the recent bounces weigh more.
+    uint16_t& count = stats.bins[bin < DEBOUNCE_CALIB_BINS ? bin : DEBOUNCE_CALIB_BINS - 1];
+    if (count == UINT16_MAX) {
+        for(uint16_t& each : stats.bins) {
+            each >>= 1;
+        }
+    }
+
+    count++;
+
+    if (stats.edges < UINT16_MAX) {
+        stats.edges++;
+    }
+
+    if (took > stats.longest) {
+        stats.longest = uint16_t(took < UINT16_MAX ? took : UINT16_MAX);
+    }
+
+    if (stats.edges >= DEBOUNCE_CALIB_EDGES) {
+        pick(key);
+    }
+#else
+    (void) key; (void) raw; (void) last;
+#endif
+}
+
+void Debouncer::pick(uint8_t key) {
+#if DEBOUNCE_CALIB_BINS > 0
+    SDebounceStats& stats = _stats[key];
+    uint32_t top = 0;
+
+    for(uint32_t i = 0; i < DEBOUNCE_CALIB_BINS; ++i) {
+        if (stats.bins[i]) {
+            top = i;
+        }
+    }
+
+    // --> the last bin has no bound: the longest bounce is.
+    uint32_t window = (top + 2) * DEBOUNCE_CALIB_BIN_US;
+    if (top == DEBOUNCE_CALIB_BINS - 1) {
+        window = (stats.longest / DEBOUNCE_CALIB_BIN_US + 2) * DEBOUNCE_CALIB_BIN_US;
+    }
+
+    if (window > DEBOUNCE_MAX_US) {
+        window = DEBOUNCE_MAX_US;
+    }
+
+    stats.window = uint16_t(window);
+    _windows[key] = uint16_t(window);
+#else
+    (void) key;
+#endif
+}
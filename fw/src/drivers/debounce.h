@@ -0,0 +1,203 @@
+#ifndef __DRIVERS_DEBOUNCE_H__
+#define __DRIVERS_DEBOUNCE_H__
+
+#include <stdint.h>
+#include "../main.h"
+
+/**
+ * Debounce configurations.
+ * 1. DEBOUNCE_ALGO : the algorithm by default, `EDebounce`.
+ * 2. DEBOUNCE_PRESS_US, DEBOUNCE_RELEASE_US : the windows by default, microseconds.
+ * 3. DEBOUNCE_MAX_US : the longest window `setWindows()` accepts.
+ * 4. DEBOUNCE_CALIB_BINS : bins of the bounce histogram of each key, 0 strips the calibration out.
+ * 5. DEBOUNCE_CALIB_BIN_US : microseconds of a bin, the last bin holds the longer bounces too.
+ * 6. DEBOUNCE_CALIB_SETTLE_US : microseconds a raw level holds to end a bounce.
+ *    longer than any bounce, shorter than any hold of a key.
+ * 7. DEBOUNCE_CALIB_EDGES : edges of a key recorded before its window is picked.
+ */
+#ifndef DEBOUNCE_ALGO
+#define DEBOUNCE_ALGO EDBC_EAGER
+#endif
+
+#ifndef DEBOUNCE_PRESS_US
+#define DEBOUNCE_PRESS_US 5000
+#endif
+
+#ifndef DEBOUNCE_RELEASE_US
+#define DEBOUNCE_RELEASE_US 5000
+#endif
+
+#ifndef DEBOUNCE_MAX_US
+#define DEBOUNCE_MAX_US 50000
+#endif
+
+#ifndef DEBOUNCE_CALIB_BINS
+#define DEBOUNCE_CALIB_BINS 16
+#endif
+
+#ifndef DEBOUNCE_CALIB_BIN_US
+#define DEBOUNCE_CALIB_BIN_US 500
+#endif
+
+#ifndef DEBOUNCE_CALIB_SETTLE_US
+#define DEBOUNCE_CALIB_SETTLE_US 10000
+#endif
+
+#ifndef DEBOUNCE_CALIB_EDGES
+#define DEBOUNCE_CALIB_EDGES 16
+#endif
+
+enum EDebounce {
+    EDBC_NONE = 0,      // --> the raw level, as sampled.
+    EDBC_EAGER,         // --> pressed at once, released after the release window.
+    EDBC_DEFER,         // --> changed after the level held for the window.
+    EDBC_INTEGRATE,     // --> changed after the opposite level summed up to the window.
+    EDBC_MAX
+};
+
+/**
+ * Bounce statistics of a key, recorded while calibrating.
+ * Little-endian half words, same with the host.
+ */
+struct SDebounceStats {
+    uint16_t window;        // --> picked, microseconds. 0 until enough edges.
+    uint16_t edges;         // --> bounces recorded: the level changed.
+    uint16_t glitches;      // --> bounces back to the level before: spikes, or taps too short.
+    uint16_t longest;       // --> the longest bounce, microseconds.
+    uint16_t bins[DEBOUNCE_CALIB_BINS > 0 ? DEBOUNCE_CALIB_BINS : 1];
+};
+
+/**
+ * Debouncer of the keys.
+ * Filters the raw levels of each snapshot into the levels the keyboard sees.
+ *
+ * --
+ * A key is a word: the level, the last raw level, and 30 bits of either
+ * the time the raw level changed (EAGER, DEFER) or the microseconds the
+ * opposite level was sampled for, less the ones it was not (INTEGRATE).
+ * The integrator counts an interval by the level sampled at its start,
+ * so a long pause between the snapshots counts the level known meanwhile.
+ * A snapshot visits the keys whose raw level changed, and the ones settling:
+ * pending, integrating or bouncing. The others are left as they are.
+ *
+ * While calibrating, a bounce is timed from the first raw change to the last
+ * one, before the raw level holds for `DEBOUNCE_CALIB_SETTLE_US`. Once a key
+ * recorded `DEBOUNCE_CALIB_EDGES` bounces, its windows are a bin above the bin
+ * of its longest bounce: the smallest that no bounce recorded would pass.
+ */
+class Debouncer {
+public:
+    static constexpr uint32_t WORDS = (EKEY_MAX + 31) / 32;
+
+private:
+    static constexpr uint32_t LEVEL = 1u << 31;
+    static constexpr uint32_t RAW = 1u << 30;
+    static constexpr uint32_t FIELD = RAW - 1;
+
+private:
+    uint8_t _algo;
+    uint32_t _press;        // --> microseconds.
+    uint32_t _release;
+
+    uint32_t _now;          // --> the snapshot, microseconds.
+    uint32_t _dt;           // --> since the previous snapshot.
+    uint32_t _keys[EKEY_MAX];
+
+    uint32_t _raw[WORDS];
+    uint32_t _levels[WORDS];
+    uint32_t _busy[WORDS];  // --> settling keys, visited at each snapshot.
+
+#if DEBOUNCE_CALIB_BINS > 0
+    bool _calibrating;
+    uint16_t _windows[EKEY_MAX];    // --> picked, 0: `_press` and `_release`.
+    uint32_t _bounce[EKEY_MAX];     // --> bouncing, the level before and the first change.
+    uint32_t _bounceEnd[EKEY_MAX];  // --> the last change.
+    SDebounceStats _stats[EKEY_MAX];
+#endif
+
+public:
+    Debouncer();
+
+public:
+    /**
+     * Set the algorithm, the keys keep their levels.
+     * Returns false if unknown.
+     */
+    bool setAlgorithm(EDebounce algo);
+
+    /**
+     * Get the algorithm.
+     */
+    inline EDebounce algorithm() const { return EDebounce(_algo); }
+
+    /**
+     * Set the windows to press and release, microseconds. EAGER presses at once.
+     * The windows picked by the calibration are dropped, until picked again.
+     * Returns false if longer than `DEBOUNCE_MAX_US`.
+     */
+    bool setWindows(uint32_t pressUs, uint32_t releaseUs);
+
+    /**
+     * Get the window to press, microseconds.
+     */
+    inline uint32_t pressWindow() const { return _press; }
+
+    /**
+     * Get the window to release, microseconds.
+     */
+    inline uint32_t releaseWindow() const { return _release; }
+
+    /**
+     * Start or stop the calibration, the windows picked are kept on stop.
+     * Returns false if stripped out.
+     */
+    bool calibrate(bool val = true);
+
+    /**
+     * Test whether calibrating or not.
+     */
+    bool isCalibrating() const;
+
+    /**
+     * Drop the statistics and the windows picked.
+     */
+    void resetCalibration();
+
+    /**
+     * Get the bounce statistics of the key, null if stripped out.
+     */
+    const SDebounceStats* stats(uint8_t key) const;
+
+public:
+    /**
+     * Filter the raw levels of a snapshot at its time, microseconds: bit i of the
+     * words is key i. Returns the debounced levels, the same words.
+     */
+    const uint32_t* update(const uint32_t* raw, uint32_t now);
+
+    /**
+     * Test whether any key is bouncing: its raw level differs from the debounced.
+     */
+    bool isPending() const;
+
+private:
+    /* restart the windows of the keys, they keep their levels. */
+    void settle();
+
+    /* filter the raw level of the key, returns the debounced level. */
+    bool filter(uint8_t key, bool raw);
+
+    /* test whether the key changes by the time alone: visited without a raw change. */
+    bool isSettling(uint8_t key) const;
+
+    /* get the window of the key to the level, microseconds. */
+    uint32_t windowOf(uint8_t key, bool raw) const;
+
+    /* time the bounce of the key, the raw level sampled. */
+    void record(uint8_t key, bool raw, bool last);
+
+    /* pick the window of the key from its histogram. */
+    void pick(uint8_t key);
+};
+
+#endif
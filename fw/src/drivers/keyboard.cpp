@@ -1,27 +1,38 @@
 #include "keyboard.h"
 #include <string.h>
 #include <hardware/gpio.h>
-#include <bsp/board_api.h>
+#include <hardware/timer.h>
 
-const uint8_t Keyboard::PIN_ROW[MAX_ROW] = {
-    EGPIO_ROW1, EGPIO_ROW2
-};
+#if KEYBOARD_DISABLE_IRQ == 0
+// --> set by the interrupt, cleared when armed.
+static volatile bool g_keyboardEdge = false;
 
-const uint8_t Keyboard::PIN_COL[MAX_COL] = {
-    EGPIO_COL1, EGPIO_COL2, EGPIO_COL3
-};
+/* called by the interrupt: a column rose. */
+static void keyboardOnEdge(uint gpio, uint32_t events) {
+    (void) gpio;
+    (void) events;
 
-EKey KeyOrderIterator::operator*() const {
+    g_keyboardEdge = true;
+}
+#endif
+
+void KeyOrderIterator::next() {
+    if (_kbd && _cur != EKEY_INV) {
+        _cur = _kbd->getKeyAfter(_cur);
+    }
+}
+
+KeyOrderIterator KeyOrderDelegate::begin() const {
     if (_kbd) {
-        return _kbd->getKeyInOrder(_cur);
+        return KeyOrderIterator(_kbd, _kbd->getKeyInOrder(0));
     }
 
-    return EKEY_INV;
+    return end();
 }
 
 Keyboard::Keyboard() {
     for(uint8_t i = 0; i < MAX_ROW; ++i) {
-        const uint8_t pin = PIN_ROW[i];
+        const uint8_t pin = Board::Rows::PIN[i];
 
         gpio_init(pin);
         gpio_set_dir(pin, GPIO_OUT);
@@ -29,182 +40,235 @@ Keyboard::Keyboard() {
     }
 
     for(uint8_t i = 0; i < MAX_COL; ++i) {
-        const uint8_t pin = PIN_COL[i];
+        const uint8_t pin = Board::Cols::PIN[i];
 
         gpio_init(pin);
         gpio_set_dir(pin, GPIO_IN);
     }
 
     memset(_next, 0, sizeof(_next));
-    memset(_state, 0, sizeof(_state));
-    
-    _ordered = 0;
-    _scantick = 0;
+    memset(_keys, 0, sizeof(_keys));
 
-    for(uint8_t i = 0; i < EKEY_MAX; ++i) {
-        _orders[i] = EKEY_INV;
-    }
+    _scanAt = 0;
+    _period = KEYBOARD_SCAN_US;
+
+    _waitEnabled = _waiting = false;
+    _quietAt = 0;
+
+    _scanner = &_gpio;
+    _scanner->start(_period);
 }
 
 void Keyboard::scanOnce() {
-    const uint32_t now = board_millis();
-    if (_scantick != now) {
-        _scantick = now;
+#if KEYBOARD_DISABLE_IRQ == 0
+    if (_waiting) {
+        // --> all keys are up: nothing to scan.
+        if (!g_keyboardEdge) {
+            return;
+        }
 
-        memset(_next, 0, sizeof(_next));
+        // --> woken up: the scanner restarts, the first press isn't left to the next period.
+        leaveWait();
+    }
+#endif
 
-        // --> scan line levels.
-        for(uint8_t i = 0; i < MAX_ROW; ++i) {
-            const uint8_t row = PIN_ROW[i];
-            
-            gpio_put(row, 1);
-            delayNs();
+    const uint64_t now = time_us_64();
+    SKeyScan scan;
+    bool taken = false;
 
-            for(uint8_t j = 0; j < MAX_COL; ++j) {
-                const uint8_t mask = 1 << j;
+    // --> all snapshots since the last call, each at its own time.
+    while (_scanner->take(scan, now)) {
+        memcpy(_next, scan.rows, sizeof(_next));
+        _scanAt = scan.at;
+        taken = true;
 
-                if (gpio_get(PIN_COL[j])) {
-                    _next[i] |= mask;
-                }
-            }
+        updateOnce(uint32_t(_scanAt));
+    }
 
-            gpio_put(row, 0);
-            delayNs();
-        }
+    if (!taken) {
+        updateOnce(uint32_t(_scanAt));
     }
-    
-    updateOnce();
+
+    checkQuiet(now);
 }
 
-void Keyboard::updateOnce() {
-    // --> summarize key changes.
-    for(uint8_t row = 0; row < MAX_ROW; ++row) { 
-        const uint8_t offset = row * MAX_COL;
-
-        for(uint8_t col = 0; col < MAX_COL; ++col) {
-            const EKey key = EKey(offset + col);
-            const uint8_t mask = 1 << col;
-
-            const uint8_t prev 
-                = _state[key].ls == EKSL_RISE || 
-                  _state[key].ls == EKSL_HIGH;
-
-            const uint8_t next = (_next[row] & mask) != 0;
-            
-            if (prev != next) {
-                if (next) {
-                    _state[key].ls = EKSL_RISE;
-                    addOrder(key);
-                } else {
-                    _state[key].ls = EKSL_FALL;
-                    removeOrder(key);
-                }
-
-                _state[key].lt = board_millis();
-                continue;
-            }
-
-            if (_state[key].ls == EKSL_HIGH ||
-                _state[key].ls == EKSL_LOW)
-            {
-                continue;   
-            }
-
-            if (_state[key].ls == EKSL_RISE) {
-                _state[key].ls = EKSL_HIGH;
-            } else {
-                _state[key].ls = EKSL_LOW;
-            }
-            
-            _state[key].lt = board_millis();
-        }
+bool Keyboard::setScanPeriod(uint32_t us) {
+    if (us < KEYBOARD_SCAN_MIN_US || us > KEYBOARD_SCAN_MAX_US) {
+        return false;
+    }
+
+    _period = us;
+    if (!_waiting) {
+        _scanner->start(_period);
+    }
+
+    return true;
+}
+
+bool Keyboard::setDebounce(EDebounce algo, uint32_t pressUs, uint32_t releaseUs) {
+    if (algo >= EDBC_MAX || pressUs > DEBOUNCE_MAX_US || releaseUs > DEBOUNCE_MAX_US) {
+        return false;
     }
 
-    // --> copy and fill keys.
-    assignOrders();
+    _debounce.setAlgorithm(algo);
+    _debounce.setWindows(pressUs, releaseUs);
+    return true;
 }
 
-int32_t Keyboard::findOrder(EKey key) {
-    const uint8_t count
-        = _ordered > EKEY_MAX
-        ? EKEY_MAX : _ordered;
+bool Keyboard::calibrateDebounce(bool val) {
+    return _debounce.calibrate(val);
+}
 
-    for(uint8_t i = 0; i < count; ++i) {
-        if (_orders[i] == key) {
-            return i;
-        }
+void Keyboard::resetDebounceCalibration() {
+    _debounce.resetCalibration();
+}
+
+void Keyboard::setScanner(KeyScanner* scanner) {
+    _scanner->stop();
+    _scanner = scanner ? scanner : &_gpio;
+
+    // --> waiting: started on the edge.
+    if (!_waiting) {
+        _scanner->start(_period);
+    }
+}
+
+bool Keyboard::enableWait(bool val) {
+#if KEYBOARD_DISABLE_IRQ == 0
+    if (!val && _waiting) {
+        leaveWait();
     }
 
-    return -1;
+    _waitEnabled = val;
+    _quietAt = time_us_64();
+    return true;
+#else
+    (void) val;
+    return false;
+#endif
 }
 
-void Keyboard::addOrder(EKey key) {
-    if (_ordered >= EKEY_MAX) {
+void Keyboard::checkQuiet(uint64_t now) {
+    if (!_waitEnabled) {
         return;
     }
 
-    const uint8_t count
-        = _ordered > EKEY_MAX
-        ? EKEY_MAX : _ordered;
-
-    removeOrder(key);
+    // --> a key falling or bouncing is not quiet yet.
+    if (!_state.isQuiet() || _debounce.isPending()) {
+        _quietAt = now;
+        return;
+    }
 
-    // --> insert the key to front.
-    _orders[_ordered++] = key;
+    if (now - _quietAt >= KEYBOARD_QUIET_MS * 1000ull) {
+        enterWait();
+    }
 }
 
-void Keyboard::removeOrder(EKey key) {
-    int32_t n = findOrder(key);
-    if (n < 0) {
-        return;
+void Keyboard::enterWait() {
+#if KEYBOARD_DISABLE_IRQ == 0
+    _scanner->stop();
+
+    for(uint8_t i = 0; i < MAX_ROW; ++i) {
+        gpio_put(Board::Rows::PIN[i], 1);
+    }
+
+    KeyScanner::delayNs();
+
+    // --> enabling acknowledges the edges before: the rows rising aren't a press.
+    g_keyboardEdge = false;
+    for(uint8_t i = 0; i < MAX_COL; ++i) {
+        gpio_set_irq_enabled_with_callback(Board::Cols::PIN[i], GPIO_IRQ_EDGE_RISE, true, keyboardOnEdge);
     }
 
-    const uint8_t count
-        = _ordered > EKEY_MAX
-        ? EKEY_MAX : _ordered;
+    _waiting = true;
+
+    // --> pressed while arming: the edge was missed, so wake up by itself.
+    if (gpio_get_all() & Board::Cols::MASK) {
+        g_keyboardEdge = true;
+    }
+#endif
+}
+
+void Keyboard::leaveWait() {
+#if KEYBOARD_DISABLE_IRQ == 0
+    for(uint8_t i = 0; i < MAX_COL; ++i) {
+        gpio_set_irq_enabled(Board::Cols::PIN[i], GPIO_IRQ_EDGE_RISE, false);
+    }
 
-    for (uint8_t i = n; i < count - 1; ++i) {
-        _orders[i] = _orders[i + 1];
+    for(uint8_t i = 0; i < MAX_ROW; ++i) {
+        gpio_put(Board::Rows::PIN[i], 0);
     }
 
-    _ordered--;
+    KeyScanner::delayNs();
+
+    // --> the first snapshot may come later: quiet from now.
+    _waiting = false;
+    g_keyboardEdge = false;
+    _quietAt = time_us_64();
+    _scanner->start(_period);
+#endif
 }
 
-void Keyboard::assignOrders() {
-    const uint8_t count
-        = _ordered > EKEY_MAX
-        ? EKEY_MAX : _ordered;
+void Keyboard::updateOnce(uint32_t now) {
+    uint32_t raw[Debouncer::WORDS] = { 0, };
+
+    // --> the rows side by side: key = row * MAX_COL + col, a row may straddle two words.
+    for(uint8_t row = 0; row < MAX_ROW; ++row) {
+        const uint32_t offset = row * MAX_COL;
+        const uint32_t shift = offset & 31;
 
-    for (uint8_t i = 0; i < EKEY_MAX; ++i) {
-        _state[i].ko = 0xff;
+        raw[offset >> 5] |= uint32_t(_next[row]) << shift;
+        if (shift + MAX_COL > 32) {
+            raw[(offset >> 5) + 1] |= uint32_t(_next[row]) >> (32 - shift);
+        }
     }
-    
-    for (uint8_t i = 0; i < count; ++i) {
-        const EKey key = _orders[i];
-        if (SKey* ptr = getKeyPtr(key)) {
-            ptr->ko = i;
+
+    _state.update(_debounce.update(raw, now), now);
+
+    // --> the edges to the ring, lowest key first.
+    const uint32_t* rises = _state.rises();
+    const uint32_t* falls = _state.falls();
+
+    for(uint32_t i = 0; i < KeyState<EKEY_MAX>::WORDS; ++i) {
+        for(uint32_t bits = rises[i] | falls[i]; bits; bits &= bits - 1) {
+            const uint32_t bit = __builtin_ctz(bits);
+            const EKeyEdge edge = (rises[i] >> bit) & 1 ? EKED_RISE : EKED_FALL;
+
+            _events.push(uint16_t(i * 32 + bit), edge, now);
         }
     }
 }
 
 uint8_t Keyboard::getKeyOrder(EKey key) const {
-    if (SKey* ptr = getKeyPtr(key)) {
-        return ptr->ko;
+    if (key >= EKEY_MAX || !_state.isDown(key)) {
+        return KO_NONE;
+    }
+
+    uint8_t order = 0;
+    for(uint8_t each = _state.first(); each != key; each = _state.after(each)) {
+        order++;
     }
 
-    return 0xff;
+    return order;
 }
 
 EKey Keyboard::getKeyInOrder(uint8_t order) const {
-    const uint8_t count
-        = _ordered > EKEY_MAX
-        ? EKEY_MAX : _ordered;
+    uint8_t each = _state.first();
+
+    while (order-- && each != _state.NONE) {
+        each = _state.after(each);
+    }
 
-    if (order >= count) {
+    return each != _state.NONE ? EKey(each) : EKEY_INV;
+}
+
+EKey Keyboard::getKeyAfter(EKey key) const {
+    if (key >= EKEY_MAX || !_state.isDown(key)) {
         return EKEY_INV;
     }
 
-    return _orders[order];
+    const uint8_t next = _state.after(key);
+    return next != _state.NONE ? EKey(next) : EKEY_INV;
 }
 
 uint8_t Keyboard::getKeys(EKeyState state, EKey* buf, uint8_t max) const {
@@ -212,17 +276,15 @@ uint8_t Keyboard::getKeys(EKeyState state, EKey* buf, uint8_t max) const {
         max = EKEY_MAX;
     }
 
-    if (max <= 0) {
-        return 0;
-    }
-    
     uint8_t index = 0;
-    for(uint8_t key: _orders) {
+    for(EKey key : pressing()) {
         if (index >= max) {
             break;
         }
 
-        buf[index++] = EKey(key);
+        if (getKeyState(key) == state) {
+            buf[index++] = key;
+        }
     }
 
     return index;
@@ -233,7 +295,7 @@ SKey *Keyboard::getKeyPtr(EKey key) const {
         return nullptr;
     }
 
-    return &_state[key];
+    return &_keys[key];
 }
 
 EKeyState Keyboard::getKeyState(EKey key) const {
@@ -241,7 +303,19 @@ EKeyState Keyboard::getKeyState(EKey key) const {
         return EKSL_LOW;
     }
 
-    return EKeyState(_state[key].ls);
+    if (_state.isDown(key)) {
+        return _state.isRising(key) ? EKSL_RISE : EKSL_HIGH;
+    }
+
+    return _state.isFalling(key) ? EKSL_FALL : EKSL_LOW;
+}
+
+uint32_t Keyboard::getKeyTime(EKey key) const {
+    if (key >= EKEY_MAX) {
+        return 0;
+    }
+
+    return _state.changedAt(key);
 }
 
 bool Keyboard::isKeyDown(EKey key) const {
@@ -249,7 +323,7 @@ bool Keyboard::isKeyDown(EKey key) const {
         return false;
     }
 
-    return _state[key].ls == EKSL_HIGH;
+    return _state.isDown(key) && !_state.isRising(key);
 }
 
 bool Keyboard::isKeyUp(EKey key) const {
@@ -257,5 +331,5 @@ bool Keyboard::isKeyUp(EKey key) const {
         return false;
     }
 
-    return _state[key].ls == EKSL_LOW;
+    return !_state.isDown(key) && !_state.isFalling(key);
 }
\ No newline at end of file
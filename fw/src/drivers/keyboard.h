@@ -3,6 +3,43 @@
 
 #include <stdint.h>
 #include "../main.h"
+#include "keyscan.h"
+#include "debounce.h"
+#include "keystate.h"
+#include "keyevents.h"
+
+/**
+ * Keyboard configurations.
+ * 1. KEYBOARD_DISABLE_IRQ : strips the interrupt wait out, then the matrix is scanned always.
+ * 2. KEYBOARD_QUIET_MS : milliseconds all keys stay up before waiting for the interrupt.
+ * 3. KEYBOARD_SCAN_US : microseconds between the scans of the matrix, by default.
+ * 4. KEYBOARD_SCAN_MIN_US, KEYBOARD_SCAN_MAX_US : the range `setScanPeriod()` accepts.
+ * 5. KEYBOARD_EVENTS : edges the event ring holds, a power of two.
+ *    a consumer behind by as many loses the oldest, and counts them.
+ */
+#ifndef KEYBOARD_DISABLE_IRQ
+#define KEYBOARD_DISABLE_IRQ 0
+#endif
+
+#ifndef KEYBOARD_QUIET_MS
+#define KEYBOARD_QUIET_MS 50
+#endif
+
+#ifndef KEYBOARD_SCAN_US
+#define KEYBOARD_SCAN_US 250
+#endif
+
+#ifndef KEYBOARD_SCAN_MIN_US
+#define KEYBOARD_SCAN_MIN_US 100
+#endif
+
+#ifndef KEYBOARD_SCAN_MAX_US
+#define KEYBOARD_SCAN_MAX_US 1000
+#endif
+
+#ifndef KEYBOARD_EVENTS
+#define KEYBOARD_EVENTS 64
+#endif
 
 // --> forward decls.
 class Keyboard;
@@ -26,28 +63,15 @@ enum EKeyControls {
 constexpr uint8_t KO_NONE = 0xffu;
 
 /**
- * Key state structure.
+ * Key structure: the configurations of the key, and its toggle state.
+ * The levels and the press order are kept by the keyboard, see `getKeyState()`.
  */
 struct SKey {
-    // ------------------------- BY KEYBOARD INSTANCE -------------------------
-    uint8_t         ls;     // --> level state: EKeyState.
-    uint8_t         ko;     // --> key order, 0 ~ 5.
-    uint32_t        lt;     // --> last tick.
-
-    // ----------------------------- CUSTOMIZABLE -----------------------------
     uint8_t         cm;     // --> control mode.
     uint8_t         kc;     // --> key code.
     uint8_t         km;     // --> key modifier.
     uint8_t         ts;     // --> toggle state, 0 or 1.
     uint8_t         id;     // --> key id.
-
-    union {
-        uint64_t    u64;
-        uint32_t    u32;
-        uint16_t    u16;
-        uint8_t     u8;
-        void*       ptr;
-    } data;
 };
 
 /**
@@ -107,32 +131,26 @@ public:
 class KeyOrderIterator {
 private:
     const Keyboard* _kbd;
-    uint8_t _cur;
-    uint8_t _max;
+    EKey _cur;
 
 public:
-    KeyOrderIterator() : _kbd(nullptr), _cur(0), _max(0) { }
-    KeyOrderIterator(const Keyboard* kbd, uint8_t cur, uint8_t max)
-        : _kbd(kbd), _cur(cur), _max(max) { }
+    KeyOrderIterator() : _kbd(nullptr), _cur(EKEY_INV) { }
+    KeyOrderIterator(const Keyboard* kbd, EKey cur)
+        : _kbd(kbd), _cur(cur) { }
 
 public:
     KeyOrderIterator operator++() {
         KeyOrderIterator self = *this;
-        if (_cur < _max) {
-            _cur = _cur + 1;
-        }
+        next();
 
         return self;
     }
     KeyOrderIterator& operator++(int) {
-        if (_cur < _max) {
-            _cur = _cur + 1;
-        }
-
+        next();
         return *this;
     }
 
-    EKey operator*() const;
+    EKey operator*() const { return _cur; }
 
     /* test whether other iterator is same with this or not. */
     bool operator == (const KeyOrderIterator& other) const {
@@ -143,6 +161,10 @@ public:
     bool operator != (const KeyOrderIterator& other) const {
         return _cur != other._cur;
     }
+
+private:
+    /* move to the key pressed after. */
+    void next();
 };
 
 /**
@@ -152,47 +174,66 @@ public:
 class KeyOrderDelegate {
 private:
     const Keyboard* _kbd;
-    const uint8_t _max;
 
 public:
-    KeyOrderDelegate() : _kbd(nullptr), _max(0) { }
-    KeyOrderDelegate(const Keyboard* kbd, uint8_t max) : _kbd(kbd), _max(max) { }
+    KeyOrderDelegate() : _kbd(nullptr) { }
+    KeyOrderDelegate(const Keyboard* kbd) : _kbd(kbd) { }
 
 public:
-    KeyOrderIterator begin() const {
-        return KeyOrderIterator(_kbd, 0, _max);
-    }
+    KeyOrderIterator begin() const;
 
     KeyOrderIterator end() const {
-        return KeyOrderIterator(_kbd, _max, _max);
+        return KeyOrderIterator(_kbd, EKEY_INV);
     }
 };
 
 /**
  * Keyboard. 
+ *
+ * --
+ * While all keys are up, the matrix needs no scan: all rows are driven
+ * high, so any key pulls its column high, and the rising edges of the
+ * columns interrupt. The first edge scans the matrix at once, not at the
+ * next tick, and the scan goes on until the keys are quiet again.
+ * So the core can sleep meanwhile, see `isWaiting()`.
+ *
+ * The matrix is sampled by a `KeyScanner`, the CPU by default: each snapshot
+ * taken is applied at its own time, so the ones queued by a background scanner
+ * while the loop was busy are not merged.
+ *
+ * The raw levels of the snapshots pass through a `Debouncer`: a key rises and
+ * falls by its debounced level, so the chatter of a switch adds no order.
+ * The levels are bitmasks, see `KeyState`: a snapshot without a change
+ * touches no key, and the press order changes on the edges only.
+ *
+ * Each edge is pushed to a ring of `KeyEvents` with the time of its snapshot.
+ * The consumers read the ring by their own `Events::Reader`, on either core:
+ * so a tap shorter than the poll of a consumer is seen, once, all the same.
  */
 class Keyboard {
-private:
-    static constexpr uint8_t MAX_ROW = 2;
-    static constexpr uint8_t MAX_COL = 3;
-    static const uint8_t PIN_ROW[MAX_ROW];
-    static const uint8_t PIN_COL[MAX_COL];
+public:
+    typedef KeyEvents<KEYBOARD_EVENTS> Events;
 
-    /**
-     * generate nano seconds delay.
-     * this is used to ensure GPIO pin state to be applied.
-     */
-    static void __attribute__((optimize("O0"))) delayNs() {
-        for(uint32_t i = 0; i < 10; ++i);
-    }
+private:
+    static constexpr uint8_t MAX_ROW = Board::MAX_ROW;
+    static constexpr uint8_t MAX_COL = Board::MAX_COL;
 
 private:
-    uint8_t _next[MAX_ROW];
-    EKey _orders[EKEY_MAX];
-    uint8_t _ordered;
-    uint32_t _scantick;
+    GpioScanner _gpio;
+    KeyScanner* _scanner;
+    Debouncer _debounce;
+
+    Board::row_t _next[MAX_ROW];
+    uint64_t _scanAt;       // --> the last snapshot, microseconds.
+    uint32_t _period;       // --> microseconds between the scans.
 
-    mutable SKey _state[EKEY_MAX];
+    bool _waitEnabled;
+    bool _waiting;          // --> rows high, waiting for the edge.
+    uint64_t _quietAt;      // --> the last scan a key was down.
+
+    KeyState<EKEY_MAX> _state;
+    Events _events;
+    mutable SKey _keys[EKEY_MAX];
 
 public:
     Keyboard();
@@ -200,20 +241,86 @@ public:
 public:
     void scanOnce();
 
-private:
-    void updateOnce();
+    /**
+     * Enable the interrupt wait: after the keys are quiet for `KEYBOARD_QUIET_MS`,
+     * `scanOnce()` does nothing until a key is pressed.
+     * Returns false if stripped out.
+     */
+    bool enableWait(bool val = true);
 
-    /* find order of the key.*/
-    int32_t findOrder(EKey key);
+    /**
+     * Test whether the keyboard waits for the interrupt or not.
+     * The core may sleep until an interrupt then, a press wakes it up.
+     */
+    inline bool isWaiting() const { return _waiting; }
 
-    /* add a key into order set. */
-    void addOrder(EKey key);
+    /**
+     * Set the microseconds between the scans.
+     * Returns false if out of `KEYBOARD_SCAN_MIN_US` ~ `KEYBOARD_SCAN_MAX_US`.
+     */
+    bool setScanPeriod(uint32_t us);
+
+    /**
+     * Get the microseconds between the scans.
+     */
+    inline uint32_t scanPeriod() const { return _period; }
+
+    /**
+     * Set the scanner of the matrix, null for the CPU's.
+     * The previous one is stopped, and the new one is started unless waiting.
+     */
+    void setScanner(KeyScanner* scanner);
+
+    /**
+     * Get the scanner of the matrix.
+     */
+    inline KeyScanner* scanner() const { return _scanner; }
+
+    /**
+     * Set the debounce algorithm and its windows, microseconds.
+     * Returns false if unknown, or out of `DEBOUNCE_MAX_US`: nothing is changed then.
+     */
+    bool setDebounce(EDebounce algo, uint32_t pressUs, uint32_t releaseUs);
+
+    /**
+     * Start or stop the debounce calibration: the keys time their bounces, and each
+     * one gets its own window once it recorded enough. The windows are kept on stop.
+     * Returns false if stripped out.
+     */
+    bool calibrateDebounce(bool val = true);
 
-    /* remove a key from order set. */
-    void removeOrder(EKey key);
+    /**
+     * Drop the bounces recorded, and the windows picked from them.
+     */
+    void resetDebounceCalibration();
 
-    /* copy orders to key pointer. */
-    void assignOrders();
+    /**
+     * Get the debouncer of the keys.
+     */
+    inline const Debouncer& debouncer() const { return _debounce; }
+
+    /**
+     * Get the ring of the key events, to attach the readers.
+     */
+    inline const Events& events() const { return _events; }
+
+    /**
+     * Get the levels of the keys, bit i of the words is key i.
+     * A reader of the events takes these on `resync()`.
+     */
+    inline const uint32_t* levels() const { return _state.downs(); }
+
+private:
+    void updateOnce(uint32_t now);
+
+    /* wait for the interrupt if all keys are quiet. */
+    void checkQuiet(uint64_t now);
+
+    /* drive all rows high, and arm the edges of the columns. */
+    void enterWait();
+
+    /* disarm the edges, and drive the rows low to scan. */
+    void leaveWait();
 
 public:
     /* get the begining key iterator. */
@@ -224,21 +331,20 @@ public:
 
     /* get all pressing key delegate for `range` iterations. */
     KeyOrderDelegate pressing() const {
-        const uint8_t count
-            = _ordered > EKEY_MAX
-            ? EKEY_MAX : _ordered;
-            
-        return KeyOrderDelegate(this, count);
+        return KeyOrderDelegate(this);
     }
 
 public:
-    /* get the key order. */
+    /* get the key order, `KO_NONE` if not pressed. this walks the order set. */
     uint8_t getKeyOrder(EKey key) const;
 
-    /* get the n'th key in order set. */
+    /* get the n'th key in order set. this walks the order set. */
     EKey getKeyInOrder(uint8_t order) const;
 
-    /* get all keys in pressing order. */
+    /* get the key pressed after the key, `EKEY_INV` if the last. */
+    EKey getKeyAfter(EKey key) const;
+
+    /* get the pressed keys in the state, in pressing order. */
     uint8_t getKeys(EKeyState state, EKey* buf, uint8_t max) const;
 
     /* get the key pointer. */
@@ -247,6 +353,9 @@ public:
     /* get the key state. */
     EKeyState getKeyState(EKey key) const;
 
+    /* get the time of the last edge of the key, microseconds. */
+    uint32_t getKeyTime(EKey key) const;
+
     /* test whether the key is down or not. */
     bool isKeyDown(EKey key) const;
 
@@ -0,0 +1,205 @@
+#ifndef __DRIVERS_KEYEVENTS_H__
+#define __DRIVERS_KEYEVENTS_H__
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Edge of a key event.
+ */
+enum EKeyEdge {
+    EKED_FALL = 0,      // --> released.
+    EKED_RISE = 1       // --> pressed.
+};
+
+/**
+ * Key event: an edge of the debounced level of a key.
+ */
+struct SKeyEvent {
+    uint32_t at;        // --> the snapshot of the edge, microseconds.
+    uint16_t key;
+    uint8_t edge;       // --> `EKeyEdge`.
+};
+
+/**
+ * Ring of the key events, `SIZE` events, a power of two.
+ * A producer pushes, and each `Reader` reads every event once, by its own cursor.
+ *
+ * --
+ * The producer never waits for the readers: a reader behind by the ring
+ * loses the oldest events, and counts them, see `Reader::lost()`.
+ * So a reader keeps `SIZE - 1` events for sure, the next push may be on the oldest.
+ * No locks: the producer writes the slot, then publishes the count of the events.
+ * A reader copies the slot, then checks the count again: if the producer
+ * may have reached the slot meanwhile, the copy is dropped as lost.
+ * So the producer and the readers may run on different cores.
+ */
+template<uint32_t SIZE>
+class KeyEvents {
+public:
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "the ring must be a power of two.");
+
+private:
+    static constexpr uint32_t MASK = SIZE - 1;
+
+    std::atomic<uint32_t> _head;        // --> events pushed, wraps.
+    std::atomic<uint32_t> _at[SIZE];
+    std::atomic<uint32_t> _code[SIZE];  // --> key, and the edge at bit 16.
+
+public:
+    KeyEvents() : _head(0) {
+        for(uint32_t i = 0; i < SIZE; ++i) {
+            _at[i].store(0, std::memory_order_relaxed);
+            _code[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /**
+     * Push the edge of the key at the time, microseconds. The producer only.
+     * This never blocks: the oldest event is overwritten if the ring is full.
+     */
+    void push(uint16_t key, EKeyEdge edge, uint32_t at) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        const uint32_t slot = head & MASK;
+
+        // --> the count before is seen by a reader that sees the slot rewritten.
+        std::atomic_thread_fence(std::memory_order_release);
+
+        _at[slot].store(at, std::memory_order_relaxed);
+        _code[slot].store(key | (uint32_t(edge) << 16), std::memory_order_relaxed);
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Get the events pushed, wrapped at 32 bits.
+     */
+    inline uint32_t pushed() const { return _head.load(std::memory_order_acquire); }
+
+public:
+    /**
+     * Reader of the ring, a cursor of a consumer.
+     * A reader is used by a core only, the ring may be pushed by the other.
+     */
+    class Reader {
+    private:
+        const KeyEvents* _ring;
+        uint32_t _tail;         // --> the next event to read.
+        uint32_t _lost;         // --> events overwritten before read.
+        bool _resync;
+
+    public:
+        Reader() : _ring(nullptr), _tail(0), _lost(0), _resync(false) { }
+
+    public:
+        /**
+         * Attach to the ring: the events from now are read.
+         * The consumer takes the levels as they are, see `resync()`.
+         */
+        void attach(const KeyEvents* ring) {
+            _ring = ring;
+            _lost = 0;
+            drop();
+        }
+
+        /**
+         * Skip the events not read yet, without counting them as lost.
+         */
+        void drop() {
+            if (_ring) {
+                _tail = _ring->pushed();
+            }
+
+            _resync = true;
+        }
+
+        /**
+         * Copy the oldest event not read, without taking it.
+         * Returns false if none.
+         */
+        bool peek(SKeyEvent& event) {
+            while (_ring) {
+                const uint32_t head = _ring->_head.load(std::memory_order_acquire);
+                if (head == _tail) {
+                    return false;
+                }
+
+                // --> behind by more than the ring: the oldest are gone.
+                if (head - _tail > SIZE) {
+                    skipLost(head - _tail - SIZE);
+                }
+
+                const uint32_t slot = _tail & MASK;
+                const uint32_t at = _ring->_at[slot].load(std::memory_order_relaxed);
+                const uint32_t code = _ring->_code[slot].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                // --> the producer reached the slot while copied: it may be torn.
+                if (_ring->_head.load(std::memory_order_relaxed) - _tail >= SIZE) {
+                    skipLost(1);
+                    continue;
+                }
+
+                event.at = at;
+                event.key = uint16_t(code);
+                event.edge = uint8_t(code >> 16);
+                return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * Take the event copied by `peek()`.
+         */
+        inline void skip() { _tail++; }
+
+        /**
+         * Take the oldest event not read.
+         * Returns false if none.
+         */
+        bool next(SKeyEvent& event) {
+            if (!peek(event)) {
+                return false;
+            }
+
+            _tail++;
+            return true;
+        }
+
+        /**
+         * Test whether any event is not read yet, or the levels are to take.
+         */
+        inline bool isPending() const {
+            return _resync || (_ring && _ring->pushed() != _tail);
+        }
+
+        /**
+         * Get the events lost since attached: overwritten before read.
+         */
+        inline uint32_t lost() const { return _lost; }
+
+        /**
+         * Returns true once after attached or dropped, or events lost:
+         * the consumer takes the levels of the keys as they are then.
+         * The events not read yet may repeat the edges of the levels, harmless.
+         */
+        bool resync() {
+            const bool resync = _resync;
+
+            _resync = false;
+            return resync;
+        }
+
+    private:
+        /* skip the events lost. */
+        void skipLost(uint32_t count) {
+            _tail += count;
+            _lost += count;
+            _resync = true;
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "keyscan.h"
+#include <string.h>
+#include <hardware/gpio.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include <hardware/timer.h>
+
+GpioScanner::GpioScanner()
+    : _scanAt(0), _period(0), _due(false)
+{
+}
+
+void GpioScanner::start(uint32_t period) {
+    _period = period;
+    _due = true;
+}
+
+void GpioScanner::stop() {
+    _due = false;
+}
+
+bool GpioScanner::take(SKeyScan& scan, uint64_t now) {
+    if (!_due && now - _scanAt < _period) {
+        return false;
+    }
+
+    _due = false;
+    _scanAt = now;
+
+    scan.at = now;
+    MatrixScan<Board>::scan(scan.rows);
+    return true;
+}
+
+#if KEYSCAN_DISABLE_PIO == 0
+/**
+ * The scan program: the rows on the set pins, the columns on the in pins.
+ * The OSR keeps the wait cycles, X counts the scans down, and a scan takes the
+ * wait plus `2 * MAX_ROW + 6` cycles. A snapshot is the columns of each row,
+ * from the top, then the low bits of X: pushed without blocking, the DMA pops it at once.
+ * For the 2x3 pad:
+ *
+ *      pull                ; osr = the wait cycles, once.
+ *      mov x, ~null        ; x = the scan count, down from all ones.
+ *  .wrap_target
+ *      set pins, 1         ; ROW1 high: the columns settle for a cycle.
+ *      in pins, 3
+ *      set pins, 2         ; ROW2 high.
+ *      in pins, 3
+ *      set pins, 0
+ *      in x, 26
+ *      push noblock
+ *      mov y, osr
+ *  wait:
+ *      jmp y--, wait
+ *      jmp x--, top        ; decrements only, the wrap goes to the top anyway.
+ *  .wrap
+ */
+static constexpr uint32_t KEYSCAN_PIO_LEN = 2 * Board::MAX_ROW + 8;
+static constexpr uint32_t KEYSCAN_PIO_TOP = 2;                              // --> `.wrap_target`.
+static constexpr uint32_t KEYSCAN_PIO_CYCLES = 2 * Board::MAX_ROW + 6;      // --> per scan besides the wait.
+static constexpr uint32_t KEYSCAN_PIO_PUSH = 2 * Board::MAX_ROW + 5;        // --> the first snapshot pushed, from the start.
+static constexpr uint32_t KEYSCAN_PIO_COUNT = Board::MAX_KEY < 32 ? 32 - Board::MAX_KEY : 0; // --> bits of the scan count.
+static constexpr uint32_t KEYSCAN_RING_BITS = __builtin_ctz(KEYSCAN_RING * 4);
+
+// --> `set` drives 5 pins at most, and the count tells the laps of the ring.
+static constexpr bool KEYSCAN_PIO_FITS = Board::MAX_ROW <= 5 && Board::Rows::RUN && Board::Cols::RUN
+    && KEYSCAN_PIO_COUNT > __builtin_ctz(KEYSCAN_RING);
+
+/**
+ * The instructions of the program, for the board.
+ */
+struct SKeyScanProgram {
+    uint16_t code[KEYSCAN_PIO_LEN];
+
+    constexpr SKeyScanProgram() : code() {
+        constexpr uint32_t wait = KEYSCAN_PIO_LEN - 2;
+        uint32_t n = 0;
+
+        code[n++] = 0x80a0;                                     // --> pull
+        code[n++] = 0xa02b;                                     // --> mov x, ~null
+
+        for(uint32_t i = 0; i < Board::MAX_ROW; ++i) {
+            code[n++] = uint16_t(0xe000 | ((1u << i) & 0x1f));  // --> set pins, 1 << i
+            code[n++] = uint16_t(0x4000 | (Board::MAX_COL & 0x1f)); // --> in pins, MAX_COL
+        }
+
+        code[n++] = 0xe000;                                     // --> set pins, 0
+        code[n++] = uint16_t(0x4020 | (KEYSCAN_PIO_COUNT & 0x1f)); // --> in x, the count bits
+        code[n++] = 0x8000;                                     // --> push noblock
+        code[n++] = 0xa047;                                     // --> mov y, osr
+        code[n++] = uint16_t(0x0080 | wait);                    // --> jmp y--, wait
+        code[n++] = uint16_t(0x0040 | KEYSCAN_PIO_TOP);         // --> jmp x--, top
+    }
+};
+
+static constexpr SKeyScanProgram KEYSCAN_PIO_SCAN;
+
+static_assert((KEYSCAN_RING & (KEYSCAN_RING - 1)) == 0 && KEYSCAN_RING >= 4 && KEYSCAN_RING * 4 <= 32768,
+    "the ring must be a power of two, 16 bytes ~ 32KB.");
+#endif
+
+PioScanner::PioScanner()
+    : _pio(nullptr), _sm(-1), _dma(-1), _offset(0),
+      _running(false), _period(0), _startAt(0),
+      _issued(0), _head(0), _tail(0), _overruns(0)
+{
+    memset(_ring, 0, sizeof(_ring));
+}
+
+PioScanner::~PioScanner() {
+    deinit();
+}
+
+bool PioScanner::init(PIO pio) {
+#if KEYSCAN_DISABLE_PIO == 0
+    const pio_program_t program = { KEYSCAN_PIO_SCAN.code, uint8_t(KEYSCAN_PIO_LEN), -1 };
+
+    deinit();
+
+    if (!KEYSCAN_PIO_FITS || !pio || !pio_can_add_program(pio, &program)) {
+        return false;
+    }
+
+    const int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+
+    const int dma = dma_claim_unused_channel(false);
+    if (dma < 0) {
+        pio_sm_unclaim(pio, sm);
+        return false;
+    }
+
+    _pio = pio;
+    _sm = int8_t(sm);
+    _dma = int8_t(dma);
+    _offset = uint8_t(pio_add_program(pio, &program));
+    return true;
+#else
+    (void) pio;
+    return false;
+#endif
+}
+
+void PioScanner::deinit() {
+#if KEYSCAN_DISABLE_PIO == 0
+    if (!_pio) {
+        return;
+    }
+
+    const pio_program_t program = { KEYSCAN_PIO_SCAN.code, uint8_t(KEYSCAN_PIO_LEN), -1 };
+
+    stop();
+    pio_remove_program(_pio, &program, _offset);
+    pio_sm_unclaim(_pio, _sm);
+    dma_channel_unclaim(_dma);
+
+    _pio = nullptr;
+    _sm = _dma = -1;
+#endif
+}
+
+void PioScanner::start(uint32_t period) {
+#if KEYSCAN_DISABLE_PIO == 0
+    if (!_pio) {
+        return;
+    }
+
+    stop();
+
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, _offset + KEYSCAN_PIO_TOP, _offset + KEYSCAN_PIO_LEN - 1);
+    sm_config_set_set_pins(&config, Board::Rows::PIN[0], Board::MAX_ROW);
+    sm_config_set_in_pins(&config, Board::Cols::PIN[0]);
+    sm_config_set_in_shift(&config, false, false, 32);
+
+    // --> the clock of the program, not faster than the system's.
+    uint64_t div = uint64_t(clock_get_hz(clk_sys)) * 256 / PIO_HZ;
+    if (div < 256) {
+        div = 256;
+    }
+
+    sm_config_set_clkdiv_int_frac(&config, uint16_t(div >> 8), uint8_t(div & 0xff));
+    pio_sm_init(_pio, _sm, _offset, &config);
+
+    // --> the rows stay low until the first strobe.
+    pio_sm_set_pins_with_mask(_pio, _sm, 0, Board::Rows::MASK);
+    pio_sm_set_consecutive_pindirs(_pio, _sm, Board::Rows::PIN[0], Board::MAX_ROW, true);
+    for(uint8_t i = 0; i < Board::MAX_ROW; ++i) {
+        pio_gpio_init(_pio, Board::Rows::PIN[i]);
+    }
+
+    const uint32_t cycles = uint32_t(uint64_t(period) * PIO_HZ / 1000000);
+    pio_sm_put_blocking(_pio, _sm, cycles > KEYSCAN_PIO_CYCLES ? cycles - KEYSCAN_PIO_CYCLES : 0);
+
+    // --> endless in practice: 2^32 scans, then re-armed by `take()`.
+    dma_channel_config dc = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+    channel_config_set_read_increment(&dc, false);
+    channel_config_set_write_increment(&dc, true);
+    channel_config_set_ring(&dc, true, KEYSCAN_RING_BITS);
+    channel_config_set_dreq(&dc, pio_get_dreq(_pio, _sm, false));
+    dma_channel_configure(_dma, &dc, _ring, &_pio->rxf[_sm], UINT32_MAX, true);
+
+    _period = period;
+    _issued = UINT32_MAX;
+    _head = _tail = 0;
+    _running = true;
+
+    _startAt = time_us_64();
+    pio_sm_set_enabled(_pio, _sm, true);
+#else
+    (void) period;
+#endif
+}
+
+void PioScanner::stop() {
+#if KEYSCAN_DISABLE_PIO == 0
+    if (!_running) {
+        return;
+    }
+
+    pio_sm_set_enabled(_pio, _sm, false);
+    dma_channel_abort(_dma);
+
+    // --> back to the SIO, stopped anywhere in the strobe.
+    for(uint8_t i = 0; i < Board::MAX_ROW; ++i) {
+        gpio_set_function(Board::Rows::PIN[i], GPIO_FUNC_SIO);
+        gpio_put(Board::Rows::PIN[i], 0);
+    }
+
+    _running = false;
+#endif
+}
+
+bool PioScanner::take(SKeyScan& scan, uint64_t now) {
+#if KEYSCAN_DISABLE_PIO == 0
+    if (!_running) {
+        return false;
+    }
+
+    // --> drained: read how far the DMA wrote, once the next one is due.
+    if (_tail >= _head) {
+        if (now < _startAt + _head * _period + KEYSCAN_PIO_PUSH * 1000000ull / PIO_HZ) {
+            return false;
+        }
+
+        const uint32_t left = dma_channel_hw_addr(_dma)->transfer_count;
+        _head = _issued - left;
+
+        if (!left) {
+            dma_channel_set_trans_count(_dma, UINT32_MAX, true);
+            _issued += UINT32_MAX;
+        }
+
+        if (_tail >= _head) {
+            return false;
+        }
+    }
+
+    // --> lapped: the oldest ones are overwritten, the slot the DMA writes next too.
+    if (_head - _tail >= KEYSCAN_RING) {
+        _overruns += uint32_t(_head - _tail - (KEYSCAN_RING - 1));
+        _tail = _head - (KEYSCAN_RING - 1);
+    }
+
+    const uint32_t word = _ring[_tail & (KEYSCAN_RING - 1)];
+    const uint32_t mask = (1u << KEYSCAN_PIO_COUNT) - 1;
+
+    // --> overwritten while read: lost, the newer ones are taken next time.
+    if ((~word & mask) != (_tail & mask)) {
+        _overruns += uint32_t(_head - _tail);
+        _tail = _head;
+        return false;
+    }
+
+    scan.at = _startAt + _tail * _period;
+
+    // --> the first row at the top.
+    for(uint8_t i = 0; i < Board::MAX_ROW; ++i) {
+        const uint32_t shift = (32 - (i + 1) * Board::MAX_COL) & 31;
+        scan.rows[i] = Board::row_t((word >> shift) & ((1u << Board::MAX_COL) - 1));
+    }
+
+    _tail++;
+    return true;
+#else
+    (void) scan; (void) now;
+    return false;
+#endif
+}
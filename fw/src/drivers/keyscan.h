@@ -0,0 +1,187 @@
+#ifndef __DRIVERS_KEYSCAN_H__
+#define __DRIVERS_KEYSCAN_H__
+
+#include <stdint.h>
+#include <utility>
+#include <hardware/gpio.h>
+#include <hardware/pio.h>
+#include "../main.h"
+
+/**
+ * Key scanner configurations.
+ * 1. KEYSCAN_DISABLE_PIO : strips the PIO scanner out, then the matrix is scanned by the CPU only.
+ * 2. KEYSCAN_RING : snapshots the DMA ring holds, a power of two.
+ *    the keyboard must take them within this many periods, or the oldest are lost.
+ */
+#ifndef KEYSCAN_DISABLE_PIO
+#define KEYSCAN_DISABLE_PIO 0
+#endif
+
+#ifndef KEYSCAN_RING
+#define KEYSCAN_RING 64
+#endif
+
+/**
+ * Snapshot of the matrix.
+ */
+struct SKeyScan {
+    uint64_t at;                            // --> sampled, microseconds.
+    Board::row_t rows[Board::MAX_ROW];      // --> column bits of each row.
+};
+
+/**
+ * Key scanner, the backend of the `Keyboard`.
+ * Samples the matrix at a period and, hands the snapshots in time order.
+ *
+ * --
+ * The keyboard owns the rows while it waits for the interrupt:
+ * the scanner is stopped then, and started again on the first edge.
+ */
+class KeyScanner {
+public:
+    /**
+     * generate nano seconds delay.
+     * this is used to ensure GPIO pin state to be applied.
+     */
+    static void __attribute__((optimize("O0"))) delayNs() {
+        for(uint32_t i = 0; i < 10; ++i);
+    }
+
+public:
+    virtual ~KeyScanner() { }
+
+public:
+    /**
+     * Start to scan at the period, microseconds. The rows are low before.
+     * If running, this restarts at the period: the snapshots not taken are dropped.
+     */
+    virtual void start(uint32_t period) = 0;
+
+    /**
+     * Stop scanning, and leave the rows low.
+     */
+    virtual void stop() = 0;
+
+    /**
+     * Take the oldest snapshot not taken yet, `now` is the current time in microseconds.
+     * Returns false if none.
+     */
+    virtual bool take(SKeyScan& scan, uint64_t now) = 0;
+};
+
+/**
+ * Scan of the matrix on the CPU, unrolled for the board at compile time:
+ * each row is driven high, and all columns are read by a read of the GPIO bank.
+ */
+template<typename BOARD>
+class MatrixScan {
+public:
+    /* scan all rows, the column bits of each. */
+    static inline void scan(typename BOARD::row_t* rows) {
+        scanRows(rows, std::make_integer_sequence<uint8_t, BOARD::MAX_ROW>());
+    }
+
+private:
+    template<uint8_t... R>
+    static inline void scanRows(typename BOARD::row_t* rows, std::integer_sequence<uint8_t, R...>) {
+        (scanRow<R>(rows), ...);
+    }
+
+    template<uint8_t R>
+    static inline void scanRow(typename BOARD::row_t* rows) {
+        constexpr uint8_t pin = BOARD::Rows::PIN[R];
+
+        gpio_put(pin, 1);
+        KeyScanner::delayNs();
+
+        rows[R] = BOARD::columns(gpio_get_all());
+
+        gpio_put(pin, 0);
+        KeyScanner::delayNs();
+    }
+};
+
+/**
+ * Key scanner on the CPU: drives the rows one by one and, samples the columns
+ * when a snapshot is taken after the period. See `MatrixScan`.
+ */
+class GpioScanner : public KeyScanner {
+private:
+    uint64_t _scanAt;       // --> the last scan, microseconds.
+    uint32_t _period;
+    bool _due;              // --> started: scan at once.
+
+public:
+    GpioScanner();
+
+public:
+    void start(uint32_t period) override;
+    void stop() override;
+    bool take(SKeyScan& scan, uint64_t now) override;
+};
+
+/**
+ * Key scanner on a PIO state machine, and a DMA channel.
+ * The program is built for the board: up to 5 consecutive rows, consecutive
+ * columns, and a snapshot fits a word with the scan count. `init()` fails on
+ * the other boards, so the CPU scans them.
+ *
+ * --
+ * The state machine strobes the rows and samples all columns of a row at once,
+ * a cycle after it rose, at a fixed period of its own clock. The snapshots are
+ * pushed with the scan count, and the DMA writes them into a ring buffer, paced
+ * by the RX FIFO: so the scan takes no CPU time at all, and a snapshot's time
+ * is the start time plus its count times the period.
+ *
+ * Taking a snapshot reads the transfer count of the channel once the ring is
+ * drained and the next one is due, so the loop polls no register meanwhile.
+ * The count in the snapshot tells a slot overwritten while read.
+ */
+class PioScanner : public KeyScanner {
+public:
+    // --> a cycle per microsecond: the rows settle for a cycle.
+    static constexpr uint32_t PIO_HZ = 1000 * 1000;
+
+private:
+    PIO _pio;               // --> null if not initialized.
+    int8_t _sm;
+    int8_t _dma;
+    uint8_t _offset;
+
+    bool _running;
+    uint32_t _period;
+    uint64_t _startAt;      // --> the state machine enabled, microseconds.
+    uint64_t _issued;       // --> transfers triggered since the start.
+    uint64_t _head;         // --> snapshots written, as of the last read.
+    uint64_t _tail;         // --> snapshots taken.
+    uint32_t _overruns;
+
+    alignas(KEYSCAN_RING * 4) uint32_t _ring[KEYSCAN_RING];
+
+public:
+    PioScanner();
+    ~PioScanner();
+
+public:
+    /**
+     * Load the program on the PIO, and claim a state machine and a DMA channel.
+     * Returns false if no space, the board doesn't fit, or stripped out.
+     */
+    bool init(PIO pio);
+
+    /**
+     * Release the PIO and the DMA channel.
+     */
+    void deinit();
+
+    void start(uint32_t period) override;
+    void stop() override;
+    bool take(SKeyScan& scan, uint64_t now) override;
+
+    /**
+     * Get the snapshots lost: the ring was overwritten before they were taken.
+     */
+    inline uint32_t overruns() const { return _overruns; }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef __DRIVERS_KEYSTATE_H__
+#define __DRIVERS_KEYSTATE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * Level states of the keys, and their press order.
+ * Bit i of the words is key i.
+ *
+ * --
+ * The levels are three bitmasks: down, rose and fell at the last update.
+ * So an update is a XOR of each word, and only the keys changed are visited:
+ * the order list and the times of the edges are updated on the edges only.
+ * The order list links each pressed key to the next one pressed after it,
+ * so adding or removing a key takes no search and no move.
+ */
+template<uint32_t KEYS>
+class KeyState {
+public:
+    static constexpr uint32_t WORDS = (KEYS + 31) / 32;
+
+    // --> index of the keys, the list ends at `NONE`.
+    typedef typename std::conditional<(KEYS < 0xff), uint8_t, uint16_t>::type index_t;
+    static constexpr index_t NONE = index_t(KEYS);
+
+private:
+    uint32_t _down[WORDS];
+    uint32_t _rise[WORDS];
+    uint32_t _fall[WORDS];
+
+    index_t _next[KEYS + 1];    // --> the key pressed after, `NONE` is the head.
+    index_t _prev[KEYS + 1];
+    index_t _count;
+
+    uint32_t _at[KEYS];         // --> the last edge, microseconds.
+
+public:
+    KeyState() { reset(); }
+
+public:
+    /**
+     * Release all keys, without edges.
+     */
+    void reset() {
+        memset(_down, 0, sizeof(_down));
+        memset(_rise, 0, sizeof(_rise));
+        memset(_fall, 0, sizeof(_fall));
+        memset(_at, 0, sizeof(_at));
+
+        _next[NONE] = _prev[NONE] = NONE;
+        _count = 0;
+    }
+
+    /**
+     * Update the levels of the keys, `WORDS` words, at the time in microseconds.
+     * The keys changed rise or fall, the others keep their levels.
+     */
+    void update(const uint32_t* levels, uint32_t now) {
+        for(uint32_t i = 0; i < WORDS; ++i) {
+            const uint32_t down = _down[i];
+            const uint32_t changed = levels[i] ^ down;
+
+            _rise[i] = changed & levels[i];
+            _fall[i] = changed & down;
+            _down[i] = levels[i];
+
+            // --> the edges only, lowest key first.
+            for(uint32_t bits = changed; bits; bits &= bits - 1) {
+                const index_t key = index_t(i * 32 + __builtin_ctz(bits));
+
+                if (levels[i] & (1u << (key & 31))) {
+                    link(key);
+                }
+
+                else {
+                    unlink(key);
+                }
+
+                _at[key] = now;
+            }
+        }
+    }
+
+public:
+    /* test whether the key is down, rising or high. */
+    inline bool isDown(uint32_t key) const { return (_down[key >> 5] >> (key & 31)) & 1; }
+
+    /* test whether the key rose at the last update. */
+    inline bool isRising(uint32_t key) const { return (_rise[key >> 5] >> (key & 31)) & 1; }
+
+    /* test whether the key fell at the last update. */
+    inline bool isFalling(uint32_t key) const { return (_fall[key >> 5] >> (key & 31)) & 1; }
+
+    /* get the time of the last edge of the key, microseconds. */
+    inline uint32_t changedAt(uint32_t key) const { return _at[key]; }
+
+    /* get the keys down. */
+    inline uint32_t count() const { return _count; }
+
+    /* get the words of the keys down. */
+    inline const uint32_t* downs() const { return _down; }
+
+    /* get the words of the keys rose at the last update. */
+    inline const uint32_t* rises() const { return _rise; }
+
+    /* get the words of the keys fell at the last update. */
+    inline const uint32_t* falls() const { return _fall; }
+
+    /* test whether no key is down, nor fell at the last update. */
+    bool isQuiet() const {
+        uint32_t bits = 0;
+
+        for(uint32_t i = 0; i < WORDS; ++i) {
+            bits |= _down[i] | _fall[i];
+        }
+
+        return bits == 0;
+    }
+
+public:
+    /* get the key pressed first, `NONE` if none. */
+    inline index_t first() const { return _next[NONE]; }
+
+    /* get the key pressed after the key, `NONE` if the last. */
+    inline index_t after(index_t key) const { return _next[key]; }
+
+private:
+    /* append the key to the order list. */
+    void link(index_t key) {
+        const index_t tail = _prev[NONE];
+
+        _next[key] = NONE;
+        _prev[key] = tail;
+        _next[tail] = key;
+        _prev[NONE] = key;
+        _count++;
+    }
+
+    /* remove the key from the order list. */
+    void unlink(index_t key) {
+        _next[_prev[key]] = _next[key];
+        _prev[_next[key]] = _prev[key];
+        _count--;
+    }
+};
+
+#endif
@@ -1,4 +1,4 @@
-#include "SPI.h"
+#include "spi.h"
 #include "hardware/gpio.h"
 #include "hardware/spi.h"
 
@@ -71,25 +71,33 @@ void UsbCdc::transmitOnce() {
     }
     
     memcpy(txbuf, _wbuf, txlen);
+
+    // --> the FIFO full: retry the same bytes, not none.
+    uint32_t sent = 0;
     while(true) {
-        txlen = tud_cdc_n_write(0, txbuf, txlen);
+        sent = tud_cdc_n_write(0, txbuf, txlen);
         tud_cdc_n_write_flush(0);
 
-        if (txlen) {
+        if (sent) {
             break;
         }
 
         tud_task();
     }
 
-    memcpy(txbuf, txbuf + txlen, _wpos - txlen);
-    _wpos -= txlen;
+    // --> the rest to the front, more than a message may be queued.
+    memmove(_wbuf, _wbuf + sent, _wpos - sent);
+    _wpos -= sent;
 }
 
 void UsbCdc::reset() {
     _wpos = _rpos = 0;
 }
 
+bool UsbCdc::isIdle() const {
+    return !g_usbCdcIntr && !_wpos && !_rpos;
+}
+
 uint32_t UsbCdc::read(uint8_t *buf, uint32_t len) {
     if (_rpos) {
         if (len > _rpos) {
@@ -97,7 +105,7 @@ uint32_t UsbCdc::read(uint8_t *buf, uint32_t len) {
         }
 
         memcpy(buf, _rbuf, len);
-        memcpy(_rbuf, _rbuf + _rpos, _rpos - len);
+        memmove(_rbuf, _rbuf + len, _rpos - len);
 
         _rpos -= len;
         return len;
@@ -149,14 +157,14 @@ bool UsbCdc::read(SCdcMessage& msg) {
     msg.checksum = _rbuf[2 + msg.length];
 
     if (checksum(msg) != msg.checksum) {
-        memcpy(_rbuf, _rbuf + 1, _rpos - 1);
+        memmove(_rbuf, _rbuf + 1, _rpos - 1);
         _rpos--;
 
         return false;
     }
 
     if ( _rpos - total > 0) {
-        memcpy(_rbuf, _rbuf + total, _rpos - total);
+        memmove(_rbuf, _rbuf + total, _rpos - total);
     }
     
     _rpos -= total;
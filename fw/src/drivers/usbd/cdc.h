@@ -25,6 +25,9 @@ enum {
     ECDCM_KEY_REPORT,
     ECDCM_REBOOT,
     ECDCM_UPLOAD,
+    ECDCM_SCRUB_REPORT,
+    ECDCM_SCAN_PERIOD,
+    ECDCM_DEBOUNCE_STATS,
 };
 
 /**
@@ -56,6 +59,9 @@ public:
     /* reset the CDC transceive-buffers. */
     void reset();
 
+    /* test whether no bytes are left to receive or to transmit. */
+    bool isIdle() const;
+
     /* read bytes from the buffer. */
     uint32_t read(uint8_t* buf, uint32_t len);
 
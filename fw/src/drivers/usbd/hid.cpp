@@ -1,5 +1,4 @@
 #include "hid.h"
-#include "../keyboard.h"
 #ifdef __INTELLISENSE__
 #include <tusb_config.h>
 #define CFG_TUD_EXTERN
@@ -26,6 +25,7 @@ UsbHid::UsbHid()
     : _modifiers(0), _blocked(0)
 {
     _keyboard = nullptr;
+    memset(_levels, 0, sizeof(_levels));
     memset(_keycodes, 0, sizeof(_keycodes));
 }
 
@@ -50,6 +50,42 @@ uint8_t UsbHid::leds() {
 
 void UsbHid::init(Keyboard *kbd) {
     _keyboard = kbd;
+    _events.attach(&kbd->events());
+}
+
+bool UsbHid::updateKeys() {
+    SKeyEvent event;
+
+    // --> attached, or edges lost: the levels as they are.
+    if (_events.resync()) {
+        memcpy(_levels, _keyboard->levels(), sizeof(_levels));
+        _state.update(_levels, 0);
+        return true;
+    }
+
+    if (!_events.peek(event)) {
+        return false;
+    }
+
+    // --> the edges of a snapshot at once: a chord is a report.
+    const uint32_t at = event.at;
+
+    do {
+        const uint32_t bit = 1u << (event.key & 31);
+
+        if (event.edge == EKED_RISE) {
+            _levels[event.key >> 5] |= bit;
+        }
+
+        else {
+            _levels[event.key >> 5] &= ~bit;
+        }
+
+        _events.skip();
+    } while (_events.peek(event) && event.at == at);
+
+    _state.update(_levels, at);
+    return true;
 }
 
 bool UsbHid::updateKeyCodes() {
@@ -60,7 +96,7 @@ bool UsbHid::updateKeyCodes() {
     bool dirty = false;
 
     if (_blocked == 0) {
-        for(uint8_t keyn : _keyboard->pressing()) {
+        for(uint32_t keyn = _state.first(); keyn != _state.NONE; keyn = _state.after(keyn)) {
             const SKey* ptr = _keyboard->getKeyPtr(EKey(keyn));
 
             if (ptr->kc && index < MAX_KC) {
@@ -85,7 +121,33 @@ bool UsbHid::updateKeyCodes() {
 }
 
 void UsbHid::transmitOnce() {
-    if (updateKeyCodes()) {
+    // --> no edge: only the configurations may change the report.
+    if (!_events.isPending()) {
+        if (updateKeyCodes()) {
+            tud_hid_keyboard_report(REPORT_ID, _modifiers, _keycodes);
+        }
+
+        return;
+    }
+
+    // --> no host: the keys down are taken as they are once mounted.
+    if (!tud_mounted()) {
+        _events.drop();
+        return;
+    }
+
+    // --> a report in flight: the edges wait.
+    if (!tud_hid_ready()) {
+        return;
+    }
+
+    // --> the next snapshot with a change, the configurations may change the report too.
+    bool dirty = updateKeyCodes();
+    while (!dirty && updateKeys()) {
+        dirty = updateKeyCodes();
+    }
+
+    if (dirty) {
         tud_hid_keyboard_report(REPORT_ID, _modifiers, _keycodes);
     }
 }
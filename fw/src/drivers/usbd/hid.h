@@ -4,9 +4,7 @@
 #include <stdint.h>
 #include <vector>
 #include "hid_kc.h"
-
-// --> forward decls.
-class Keyboard;
+#include "../keyboard.h"
 
 /**
  * Usb HID LED indicator bits.
@@ -22,6 +20,11 @@ enum EUsbHidLed {
 
 /**
  * Usb HID transmitter. 
+ *
+ * --
+ * The keys down are followed by the key events, in their press order:
+ * the edges of a snapshot make a report, sent when the endpoint is ready.
+ * So the edges wait in the ring while a report is in flight, none is merged away.
  */
 class UsbHid {
 public:
@@ -32,6 +35,10 @@ private:
 
 private:
     Keyboard* _keyboard;
+    Keyboard::Events::Reader _events;
+    KeyState<EKEY_MAX> _state;
+    uint32_t _levels[KeyState<EKEY_MAX>::WORDS];
+
     uint8_t _keycodes[MAX_KC];
     uint8_t _modifiers;
     uint8_t _blocked;
@@ -51,6 +58,9 @@ public:
     void init(Keyboard* kbd);
 
 private:
+    /* apply the events of the next snapshot, or the levels on resync. returns false if none. */
+    bool updateKeys();
+
     bool updateKeyCodes();
 
 public:
@@ -3,6 +3,14 @@
 #include <hardware/gpio.h>
 #include <string.h>
 
+#if W25QXX_DISABLE_DMA == 0
+#include <hardware/dma.h>
+#endif
+
+#if W25QXX_DISABLE_PIO == 0
+#include <hardware/clocks.h>
+#endif
+
 /**
  * Macros to switch fast-mode, optimizable at compile-time.
  */
@@ -35,8 +43,18 @@ const uint16_t W25QXX::MODELS[MODEL_MAX] = {
 };
 
 W25QXX::W25QXX(spi_inst_t* dev, uint8_t csn, uint8_t clk, uint8_t miso, uint8_t mosi)
-    : _dev(dev), _csn(csn), _clk(clk), _miso(miso), _mosi(mosi), _init(0), _sel(0), _id(0), _bcnt(0)
+    : _dev(dev), _csn(csn), _clk(clk), _miso(miso), _mosi(mosi), _init(0), _sel(0), _id(0), _bcnt(0), _baud(0),
+      _geo(), _job(EW25J_IDLE), _jobErase(0), _jobEraseBegin(0), _jobEraseDone(0), _jobEraseEnd(0), _jobBegin(0), _jobAddr(0), _jobBuf(nullptr), _jobLen(0),
+      _jobCompare(0), _jobUpdate(EW25U_NONE), _jobUnit(0),
+      _wip(false), _wipAddr(0), _wipLen(0), _suspended(false), _resumedAt(0),
+      _dmaTx(-1), _dmaRx(-1), _xfer(false), _xferLen(0), _xferCb(nullptr), _xferCtx(nullptr),
+      _xferDummy(DUMMY_BYTE), _xferSink(0), _xferResume(false),
+      _pio(nullptr), _pioSm(-1), _pioOffset(0), _pioLines(0), _pioBits(0), _pioCmd(0), _pioDummy(0),
+      _pioRetry(nullptr), _pioIo2(NO_PIN), _pioIo3(NO_PIN),
+      _cacheOn(false), _cacheTick(0), _cacheHits(0), _cacheMisses(0)
 {
+    memset(_jobDiffer, 0, sizeof(_jobDiffer));
+    cacheClear();
 }
 
 bool W25QXX::init() {
@@ -49,14 +67,258 @@ bool W25QXX::init() {
         configure();
     }
 
-    // --> reset the block count.
+    // --> the read modes are discovered again.
+    disablePio();
+
+    // --> reset the block count, and identify at the safe clock.
     _bcnt = 0;
+    cacheClear();
+    _baud = spi_set_baudrate(_dev, BAUDRATE);
+    memset(&_geo, 0, sizeof(_geo));
 
     // --> read ID.
     disableWrite();
+    _id = readId();
+
+    // --> the SFDP tables first, then the Winbond models.
+    SW25QGeometry geo;
+    if (!discover(&geo) && !fromModels(&geo)) {
+        return false;
+    }
+
+    // --> sectors and pages are the units of addressing.
+    if (geo.capacity < BLOCK_SIZE || geo.pageSize < PAGE_SIZE) {
+        return false;
+    }
+
+    _geo = geo;
+    if (!eraseOf(SECTOR_SIZE)) {
+        memset(&_geo, 0, sizeof(_geo));
+        return false;
+    }
+
+    if (_geo.addrMode == EW25A_4B_MODE) {
+        xfer(0xb7);
+    }
+
+    // --> set the block count.
+    _bcnt = _geo.capacity / BLOCK_SIZE;
+
+    // --> read all status registers.
+    for (uint8_t i = 0; i < 3; ++i) {
+        readStatus(i + 1);
+    }
+
+    tuneClock();
+    return true;
+}
+
+/* get the DWORD of the SFDP table, little endian. */
+static uint32_t W25QXX_Dword(const uint8_t* buf, uint32_t i) {
+    buf += i * 4;
+    return uint32_t(buf[0])
+        | (uint32_t(buf[1]) << 8)
+        | (uint32_t(buf[2]) << 16)
+        | (uint32_t(buf[3]) << 24)
+        ;
+}
+
+/* get the read mode of the BFPT half DWORD: dummy [4:0], mode clocks [7:5], opcode [15:8]. */
+static SW25QRead W25QXX_ReadMode(uint32_t half) {
+    SW25QRead mode;
+
+    mode.opcode = uint8_t(half >> 8);
+    mode.dummy = uint8_t((half & 0x1f) + ((half >> 5) & 0x07));
+    return mode;
+}
+
+bool W25QXX::discover(SW25QGeometry* geo) {
+    uint8_t head[8 * (1 + SFDP_MAX_HEADERS)];
+
+    memset(geo, 0, sizeof(SW25QGeometry));
+    readSfdp(0, head, 8);
+
+    if (W25QXX_Dword(head, 0) != SFDP_SIGNATURE) {
+        return false;
+    }
+
+    // --> the parameter headers: NPH is zero-based.
+    uint32_t count = uint32_t(head[6]) + 1;
+    if (count > SFDP_MAX_HEADERS) {
+        count = SFDP_MAX_HEADERS;
+    }
+
+    readSfdp(8, head + 8, count * 8);
+
+    uint32_t bfpt = 0, bfptLen = 0;
+    uint32_t fourb = 0, fourbLen = 0;
+
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint8_t* ph = head + 8 * (i + 1);
+        const uint16_t id = uint16_t(ph[0] | (ph[7] << 8));
+        const uint32_t ptp = uint32_t(ph[4]) | (uint32_t(ph[5]) << 8) | (uint32_t(ph[6]) << 16);
+
+        // --> the first one is mandatory, the later ones are newer revisions.
+        if (id == SFDP_BFPT && ph[3] >= 9) {
+            bfpt = ptp;
+            bfptLen = ph[3];
+        }
+
+        else if (id == SFDP_4BAIT && ph[3] >= 2) {
+            fourb = ptp;
+            fourbLen = 2;
+        }
+    }
+
+    if (!bfptLen) {
+        return false;
+    }
+
+    if (bfptLen > SFDP_BFPT_DWORDS) {
+        bfptLen = SFDP_BFPT_DWORDS;
+    }
+
+    uint8_t table[SFDP_BFPT_DWORDS * 4];
+    readSfdp(bfpt, table, bfptLen * 4);
+
+    // --> DWORD 2: density in bits, or 2 ^ N bits if the MSB set.
+    const uint32_t density = W25QXX_Dword(table, 1);
+    uint64_t bits = uint64_t(density) + 1;
+
+    if (density & 0x80000000) {
+        if ((density & 0x7fffffff) > 34) {
+            return false;
+        }
+
+        bits = 1ull << (density & 0x7fffffff);
+    }
+
+    // --> 32-bit addresses: up to 2 GB.
+    if (bits / 8 > 0x80000000ull) {
+        return false;
+    }
+
+    geo->capacity = uint32_t(bits / 8);
+    geo->sfdp = true;
+
+    // --> DWORD 8, 9: erase types, size 2 ^ N [7:0] and opcode [15:8] each.
+    uint32_t types = 0;
+    for(uint32_t i = 0; i < 4; ++i) {
+        const uint32_t half = W25QXX_Dword(table, 7 + i / 2) >> (16 * (i % 2));
+        const uint8_t shift = uint8_t(half & 0xff);
+
+        if (shift == 0 || shift >= 32) {
+            continue;
+        }
+
+        // --> insertion, ascending by the size.
+        uint32_t at = types++;
+        while (at > 0 && geo->erases[at - 1].shift > shift) {
+            geo->erases[at] = geo->erases[at - 1];
+            at--;
+        }
+
+        geo->erases[at].shift = shift;
+        geo->erases[at].opcode = uint8_t(half >> 8);
+        geo->erases[at].opcode4 = 0;
+    }
+
+    // --> DWORD 1: the supported read modes, DWORD 3, 4: their opcodes.
+    const uint32_t dw1 = W25QXX_Dword(table, 0);
+    const uint32_t dw3 = W25QXX_Dword(table, 2);
+    const uint32_t dw4 = W25QXX_Dword(table, 3);
+
+    geo->reads[EW25R_FAST].opcode = 0x0b;
+    geo->reads[EW25R_FAST].dummy = 8;
+
+    if (dw1 & (1 << 16)) geo->reads[EW25R_DUAL_OUT] = W25QXX_ReadMode(dw4 & 0xffff);
+    if (dw1 & (1 << 20)) geo->reads[EW25R_DUAL_IO] = W25QXX_ReadMode(dw4 >> 16);
+    if (dw1 & (1 << 22)) geo->reads[EW25R_QUAD_OUT] = W25QXX_ReadMode(dw3 >> 16);
+    if (dw1 & (1 << 21)) geo->reads[EW25R_QUAD_IO] = W25QXX_ReadMode(dw3 & 0xffff);
+
+    // --> DWORD 11 (JESD216A): page size, 2 ^ N [7:4].
+    geo->pageSize = 256;
+    if (bfptLen >= 11) {
+        geo->pageSize = uint16_t(1u << ((W25QXX_Dword(table, 10) >> 4) & 0x0f));
+    }
+
+    // --> 16 MB or less: 3-byte address.
+    geo->addrMode = EW25A_3B;
+    if (geo->capacity <= 0x1000000) {
+        return true;
+    }
+
+    // --> 4BAIT: 0x13 and 0x0c [1:0], 0x12 [6], the erase types [12:9] and their opcodes.
+    if (fourbLen) {
+        uint8_t fourbTable[8];
+        readSfdp(fourb, fourbTable, sizeof(fourbTable));
+
+        const uint32_t support = W25QXX_Dword(fourbTable, 0);
+        const uint32_t opcodes = W25QXX_Dword(fourbTable, 1);
+
+        // --> the erase types with 4-byte opcode only, the 4 KB one is required.
+        SW25QErase erases[4];
+        uint32_t kept = 0;
+        bool sector = false;
+
+        memset(erases, 0, sizeof(erases));
+        for(const SW25QErase& each : geo->erases) {
+            for(uint32_t i = 0; each.shift && i < 4; ++i) {
+                const uint8_t shift = uint8_t(W25QXX_Dword(table, 7 + i / 2) >> (16 * (i % 2)));
+
+                if (shift != each.shift || !(support & (1 << (9 + i)))) {
+                    continue;
+                }
+
+                erases[kept] = each;
+                erases[kept++].opcode4 = uint8_t(opcodes >> (8 * i));
+                sector = sector || (1u << shift) == SECTOR_SIZE;
+                break;
+            }
+        }
+
+        if ((support & 0x03) == 0x03 && (support & (1 << 6)) && sector) {
+            // --> the dual and quad reads with 4-byte opcode only: 0x3c, 0xbc, 0x6c, 0xec [5:2].
+            for(uint32_t i = EW25R_DUAL_OUT; i < EW25R_MAX; ++i) {
+                if (!(support & (1u << (1 + i)))) {
+                    geo->reads[i].opcode = 0;
+                }
+            }
+
+            memcpy(geo->erases, erases, sizeof(erases));
+            geo->addrMode = EW25A_4B_OPCODES;
+            return true;
+        }
+    }
+
+    // --> DWORD 16 (JESD216B): enter 4-byte address mode by 0xb7 [24].
+    if (bfptLen >= 16 && (W25QXX_Dword(table, 15) & (1 << 24))) {
+        geo->addrMode = EW25A_4B_MODE;
+        return true;
+    }
+
+    // --> no way to address above: the first 16 MB only.
+    geo->capacity = 0x1000000;
+    return true;
+}
+
+void W25QXX::readSfdp(uint32_t addr, uint8_t* buf, uint32_t len) {
+    // --> 3-byte address and 8 dummy clocks.
+    const uint8_t frame[5] = {
+        0x5a, uint8_t(addr >> 16), uint8_t(addr >> 8), uint8_t(addr), 0x00
+    };
+
+    W25QXX_ChipSelect _(this);
+
+    burst(frame, nullptr, sizeof(frame));
+    spi_read_blocking(_dev, DUMMY_BYTE, buf, len);
+}
+
+bool W25QXX::fromModels(SW25QGeometry* geo) const {
+    memset(geo, 0, sizeof(SW25QGeometry));
 
     // --> check vendor id.
-    if (((_id = readId()) & 0x0000ff00) != 0x4000) {
+    if ((_id & 0x0000ff00) != 0x4000) {
         return false;
     }
 
@@ -70,17 +332,108 @@ bool W25QXX::init() {
         return false;
     }
 
-    // --> set the block count.
-    _bcnt = MODELS[n];
+    // --> W25Qxx: 4K, 32K and 64K erases, and 4-byte opcodes above 16 MB.
+    geo->capacity = MODELS[n] * BLOCK_SIZE;
+    geo->pageSize = 256;
+    geo->addrMode = MODELS[n] > 256 ? EW25A_4B_OPCODES : EW25A_3B;
 
-    // --> read all status registers.
-    for (uint8_t i = 0; i < 3; ++i) {
-        readStatus(i + 1);
+    geo->erases[0] = { 12, 0x20, 0x21 };
+    geo->erases[1] = { 15, 0x52, 0x5c };
+    geo->erases[2] = { 16, 0xd8, 0xdc };
+
+    geo->reads[EW25R_FAST] = { 0x0b, 8 };
+    geo->reads[EW25R_DUAL_OUT] = { 0x3b, 8 };
+    geo->reads[EW25R_DUAL_IO] = { 0xbb, 4 };
+    geo->reads[EW25R_QUAD_OUT] = { 0x6b, 8 };
+    geo->reads[EW25R_QUAD_IO] = { 0xeb, 6 };
+    return true;
+}
+
+const SW25QErase* W25QXX::eraseOf(uint32_t size) const {
+    for(const SW25QErase& each : _geo.erases) {
+        if (each.shift && (1u << each.shift) == size) {
+            return &each;
+        }
+    }
+
+    return nullptr;
+}
+
+void W25QXX::tuneClock() {
+    uint8_t uid[8];
+    uint8_t ref[CLOCK_CHECK_LEN];
+
+    // --> references at the safe clock.
+    readUniqueId(uid, sizeof(uid));
+    transact(0x0b, 0, true, nullptr, ref, sizeof(ref));
+
+    // --> step up by 1.5x, until the max or a failure.
+    //   : the SSP divides the clock, so some steps fall to the same clock.
+    uint32_t failed = 0;
+    for(uint32_t next = _baud; next < W25QXX_MAX_BAUDRATE; ) {
+        next = next + next / 2;
+
+        if (next > W25QXX_MAX_BAUDRATE) {
+            next = W25QXX_MAX_BAUDRATE;
+        }
+
+        const uint32_t actual = spi_set_baudrate(_dev, next);
+        if (actual <= _baud) {
+            continue;
+        }
+
+        if (!checkClock(uid, ref, sizeof(ref))) {
+            failed = actual;
+            break;
+        }
+
+        _baud = actual;
+    }
+
+    // --> keep the margin below the failed one, lower clocks passed already.
+    if (failed) {
+        const uint32_t limit = uint32_t(uint64_t(failed) * (100 - W25QXX_CLOCK_MARGIN) / 100);
+
+        while (_baud > limit && _baud > BAUDRATE) {
+            _baud = spi_set_baudrate(_dev, _baud - _baud / 4);
+        }
+    }
+
+    applyClock();
+}
+
+bool W25QXX::checkClock(const uint8_t* uid, const uint8_t* ref, uint32_t len) {
+    uint8_t buf[CLOCK_CHECK_LEN];
+
+    for(uint32_t i = 0; i < CLOCK_CHECKS; ++i) {
+        if (readId() != _id) {
+            return false;
+        }
+
+        if (readUniqueId(buf, 8) != 8 || memcmp(buf, uid, 8) != 0) {
+            return false;
+        }
+
+        transact(0x0b, 0, true, nullptr, buf, len);
+        if (memcmp(buf, ref, len) != 0) {
+            return false;
+        }
     }
 
     return true;
 }
 
+void W25QXX::applyClock() {
+    uint32_t baud = _baud;
+
+    // --> the normal read is slower than the fast read.
+    if (!W25QXX_IS_FASTMODE && baud > READ_BAUDRATE) {
+        baud = READ_BAUDRATE;
+    }
+
+    spi_set_baudrate(_dev, baud);
+}
+
 void W25QXX_InvertBits(uint8_t* buf, const uint8_t* src, uint32_t len) {
     for(uint32_t i = 0; i < len; ++i) {
         buf[i] = ~src[i];
@@ -131,6 +484,8 @@ bool W25QXX::fastMode(bool val) {
     #else
         _init = val ? 2 : 1;
     #endif
+
+    applyClock();
     return true;
 }
 #endif
@@ -149,6 +504,11 @@ void W25QXX::configure() {
 }
 
 void W25QXX::select() {
+    // --> the bus is owned by the transfer.
+    if (_xfer) {
+        waitForXfer();
+    }
+
     if ((_sel++) == 0) {
         gpio_put(_csn, 0);
     }
@@ -168,28 +528,27 @@ uint8_t W25QXX::xfer(uint8_t data) {
     return read;
 }
 
-uint32_t W25QXX::xfer(uint8_t* buf, uint32_t len) {
+void W25QXX::burst(const uint8_t* tx, uint8_t* rx, uint32_t len) {
     W25QXX_ChipSelect _(this);
-    return spi_read_blocking(_dev, DUMMY_BYTE, buf, len);
-}
 
-uint32_t W25QXX::xmit(const uint8_t* buf, uint32_t len) {
-    W25QXX_ChipSelect _(this);
-    return spi_write_blocking(_dev, buf, len);
+    if (rx) {
+        spi_write_read_blocking(_dev, tx, rx, len);
+    }
+
+    else {
+        spi_write_blocking(_dev, tx, len);
+    }
 }
 
 uint32_t W25QXX::readId() {
-    W25QXX_ChipSelect _(this);
+    const uint8_t tx[4] = { 0x9f, DUMMY_BYTE, DUMMY_BYTE, DUMMY_BYTE };
+    uint8_t rx[4];
 
-    xfer(0x9f);
+    burst(tx, rx, sizeof(tx));
 
-    uint8_t b0 = xfer(DUMMY_BYTE);
-    uint8_t b1 = xfer(DUMMY_BYTE);
-    uint8_t b2 = xfer(DUMMY_BYTE);
-
-    return (uint32_t(b0) << 16)
-         | (uint32_t(b1) << 8)
-         | (uint32_t(b2) << 0)
+    return (uint32_t(rx[1]) << 16)
+         | (uint32_t(rx[2]) << 8)
+         | (uint32_t(rx[3]) << 0)
         ;
 }
 
@@ -203,20 +562,15 @@ uint32_t W25QXX::readUniqueId(uint8_t* buf, uint32_t len) {
     }
 
     if (buf && len) {
-        W25QXX_ChipSelect _(this);
+        // --> 0x4b, 4 dummy bytes, then 8 bytes of the ID.
+        uint8_t tx[13];
+        uint8_t rx[13];
 
-        xfer(0x4b);
-        for(uint8_t i = 0; i < 4; ++i) {
-            xfer(DUMMY_BYTE);
-        }
-
-        for(uint8_t i = 0; i < len; ++i) {
-            buf[i] = xfer(DUMMY_BYTE);
-        }
+        memset(tx, DUMMY_BYTE, sizeof(tx));
+        tx[0] = 0x4b;
 
-        for(uint8_t i = len; i < 8; ++i) {
-            xfer(DUMMY_BYTE);
-        }
+        burst(tx, rx, sizeof(tx));
+        memcpy(buf, rx + 5, len);
     }
 
     return len;
@@ -227,16 +581,18 @@ uint8_t W25QXX::readStatus(uint8_t number) {
         return 0xff;
     }
     
-    W25QXX_ChipSelect _(this);
+    uint8_t tx[2] = { 0, DUMMY_BYTE };
+    uint8_t rx[2];
 
     switch(number) {
-        case 1: xfer(0x05); break;
-        case 2: xfer(0x35); break;
-        case 3: xfer(0x15); break;
+        case 1: tx[0] = 0x05; break;
+        case 2: tx[0] = 0x35; break;
+        case 3: tx[0] = 0x15; break;
         default: return 0;
     }
     
-    return xfer(DUMMY_BYTE);
+    burst(tx, rx, sizeof(tx));
+    return rx[1];
 }
 
 bool W25QXX::writeStatus(uint8_t number, uint8_t val) {
@@ -244,16 +600,16 @@ bool W25QXX::writeStatus(uint8_t number, uint8_t val) {
         return false;
     }
     
-    W25QXX_ChipSelect _(this);
+    uint8_t tx[2] = { 0, val };
 
     switch(number) {
-        case 1: xfer(0x01); break;
-        case 2: xfer(0x31); break;
-        case 3: xfer(0x11); break;
+        case 1: tx[0] = 0x01; break;
+        case 2: tx[0] = 0x31; break;
+        case 3: tx[0] = 0x11; break;
         default: return false;
     }
     
-    xfer(val);
+    burst(tx, nullptr, sizeof(tx));
     return true;
 }
 
@@ -264,13 +620,18 @@ void W25QXX::waitForWrite() {
     
     W25QXX_ChipSelect _(this);
 
-    uint8_t status = 0xff;
-    xfer(0x05);
-    do {
+    // --> the first poll goes with the command.
+    const uint8_t tx[2] = { 0x05, DUMMY_BYTE };
+    uint8_t rx[2];
+
+    burst(tx, rx, sizeof(tx));
+
+    uint8_t status = rx[1];
+    while((status & 0x01) != 0) {
         status = xfer(DUMMY_BYTE);
     }
 
-    while((status & 0x01) != 0);
+    _wip = false;
 }
 
 void W25QXX::eraseChip() {
@@ -287,36 +648,95 @@ void W25QXX::eraseChip() {
 
         xfer(0xc7);
     }
+
+    cacheClear();
     
     waitForWrite();
     disableWrite();
 }
 
-void W25QXX::xferAddr(uint32_t addr) {
-    W25QXX_ChipSelect _(this);
-
-    if (_bcnt > 256) {
-        xfer((addr >> 24) & 0xff);
-    }
-
-    xfer((addr >> 16) & 0xff);
-    xfer((addr >> 8) & 0xff);
-    xfer((addr >> 0) & 0xff);
-}
+uint32_t W25QXX::header(uint8_t* buf, uint8_t cmd, uint32_t addr, bool dummy) const {
+    uint32_t len = 0;
 
-uint8_t W25QXX::xferCmd(uint8_t cmd) {
-    if (_bcnt > 256) {
+    if (_geo.addrMode == EW25A_4B_OPCODES) {
         switch(cmd) {
             case 0x02: cmd = 0x12; break; // write
             case 0x03: cmd = 0x13; break; // read
             case 0x0b: cmd = 0x0c; break; // fast-read.
-            case 0x20: cmd = 0x21; break; // erase sector
-            case 0xd8: cmd = 0xdc; break; // erase block
-            default: break;
+            case 0x3b: cmd = 0x3c; break; // dual output.
+            case 0x6b: cmd = 0x6c; break; // quad output.
+
+            default:
+                // --> erase types.
+                for(const SW25QErase& each : _geo.erases) {
+                    if (each.shift && each.opcode == cmd) {
+                        cmd = each.opcode4;
+                        break;
+                    }
+                }
+                break;
+        }
+    }
+
+    buf[len++] = cmd;
+
+    if (_geo.addrMode != EW25A_3B) {
+        buf[len++] = (addr >> 24) & 0xff;
+    }
+
+    buf[len++] = (addr >> 16) & 0xff;
+    buf[len++] = (addr >> 8) & 0xff;
+    buf[len++] = (addr >> 0) & 0xff;
+
+    if (dummy) {
+        buf[len++] = 0x00; // --> 0x0b, 0x0c requires dummy byte.
+    }
+
+    return len;
+}
+
+uint32_t W25QXX::transact(uint8_t cmd, uint32_t addr, bool dummy, const uint8_t* tx, uint8_t* rx, uint32_t len) {
+    W25QXX_ChipSelect _(this);
+
+    uint8_t frame[HEADER_MAX + INLINE_MAX];
+    const uint32_t head = header(frame, cmd, addr, dummy);
+
+    // --> short payload: a burst with the header.
+    if (len <= INLINE_MAX) {
+        if (tx) {
+            memcpy(frame + head, tx, len);
+        }
+
+        else {
+            memset(frame + head, DUMMY_BYTE, len);
+        }
+
+        if (!rx) {
+            burst(frame, nullptr, head + len);
+            return len;
         }
+
+        uint8_t in[HEADER_MAX + INLINE_MAX];
+
+        burst(frame, in, head + len);
+        memcpy(rx, in + head, len);
+        return len;
+    }
+
+    burst(frame, nullptr, head);
+
+    if (rx) {
+        return spi_read_blocking(_dev, DUMMY_BYTE, rx, len);
     }
 
-    return xfer(cmd);
+    return spi_write_blocking(_dev, tx, len);
+}
+
+void W25QXX::beginFrame(uint8_t cmd, uint32_t addr, bool dummy) {
+    uint8_t frame[HEADER_MAX];
+
+    select();
+    burst(frame, nullptr, header(frame, cmd, addr, dummy));
 }
 
 bool W25QXX::eraseSector(uint32_t sector) {
@@ -330,13 +750,8 @@ bool W25QXX::eraseSector(uint32_t sector) {
     waitForWrite();
     enableWrite();
 
-    // --
-    {
-        W25QXX_ChipSelect _(this);
-
-        xferCmd(0x20);
-        xferAddr(sector);
-    }
+    transact(eraseOf(SECTOR_SIZE)->opcode, sector, false, nullptr, nullptr, 0);
+    cacheInvalidate(sector, SECTOR_SIZE);
     
     waitForWrite();
     disableWrite();
@@ -349,17 +764,21 @@ bool W25QXX::eraseBlock(uint32_t block) {
         return false;
     }
 
+    const SW25QErase* erase = eraseOf(BLOCK_SIZE);
+    if (!erase) {
+        for(uint32_t i = 0; i < BLOCK_SIZE / SECTOR_SIZE; ++i) {
+            eraseSector(block * (BLOCK_SIZE / SECTOR_SIZE) + i);
+        }
+
+        return true;
+    }
+
     block *= BLOCK_SIZE;
     waitForWrite();
     enableWrite();
 
-    // --
-    {
-        W25QXX_ChipSelect _(this);
-
-        xferCmd(0xd8);
-        xferAddr(block);
-    }
+    transact(erase->opcode, block, false, nullptr, nullptr, 0);
+    cacheInvalidate(block, BLOCK_SIZE);
     
     waitForWrite();
     disableWrite();
@@ -375,14 +794,8 @@ bool W25QXX::writeByte(uint32_t addr, uint8_t val) {
     waitForWrite();
     enableWrite();
 
-    {
-        W25QXX_ChipSelect _(this);
-
-        xferCmd(0x02);
-        xferAddr(addr);
-
-        xfer(val);
-    }
+    transact(0x02, addr, false, &val, nullptr, 1);
+    cacheInvalidate(addr, 1);
 
     waitForWrite();
     disableWrite();
@@ -434,14 +847,8 @@ uint32_t W25QXX::writePage(uint32_t page, uint32_t offset, const uint8_t* buf, u
     waitForWrite();
     enableWrite();
 
-    {
-        W25QXX_ChipSelect _(this);
-
-        xferCmd(0x02);
-        xferAddr(page);
-
-        len = xmit(buf, len);
-    }
+    len = transact(0x02, page, false, buf, nullptr, len);
+    cacheInvalidate(page, len);
 
     waitForWrite();
     disableWrite();
@@ -484,16 +891,8 @@ bool W25QXX::readByte(uint32_t addr, uint8_t* val) {
         return false;
     }
 
-    W25QXX_ChipSelect _(this);
-
-    xferCmd(W25QXX_READ_CMD);
-    xferAddr(addr);
-
-    if (W25QXX_IS_FASTMODE) {
-        xfer(0x00); // --> 0x0b, 0x0c requires dummy byte.
-    }
-
-    uint8_t temp = xfer(DUMMY_BYTE);
+    uint8_t temp;
+    read(addr, &temp, 1);
 
     if (val) {
         *val = temp;
@@ -513,59 +912,1023 @@ uint32_t W25QXX::read(uint32_t addr, uint8_t* buf, uint32_t len) {
         len = cap - addr;
     }
 
-    W25QXX_ChipSelect _(this);
+#if W25QXX_CACHE_SETS > 0
+    if (_cacheOn && len <= W25QXX_CACHE_BYPASS) {
+        for(uint32_t done = 0; done < len; ) {
+            const uint32_t offset = (addr + done) % PAGE_SIZE;
+            const uint8_t* page = cachePage((addr + done) / PAGE_SIZE);
+            uint32_t slice = PAGE_SIZE - offset;
+
+            if (slice > len - done) {
+                slice = len - done;
+            }
 
-    xferCmd(W25QXX_READ_CMD);
-    xferAddr(addr);
+            memcpy(buf + done, page + offset, slice);
+            done += slice;
+        }
 
-    if (W25QXX_IS_FASTMODE) {
-        xfer(0x00); // --> 0x0b, 0x0c requires dummy byte.
+        return len;
     }
+#endif
 
-    return xfer(buf, len);
+    return readChip(addr, buf, len);
 }
 
-uint32_t W25QXX::readPage(uint32_t page, uint32_t offset, uint8_t* buf, uint32_t len) {
-    if (page >= pageMax() || offset >= PAGE_SIZE || len <= 0) {
+uint32_t W25QXX::readUncached(uint32_t addr, uint8_t* buf, uint32_t len) {
+    const uint32_t cap = capacity();
+
+    if (addr >= cap || len <= 0) {
         return 0;
     }
 
-    if (len > PAGE_SIZE - offset) {
-        len = PAGE_SIZE - offset;
+    if (len > cap - addr) {
+        len = cap - addr;
     }
-    
-    page *= PAGE_SIZE;
-    page += offset;
 
-    return read(page, buf, len);
+    return readChip(addr, buf, len);
 }
 
-uint32_t W25QXX::readSector(uint32_t sector, uint32_t offset, uint8_t* buf, uint32_t len) {
-    if (sector >= sectorMax() || offset >= SECTOR_SIZE || len <= 0) {
-        return 0;
+uint32_t W25QXX::readChip(uint32_t addr, uint8_t* buf, uint32_t len) {
+    const bool suspended = suspendWrite(addr, len);
+
+#if W25QXX_DISABLE_PIO == 0
+    if (_pio && len >= W25QXX_PIO_MIN) {
+        len = pioRead(addr, buf, len);
     }
 
-    if (len > SECTOR_SIZE - offset) {
-        len = SECTOR_SIZE - offset;
+    else
+#endif
+    {
+        len = transact(W25QXX_READ_CMD, addr, W25QXX_IS_FASTMODE, nullptr, buf, len);
     }
-    
-    sector *= SECTOR_SIZE;
-    sector += offset;
 
-    return read(sector, buf, len);
+    if (suspended) {
+        resumeWrite();
+    }
+
+    return len;
 }
 
-uint32_t W25QXX::readBlock(uint32_t block, uint32_t offset, uint8_t* buf, uint32_t len) {
-    if (block >= _bcnt || offset >= BLOCK_SIZE || len <= 0) {
-        return 0;
+bool W25QXX::enableCache(bool val) {
+#if W25QXX_CACHE_SETS > 0
+    if (_cacheOn != val) {
+        cacheClear();
+        _cacheOn = val;
     }
 
-    if (len > BLOCK_SIZE - offset) {
-        len = BLOCK_SIZE - offset;
-    }
-    
-    block *= BLOCK_SIZE;
-    block += offset;
-    
+    return _cacheOn;
+#else
+    (void) val;
+    return false;
+#endif
+}
+
+const uint8_t* W25QXX::cachePage(uint32_t page) {
+#if W25QXX_CACHE_SETS > 0
+    SW25QCacheLine* set = _cache[page % W25QXX_CACHE_SETS];
+    SW25QCacheLine* victim = &set[0];
+
+    for(uint32_t i = 0; i < W25QXX_CACHE_WAYS; ++i) {
+        SW25QCacheLine& each = set[i];
+
+        if (each.page == page) {
+            each.stamp = ++_cacheTick;
+            _cacheHits++;
+            return each.data;
+        }
+
+        // --> an empty one first, then the least recent one.
+        if (victim->page != INVALID_PAGE && (each.page == INVALID_PAGE || each.stamp < victim->stamp)) {
+            victim = &each;
+        }
+    }
+
+    _cacheMisses++;
+    readChip(page * PAGE_SIZE, victim->data, PAGE_SIZE);
+
+    victim->page = page;
+    victim->stamp = ++_cacheTick;
+    return victim->data;
+#else
+    (void) page;
+    return nullptr;
+#endif
+}
+
+bool W25QXX::cacheCopy(uint32_t addr, uint8_t* buf, uint32_t len) {
+#if W25QXX_CACHE_SETS > 0
+    if (!_cacheOn || len > W25QXX_CACHE_BYPASS) {
+        return false;
+    }
+
+    const uint32_t first = addr / PAGE_SIZE;
+    const uint32_t last = (addr + len - 1) / PAGE_SIZE;
+
+    // --> all or nothing: a miss would block.
+    for(uint32_t page = first; page <= last; ++page) {
+        const SW25QCacheLine* set = _cache[page % W25QXX_CACHE_SETS];
+        bool cached = false;
+
+        for(uint32_t i = 0; !cached && i < W25QXX_CACHE_WAYS; ++i) {
+            cached = set[i].page == page;
+        }
+
+        if (!cached) {
+            return false;
+        }
+    }
+
+    read(addr, buf, len);
+    return true;
+#else
+    (void) addr; (void) buf; (void) len;
+    return false;
+#endif
+}
+
+void W25QXX::cacheClear() {
+#if W25QXX_CACHE_SETS > 0
+    for(SW25QCacheLine (&set)[W25QXX_CACHE_WAYS] : _cache) {
+        for(SW25QCacheLine& each : set) {
+            each.page = INVALID_PAGE;
+        }
+    }
+#endif
+}
+
+void W25QXX::cacheInvalidate(uint32_t addr, uint32_t len) {
+#if W25QXX_CACHE_SETS > 0
+    const uint32_t first = addr / PAGE_SIZE;
+    const uint32_t last = len ? (addr + (len - 1)) / PAGE_SIZE : first;
+
+    for(SW25QCacheLine (&set)[W25QXX_CACHE_WAYS] : _cache) {
+        for(SW25QCacheLine& each : set) {
+            if (each.page >= first && each.page <= last) {
+                each.page = INVALID_PAGE;
+            }
+        }
+    }
+#else
+    (void) addr; (void) len;
+#endif
+}
+
+#if W25QXX_DISABLE_PIO == 0
+/**
+ * The read program, SPI mode 3: SCK on the side-set, 2 instructions per clock.
+ * The SPI sends the opcode and the address, then this clocks the dummy cycles and
+ * samples the IO pins at each falling edge: the flash shifts the next bits out
+ * after it, so the synchronized pins still hold the current ones.
+ *
+ *  .side_set 1
+ *  .wrap_target
+ *      pull            side 1      ; x = dummy clocks.
+ *      mov x, osr      side 1
+ *      pull            side 1      ; y = data clocks - 1.
+ *      mov y, osr      side 1
+ *  skip:
+ *      nop             side 0      ; the dummy clocks, and the first falling edge.
+ *      jmp x--, skip   side 1
+ *  loop:
+ *      in pins, N      side 0      ; N = 4 or 8 pins from the lowest IO, autopush at 32 bits.
+ *      jmp y--, loop   side 1
+ *  .wrap
+ */
+static const uint16_t W25QXX_PIO_READ[] = {
+    0x90a0, 0xb027, 0x90a0, 0xb047,
+    0xa042, 0x1044,
+    0x4000, 0x1086,
+};
+
+static constexpr uint32_t W25QXX_PIO_LEN = sizeof(W25QXX_PIO_READ) / sizeof(uint16_t);
+static constexpr uint32_t W25QXX_PIO_IN = 6;   // --> `in pins, N`.
+#endif
+
+bool W25QXX::enablePio(PIO pio, uint8_t io2, uint8_t io3) {
+#if W25QXX_DISABLE_PIO == 0
+    if (!_bcnt || !pio) {
+        return false;
+    }
+
+    disablePio();
+    waitForWrite();
+
+    const uint8_t check = tryPio(pio, io2, io3, 0, PIO_CHECK_SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+
+    // --> a fresh or erased chip: nothing to check the wiring on yet.
+    if (check == EW25P_BLANK) {
+        _pioRetry = pio;
+        _pioIo2 = io2;
+        _pioIo3 = io3;
+    }
+
+    return check == EW25P_OK;
+#else
+    (void) pio; (void) io2; (void) io3;
+    return false;
+#endif
+}
+
+void W25QXX::disablePio() {
+#if W25QXX_DISABLE_PIO == 0
+    if (!_pio) {
+        return;
+    }
+
+    const pio_program_t program = { W25QXX_PIO_READ, uint8_t(W25QXX_PIO_LEN), -1 };
+
+    pio_sm_set_enabled(_pio, _pioSm, false);
+    pio_remove_program(_pio, &program, _pioOffset);
+    pio_sm_unclaim(_pio, _pioSm);
+
+    _pio = nullptr;
+    _pioSm = -1;
+    _pioLines = 0;
+#endif
+
+    _pioRetry = nullptr;
+}
+
+#if W25QXX_DISABLE_PIO == 0
+bool W25QXX::startPio(PIO pio, const uint8_t* io, uint8_t lines) {
+    const SW25QRead& mode = _geo.reads[lines == 4 ? EW25R_QUAD_OUT : EW25R_DUAL_OUT];
+    if (!mode.opcode) {
+        return false;
+    }
+
+    // --> the pins are sampled from the lowest IO, 8 at most.
+    uint8_t lo = io[0], hi = io[0];
+    for(uint8_t i = 1; i < lines; ++i) {
+        lo = io[i] < lo ? io[i] : lo;
+        hi = io[i] > hi ? io[i] : hi;
+    }
+
+    if (hi - lo >= 8) {
+        return false;
+    }
+
+    uint16_t code[W25QXX_PIO_LEN];
+    const pio_program_t program = { code, uint8_t(W25QXX_PIO_LEN), -1 };
+    const uint8_t bits = hi - lo < 4 ? 4 : 8;
+
+    memcpy(code, W25QXX_PIO_READ, sizeof(code));
+    code[W25QXX_PIO_IN] |= bits;
+
+    if (!pio_can_add_program(pio, &program)) {
+        return false;
+    }
+
+    const int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+
+    _pio = pio;
+    _pioSm = int8_t(sm);
+    _pioOffset = uint8_t(pio_add_program(pio, &program));
+    _pioLines = lines;
+    _pioBits = bits;
+    _pioCmd = mode.opcode;
+    _pioDummy = mode.dummy;
+
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, _pioOffset, _pioOffset + W25QXX_PIO_LEN - 1);
+    sm_config_set_sideset(&config, 1, false, false);
+    sm_config_set_sideset_pins(&config, _clk);
+    sm_config_set_in_pins(&config, lo);
+    sm_config_set_in_shift(&config, false, true, 32);
+
+    // --> 2 instructions per clock, at most the tuned clock: the wiring passed it.
+    const uint64_t rate = 2ull * _baud;
+    uint64_t div = (uint64_t(clock_get_hz(clk_sys)) * 256 + rate - 1) / rate;
+    if (div < 256) {
+        div = 256;
+    }
+
+    sm_config_set_clkdiv_int_frac(&config, uint16_t(div >> 8), uint8_t(div & 0xff));
+    pio_sm_init(pio, sm, _pioOffset, &config);
+
+    // --> SCK idles high, the IO pins are driven by the flash.
+    pio_sm_set_pins_with_mask(pio, sm, 1u << _clk, 1u << _clk);
+    pio_sm_set_consecutive_pindirs(pio, sm, _clk, 1, true);
+    for(uint8_t i = 0; i < lines; ++i) {
+        pio_sm_set_consecutive_pindirs(pio, sm, io[i], 1, false);
+    }
+
+    // --> IO2 and IO3 stay on the PIO, SCK and IO0 are switched for each read.
+    for(uint8_t i = 2; i < lines; ++i) {
+        pio_gpio_init(pio, io[i]);
+    }
+
+    pio_sm_set_enabled(pio, sm, true);
+
+    // --> the sampled byte to the data bits: the first clock upper, IO3..IO0 in a clock.
+    const uint8_t clocks = 8 / bits;
+    for(uint32_t raw = 0; raw < 256; ++raw) {
+        uint8_t data = 0;
+
+        for(uint8_t c = 0; c < clocks; ++c) {
+            const uint32_t sample = raw >> (8 - bits * (c + 1));
+
+            for(uint8_t k = lines; k-- > 0; ) {
+                data = uint8_t((data << 1) | ((sample >> (io[k] - lo)) & 1));
+            }
+        }
+
+        _pioDecode[raw] = data;
+    }
+
+    return true;
+}
+
+uint8_t W25QXX::tryPio(PIO pio, uint8_t io2, uint8_t io3, uint32_t addr, uint32_t len, uint32_t stride) {
+    const uint8_t io[4] = { _mosi, _miso, io2, io3 };
+
+    // --> 1-1-4 if IO2 and IO3 are wired.
+    if (io2 != NO_PIN && io3 != NO_PIN && _geo.reads[EW25R_QUAD_OUT].opcode && enableQuad()) {
+        const uint8_t check = startPio(pio, io, 4) ? checkPio(addr, len, stride) : uint8_t(EW25P_FAIL);
+        if (check != EW25P_FAIL) {
+            if (check == EW25P_BLANK) {
+                disablePio();
+            }
+
+            return check;
+        }
+
+        disablePio();
+    }
+
+    // --> 1-1-2 on MOSI and MISO.
+    const uint8_t check = startPio(pio, io, 2) ? checkPio(addr, len, stride) : uint8_t(EW25P_FAIL);
+    if (check != EW25P_OK) {
+        disablePio();
+    }
+
+    return check;
+}
+
+uint8_t W25QXX::checkPio(uint32_t addr, uint32_t len, uint32_t stride) {
+    uint8_t ref[CLOCK_CHECK_LEN];
+    uint8_t buf[CLOCK_CHECK_LEN];
+
+    // --> at most the sectors of the enable searched, wherever the range is.
+    for(uint32_t n = 0, at = addr; n < PIO_CHECK_SECTORS && at - addr < len && at < capacity(); ++n, at += stride) {
+        bool blank = true;
+
+        transact(0x0b, at, true, nullptr, ref, sizeof(ref));
+        for(uint32_t i = 0; i < sizeof(ref) && blank; ++i) {
+            blank = ref[i] == 0xff;
+        }
+
+        // --> the undriven lines read ones: a blank range proves nothing.
+        if (blank) {
+            continue;
+        }
+
+        for(uint32_t i = 0; i < CLOCK_CHECKS; ++i) {
+            if (pioRead(at, buf, sizeof(buf)) != sizeof(buf) || memcmp(buf, ref, sizeof(ref)) != 0) {
+                return EW25P_FAIL;
+            }
+        }
+
+        return EW25P_OK;
+    }
+
+    return EW25P_BLANK;
+}
+
+void W25QXX::retryPio(uint32_t addr, uint32_t len) {
+    const PIO pio = _pioRetry;
+
+    if (!pio) {
+        return;
+    }
+
+    // --> cleared by the try, kept again if the range programmed was all 0xff.
+    if (tryPio(pio, _pioIo2, _pioIo3, addr, len, CLOCK_CHECK_LEN) == EW25P_BLANK) {
+        _pioRetry = pio;
+    }
+}
+
+bool W25QXX::enableQuad() {
+    uint8_t sr2 = readStatus(2);
+
+    // --> the other vendors place QE elsewhere: the check tells if it was set.
+    if ((_id >> 16) == 0xef && !(sr2 & 0x02)) {
+        enableWrite();
+        writeStatus(2, sr2 | 0x02);
+        waitForWrite();
+
+        sr2 = readStatus(2);
+        return (sr2 & 0x02) != 0;
+    }
+
+    return true;
+}
+
+uint32_t W25QXX::pioRead(uint32_t addr, uint8_t* buf, uint32_t len) {
+    W25QXX_ChipSelect _(this);
+    uint8_t frame[HEADER_MAX];
+
+    // --> the opcode and the address on the SPI, SCK idles high after.
+    burst(frame, nullptr, header(frame, _pioCmd, addr, false));
+
+    // --> whole words: 4 sampled bytes each, the bytes past `len` are dropped.
+    const uint32_t step = (8 / _pioBits) * _pioLines;
+    const uint32_t bytes = step / 2;
+    const uint32_t words = (len + bytes - 1) / bytes;
+
+    // --> SCK and IO0 to the state machine.
+    pio_gpio_init(_pio, _clk);
+    pio_gpio_init(_pio, _mosi);
+
+    pio_sm_put_blocking(_pio, _pioSm, _pioDummy);
+    pio_sm_put_blocking(_pio, _pioSm, words * (32 / _pioBits) - 1);
+
+    for(uint32_t i = 0, n = 0; i < words; ++i) {
+        const uint32_t word = pio_sm_get_blocking(_pio, _pioSm);
+        uint32_t data = 0;
+
+        for(int32_t shift = 24; shift >= 0; shift -= 8) {
+            data = (data << step) | _pioDecode[(word >> shift) & 0xff];
+        }
+
+        for(uint32_t b = bytes; b-- > 0 && n < len; ) {
+            buf[n++] = uint8_t(data >> (8 * b));
+        }
+    }
+
+    gpio_set_function(_clk, GPIO_FUNC_SPI);
+    gpio_set_function(_mosi, GPIO_FUNC_SPI);
+    return len;
+}
+#endif
+
+uint32_t W25QXX::readPage(uint32_t page, uint32_t offset, uint8_t* buf, uint32_t len) {
+    if (page >= pageMax() || offset >= PAGE_SIZE || len <= 0) {
+        return 0;
+    }
+
+    if (len > PAGE_SIZE - offset) {
+        len = PAGE_SIZE - offset;
+    }
+    
+    page *= PAGE_SIZE;
+    page += offset;
+
+    return read(page, buf, len);
+}
+
+uint32_t W25QXX::readSector(uint32_t sector, uint32_t offset, uint8_t* buf, uint32_t len) {
+    if (sector >= sectorMax() || offset >= SECTOR_SIZE || len <= 0) {
+        return 0;
+    }
+
+    if (len > SECTOR_SIZE - offset) {
+        len = SECTOR_SIZE - offset;
+    }
+    
+    sector *= SECTOR_SIZE;
+    sector += offset;
+
+    return read(sector, buf, len);
+}
+
+uint32_t W25QXX::readBlock(uint32_t block, uint32_t offset, uint8_t* buf, uint32_t len) {
+    if (block >= _bcnt || offset >= BLOCK_SIZE || len <= 0) {
+        return 0;
+    }
+
+    if (len > BLOCK_SIZE - offset) {
+        len = BLOCK_SIZE - offset;
+    }
+    
+    block *= BLOCK_SIZE;
+    block += offset;
+    
     return read(block, buf, len);
-}
\ No newline at end of file
+}
+
+bool W25QXX::isBusy() {
+    if ((readStatus(1) & 0x01) != 0) {
+        return true;
+    }
+
+    _wip = false;
+    return false;
+}
+
+bool W25QXX::startEraseSector(uint32_t sector) {
+    if (sector >= sectorMax() || isBusy()) {
+        return false;
+    }
+
+    startErase(eraseOf(SECTOR_SIZE), sector * SECTOR_SIZE);
+    return true;
+}
+
+void W25QXX::startErase(const SW25QErase* erase, uint32_t addr) {
+    enableWrite();
+
+    transact(erase->opcode, addr, false, nullptr, nullptr, 0);
+    cacheInvalidate(addr, 1u << erase->shift);
+    _wip = true;
+    _wipAddr = addr;
+    _wipLen = 1u << erase->shift;
+}
+
+bool W25QXX::suspendWrite(uint32_t addr, uint32_t len) {
+    if (!_wip || _suspended) {
+        return false;
+    }
+
+    // --> the region under the erase or program reads undefined while suspended.
+    if (addr < _wipAddr + _wipLen && _wipAddr < addr + len) {
+        waitForWrite();
+        return false;
+    }
+
+#if W25QXX_DISABLE_SUSPEND == 0
+    if (!isBusy()) {
+        return false;
+    }
+
+    // --> tRS: the chip ignores the suspend right after the resume.
+    const uint64_t now = time_us_64();
+    if (now < _resumedAt + W25QXX_RESUME_GAP) {
+        sleep_us(_resumedAt + W25QXX_RESUME_GAP - now);
+    }
+
+    xfer(0x75);
+
+    // --> tSUS: BUSY clears when suspended, or completed meanwhile.
+    while ((readStatus(1) & 0x01) != 0);
+
+    _suspended = (readStatus(2) & 0x80) != 0;
+    _wip = _suspended;
+    return _suspended;
+#else
+    waitForWrite();
+    return false;
+#endif
+}
+
+void W25QXX::resumeWrite() {
+    xfer(0x7a);
+
+    _suspended = false;
+    _resumedAt = time_us_64();
+}
+
+uint32_t W25QXX::startWritePage(uint32_t page, uint32_t offset, const uint8_t* buf, uint32_t len) {
+    if (page >= pageMax() || offset >= PAGE_SIZE || len <= 0 || isBusy()) {
+        return 0;
+    }
+
+    if (len > PAGE_SIZE - offset) {
+        len = PAGE_SIZE - offset;
+    }
+
+    enableWrite();
+
+    len = transact(0x02, page * PAGE_SIZE + offset, false, buf, nullptr, len);
+    cacheInvalidate(page * PAGE_SIZE + offset, len);
+    _wip = true;
+    _wipAddr = page * PAGE_SIZE + offset;
+    _wipLen = len;
+
+    return len;
+}
+
+bool W25QXX::enableDma() {
+#if W25QXX_DISABLE_DMA == 0
+    if (!_dev || isDmaEnabled()) {
+        return isDmaEnabled();
+    }
+
+    const int tx = dma_claim_unused_channel(false);
+    const int rx = dma_claim_unused_channel(false);
+
+    if (tx < 0 || rx < 0) {
+        if (tx >= 0) {
+            dma_channel_unclaim(tx);
+        }
+
+        if (rx >= 0) {
+            dma_channel_unclaim(rx);
+        }
+
+        return false;
+    }
+
+    _dmaTx = int8_t(tx);
+    _dmaRx = int8_t(rx);
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint32_t W25QXX::readAsync(uint32_t addr, uint8_t* buf, uint32_t len, W25QXXCb cb, void* ctx) {
+    const uint32_t cap = capacity();
+
+    if (_xfer || addr >= cap || len <= 0) {
+        return 0;
+    }
+
+    if (len > cap - addr) {
+        len = cap - addr;
+    }
+
+    if (cacheCopy(addr, buf, len)) {
+        if (cb) {
+            cb(this, len, ctx);
+        }
+
+        return len;
+    }
+
+#if W25QXX_DISABLE_DMA == 0
+    if (isDmaEnabled()) {
+        _xferResume = suspendWrite(addr, len);
+
+        // --> kept selected until completed.
+        beginFrame(W25QXX_READ_CMD, addr, W25QXX_IS_FASTMODE);
+
+        _xferLen = len;
+        _xferCb = cb;
+        _xferCtx = ctx;
+
+        startDma(nullptr, buf, len);
+        return len;
+    }
+#endif
+
+    len = read(addr, buf, len);
+    if (cb) {
+        cb(this, len, ctx);
+    }
+
+    return len;
+}
+
+uint32_t W25QXX::writePageAsync(uint32_t page, uint32_t offset, const uint8_t* buf, uint32_t len, W25QXXCb cb, void* ctx) {
+    if (_xfer || page >= pageMax() || offset >= PAGE_SIZE || len <= 0) {
+        return 0;
+    }
+
+    if (len > PAGE_SIZE - offset) {
+        len = PAGE_SIZE - offset;
+    }
+
+#if W25QXX_DISABLE_DMA == 0
+    if (isDmaEnabled()) {
+        if (isBusy()) {
+            return 0;
+        }
+
+        enableWrite();
+
+        // --> kept selected until completed, the program starts then.
+        beginFrame(0x02, page * PAGE_SIZE + offset);
+        cacheInvalidate(page * PAGE_SIZE + offset, len);
+        _wip = true;
+        _wipAddr = page * PAGE_SIZE + offset;
+        _wipLen = len;
+
+        _xferLen = len;
+        _xferCb = cb;
+        _xferCtx = ctx;
+
+        startDma(buf, nullptr, len);
+        return len;
+    }
+#endif
+
+    len = startWritePage(page, offset, buf, len);
+    if (len && cb) {
+        cb(this, len, ctx);
+    }
+
+    return len;
+}
+
+bool W25QXX::updateOnce() {
+    if (!_xfer) {
+        return false;
+    }
+
+#if W25QXX_DISABLE_DMA == 0
+    if (dma_channel_is_busy(_dmaRx)) {
+        return true;
+    }
+#endif
+
+    completeXfer();
+    return false;
+}
+
+void W25QXX::waitForXfer() {
+    if (!_xfer) {
+        return;
+    }
+
+#if W25QXX_DISABLE_DMA == 0
+    dma_channel_wait_for_finish_blocking(_dmaRx);
+#endif
+
+    completeXfer();
+}
+
+void W25QXX::startDma(const uint8_t* src, uint8_t* dst, uint32_t len) {
+#if W25QXX_DISABLE_DMA == 0
+    volatile void* dr = &spi_get_hw(_dev)->dr;
+
+    // --> TX: memory to SPI, paced by the TX FIFO.
+    dma_channel_config tx = dma_channel_get_default_config(_dmaTx);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_8);
+    channel_config_set_read_increment(&tx, src != nullptr);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_dreq(&tx, spi_get_dreq(_dev, true));
+
+    // --> RX: SPI to memory, paced by the RX FIFO.
+    dma_channel_config rx = dma_channel_get_default_config(_dmaRx);
+    channel_config_set_transfer_data_size(&rx, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx, false);
+    channel_config_set_write_increment(&rx, dst != nullptr);
+    channel_config_set_dreq(&rx, spi_get_dreq(_dev, false));
+
+    dma_channel_configure(_dmaTx, &tx, dr, src ? src : &_xferDummy, len, false);
+    dma_channel_configure(_dmaRx, &rx, dst ? dst : &_xferSink, dr, len, false);
+
+    // --> start both at once, RX never misses a byte.
+    _xfer = true;
+    dma_start_channel_mask((1u << _dmaTx) | (1u << _dmaRx));
+#else
+    (void) src; (void) dst; (void) len;
+#endif
+}
+
+void W25QXX::completeXfer() {
+    W25QXXCb cb = _xferCb;
+
+    _xfer = false;
+    _xferCb = nullptr;
+
+    deselect();
+
+    if (_xferResume) {
+        _xferResume = false;
+        resumeWrite();
+    }
+
+    if (cb) {
+        cb(this, _xferLen, _xferCtx);
+    }
+}
+
+bool W25QXX::startJob(uint32_t addr, const uint8_t* buf, uint32_t len, bool erase) {
+    if (isJobRunning()) {
+        return false;
+    }
+
+    const uint32_t cap = capacity();
+    if (addr >= cap || len > cap - addr || (len && !buf)) {
+        _job = EW25J_FAIL;
+        return false;
+    }
+
+    // --> sectors which cover the range.
+    _jobErase = _jobEraseBegin = _jobEraseDone = addr & ~(SECTOR_SIZE - 1);
+    _jobEraseEnd = (erase && len > 0) ? ((addr + len + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1)) : _jobErase;
+
+    _jobBegin = _jobAddr = _jobCompare = addr;
+    _jobBuf = buf;
+    _jobLen = len;
+    _jobUpdate = EW25U_NONE;
+    _jobUnit = addr / DIFFER_UNIT;
+
+    memset(_jobDiffer, 0, sizeof(_jobDiffer));
+
+    _job = EW25J_ERASE;
+    return true;
+}
+
+bool W25QXX::startUpdate(uint32_t addr, const uint8_t* buf, uint32_t len) {
+    if (!startJob(addr, buf, len, true)) {
+        return false;
+    }
+
+    // --> same as the flash until a difference found.
+    _jobUpdate = EW25U_SKIP;
+    _job = EW25J_COMPARE;
+    return true;
+}
+
+bool W25QXX::eraseRange(uint32_t addr, uint32_t len) {
+    // --> an erase only job.
+    if (!startJob(addr, nullptr, 0, false)) {
+        return false;
+    }
+
+    if (len > capacity() - addr) {
+        _job = EW25J_FAIL;
+        return false;
+    }
+
+    // --> an empty range covers no sector: done with no erase.
+    if (len > 0) {
+        _jobEraseEnd = (addr + len + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+    }
+
+    return true;
+}
+
+const SW25QErase* W25QXX::planErase(uint32_t addr, uint32_t end) const {
+    // --> from the largest, ascending in the table.
+    for(uint32_t i = 4; i-- > 0; ) {
+        const SW25QErase& each = _geo.erases[i];
+        const uint32_t size = each.shift ? (1u << each.shift) : 0;
+
+        if (size && (addr & (size - 1)) == 0 && size <= end - addr) {
+            return &each;
+        }
+    }
+
+    return eraseOf(SECTOR_SIZE);
+}
+
+uint8_t W25QXX::stepJob() {
+    if (!isJobRunning()) {
+        return _job;
+    }
+
+    // --> the previous transfer or command is still running.
+    if (updateOnce() || isBusy()) {
+        return _job;
+    }
+
+    if (_job == EW25J_COMPARE) {
+        compareJob();
+        return _job;
+    }
+
+    if (_job == EW25J_ERASE) {
+        // --> the chip is idle: the erases issued so far completed.
+        _jobEraseDone = _jobErase;
+
+        if (_jobErase < _jobEraseEnd) {
+            const SW25QErase* erase = planErase(_jobErase, _jobEraseEnd);
+
+            startErase(erase, _jobErase);
+            _jobErase += 1u << erase->shift;
+            return _job;
+        }
+
+        _job = EW25J_PROGRAM;
+    }
+
+    // --> update: skip the bytes same as the flash, a skip a step.
+    if (const uint32_t same = sameBytes()) {
+        _jobAddr += same;
+        _jobBuf += same;
+        _jobLen -= same;
+
+        return _job;
+    }
+
+    if (_jobLen) {
+        const uint32_t offset = _jobAddr % PAGE_SIZE;
+        uint32_t slice = jobSlice(_jobAddr, _jobLen);
+
+        slice = writePageAsync(_jobAddr / PAGE_SIZE, offset, _jobBuf, slice);
+
+        _jobAddr += slice;
+        _jobBuf += slice;
+        _jobLen -= slice;
+
+        return _job;
+    }
+
+    // --> the last program completed.
+    _job = EW25J_DONE;
+    _jobBuf = nullptr;
+
+#if W25QXX_DISABLE_PIO == 0
+    // --> data on the chip now: the check deferred by a blank chip runs on it.
+    retryPio(_jobBegin, _jobAddr - _jobBegin);
+#endif
+
+    return _job;
+}
+
+uint32_t W25QXX::jobSlice(uint32_t addr, uint32_t left) const {
+    uint32_t slice = PAGE_SIZE - addr % PAGE_SIZE;
+
+    // --> DMA transfers don't block, so a page at once.
+    if (!isDmaEnabled() && slice > W25QXX_JOB_CHUNK) {
+        slice = W25QXX_JOB_CHUNK;
+    }
+
+    return slice > left ? left : slice;
+}
+
+void W25QXX::compareJob() {
+    const uint32_t offset = _jobCompare - _jobAddr;
+    const uint32_t left = _jobLen - offset;
+
+    if (left) {
+        uint8_t temp[PAGE_SIZE];
+        const uint32_t slice = jobSlice(_jobCompare, left);
+        const uint8_t* src = _jobBuf + offset;
+
+        const uint32_t at = _jobCompare;
+
+        read(at, temp, slice);
+        _jobCompare += slice;
+
+        for(uint32_t i = 0; i < slice; ++i) {
+            if (temp[i] == src[i]) {
+                continue;
+            }
+
+            // --> kept for the program: the same units are never read again.
+            const uint32_t unit = (at + i) / DIFFER_UNIT - _jobUnit;
+            if (unit < DIFFER_UNITS) {
+                _jobDiffer[unit / 32] |= 1u << (unit % 32);
+            }
+
+            _jobUpdate = EW25U_PROGRAM;
+
+            // --> a bit to raise 0 -> 1: erase, no more to compare.
+            if (src[i] & ~temp[i]) {
+                _jobUpdate = EW25U_ERASE;
+                _job = EW25J_ERASE;
+
+                // --> the sectors out of the range would be erased too: nothing written.
+                if (((_jobAddr | (_jobAddr + _jobLen)) & (SECTOR_SIZE - 1)) != 0) {
+                    _job = EW25J_FAIL;
+                    _jobBuf = nullptr;
+                }
+
+                return;
+            }
+        }
+
+        if (_jobCompare < _jobAddr + _jobLen) {
+            return;
+        }
+    }
+
+    if (_jobUpdate == EW25U_SKIP) {
+        _job = EW25J_DONE;
+        _jobBuf = nullptr;
+        return;
+    }
+
+    // --> in place, no erase.
+    _jobEraseEnd = _jobErase;
+    _job = EW25J_ERASE;
+}
+
+uint32_t W25QXX::sameBytes() const {
+    if (!_jobLen) {
+        return 0;
+    }
+
+    if (_jobUpdate == EW25U_ERASE) {
+        const uint32_t slice = jobSlice(_jobAddr, _jobLen);
+
+        // --> erased: 0xff needs no program.
+        for(uint32_t i = 0; i < slice; ++i) {
+            if (_jobBuf[i] != 0xff) {
+                return 0;
+            }
+        }
+
+        return slice;
+    }
+
+    if (_jobUpdate == EW25U_PROGRAM) {
+        uint32_t same = 0;
+
+        // --> the units the compare found same, bounded by the map.
+        while (same < _jobLen && !isDiffer(_jobAddr + same)) {
+            same += DIFFER_UNIT - (_jobAddr + same) % DIFFER_UNIT;
+        }
+
+        return same > _jobLen ? _jobLen : same;
+    }
+
+    return 0;
+}
+
+bool W25QXX::isDiffer(uint32_t addr) const {
+    const uint32_t unit = addr / DIFFER_UNIT - _jobUnit;
+
+    if (unit >= DIFFER_UNITS) {
+        return true;
+    }
+
+    return (_jobDiffer[unit / 32] & (1u << (unit % 32))) != 0;
+}
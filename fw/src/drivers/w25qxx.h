@@ -3,12 +3,27 @@
 
 #include <stdint.h>
 #include <hardware/spi.h>
+#include <hardware/pio.h>
 
 /**
  * W25QXX SPI flash driver configurations.
  * 1. W25QXX_DISABLE_TEST : strips `test` method out.
  * 2. W25QXX_DEFAULT_FASTMODE : make default operation mode to fast-mode.
  * 3. W25QXX_DISABLE_FASTMODE : strips `fastMode(val)` method out.
+ * 4. W25QXX_JOB_CHUNK : max bytes programmed by a job step, this bounds the step time.
+ * 5. W25QXX_DISABLE_DMA : strips the DMA transfer path out, then the async methods block.
+ * 6. W25QXX_MAX_BAUDRATE : the highest SPI clock `init()` tries, `BAUDRATE` to disable the tuning.
+ * 7. W25QXX_CLOCK_MARGIN : percents below the lowest failed clock, the tuned clock stays under it.
+ * 8. W25QXX_DISABLE_SUSPEND : reads wait for the erase or program in progress instead of suspending it.
+ * 9. W25QXX_RESUME_GAP : microseconds from a resume to the next suspend, tRS (20 us) at least.
+ *    the erase progresses this at least between the reads.
+ * 10. W25QXX_CACHE_SETS : sets of the page cache in front of `read()`, 0 strips it out.
+ * 11. W25QXX_CACHE_WAYS : pages per set, the cache takes SETS * WAYS * 256 bytes.
+ * 12. W25QXX_CACHE_BYPASS : reads longer than this bypass the cache, so streaming never evicts it.
+ * 13. W25QXX_DISABLE_PIO : strips the PIO read path out, then the reads use the SPI only.
+ * 14. W25QXX_PIO_MIN : reads shorter than this use the SPI, the pin switching costs more than it saves.
+ * 15. W25QXX_UPDATE_SPAN : bytes of an update job whose compare is kept, a bit per `W25QXX_JOB_CHUNK`.
+ *    the bytes past it are programmed in place without skipping the same ones.
  */
 #ifndef W25QXX_DISABLE_TEST
 #define W25QXX_DISABLE_TEST 0
@@ -22,9 +37,155 @@
 #define W25QXX_DISABLE_FASTMODE 0
 #endif
 
+#ifndef W25QXX_JOB_CHUNK
+#define W25QXX_JOB_CHUNK 64
+#endif
+
+#ifndef W25QXX_DISABLE_DMA
+#define W25QXX_DISABLE_DMA 0
+#endif
+
+#ifndef W25QXX_MAX_BAUDRATE
+#define W25QXX_MAX_BAUDRATE (62500 * 1000)
+#endif
+
+#ifndef W25QXX_CLOCK_MARGIN
+#define W25QXX_CLOCK_MARGIN 20
+#endif
+
+#ifndef W25QXX_DISABLE_SUSPEND
+#define W25QXX_DISABLE_SUSPEND 0
+#endif
+
+#ifndef W25QXX_RESUME_GAP
+#define W25QXX_RESUME_GAP 50
+#endif
+
+#ifndef W25QXX_CACHE_SETS
+#define W25QXX_CACHE_SETS 8
+#endif
+
+#ifndef W25QXX_CACHE_WAYS
+#define W25QXX_CACHE_WAYS 2
+#endif
+
+#ifndef W25QXX_CACHE_BYPASS
+#define W25QXX_CACHE_BYPASS 1024
+#endif
+
+#ifndef W25QXX_DISABLE_PIO
+#define W25QXX_DISABLE_PIO 0
+#endif
+
+#ifndef W25QXX_PIO_MIN
+#define W25QXX_PIO_MIN 64
+#endif
+
+#ifndef W25QXX_UPDATE_SPAN
+#define W25QXX_UPDATE_SPAN (64 * 1024)
+#endif
+
+/**
+ * State of the asynchronous job.
+ */
+enum EW25QJob {
+    EW25J_IDLE = 0,
+    EW25J_COMPARE,      // --> comparing the range with the buffer.
+    EW25J_ERASE,        // --> erasing sectors.
+    EW25J_PROGRAM,      // --> programming pages.
+    EW25J_DONE,         // --> completed.
+    EW25J_FAIL          // --> rejected or out of range.
+};
+
+/**
+ * Decision of the update job, `W25QXX::updateResult()`.
+ */
+enum EW25QUpdate {
+    EW25U_NONE = 0,     // --> not an update job.
+    EW25U_SKIP,         // --> same as the flash, nothing written.
+    EW25U_PROGRAM,      // --> programmed in place, 1 -> 0 bits only.
+    EW25U_ERASE         // --> erased and programmed.
+};
+
+/**
+ * Result of the check of the PIO reads against the SPI ones.
+ */
+enum EW25QPioCheck {
+    EW25P_BLANK = 0,    // --> no bytes but 0xff to compare: the undriven lines read so too.
+    EW25P_FAIL,         // --> the PIO read other bytes.
+    EW25P_OK
+};
+
+/**
+ * Read modes of the flash, `SW25QGeometry::reads`.
+ * `1-x-y`: lines of the opcode, the address and the data.
+ */
+enum EW25QRead {
+    EW25R_FAST = 0,     // --> 1-1-1, 0x0b.
+    EW25R_DUAL_OUT,     // --> 1-1-2.
+    EW25R_DUAL_IO,      // --> 1-2-2.
+    EW25R_QUAD_OUT,     // --> 1-1-4.
+    EW25R_QUAD_IO,      // --> 1-4-4.
+    EW25R_MAX
+};
+
+/**
+ * Addressing of the flash.
+ */
+enum EW25QAddr {
+    EW25A_3B = 0,       // --> 3-byte address.
+    EW25A_4B_OPCODES,   // --> 4-byte address by the dedicated opcodes.
+    EW25A_4B_MODE       // --> 4-byte address mode, entered by 0xb7.
+};
+
+/**
+ * Erase type of the flash.
+ */
+struct SW25QErase {
+    uint8_t shift;      // --> size = 1 << shift, 0 if not supported.
+    uint8_t opcode;
+    uint8_t opcode4;    // --> opcode with 4-byte address, `EW25A_4B_OPCODES` only.
+};
+
+/**
+ * Read mode of the flash.
+ */
+struct SW25QRead {
+    uint8_t opcode;     // --> 0 if not supported.
+    uint8_t dummy;      // --> wait states and mode clocks.
+};
+
+/**
+ * Geometry of the flash, discovered from the SFDP tables.
+ * The chips without SFDP fall back to the Winbond model table.
+ */
+struct SW25QGeometry {
+    uint32_t capacity;
+    uint16_t pageSize;
+    uint8_t addrMode;                   // --> EW25QAddr.
+    bool sfdp;                          // --> discovered from the SFDP tables.
+    SW25QErase erases[4];               // --> ascending by the size.
+    SW25QRead reads[EW25R_MAX];
+};
+
+/**
+ * A page of the cache.
+ */
+struct SW25QCacheLine {
+    uint32_t page;      // --> page number, 0xffffffff if empty.
+    uint32_t stamp;     // --> last use, the least recent one is evicted.
+    uint8_t data[256];
+};
+
 // --> forward decl.
+class W25QXX;
 class W25QXX_ChipSelect;
 
+/**
+ * Completion callback of the asynchronous transfer.
+ */
+typedef void(* W25QXXCb)(W25QXX* w25qxx, uint32_t len, void* ctx);
+
 /**
  * W25QXX SPI flash driver.
  * --
@@ -35,14 +196,30 @@ class W25QXX_ChipSelect;
 class W25QXX {
     friend class W25QXX_ChipSelect;
 
-private:
+public:
     /**
-     * Constants.
+     * Geometry.
      */
     static constexpr uint32_t PAGE_SIZE = 256;
     static constexpr uint32_t SECTOR_SIZE = 0x1000;
     static constexpr uint32_t BLOCK_SIZE = 0x10000;
+
+    // --> the pin not wired.
+    static constexpr uint8_t NO_PIN = 0xff;
+
+private:
+    /**
+     * Constants.
+     */
     static constexpr uint8_t DUMMY_BYTE = 0xa5;
+
+    /**
+     * Transaction framing.
+     * The header is an opcode, 3 or 4 bytes address and a dummy byte.
+     * A payload up to `INLINE_MAX` bytes goes in the same burst with the header.
+     */
+    static constexpr uint32_t HEADER_MAX = 6;
+    static constexpr uint32_t INLINE_MAX = 16;
     
     /**
      * W25Qxx model precomputed Block-Count table.
@@ -52,14 +229,39 @@ private:
     static constexpr uint16_t MODEL_BASE = 0x11;    // --> starting offset of model number.
     static const uint16_t MODELS[MODEL_MAX];
 
+    /**
+     * SFDP: the signature, the parameter IDs and the headers read at most.
+     */
+    static constexpr uint32_t SFDP_SIGNATURE = 0x50444653;   // --> "SFDP".
+    static constexpr uint16_t SFDP_BFPT = 0xff00;            // --> basic flash parameter table.
+    static constexpr uint16_t SFDP_4BAIT = 0xff84;           // --> 4-byte address instruction table.
+    static constexpr uint32_t SFDP_MAX_HEADERS = 8;
+    static constexpr uint32_t SFDP_BFPT_DWORDS = 16;
+
     /**
      * SPI baud-rate, CPOL and CPHA.
      * RP2040 doesn't support LSB first mode, so it can not be customized.
+     * `BAUDRATE` is the safe clock to identify the chip, then `init()` tunes it up.
      */
     static constexpr uint32_t BAUDRATE = 1000 * 1000; // --> 1MHz.    
+    static constexpr uint32_t READ_BAUDRATE = 50 * 1000 * 1000; // --> max of 0x03, 0x13.
+
+    /**
+     * Clock tuning: bytes compared and repeats at each clock.
+     */
+    static constexpr uint32_t CLOCK_CHECK_LEN = 64;
+    static constexpr uint32_t CLOCK_CHECKS = 2;
     static constexpr spi_cpol_t CPOL = SPI_CPOL_1;
     static constexpr spi_cpha_t CPHA = SPI_CPHA_1;
 
+    /**
+     * PIO reads: the sectors searched for the non-blank bytes to check against the SPI.
+     */
+    static constexpr uint32_t PIO_CHECK_SECTORS = 16;
+
+    // --> tag of the empty cache line.
+    static constexpr uint32_t INVALID_PAGE = 0xffffffff;
+
 private:
     spi_inst_t* _dev;
 
@@ -71,6 +273,65 @@ private:
 
     uint32_t _id;
     uint32_t _bcnt;
+    uint32_t _baud;             // --> tuned clock.
+    SW25QGeometry _geo;
+
+    // --> compare of the update job kept a bit per unit: a job step programs a unit at least.
+    static constexpr uint32_t DIFFER_UNIT = W25QXX_JOB_CHUNK < PAGE_SIZE ? W25QXX_JOB_CHUNK : PAGE_SIZE;
+    static constexpr uint32_t DIFFER_UNITS = (W25QXX_UPDATE_SPAN + DIFFER_UNIT - 1) / DIFFER_UNIT;
+
+    // --> asynchronous job.
+    uint8_t _job;
+    uint32_t _jobErase;         // --> next address to erase.
+    uint32_t _jobEraseBegin;
+    uint32_t _jobEraseDone;     // --> erased until here.
+    uint32_t _jobEraseEnd;
+    uint32_t _jobBegin;         // --> the first address to program.
+    uint32_t _jobAddr;          // --> next address to program.
+    const uint8_t* _jobBuf;
+    uint32_t _jobLen;           // --> bytes left to program.
+    uint32_t _jobCompare;       // --> next address to compare.
+    uint8_t _jobUpdate;         // --> EW25QUpdate.
+    uint32_t _jobUnit;          // --> the first unit of the job, `DIFFER_UNIT` bytes.
+    uint32_t _jobDiffer[(DIFFER_UNITS + 31) / 32];  // --> units found differing by the compare.
+
+    // --> erase or program started without waiting, reads suspend it.
+    bool _wip;
+    uint32_t _wipAddr;          // --> region of the erase or program in flight.
+    uint32_t _wipLen;
+    bool _suspended;
+    uint64_t _resumedAt;        // --> microseconds.
+
+    // --> asynchronous transfer.
+    int8_t _dmaTx, _dmaRx;      // --> DMA channels, -1 if not claimed.
+    bool _xfer;
+    uint32_t _xferLen;
+    W25QXXCb _xferCb;
+    void* _xferCtx;
+    uint8_t _xferDummy;         // --> source of the TX channel for reads.
+    uint8_t _xferSink;          // --> sink of the RX channel for writes.
+    bool _xferResume;           // --> resume the erase or program when completed.
+
+    // --> PIO reads.
+    PIO _pio;                   // --> null if not enabled.
+    int8_t _pioSm;
+    uint8_t _pioOffset;
+    uint8_t _pioLines;          // --> data lines, 0 if not enabled.
+    uint8_t _pioBits;           // --> pins sampled per clock, 4 or 8.
+    uint8_t _pioCmd;
+    uint8_t _pioDummy;
+    uint8_t _pioDecode[256];    // --> sampled byte to the data bits.
+    PIO _pioRetry;              // --> blank when enabled: checked again on the first data programmed.
+    uint8_t _pioIo2, _pioIo3;
+
+    // --> page cache.
+    bool _cacheOn;
+    uint32_t _cacheTick;
+    uint32_t _cacheHits;
+    uint32_t _cacheMisses;
+#if W25QXX_CACHE_SETS > 0
+    SW25QCacheLine _cache[W25QXX_CACHE_SETS][W25QXX_CACHE_WAYS];
+#endif
 
     /**
      * Note for SPI device:
@@ -175,6 +436,29 @@ public:
         return capacity() / PAGE_SIZE;
     }
 
+    /**
+     * Get the geometry of the flash.
+     * This will be valid after calling `init()` method.
+     */
+    inline const SW25QGeometry& geometry() const {
+        return _geo;
+    }
+
+    /**
+     * Get the SPI clock tuned by `init()` method.
+     * The normal read caps it at `READ_BAUDRATE` unless fast-mode.
+     */
+    inline uint32_t tunedBaudrate() const {
+        return _baud;
+    }
+
+    /**
+     * Get the SPI clock in use.
+     */
+    inline uint32_t baudrate() const {
+        return _dev ? spi_get_baudrate(_dev) : 0;
+    }
+
 private:
     /**
      * Configure all GPIO and SPI interfaces.
@@ -182,6 +466,45 @@ private:
      */
     void configure();
 
+    /**
+     * Discover the geometry from the SFDP tables.
+     * Returns false if the chip has no valid SFDP.
+     */
+    bool discover(SW25QGeometry* geo);
+
+    /**
+     * Read the SFDP, 3-byte address always.
+     * Cmd: 0x5a.
+     */
+    void readSfdp(uint32_t addr, uint8_t* buf, uint32_t len);
+
+    /**
+     * Fill the geometry from the Winbond model table, by the JEDEC ID.
+     * Returns false if the chip isn't a known Winbond one.
+     */
+    bool fromModels(SW25QGeometry* geo) const;
+
+    /* get the erase type of the size, null if not supported. */
+    const SW25QErase* eraseOf(uint32_t size) const;
+
+    /**
+     * Get the largest erase type aligned at `addr` that ends until `end`.
+     * Both must be sector aligned, so the 4 KB erase fits at least.
+     */
+    const SW25QErase* planErase(uint32_t addr, uint32_t end) const;
+
+    /**
+     * Step the clock up from `BAUDRATE` and keep the highest one that reads
+     * the JEDEC ID, the unique ID and the first bytes same as the safe clock.
+     */
+    void tuneClock();
+
+    /* test whether the chip reads same at the current clock or not. */
+    bool checkClock(const uint8_t* uid, const uint8_t* ref, uint32_t len);
+
+    /* set the clock for the current read mode. */
+    void applyClock();
+
 protected:
     /**
      * Chip select, this makes CSN pin to low.
@@ -199,11 +522,8 @@ private:
     /* write data and read one byte. */
     uint8_t xfer(uint8_t data);
 
-    /* read multiple bytes from SPI. */
-    uint32_t xfer(uint8_t* buf, uint32_t len);
-
-    /* write data through SPI. */
-    uint32_t xmit(const uint8_t* buf, uint32_t len);
+    /* write the bytes and read them back to `rx` in a burst, `rx` can be null. */
+    void burst(const uint8_t* tx, uint8_t* rx, uint32_t len);
 
 private:
     /**
@@ -257,27 +577,36 @@ public:
     
 private:
     /**
-     * Xfer a command byte to the chip.
-     * This translate 3-Byte based command to 4-Byte command if required.
+     * Build the header of the transaction to `buf`, returns its length.
+     * This translate 3-Byte based command to 4-Byte command if required,
+     * and appends the dummy byte if `dummy` is true.
      */
-    uint8_t xferCmd(uint8_t cmd);
+    uint32_t header(uint8_t* buf, uint8_t cmd, uint32_t addr, bool dummy = false) const;
 
     /**
-     * Xfer an address to the chip.
+     * Run a transaction in a frame: the header, then `len` bytes of payload.
+     * Writes `tx` if not null, and reads to `rx` if not null.
      */
-    void xferAddr(uint32_t addr);
+    uint32_t transact(uint8_t cmd, uint32_t addr, bool dummy, const uint8_t* tx, uint8_t* rx, uint32_t len);
+
+    /**
+     * Start the header of the transaction, the frame is kept selected.
+     * The caller must `deselect()` after the payload.
+     */
+    void beginFrame(uint8_t cmd, uint32_t addr, bool dummy = false);
 
 public:
 
     /**
      * Erase a sector.
-     * Cmd: 0x20 (24-bit), 0x21 (32-bit).
+     * Cmd: the 4 KB erase type, 0x20 (24-bit), 0x21 (32-bit) usually.
     */
     bool eraseSector(uint32_t sector);
 
     /**
      * Erase a block.
-     * Cmd: 0xd8 (24-bit), 0xdc (32-bit).
+     * Cmd: the 64 KB erase type, 0xd8 (24-bit), 0xdc (32-bit) usually.
+     * Erases the sectors one by one if the chip has no 64 KB erase.
      */
     bool eraseBlock(uint32_t block);
 
@@ -313,16 +642,23 @@ public:
 
     /**
      * Read a byte.
-     * Cmd: 0x03 (24-bit), 0x13 (32-bit, fast), 0x0b (24-bit), 0x0c (32-bit, fast).
+     * Uses: read(...) method.
      */
     bool readByte(uint32_t addr, uint8_t* val);
 
     /**
      * Read multiple bytes and returns read bytes.
+     * Served by the page cache if enabled, unless longer than `W25QXX_CACHE_BYPASS`.
      * Cmd: 0x03 (24-bit), 0x13 (32-bit, fast), 0x0b (24-bit), 0x0c (32-bit, fast).
      */
     uint32_t read(uint32_t addr, uint8_t* buf, uint32_t len);
 
+    /**
+     * Read multiple bytes from the chip, never served by the page cache.
+     * Verifying the stored bytes must see the cells, not the cached copy.
+     */
+    uint32_t readUncached(uint32_t addr, uint8_t* buf, uint32_t len);
+
     /**
      * Read a page and returns read bytes.
      * Uses: read(...) method.
@@ -340,7 +676,263 @@ public:
      * Uses: read(...) method.
      */
     uint32_t readBlock(uint32_t block, uint32_t offset, uint8_t* buf, uint32_t len);
-    
+
+public:
+    /**
+     * Enable or disable the page cache, and returns true if enabled.
+     * Writes and erases through the driver invalidate the pages, so it holds
+     * the bytes read from the chip only. Returns false if stripped out.
+     */
+    bool enableCache(bool val = true);
+
+    /**
+     * Test whether the page cache is enabled or not.
+     */
+    inline bool isCacheEnabled() const { return _cacheOn; }
+
+    /**
+     * Get the reads served by the cache, and the pages loaded from the chip.
+     */
+    inline uint32_t cacheHits() const { return _cacheHits; }
+    inline uint32_t cacheMisses() const { return _cacheMisses; }
+
+    /**
+     * Reset the hit and miss counters.
+     */
+    inline void resetCacheStats() { _cacheHits = _cacheMisses = 0; }
+
+private:
+    /* read the chip, suspending the erase or program in progress. */
+    uint32_t readChip(uint32_t addr, uint8_t* buf, uint32_t len);
+
+    /* get the cached page, and load it on a miss. */
+    const uint8_t* cachePage(uint32_t page);
+
+    /* copy the range from the cache if all pages cached, returns false if not. */
+    bool cacheCopy(uint32_t addr, uint8_t* buf, uint32_t len);
+
+    /* invalidate the cached pages of the range. */
+    void cacheInvalidate(uint32_t addr, uint32_t len);
+
+    /* invalidate all cached pages. */
+    void cacheClear();
+
+public:
+    /**
+     * Read by a state machine of `pio` on 2 or 4 lines, the SPI sends the opcode and the address.
+     * 1-1-4 if `io2` and `io3` are wired, 1-1-2 on MOSI and MISO otherwise, if the chip reads so.
+     * The IO pins must be within 8 pins, and the PIO must read the first non-blank bytes
+     * same as the SPI. Returns false if not, then the reads stay on the SPI.
+     * On a blank chip the check is deferred: the first job that programs data runs it.
+     * Cmd: 0x3b, 0x6b (24-bit), 0x3c, 0x6c (32-bit), 0x31 to set QE of Winbond chips.
+     */
+    bool enablePio(PIO pio, uint8_t io2 = NO_PIN, uint8_t io3 = NO_PIN);
+
+    /**
+     * Unload the program and release the state machine, the reads use the SPI.
+     */
+    void disablePio();
+
+    /**
+     * Get the data lines of the reads: 1 on the SPI, 2 or 4 on the PIO.
+     */
+    inline uint8_t readLines() const { return _pioLines ? _pioLines : 1; }
+
+private:
+    /* load the program for the lines, and start the state machine. */
+    bool startPio(PIO pio, const uint8_t* io, uint8_t lines);
+
+    /* start the PIO on 4 lines if wired, or on 2, checked on the first non-blank bytes of the range. */
+    uint8_t tryPio(PIO pio, uint8_t io2, uint8_t io3, uint32_t addr, uint32_t len, uint32_t stride);
+
+    /* compare the PIO reads with the SPI ones, on the first non-blank bytes of the range: `EW25QPioCheck`. */
+    uint8_t checkPio(uint32_t addr, uint32_t len, uint32_t stride);
+
+    /* run the check deferred by a blank chip, on the range just programmed. */
+    void retryPio(uint32_t addr, uint32_t len);
+
+    /* set QE of SR2, IO2 and IO3 are /WP and /HOLD until set. */
+    bool enableQuad();
+
+    /* read the data on the PIO. */
+    uint32_t pioRead(uint32_t addr, uint8_t* buf, uint32_t len);
+
+public:
+    /**
+     * Test whether the chip is busy for erase or program, without waiting.
+     * Cmd: 0x05.
+     */
+    bool isBusy();
+
+    /**
+     * Start to erase a sector without waiting for it.
+     * Returns false if the chip is busy or out of range.
+     * Cmd: 0x20 (24-bit), 0x21 (32-bit).
+     */
+    bool startEraseSector(uint32_t sector);
+
+    /**
+     * Test whether the erase or program is suspended for a read or not.
+     */
+    inline bool isSuspended() const { return _suspended; }
+
+private:
+    /* start the erase of the type at the address, the chip must be idle. */
+    void startErase(const SW25QErase* erase, uint32_t addr);
+
+    /**
+     * Suspend the erase or program started without waiting, for a read of the range.
+     * Returns true if suspended, then `resumeWrite()` must follow the read.
+     * Waits for it instead if the range overlaps its region, which reads undefined while suspended,
+     * or if `W25QXX_DISABLE_SUSPEND` set.
+     * Cmd: 0x05, 0x75.
+     */
+    bool suspendWrite(uint32_t addr, uint32_t len);
+
+    /**
+     * Resume the suspended erase or program.
+     * Cmd: 0x7a.
+     */
+    void resumeWrite();
+
+public:
+
+    /**
+     * Start to write a page without waiting for it, and returns written bytes.
+     * Returns zero if the chip is busy or out of range.
+     * Cmd: 0x02 (24-bit), 0x12 (32-bit).
+     */
+    uint32_t startWritePage(uint32_t page, uint32_t offset, const uint8_t* buf, uint32_t len);
+
+public:
+    /**
+     * Claim two DMA channels for the asynchronous transfers.
+     * Returns false if not available, then the async methods block.
+     */
+    bool enableDma();
+
+    /**
+     * Test whether the DMA channels are claimed or not.
+     */
+    inline bool isDmaEnabled() const { return _dmaRx >= 0; }
+
+    /**
+     * Start to read bytes without waiting for the transfer, and returns bytes to read.
+     * `cb` is called by `updateOnce()` when completed, so `buf` must be kept until then.
+     * If all pages are cached, copies them and calls `cb` at once.
+     * Returns zero if out of range or the other transfer is running.
+     * Cmd: 0x03 (24-bit), 0x13 (32-bit), 0x0b, 0x0c (fast-mode).
+     */
+    uint32_t readAsync(uint32_t addr, uint8_t* buf, uint32_t len, W25QXXCb cb = nullptr, void* ctx = nullptr);
+
+    /**
+     * Start to write a page without waiting for the transfer, and returns written bytes.
+     * `cb` is called by `updateOnce()` when transferred, the chip is busy after that.
+     * Returns zero if the chip is busy, out of range or the other transfer is running.
+     * Cmd: 0x02 (24-bit), 0x12 (32-bit).
+     */
+    uint32_t writePageAsync(uint32_t page, uint32_t offset, const uint8_t* buf, uint32_t len,
+        W25QXXCb cb = nullptr, void* ctx = nullptr);
+
+    /**
+     * Complete the transfer if finished: de-select the chip and call the callback.
+     * Returns true if the transfer is still running.
+     */
+    bool updateOnce();
+
+    /**
+     * Test whether the transfer is running or not.
+     */
+    inline bool isXferBusy() const { return _xfer; }
+
+    /**
+     * Wait for the transfer to be completed.
+     * Other methods call this first, so they never break the transfer.
+     */
+    void waitForXfer();
+
+private:
+    /* start the DMA channels: null `src` sends dummy bytes, null `dst` drops received bytes. */
+    void startDma(const uint8_t* src, uint8_t* dst, uint32_t len);
+
+    /* complete the transfer. */
+    void completeXfer();
+
+public:
+    /**
+     * Start a job that erases all sectors of the range (if `erase` set),
+     * then programs the buffer to the range, a step at a time.
+     * The buffer must be kept until the job ends,
+     * and the blocking methods should not be used meanwhile.
+     * Returns false if the other job is running.
+     */
+    bool startJob(uint32_t addr, const uint8_t* buf, uint32_t len, bool erase = true);
+
+    /**
+     * Advance the job a step and returns its state.
+     * A step is a status read and, at most one compare read, one erase command,
+     * one program command of `W25QXX_JOB_CHUNK` bytes or one skip of the bytes same as the flash.
+     */
+    uint8_t stepJob();
+
+    /**
+     * Start a job that erases all sectors which cover the range.
+     * Each step issues the largest erase that fits in the rest: 64 KB, 32 KB or 4 KB,
+     * so the range is erased by the fewest commands the chip supports.
+     * Returns false if the other job is running.
+     */
+    bool eraseRange(uint32_t addr, uint32_t len);
+
+    /**
+     * Start a job that compares the range with the buffer first:
+     * skips the write if same, programs in place if no bit needs 0 -> 1,
+     * or erases the sectors which cover the range like `startJob`.
+     * The slices same as the flash are never programmed.
+     * A range not aligned to the sectors fails without writing if it needs the erase.
+     * Returns false if the other job is running.
+     */
+    bool startUpdate(uint32_t addr, const uint8_t* buf, uint32_t len);
+
+    /**
+     * Get the decision of the update job, EW25U_NONE for the other jobs.
+     */
+    inline uint8_t updateResult() const { return _jobUpdate; }
+
+    /**
+     * Get the bytes erased by the job, the erase in progress excluded.
+     */
+    inline uint32_t jobErased() const { return _jobEraseDone - _jobEraseBegin; }
+
+    /**
+     * Get the bytes to be erased by the job, rounded out to the sectors.
+     */
+    inline uint32_t jobEraseTotal() const { return _jobEraseEnd - _jobEraseBegin; }
+
+    /**
+     * Get the state of the job.
+     */
+    inline uint8_t jobState() const { return _job; }
+
+    /**
+     * Test whether a job is running or not.
+     */
+    inline bool isJobRunning() const {
+        return _job == EW25J_COMPARE || _job == EW25J_ERASE || _job == EW25J_PROGRAM;
+    }
+
+private:
+    /* get the bytes of the job step at the address: in the page, `W25QXX_JOB_CHUNK` without DMA. */
+    uint32_t jobSlice(uint32_t addr, uint32_t left) const;
+
+    /* compare a slice of the update job, and decide it at the end. */
+    void compareJob();
+
+    /* get the bytes the update job can skip programming from the next address, no flash read. */
+    uint32_t sameBytes() const;
+
+    /* test whether the compare found the unit of the address differing, the units past the map do. */
+    bool isDiffer(uint32_t addr) const;
+
 public:
     /**
      * Read a structure and returns true if full bytes loaded. 
@@ -1,13 +1,10 @@
 #ifndef __MAIN_H__
 #define __MAIN_H__
 
-enum {
+#include "board.h"
 
-    EGPIO_ROW1 = 5,
-    EGPIO_ROW2 = 6,
-    EGPIO_COL1 = 7,
-    EGPIO_COL2 = 8,
-    EGPIO_COL3 = 9,
+// --> pins of all boards: the rows and the columns are the `Board`'s.
+enum {
 
     EGPIO_595_LAT = 10,
     EGPIO_595_CLK = 11,
@@ -25,26 +22,16 @@ enum {
     
 };
 
+// --> the keys of the first two rows by name, the others by `row * MAX_COL + col`.
 enum EKey {
     EKEY_00 = 0,
-    EKEY_01,
-    EKEY_02,
-    EKEY_10,
-    EKEY_11,
-    EKEY_12,
-    EKEY_MAX,
+    EKEY_01 = 1,
+    EKEY_02 = 2,
+    EKEY_10 = Board::MAX_COL,
+    EKEY_11 = Board::MAX_COL + 1,
+    EKEY_12 = Board::MAX_COL + 2,
+    EKEY_MAX = Board::MAX_KEY,
     EKEY_INV = 0xff,
 };
 
-enum ELed {
-    ELED_00 = 7,
-    ELED_01 = 6,
-    ELED_02 = 1,
-    ELED_10 = 4,
-    ELED_11 = 3,
-    ELED_12 = 5,
-    ELED_TR = 2,    // --> D13. CAPSLOCK
-    ELED_TL = 0     // --> D14. NUMLOCK
-};
-
 #endif
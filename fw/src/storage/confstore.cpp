@@ -0,0 +1,412 @@
+#include "confstore.h"
+#include <stddef.h>
+#include <string.h>
+
+static_assert((CONFSTORE_MAX_RECORD & (CONFSTORE_MAX_RECORD - 1)) == 0
+    && CONFSTORE_MAX_RECORD >= W25QXX::PAGE_SIZE && CONFSTORE_MAX_RECORD <= W25QXX::SECTOR_SIZE / 2,
+    "a record is a page ~ half a sector, a power of two.");
+
+ConfStore::ConfStore(W25QXX* flash)
+    : _flash(flash), _first(0), _count(0), _len(0), _slotSize(0), _slots(0),
+      _seq(0), _loaded(false), _head(0), _slot(0), _active(0), _record(0),
+      _state(ECFS_IDLE), _prep(ECFP_UNKNOWN), _prepOffset(0), _pending(false),
+      _reading(false)
+{
+    memset(_buf, 0xff, sizeof(_buf));
+}
+
+bool ConfStore::mount(uint32_t first, uint32_t count, uint32_t len) {
+    const uint32_t sectorMax = _flash->sectorMax();
+
+    _count = 0;
+    _seq = 0;
+    _loaded = false;
+    _head = _slot = _active = 0;
+    _record = 0;
+    _state = ECFS_IDLE;
+    _prep = ECFP_UNKNOWN;
+    _pending = false;
+    _reading = false;
+
+    if (first >= sectorMax || len > MAX_PAYLOAD) {
+        return false;
+    }
+
+    if (count > sectorMax - first) {
+        count = sectorMax - first;
+    }
+
+    if (count > CONFSTORE_MAX_SECTORS) {
+        count = CONFSTORE_MAX_SECTORS;
+    }
+
+    // --> the next sector is erased ahead of the head, so two at least.
+    if (count < 2) {
+        return false;
+    }
+
+    _first = first;
+    _count = count;
+    _len = len;
+
+    // --> power of two: within a page, or whole pages from a page boundary.
+    _slotSize = 16;
+    while (_slotSize < sizeof(SConfRecord) + len) {
+        _slotSize <<= 1;
+    }
+
+    _slots = W25QXX::SECTOR_SIZE / _slotSize;
+
+    // --> sequence of the first record of each sector.
+    uint32_t seqs[CONFSTORE_MAX_SECTORS];
+    bool used[CONFSTORE_MAX_SECTORS];
+
+    for(uint32_t i = 0; i < _count; ++i) {
+        SConfRecord rec;
+
+        used[i] = false;
+        for(uint32_t slot = 0; slot < _slots; ++slot) {
+            if (!readHeader(i, slot, &rec)) {
+                break;
+            }
+
+            if (rec.magic == MAGIC) {
+                seqs[i] = rec.seq;
+                used[i] = true;
+                break;
+            }
+        }
+    }
+
+    // --> try the sectors from the newest one.
+    //   : a torn record makes the whole sector invalid, then try older one.
+    bool bounded = false;
+    uint32_t bound = 0;
+
+    while (true) {
+        int32_t pick = -1;
+
+        for(uint32_t i = 0; i < _count; ++i) {
+            if (!used[i] || (bounded && seqs[i] >= bound)) {
+                continue;
+            }
+
+            if (pick < 0 || seqs[i] > seqs[pick]) {
+                pick = int32_t(i);
+            }
+        }
+
+        if (pick < 0) {
+            break;
+        }
+
+        if (scanSector(uint32_t(pick))) {
+            return true;
+        }
+
+        bound = seqs[pick];
+        bounded = true;
+    }
+
+    // --> no valid record: start from the first free slot of the first sector.
+    _slot = findBlank(0);
+    return false;
+}
+
+bool ConfStore::load(void* buf) const {
+    if (!_loaded) {
+        return false;
+    }
+
+    memcpy(buf, _buf + sizeof(SConfRecord), _len);
+    return true;
+}
+
+bool ConfStore::save(const void* buf) {
+    if (!_count || _pending) {
+        return false;
+    }
+
+    SConfRecord rec;
+    uint8_t* payload = _buf + sizeof(SConfRecord);
+
+    // --> same as the newest record: nothing to write.
+    if (_loaded && memcmp(payload, buf, _len) == 0) {
+        return true;
+    }
+
+    rec.magic = MAGIC;
+    rec.len = uint16_t(_len);
+    rec.seq = _seq + 1;
+
+    memcpy(payload, buf, _len);
+    rec.crc = checksum(&rec, payload);
+
+    memcpy(_buf, &rec, sizeof(rec));
+    _pending = true;
+    return true;
+}
+
+bool ConfStore::rewrite() {
+    if (!_count || !_loaded || _pending) {
+        return false;
+    }
+
+    SConfRecord rec;
+    memcpy(&rec, _buf, sizeof(rec));
+
+    rec.seq = _seq + 1;
+    rec.crc = checksum(&rec, _buf + sizeof(SConfRecord));
+
+    memcpy(_buf, &rec, sizeof(rec));
+    _pending = true;
+    return true;
+}
+
+void ConfStore::step() {
+    if (!_count) {
+        return;
+    }
+
+    switch(_state) {
+        case ECFS_PROGRAM: {
+            const uint8_t job = _flash->stepJob();
+
+            if (job == EW25J_DONE) {
+                _state = ECFS_VERIFY;
+            }
+
+            else if (job == EW25J_FAIL) {
+                _slot++;
+                _state = ECFS_IDLE;
+            }
+
+            return;
+        }
+
+        case ECFS_VERIFY: {
+            const uint32_t size = sizeof(SConfRecord) + _len;
+            if (!readBack(addressOf(_head, _slot), size)) {
+                return;
+            }
+
+            const bool ok = memcmp(_check, _buf, size) == 0;
+            const uint32_t addr = addressOf(_head, _slot);
+
+            // --> on failure, retry to the next slot.
+            _slot++;
+            _state = ECFS_IDLE;
+
+            if (ok) {
+                SConfRecord rec;
+                memcpy(&rec, _buf, sizeof(rec));
+
+                _seq = rec.seq;
+                _loaded = true;
+                _active = _head;
+                _record = addr;
+                _pending = false;
+            }
+
+            return;
+        }
+
+        case ECFS_ERASE: {
+            if (!_flash->isBusy()) {
+                _prep = ECFP_READY;
+                _state = ECFS_IDLE;
+            }
+
+            return;
+        }
+
+        default:
+            break;
+    }
+
+    if (_pending && !_reading && append()) {
+        return;
+    }
+
+    prepare();
+}
+
+bool ConfStore::isIdle() const {
+    if (!_count) {
+        return true;
+    }
+
+    if (_pending || _reading || _state != ECFS_IDLE) {
+        return false;
+    }
+
+    return _prep == ECFP_READY || (_loaded && (_head + 1) % _count == _active);
+}
+
+uint32_t ConfStore::checksum(const SConfRecord* rec, const uint8_t* payload) {
+    // --> the header except the `crc` field, then the payload.
+    const uint32_t crc = crc32(rec, offsetof(SConfRecord, crc));
+    return crc32(payload, rec->len, crc);
+}
+
+bool ConfStore::readHeader(uint32_t sector, uint32_t slot, SConfRecord* rec) const {
+    if (!_flash->read(addressOf(sector, slot), rec)) {
+        return false;
+    }
+
+    const uint8_t* raw = (const uint8_t*) rec;
+    for(uint32_t i = 0; i < sizeof(SConfRecord); ++i) {
+        if (raw[i] != 0xff) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t ConfStore::findBlank(uint32_t sector) const {
+    SConfRecord rec;
+    uint32_t lo = 0, hi = _slots;
+
+    // --> slots are programmed in order: binary search.
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+
+        if (readHeader(sector, mid, &rec)) {
+            lo = mid + 1;
+        }
+
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+bool ConfStore::scanSector(uint32_t sector) {
+    SConfRecord rec;
+    const uint32_t used = findBlank(sector);
+
+    const uint32_t size = sizeof(SConfRecord) + _len;
+    for(uint32_t i = used; i-- > 0; ) {
+        if (_flash->read(addressOf(sector, i), _buf, size) != size) {
+            continue;
+        }
+
+        memcpy(&rec, _buf, sizeof(rec));
+        if (rec.magic != MAGIC || rec.len != _len) {
+            continue;
+        }
+
+        if (checksum(&rec, _buf + sizeof(SConfRecord)) != rec.crc) {
+            continue;
+        }
+
+        _seq = rec.seq;
+        _loaded = true;
+        _head = _active = sector;
+        _record = addressOf(sector, i);
+        _slot = used;
+        return true;
+    }
+
+    return false;
+}
+
+bool ConfStore::append() {
+    if (_slot >= _slots) {
+        // --> wait for the next sector to be erased.
+        if (_prep != ECFP_READY) {
+            return false;
+        }
+
+        _head = (_head + 1) % _count;
+        _slot = 0;
+        _prep = ECFP_UNKNOWN;
+    }
+
+    const uint32_t size = sizeof(SConfRecord) + _len;
+    if (!_flash->startJob(addressOf(_head, _slot), _buf, size, false)) {
+        return false;
+    }
+
+    _state = ECFS_PROGRAM;
+    return true;
+}
+
+void ConfStore::prepare() {
+    const uint32_t next = (_head + 1) % _count;
+
+    switch(_prep) {
+        case ECFP_UNKNOWN:
+            _prepOffset = 0;
+            _prep = ECFP_CHECK;
+            break;
+
+        case ECFP_CHECK: {
+            // --> DMA transfers don't block, so a page at once.
+            const uint32_t chunk = _flash->isDmaEnabled() ? W25QXX::PAGE_SIZE : CONFSTORE_CHECK_CHUNK;
+            const uint32_t addr = (_first + next) * W25QXX::SECTOR_SIZE + _prepOffset;
+
+            if (!readBack(addr, chunk)) {
+                break;
+            }
+
+            bool blank = true;
+            for(uint32_t i = 0; blank && i < chunk; ++i) {
+                blank = _check[i] == 0xff;
+            }
+
+            if (blank) {
+                _prepOffset += chunk;
+
+                if (_prepOffset >= W25QXX::SECTOR_SIZE) {
+                    _prep = ECFP_READY;
+                }
+
+                break;
+            }
+
+            // --> never erase the newest record.
+            if (_loaded && next == _active) {
+                break;
+            }
+
+            // --> holds the oldest records: erase it.
+            if (_flash->startEraseSector(_first + next)) {
+                _state = ECFS_ERASE;
+            }
+
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+bool ConfStore::readBack(uint32_t addr, uint32_t len) {
+    if (!_reading) {
+        // --> the other transfer is running: try later.
+        if (_flash->isXferBusy()) {
+            return false;
+        }
+
+        if (_flash->readAsync(addr, _check, len) != len) {
+            // --> failed to read: never matches.
+            memset(_check, 0x00, len);
+            return true;
+        }
+
+        _reading = true;
+        return false;
+    }
+
+    if (_flash->updateOnce()) {
+        return false;
+    }
+
+    _reading = false;
+    return true;
+}
@@ -0,0 +1,199 @@
+#ifndef __STORAGE_CONFSTORE_H__
+#define __STORAGE_CONFSTORE_H__
+
+#include "../drivers/w25qxx.h"
+#include "crc32.h"
+
+/**
+ * Configurations for the ConfStore.
+ * 1. CONFSTORE_MAX_SECTORS : max sectors of the ring, this bounds the mount time.
+ * 2. CONFSTORE_CHECK_CHUNK : bytes read by a blank-check step, without DMA.
+ * 3. CONFSTORE_MAX_RECORD : bytes of a record with its header at most, a power of two:
+ *    a page by default, more for the boards with many keys. two buffers of this in RAM.
+ */
+#ifndef CONFSTORE_MAX_SECTORS
+#define CONFSTORE_MAX_SECTORS 64
+#endif
+
+#ifndef CONFSTORE_CHECK_CHUNK
+#define CONFSTORE_CHECK_CHUNK 32
+#endif
+
+#ifndef CONFSTORE_MAX_RECORD
+#define CONFSTORE_MAX_RECORD 256
+#endif
+
+/**
+ * Header of the record.
+ */
+struct SConfRecord {
+    uint16_t magic;     // --> ConfStore::MAGIC.
+    uint16_t len;       // --> length of the payload.
+    uint32_t seq;       // --> sequence number, increases by each save.
+    uint32_t crc;       // --> CRC-32 of the header and the payload.
+};
+
+/**
+ * State of the ConfStore.
+ */
+enum EConfStore {
+    ECFS_IDLE = 0,
+    ECFS_PROGRAM,       // --> programming the record.
+    ECFS_VERIFY,        // --> verifying the programmed record.
+    ECFS_ERASE          // --> erasing the next sector.
+};
+
+/**
+ * State of the next sector.
+ */
+enum EConfPrep {
+    ECFP_UNKNOWN = 0,
+    ECFP_CHECK,         // --> blank-checking.
+    ECFP_READY          // --> erased.
+};
+
+/**
+ * Configuration store.
+ * Appends the records to a ring of sectors, and
+ * the newest valid record is the configuration.
+ *
+ * --
+ * Each sector is split into slots, a slot per record.
+ * Saving programs a slot only, the next sector of the ring is
+ * blank-checked and erased in the background, ahead of the time.
+ * So, the wear is spread across the ring.
+ *
+ * A record is valid only if its CRC-32 matches, so a torn program
+ * falls back to the previous record. The sector holding the newest
+ * valid record is never erased.
+ */
+class ConfStore {
+public:
+    static constexpr uint16_t MAGIC = 0xc0f5;
+    static constexpr uint32_t MAX_PAYLOAD = CONFSTORE_MAX_RECORD - sizeof(SConfRecord);
+
+private:
+    W25QXX* _flash;
+    uint32_t _first;        // --> first sector of the ring.
+    uint32_t _count;        // --> sectors of the ring.
+    uint32_t _len;          // --> length of the payload.
+    uint32_t _slotSize;
+    uint32_t _slots;        // --> slots per sector.
+
+    uint32_t _seq;          // --> sequence of the newest record.
+    bool _loaded;           // --> the newest record found.
+    uint32_t _head;         // --> sector index in the ring.
+    uint32_t _slot;         // --> next slot to program.
+    uint32_t _active;       // --> sector of the newest valid record.
+    uint32_t _record;       // --> address of the newest valid record.
+
+    uint8_t _state;
+    uint8_t _prep;
+    uint32_t _prepOffset;
+    bool _pending;
+    bool _reading;          // --> the read transfer is running.
+
+    // --> the record being saved, and bytes read back.
+    uint8_t _buf[CONFSTORE_MAX_RECORD];
+    uint8_t _check[CONFSTORE_MAX_RECORD];
+
+public:
+    ConfStore(W25QXX* flash);
+
+public:
+    /**
+     * Mount the ring and find the newest valid record.
+     * Returns true if the record found.
+     */
+    bool mount(uint32_t first, uint32_t count, uint32_t len);
+
+    /**
+     * Copy the payload of the newest record.
+     * Returns false if no record found.
+     */
+    bool load(void* buf) const;
+
+    /**
+     * Reserve the payload to save. this never blocks,
+     * and `step()` stores it later. Returns false if saving already.
+     * The payload same as the newest record is skipped, it wears nothing.
+     */
+    bool save(const void* buf);
+
+    /**
+     * Save the newest record again, as the next sequence. this never blocks,
+     * and `step()` stores it later. A record rotten on the flash memory is
+     * repaired from the copy in RAM, verified when loaded or saved.
+     * Returns false if no record or saving already.
+     */
+    bool rewrite();
+
+    /**
+     * Advance the store a step: programming, verifying the record
+     * or preparing the next sector. A step never waits for the flash memory.
+     */
+    void step();
+
+    /**
+     * Test whether the record is being saved or not.
+     */
+    inline bool isSaving() const { return _pending; }
+
+    /**
+     * Test whether `step()` has nothing to do or not: no record being saved,
+     * and the next sector erased (or holding the newest record, kept).
+     */
+    bool isIdle() const;
+
+    /**
+     * Get the sequence of the newest record.
+     */
+    inline uint32_t sequence() const { return _seq; }
+
+    /**
+     * Test whether the newest record is found or saved.
+     */
+    inline bool isLoaded() const { return _loaded; }
+
+    /**
+     * Get the address and the bytes of the newest record on the flash memory.
+     */
+    inline uint32_t recordAddress() const { return _record; }
+    inline uint32_t recordSize() const { return sizeof(SConfRecord) + _len; }
+
+    /**
+     * Get the CRC-32 of the newest record, not valid while saving.
+     */
+    inline uint32_t recordCrc() const { return ((const SConfRecord*) _buf)->crc; }
+
+    /**
+     * Compute the CRC-32 of the record.
+     */
+    static uint32_t checksum(const SConfRecord* rec, const uint8_t* payload);
+
+private:
+    /* get the address of the slot. */
+    inline uint32_t addressOf(uint32_t sector, uint32_t slot) const {
+        return (_first + sector) * W25QXX::SECTOR_SIZE + slot * _slotSize;
+    }
+
+    /* read the header of the slot, returns false if blank. */
+    bool readHeader(uint32_t sector, uint32_t slot, SConfRecord* rec) const;
+
+    /* find the first blank slot of the sector. */
+    uint32_t findBlank(uint32_t sector) const;
+
+    /* scan the sector and find the newest valid record. */
+    bool scanSector(uint32_t sector);
+
+    /* start to program the record to the next slot. */
+    bool append();
+
+    /* prepare the next sector: blank-check and erase it. */
+    void prepare();
+
+    /* read bytes to `_check` asynchronously, returns true if completed. */
+    bool readBack(uint32_t addr, uint32_t len);
+};
+
+#endif
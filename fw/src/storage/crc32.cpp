@@ -0,0 +1,22 @@
+#include "crc32.h"
+
+// --> nibble table: 64 bytes, instead of 1 KB of the byte table.
+static const uint32_t CRC32_NIBBLES[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+uint32_t crc32(const void* buf, uint32_t len, uint32_t crc) {
+    const uint8_t* src = (const uint8_t*) buf;
+
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; ++i) {
+        crc ^= src[i];
+        crc = (crc >> 4) ^ CRC32_NIBBLES[crc & 0x0f];
+        crc = (crc >> 4) ^ CRC32_NIBBLES[crc & 0x0f];
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,12 @@
+#ifndef __STORAGE_CRC32_H__
+#define __STORAGE_CRC32_H__
+
+#include <stdint.h>
+
+/**
+ * CRC-32 (IEEE 802.3, reflected, same with zlib).
+ * Pass the previous result as `crc` to continue over the next buffer.
+ */
+uint32_t crc32(const void* buf, uint32_t len, uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,530 @@
+#include "flashfs.h"
+#include <stddef.h>
+#include <string.h>
+
+static_assert(FLASHFS_CATALOG_SECTORS >= 2, "the catalog ring erases its next sector ahead.");
+
+FlashFs::FlashFs(W25QXX* flash)
+    : _flash(flash), _catalog(flash), _cat(), _data(0), _count(0), _free(0), _cursor(0),
+      _generation(0), _committing(false), _release(NONE), _moved(NONE)
+{
+    memset(_link, 0xff, sizeof(_link));
+    memset(_used, 0, sizeof(_used));
+}
+
+bool FlashFs::mount(uint32_t first, uint32_t count) {
+    const uint32_t sectorMax = _flash->sectorMax();
+
+    _count = _free = 0;
+    _cursor = 0;
+    _generation++;
+    _committing = false;
+
+    memset(_used, 0, sizeof(_used));
+    memset(&_cat, 0, sizeof(_cat));
+    for(SFsEntry& each : _cat.files) {
+        each.first = each.last = NONE;
+    }
+
+    if (first >= sectorMax) {
+        return false;
+    }
+
+    if (count > sectorMax - first) {
+        count = sectorMax - first;
+    }
+
+    // --> the catalog ring, and a data sector at least.
+    if (count <= FLASHFS_CATALOG_SECTORS) {
+        return false;
+    }
+
+    _data = first + FLASHFS_CATALOG_SECTORS;
+    _count = count - FLASHFS_CATALOG_SECTORS;
+
+    if (_count > FLASHFS_MAX_SECTORS) {
+        _count = FLASHFS_MAX_SECTORS;
+    }
+
+    _free = _count;
+
+    // --> no catalog: empty.
+    SFsCatalog cat;
+    if (_catalog.mount(first, FLASHFS_CATALOG_SECTORS, sizeof(cat)) && _catalog.load(&cat)) {
+        memcpy(&_cat, &cat, sizeof(cat));
+    }
+
+    _cursor = uint16_t(_cat.cursor % _count);
+
+    for(uint32_t i = 0; i < FLASHFS_MAX_FILES; ++i) {
+        SFsEntry& file = _cat.files[i];
+
+        file.name[FLASHFS_NAME_MAX - 1] = 0;
+        if (!file.name[0]) {
+            continue;
+        }
+
+        // --> broken chain: dropped, the next commit removes it.
+        if (!walk(i)) {
+            memset(&file, 0, sizeof(file));
+            file.first = file.last = NONE;
+        }
+    }
+
+    return true;
+}
+
+uint32_t FlashFs::size(const char* name) const {
+    const int32_t slot = find(name);
+    return slot < 0 ? 0 : _cat.files[slot].size;
+}
+
+uint32_t FlashFs::read(const char* name, uint32_t offset, void* buf, uint32_t len) {
+    const int32_t slot = find(name);
+    if (slot < 0) {
+        return 0;
+    }
+
+    const SFsEntry& file = _cat.files[slot];
+    if (offset >= file.size) {
+        return 0;
+    }
+
+    if (len > file.size - offset) {
+        len = file.size - offset;
+    }
+
+    // --> follow the chain to the sector of the offset.
+    uint16_t sector = file.first;
+    for(uint32_t i = offset / DATA_SIZE; i > 0 && sector != NONE; --i) {
+        sector = _link[sector];
+    }
+
+    uint8_t* dst = (uint8_t*) buf;
+    uint32_t at = offset % DATA_SIZE;
+    uint32_t done = 0;
+
+    while (done < len && sector != NONE) {
+        const uint32_t left = len - done;
+        const uint32_t n = left < DATA_SIZE - at ? left : DATA_SIZE - at;
+
+        if (_flash->read(addressOf(sector) + HEADER_SIZE + at, dst + done, n) != n) {
+            break;
+        }
+
+        done += n;
+        at = 0;
+        sector = _link[sector];
+    }
+
+    return done;
+}
+
+uint32_t FlashFs::append(const char* name, const void* buf, uint32_t len) {
+    SFsCatalog cat = _cat;
+    const int32_t slot = slotOf(cat, name);
+
+    if (!_count || slot < 0 || isBusy()) {
+        return 0;
+    }
+
+    SFsEntry& file = cat.files[slot];
+    const uint8_t* src = (const uint8_t*) buf;
+    const uint32_t used = file.size % DATA_SIZE;
+    uint16_t moved = NONE;
+    uint32_t done = 0;
+
+    // --> the blank tail of the last sector first.
+    if (len && file.last != NONE && used) {
+        const uint32_t n = len < DATA_SIZE - used ? len : DATA_SIZE - used;
+
+        // --> a torn append left bytes there: programming over them corrupts both.
+        if (!isBlank(addressOf(file.last) + HEADER_SIZE + used, n)) {
+            moved = file.last;
+
+            if (!relocate(file, uint16_t(slot), used)) {
+                return 0;
+            }
+        }
+
+        if (_flash->write(addressOf(file.last) + HEADER_SIZE + used, src, n) != n) {
+            if (moved != NONE) {
+                // --> the copy isn't committed: back to the tail.
+                mount(_data - FLASHFS_CATALOG_SECTORS, _count + FLASHFS_CATALOG_SECTORS);
+            }
+
+            return 0;
+        }
+
+        file.size += n;
+        done = n;
+
+        // --> the tail is full: sealed before committed, a torn seal is relocated.
+        if (file.size % DATA_SIZE == 0 && !seal(file.last)) {
+            mount(_data - FLASHFS_CATALOG_SECTORS, _count + FLASHFS_CATALOG_SECTORS);
+            return 0;
+        }
+    }
+
+    done += extend(file, uint16_t(slot), src + done, len - done);
+    cat.cursor = _cursor;
+
+    // --> the copied tail leaves the chain once committed.
+    if (!commit(cat, NONE, moved)) {
+        return 0;
+    }
+
+    return done;
+}
+
+bool FlashFs::replace(const char* name, const void* buf, uint32_t len) {
+    SFsCatalog cat = _cat;
+    const int32_t slot = slotOf(cat, name);
+
+    if (!_count || slot < 0 || isBusy()) {
+        return false;
+    }
+
+    SFsEntry& file = cat.files[slot];
+    const uint16_t old = file.first;
+
+    // --> a new chain, the old one is kept until committed.
+    file.size = 0;
+    file.first = file.last = NONE;
+
+    if (extend(file, uint16_t(slot), (const uint8_t*) buf, len) != len) {
+        release(file.first);
+        return false;
+    }
+
+    cat.cursor = _cursor;
+    return commit(cat, old, NONE);
+}
+
+bool FlashFs::remove(const char* name) {
+    const int32_t slot = find(name);
+    if (slot < 0 || isBusy()) {
+        return false;
+    }
+
+    SFsCatalog cat = _cat;
+    SFsEntry& file = cat.files[slot];
+    const uint16_t old = file.first;
+
+    memset(&file, 0, sizeof(file));
+    file.first = file.last = NONE;
+
+    return commit(cat, old, NONE);
+}
+
+void FlashFs::step() {
+    if (!_committing) {
+        return;
+    }
+
+    _catalog.step();
+    if (_catalog.isSaving()) {
+        return;
+    }
+
+    // --> committed: the old sectors aren't referred anymore.
+    _committing = false;
+
+    if (_moved != NONE) {
+        setUsed(_moved, false);
+        _generation++;
+    }
+
+    if (_release != NONE) {
+        release(_release);
+    }
+
+    _release = _moved = NONE;
+}
+
+const SFsEntry* FlashFs::entry(uint32_t slot) const {
+    if (slot >= FLASHFS_MAX_FILES || !_cat.files[slot].name[0]) {
+        return nullptr;
+    }
+
+    return &_cat.files[slot];
+}
+
+const SFsEntry* FlashFs::lookup(const char* name) const {
+    const int32_t slot = find(name);
+    return slot < 0 ? nullptr : &_cat.files[slot];
+}
+
+int32_t FlashFs::find(const char* name) const {
+    if (!name || !name[0]) {
+        return -1;
+    }
+
+    for(uint32_t i = 0; i < FLASHFS_MAX_FILES; ++i) {
+        const SFsEntry& file = _cat.files[i];
+
+        if (file.name[0] && strncmp(file.name, name, FLASHFS_NAME_MAX) == 0) {
+            return int32_t(i);
+        }
+    }
+
+    return -1;
+}
+
+int32_t FlashFs::slotOf(SFsCatalog& cat, const char* name) const {
+    const int32_t slot = find(name);
+    if (slot >= 0) {
+        return slot;
+    }
+
+    // --> the terminating zero must fit.
+    if (!name || !name[0] || strlen(name) >= FLASHFS_NAME_MAX) {
+        return -1;
+    }
+
+    for(uint32_t i = 0; i < FLASHFS_MAX_FILES; ++i) {
+        SFsEntry& file = cat.files[i];
+
+        if (!file.name[0]) {
+            memset(&file, 0, sizeof(file));
+            strncpy(file.name, name, FLASHFS_NAME_MAX - 1);
+            file.first = file.last = NONE;
+            return int32_t(i);
+        }
+    }
+
+    return -1;
+}
+
+void FlashFs::setUsed(uint16_t sector, bool used) {
+    const uint32_t bit = 1u << (sector % 32);
+
+    if (used == isUsed(sector)) {
+        return;
+    }
+
+    if (used) {
+        _used[sector / 32] |= bit;
+        _free--;
+    }
+
+    else {
+        _used[sector / 32] &= ~bit;
+        _free++;
+    }
+}
+
+bool FlashFs::readHeader(uint16_t sector, SFsSector* hdr) {
+    if (!_flash->read(addressOf(sector), hdr)) {
+        return false;
+    }
+
+    return hdr->magic == MAGIC && hdr->crc == crc32(hdr, offsetof(SFsSector, crc));
+}
+
+bool FlashFs::walk(uint32_t slot) {
+    const SFsEntry& file = _cat.files[slot];
+    uint32_t n = (file.size + DATA_SIZE - 1) / DATA_SIZE;
+    uint16_t sector = file.last;
+    uint16_t next = NONE;
+
+    if (!n) {
+        return file.first == NONE && file.last == NONE;
+    }
+
+    // --> from the last sector, so each header is read once.
+    while (n-- > 0) {
+        SFsSector hdr;
+
+        if (sector >= _count || isUsed(sector) || !readHeader(sector, &hdr)
+            || hdr.index != n || hdr.file != slot)
+        {
+            release(next);
+            return false;
+        }
+
+        setUsed(sector, true);
+        _link[sector] = next;
+
+        next = sector;
+        sector = hdr.prev;
+    }
+
+    if (sector != NONE || next != file.first) {
+        release(next);
+        return false;
+    }
+
+    return true;
+}
+
+bool FlashFs::isBlank(uint32_t addr, uint32_t len) {
+    while (len) {
+        const uint32_t n = len < sizeof(_buf) ? len : sizeof(_buf);
+
+        if (_flash->read(addr, _buf, n) != n) {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < n; ++i) {
+            if (_buf[i] != 0xff) {
+                return false;
+            }
+        }
+
+        addr += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+uint16_t FlashFs::allocate() {
+    for(uint32_t i = 0; i < _count; ++i) {
+        const uint16_t sector = uint16_t((_cursor + i) % _count);
+
+        if (isUsed(sector)) {
+            continue;
+        }
+
+        _cursor = uint16_t((sector + 1) % _count);
+
+        // --> freed or torn: erase it.
+        if (!isBlank(addressOf(sector), W25QXX::SECTOR_SIZE) && !_flash->eraseSector(_data + sector)) {
+            continue;
+        }
+
+        setUsed(sector, true);
+        return sector;
+    }
+
+    return NONE;
+}
+
+uint32_t FlashFs::extend(SFsEntry& file, uint16_t slot, const uint8_t* buf, uint32_t len) {
+    uint32_t done = 0;
+
+    while (done < len) {
+        const uint16_t sector = allocate();
+        if (sector == NONE) {
+            break;
+        }
+
+        const uint32_t left = len - done;
+        const uint32_t n = left < DATA_SIZE ? left : DATA_SIZE;
+        SFsSector hdr;
+
+        hdr.magic = MAGIC;
+        hdr.prev = file.last;
+        hdr.index = uint16_t(file.size / DATA_SIZE);
+        hdr.file = slot;
+        hdr.crc = crc32(&hdr, offsetof(SFsSector, crc));
+        hdr.seal = n == DATA_SIZE ? crc32(buf + done, n) : UNSEALED;
+
+        if (!_flash->write(addressOf(sector), &hdr) ||
+            _flash->write(addressOf(sector) + HEADER_SIZE, buf + done, n) != n)
+        {
+            setUsed(sector, false);
+            break;
+        }
+
+        if (file.last != NONE) {
+            _link[file.last] = sector;
+        }
+
+        else {
+            file.first = sector;
+        }
+
+        _link[sector] = NONE;
+        file.last = sector;
+        file.size += n;
+        done += n;
+    }
+
+    return done;
+}
+
+bool FlashFs::relocate(SFsEntry& file, uint16_t slot, uint32_t used) {
+    SFsSector hdr;
+
+    if (!readHeader(file.last, &hdr) || hdr.file != slot) {
+        return false;
+    }
+
+    const uint16_t sector = allocate();
+    if (sector == NONE) {
+        return false;
+    }
+
+    // --> same header: it takes the place of the tail, not full.
+    hdr.seal = UNSEALED;
+    bool ok = _flash->write(addressOf(sector), &hdr);
+
+    for(uint32_t at = 0; ok && at < used; at += sizeof(_buf)) {
+        const uint32_t n = used - at < sizeof(_buf) ? used - at : sizeof(_buf);
+
+        ok = _flash->read(addressOf(file.last) + HEADER_SIZE + at, _buf, n) == n
+            && _flash->write(addressOf(sector) + HEADER_SIZE + at, _buf, n) == n;
+    }
+
+    if (!ok) {
+        setUsed(sector, false);
+        return false;
+    }
+
+    if (hdr.prev != NONE) {
+        _link[hdr.prev] = sector;
+    }
+
+    else {
+        file.first = sector;
+    }
+
+    _link[sector] = NONE;
+    file.last = sector;
+    return true;
+}
+
+bool FlashFs::seal(uint16_t sector) {
+    const uint32_t addr = addressOf(sector);
+    uint32_t crc = 0;
+
+    for(uint32_t at = 0; at < DATA_SIZE; at += sizeof(_buf)) {
+        const uint32_t n = DATA_SIZE - at < sizeof(_buf) ? DATA_SIZE - at : sizeof(_buf);
+
+        // --> the cells, not the cache: a seal over the cached copy verifies nothing.
+        if (_flash->readUncached(addr + HEADER_SIZE + at, _buf, n) != n) {
+            return false;
+        }
+
+        crc = crc32(_buf, n, crc);
+    }
+
+    return _flash->write(addr + offsetof(SFsSector, seal), &crc);
+}
+
+void FlashFs::release(uint16_t sector) {
+    _generation++;
+
+    while (sector != NONE && sector < _count) {
+        setUsed(sector, false);
+        sector = _link[sector];
+    }
+}
+
+bool FlashFs::commit(SFsCatalog& cat, uint16_t release, uint16_t moved) {
+    if (!_catalog.save(&cat)) {
+        // --> the sectors allocated aren't committed: back to the catalog.
+        mount(_data - FLASHFS_CATALOG_SECTORS, _count + FLASHFS_CATALOG_SECTORS);
+        return false;
+    }
+
+    // --> read from now, stored by the steps: the freed sectors are kept till then.
+    memcpy(&_cat, &cat, sizeof(cat));
+
+    _committing = true;
+    _release = release;
+    _moved = moved;
+    return true;
+}
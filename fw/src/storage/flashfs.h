@@ -0,0 +1,259 @@
+#ifndef __STORAGE_FLASHFS_H__
+#define __STORAGE_FLASHFS_H__
+
+#include "../drivers/w25qxx.h"
+#include "confstore.h"
+
+/**
+ * Configurations for the FlashFs.
+ * 1. FLASHFS_MAX_FILES : files in the catalog, the catalog must fit a ConfStore record.
+ * 2. FLASHFS_NAME_MAX : bytes of the name with the terminating zero.
+ * 3. FLASHFS_MAX_SECTORS : max data sectors, each takes 2 bytes and a bit of RAM.
+ * 4. FLASHFS_CATALOG_SECTORS : sectors of the catalog ring, each commit programs a slot of it.
+ */
+#ifndef FLASHFS_MAX_FILES
+#define FLASHFS_MAX_FILES 12
+#endif
+
+#ifndef FLASHFS_NAME_MAX
+#define FLASHFS_NAME_MAX 12
+#endif
+
+#ifndef FLASHFS_MAX_SECTORS
+#define FLASHFS_MAX_SECTORS 4096
+#endif
+
+#ifndef FLASHFS_CATALOG_SECTORS
+#define FLASHFS_CATALOG_SECTORS 8
+#endif
+
+/**
+ * Entry of the catalog, a file.
+ */
+struct SFsEntry {
+    char name[FLASHFS_NAME_MAX];    // --> empty if not used.
+    uint32_t size;
+    uint16_t first;                 // --> data sectors, FlashFs::NONE if empty.
+    uint16_t last;
+};
+
+/**
+ * Catalog of the files, a ConfStore record.
+ */
+struct SFsCatalog {
+    uint16_t cursor;                // --> next data sector to allocate.
+    uint16_t reserved;
+    SFsEntry files[FLASHFS_MAX_FILES];
+};
+
+/**
+ * Header of the data sector.
+ */
+struct SFsSector {
+    uint16_t magic;     // --> FlashFs::MAGIC.
+    uint16_t prev;      // --> previous sector of the file, FlashFs::NONE if the first.
+    uint16_t index;     // --> sector index in the file.
+    uint16_t file;      // --> slot of the file in the catalog.
+    uint32_t crc;       // --> CRC-32 of the header.
+    uint32_t seal;      // --> CRC-32 of the data once full, FlashFs::UNSEALED until then.
+};
+
+/**
+ * Filesystem on the flash memory.
+ * Named files, appended or replaced atomically.
+ *
+ * --
+ * The catalog is a record of a ConfStore ring: each change of the files
+ * commits the whole catalog, so a torn change falls back to the previous one.
+ * The commit never blocks: `step()` stores it, sharing the flash job with
+ * the other stores, and the next change waits for it, see `isBusy()`.
+ * The sectors the change frees are kept until committed.
+ *
+ * A file is a chain of data sectors: each sector header points the previous
+ * sector, and the catalog holds the last one and the size. Mounting walks
+ * the chains backward, so it reads the headers of the live sectors only.
+ *
+ * 1. append: programs the blank tail of the last sector, then new sectors,
+ *    and commits the new size. If a torn append left bytes in the tail,
+ *    the tail is copied to a new sector first.
+ * 2. replace: writes a new chain, commits it, then frees the old one.
+ * 3. the sectors not in the chains are free, and allocated from a cursor
+ *    rotating over the region: the wear is spread. a free sector is
+ *    blank-checked and erased when allocated.
+ * 4. seal: a full sector carries the CRC-32 of its data in the header, so
+ *    the scrubber verifies it. the header CRC doesn't cover the seal, it's
+ *    programmed later when an append fills the tail.
+ */
+class FlashFs {
+public:
+    static constexpr uint16_t MAGIC = 0xf5da;
+    static constexpr uint16_t NONE = 0xffff;
+    static constexpr uint32_t UNSEALED = 0xffffffff;
+    static constexpr uint32_t HEADER_SIZE = sizeof(SFsSector);
+    static constexpr uint32_t DATA_SIZE = W25QXX::SECTOR_SIZE - HEADER_SIZE;
+
+private:
+    W25QXX* _flash;
+    ConfStore _catalog;
+    SFsCatalog _cat;            // --> committed.
+
+    uint32_t _data;             // --> first data sector.
+    uint32_t _count;            // --> data sectors.
+    uint32_t _free;             // --> free data sectors.
+    uint16_t _cursor;
+    uint32_t _generation;       // --> increases when the sectors are freed.
+
+    // --> the change being committed: the sectors it frees after.
+    bool _committing;
+    uint16_t _release;          // --> the old chain.
+    uint16_t _moved;            // --> the copied tail.
+
+    uint16_t _link[FLASHFS_MAX_SECTORS];        // --> next sector of the file.
+    uint32_t _used[(FLASHFS_MAX_SECTORS + 31) / 32];
+    uint8_t _buf[W25QXX::PAGE_SIZE];
+
+public:
+    FlashFs(W25QXX* flash);
+
+public:
+    /**
+     * Mount the sectors: the catalog ring first, then the data sectors.
+     * Empty if no catalog found, a broken chain drops its file.
+     * Returns false if the region is too small.
+     */
+    bool mount(uint32_t first, uint32_t count);
+
+    /**
+     * Test whether the file exists or not.
+     */
+    inline bool exists(const char* name) const { return find(name) >= 0; }
+
+    /**
+     * Get the size of the file, zero if not exists.
+     */
+    uint32_t size(const char* name) const;
+
+    /**
+     * Read bytes of the file from the offset, and returns read bytes.
+     */
+    uint32_t read(const char* name, uint32_t offset, void* buf, uint32_t len);
+
+    /**
+     * Append bytes to the file, created if not exists, and returns appended bytes.
+     * Fewer bytes are appended if the space runs out, none if busy.
+     * The bytes read back at once, `step()` commits them.
+     */
+    uint32_t append(const char* name, const void* buf, uint32_t len);
+
+    /**
+     * Replace the file with the bytes, created if not exists.
+     * The file is either old or new even if the power is cut.
+     * Returns false if no space or busy, then the file is kept as is.
+     */
+    bool replace(const char* name, const void* buf, uint32_t len);
+
+    /**
+     * Remove the file, returns false if not exists or busy.
+     */
+    bool remove(const char* name);
+
+    /**
+     * Advance the commit of the catalog a step, then free the sectors of the change.
+     * A step never waits for the flash memory: call this from the main loop.
+     */
+    void step();
+
+    /**
+     * Test whether a change is being committed, or the catalog rewritten by the scrubber.
+     * The changes are refused meanwhile.
+     */
+    inline bool isBusy() const { return _committing || _catalog.isSaving(); }
+
+    /**
+     * Get the entry of the slot, null if not used.
+     */
+    const SFsEntry* entry(uint32_t slot) const;
+
+    /**
+     * Get the entry of the file, null if not exists.
+     */
+    const SFsEntry* lookup(const char* name) const;
+
+    /**
+     * Find the slot of the file, -1 if not exists.
+     */
+    int32_t find(const char* name) const;
+
+    /**
+     * Get the free bytes: the free sectors.
+     */
+    inline uint32_t freeBytes() const { return _free * DATA_SIZE; }
+
+    /**
+     * Get the data sectors.
+     */
+    inline uint32_t sectors() const { return _count; }
+
+    /**
+     * Get the next sector of the chain, NONE if the last.
+     */
+    inline uint16_t nextSector(uint16_t sector) const { return sector < _count ? _link[sector] : NONE; }
+
+    /**
+     * Get the address of the data sector.
+     */
+    inline uint32_t addressOf(uint16_t sector) const {
+        return (_data + sector) * W25QXX::SECTOR_SIZE;
+    }
+
+    /**
+     * Get the generation of the chains: it changes when the sectors are freed,
+     * then the chains walked before may be reused by other files.
+     */
+    inline uint32_t generation() const { return _generation; }
+
+    /**
+     * Get the store of the catalog.
+     */
+    inline ConfStore* catalog() { return &_catalog; }
+
+private:
+    /* find the slot of the file, or a free one with the name set. */
+    int32_t slotOf(SFsCatalog& cat, const char* name) const;
+
+    /* test or set whether the data sector is in a chain. */
+    inline bool isUsed(uint16_t sector) const { return _used[sector / 32] & (1u << (sector % 32)); }
+    void setUsed(uint16_t sector, bool used);
+
+    /* read the header of the sector, returns false if not valid. */
+    bool readHeader(uint16_t sector, SFsSector* hdr);
+
+    /* walk the chain of the file backward, and link its sectors. */
+    bool walk(uint32_t slot);
+
+    /* test whether the bytes are erased or not. */
+    bool isBlank(uint32_t addr, uint32_t len);
+
+    /* allocate a blank sector from the cursor, NONE if full. */
+    uint16_t allocate();
+
+    /* add sectors to the file, returns bytes written. the last sector must be full. */
+    uint32_t extend(SFsEntry& file, uint16_t slot, const uint8_t* buf, uint32_t len);
+
+    /* copy the tail to a new sector, it replaces the tail in the chain. */
+    bool relocate(SFsEntry& file, uint16_t slot, uint32_t used);
+
+    /* program the seal of the full tail, its data is read back. */
+    bool seal(uint16_t sector);
+
+    /* free the chain from the sector. */
+    void release(uint16_t sector);
+
+    /* start to commit the catalog, the sectors are freed once done. mounts again if failed. */
+    bool commit(SFsCatalog& cat, uint16_t release, uint16_t moved);
+};
+
+static_assert(sizeof(SFsCatalog) <= ConfStore::MAX_PAYLOAD, "the catalog must fit a ConfStore record.");
+static_assert(FLASHFS_MAX_SECTORS < 0xffff, "the sectors are 16 bits.");
+
+#endif
@@ -0,0 +1,225 @@
+#include "flashstream.h"
+#include <string.h>
+
+FlashStream::FlashStream(W25QXX* flash)
+    : _flash(flash), _fs(nullptr), _generation(0), _slot(0), _first(FlashFs::NONE), _sector(FlashFs::NONE),
+      _addr(0), _segment(0), _left(0), _remain(0), _pos(0),
+      _cur(0), _fill(0), _fetching(-1), _starved(false), _aborted(false), _underruns(0)
+{
+    _len[0] = _len[1] = 0;
+}
+
+FlashStream::~FlashStream() {
+    close();
+}
+
+bool FlashStream::open(uint32_t addr, uint32_t len) {
+    close();
+
+    if (addr >= _flash->capacity() || len > _flash->capacity() - addr) {
+        return false;
+    }
+
+    reset(len);
+    _addr = addr;
+    _segment = len;
+
+    fetch();
+    return true;
+}
+
+bool FlashStream::open(FlashFs* fs, const char* name) {
+    close();
+
+    const int32_t slot = fs->find(name);
+    if (slot < 0) {
+        return false;
+    }
+
+    const SFsEntry* file = fs->entry(uint32_t(slot));
+
+    reset(file->size);
+    _fs = fs;
+    _generation = fs->generation();
+    _slot = uint16_t(slot);
+    _first = _sector = file->first;
+
+    // --> the data of the first sector, the next ones by the chain.
+    if (_sector != FlashFs::NONE) {
+        _addr = fs->addressOf(_sector) + FlashFs::HEADER_SIZE;
+        _segment = file->size < FlashFs::DATA_SIZE ? file->size : FlashFs::DATA_SIZE;
+    }
+
+    fetch();
+    return true;
+}
+
+void FlashStream::close() {
+    // --> the buffer is written by the DMA until done.
+    if (_fetching >= 0) {
+        _flash->waitForXfer();
+    }
+
+    reset(0);
+}
+
+void FlashStream::update() {
+    if (_fetching >= 0) {
+        _flash->updateOnce();
+    }
+
+    fetch();
+}
+
+bool FlashStream::read(void* buf, uint32_t len) {
+    update();
+
+    // --> the end, or cut off: not an underrun.
+    if (len > _remain || _aborted) {
+        return false;
+    }
+
+    if (available() < len) {
+        if (!_starved) {
+            _underruns++;
+        }
+
+        _starved = true;
+        return false;
+    }
+
+    uint8_t* dst = (uint8_t*) buf;
+    uint32_t done = 0;
+
+    _starved = false;
+    _remain -= len;
+
+    while (done < len) {
+        const uint32_t left = _len[_cur] - _pos;
+        const uint32_t n = len - done < left ? len - done : left;
+
+        memcpy(dst + done, _buf[_cur] + _pos, n);
+        _pos += n;
+        done += n;
+
+        // --> consumed: fetch the next bytes to it, while the other one is consumed.
+        if (_pos >= _len[_cur]) {
+            _len[_cur] = 0;
+            _pos = 0;
+            _cur ^= 1;
+
+            fetch();
+        }
+    }
+
+    return true;
+}
+
+uint32_t FlashStream::available() const {
+    // --> a buffer fetched is non-zero, the next one only after the current.
+    uint32_t n = _len[_cur] - _pos;
+
+    if (_len[_cur]) {
+        n += _len[_cur ^ 1];
+    }
+
+    return n;
+}
+
+void FlashStream::reset(uint32_t len) {
+    _fs = nullptr;
+    _first = _sector = FlashFs::NONE;
+    _addr = _segment = 0;
+    _left = _remain = len;
+
+    _len[0] = _len[1] = 0;
+    _pos = 0;
+    _cur = _fill = 0;
+    _fetching = -1;
+    _starved = false;
+    _aborted = false;
+}
+
+void FlashStream::fetch() {
+    if (_fetching >= 0 || !_left || _len[_fill]) {
+        return;
+    }
+
+    if (_fs) {
+        // --> sectors were freed: of the other files, or the chain isn't the file anymore.
+        if (_fs->generation() != _generation) {
+            if (!isSameChain()) {
+                abort();
+                return;
+            }
+
+            _generation = _fs->generation();
+        }
+
+        // --> the next sector of the chain.
+        if (!_segment) {
+            _sector = _fs->nextSector(_sector);
+
+            // --> the chain ends before the size.
+            if (_sector == FlashFs::NONE) {
+                abort();
+                return;
+            }
+
+            _addr = _fs->addressOf(_sector) + FlashFs::HEADER_SIZE;
+            _segment = _left < FlashFs::DATA_SIZE ? _left : FlashFs::DATA_SIZE;
+        }
+    }
+
+    const uint32_t n = _segment < FLASHSTREAM_CHUNK ? _segment : FLASHSTREAM_CHUNK;
+
+    // --> the callback may be called at once: cached or without the DMA.
+    _fetching = int8_t(_fill);
+    if (!_flash->readAsync(_addr, _buf[_fill], n, onFetched, this)) {
+        // --> the other transfer is running: try later.
+        _fetching = -1;
+    }
+}
+
+void FlashStream::abort() {
+    _len[0] = _len[1] = 0;
+    _pos = 0;
+    _left = 0;
+    _aborted = true;
+}
+
+bool FlashStream::isSameChain() const {
+    const SFsEntry* file = _fs->entry(_slot);
+    if (!file || file->first != _first) {
+        return false;
+    }
+
+    // --> the tail relocated by an append is a new sector: the chain bounded by the sectors.
+    uint16_t sector = _first;
+    for(uint32_t n = 0; sector != FlashFs::NONE && n < _fs->sectors(); ++n) {
+        if (sector == _sector) {
+            return true;
+        }
+
+        sector = _fs->nextSector(sector);
+    }
+
+    return false;
+}
+
+void FlashStream::onFetched(W25QXX* w25qxx, uint32_t len, void* ctx) {
+    FlashStream* self = (FlashStream*) ctx;
+    (void) w25qxx;
+
+    if (self->_fetching < 0) {
+        return;
+    }
+
+    self->_len[self->_fetching] = len;
+    self->_addr += len;
+    self->_segment -= len;
+    self->_left -= len;
+
+    self->_fill ^= 1;
+    self->_fetching = -1;
+}
@@ -0,0 +1,141 @@
+#ifndef __STORAGE_FLASHSTREAM_H__
+#define __STORAGE_FLASHSTREAM_H__
+
+#include "../drivers/w25qxx.h"
+#include "flashfs.h"
+
+/**
+ * Configurations for the FlashStream.
+ * 1. FLASHSTREAM_CHUNK : bytes of a buffer, the stream takes two of them.
+ *    a read of the stream must not exceed this.
+ */
+#ifndef FLASHSTREAM_CHUNK
+#define FLASHSTREAM_CHUNK 512
+#endif
+
+/**
+ * Prefetching stream over the flash memory.
+ * Reads a range or a FlashFs file of any length, through two buffers.
+ *
+ * --
+ * While a buffer is consumed, the other one is fetched asynchronously:
+ * the consumer never waits for the flash memory unless it outruns the chip,
+ * and that is counted as an underrun. A fetch waits for the other transfer
+ * to be done, so the stream shares the chip with the stores.
+ *
+ * The other files may change while streamed. If the file itself is replaced
+ * or removed, or the sector being read relocated by an append, the stream is
+ * aborted there: the bytes left are never read.
+ */
+class FlashStream {
+private:
+    W25QXX* _flash;
+    FlashFs* _fs;               // --> null if a range.
+    uint32_t _generation;       // --> generation the chain was checked at.
+    uint16_t _slot;             // --> slot of the file in the catalog.
+    uint16_t _first;            // --> first sector of the file.
+    uint16_t _sector;           // --> sector of the next fetch, a file.
+
+    uint32_t _addr;             // --> address of the next fetch.
+    uint32_t _segment;          // --> contiguous bytes from the address.
+    uint32_t _left;             // --> bytes left to fetch.
+    uint32_t _remain;           // --> bytes left to consume.
+
+    uint8_t _buf[2][FLASHSTREAM_CHUNK];
+    uint32_t _len[2];           // --> fetched bytes, zero if free.
+    uint32_t _pos;              // --> consumed bytes of the current buffer.
+    uint8_t _cur;               // --> buffer being consumed.
+    uint8_t _fill;              // --> buffer to fetch next.
+    int8_t _fetching;           // --> buffer being fetched, -1 if none.
+
+    bool _starved;
+    bool _aborted;
+    uint32_t _underruns;
+
+public:
+    FlashStream(W25QXX* flash);
+    ~FlashStream();
+
+public:
+    /**
+     * Open the range of the flash memory, and start to fetch it.
+     * Returns false if out of range.
+     */
+    bool open(uint32_t addr, uint32_t len);
+
+    /**
+     * Open the file of the filesystem, and start to fetch it.
+     * Returns false if not exists.
+     */
+    bool open(FlashFs* fs, const char* name);
+
+    /**
+     * Close the stream, the fetch running is waited out.
+     */
+    void close();
+
+    /**
+     * Complete the fetch if finished, and start the next one.
+     * This never waits for the flash memory.
+     */
+    void update();
+
+    /**
+     * Read the bytes if all of them are fetched, this never waits for the flash memory.
+     * Returns false if not: an underrun, unless the stream ends before them or is aborted.
+     */
+    bool read(void* buf, uint32_t len);
+
+    /**
+     * Get the bytes ready to read.
+     */
+    uint32_t available() const;
+
+    /**
+     * Test whether both buffers are fetched, or all bytes.
+     * A playback started then has a buffer ahead of it.
+     */
+    inline bool isReady() const { return available() >= _remain || (_len[0] && _len[1]); }
+
+    /**
+     * Get the bytes left to read.
+     */
+    inline uint32_t remaining() const { return _remain; }
+
+    /**
+     * Test whether all bytes are read or not.
+     */
+    inline bool isEnd() const { return !_remain; }
+
+    /**
+     * Test whether the file was cut off while streamed: the bytes left can't be read.
+     */
+    inline bool isAborted() const { return _aborted; }
+
+    /**
+     * Get the reads failed for the bytes not fetched yet.
+     * The reads retried for the same bytes are counted once.
+     */
+    inline uint32_t underruns() const { return _underruns; }
+
+private:
+    /* reset the buffers for the stream of the bytes. */
+    void reset(uint32_t len);
+
+    /* start to fetch the free buffer. */
+    void fetch();
+
+    /* cut the stream off: the fetched bytes dropped, and the bytes left never read. */
+    void abort();
+
+    /* test whether the file is still the chain being fetched: same first sector, and the sector on it. */
+    bool isSameChain() const;
+
+    /* called when the fetch is done. */
+    static void onFetched(W25QXX* w25qxx, uint32_t len, void* ctx);
+};
+
+static_assert(FLASHSTREAM_CHUNK >= 16 && FLASHSTREAM_CHUNK <= FlashFs::DATA_SIZE,
+    "a chunk must fit the data of a sector.");
+
+#endif
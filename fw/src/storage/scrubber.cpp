@@ -0,0 +1,307 @@
+#include "scrubber.h"
+#include <pico/stdlib.h>
+#include <bsp/board_api.h>
+#include <stddef.h>
+#include <string.h>
+
+Scrubber::Scrubber(W25QXX* flash)
+    : _flash(flash), _fs(nullptr), _storeCount(0),
+      _period(SCRUBBER_PERIOD_MS), _passAt(0), _requested(false), _slice(SCRUBBER_SLICE_MAX),
+      _state(ESCR_IDLE), _target(0), _addr(0), _left(0), _at(0), _crc(0), _expect(0),
+      _seq(0), _generation(0), _sector(FlashFs::NONE), _index(0), _sectors(0), _sealed(0),
+      _found(0)
+{
+    memset(_stores, 0, sizeof(_stores));
+    memset(&_report, 0, sizeof(_report));
+}
+
+bool Scrubber::addStore(ConfStore* store) {
+    if (!store || _storeCount >= SCRUBBER_MAX_STORES) {
+        return false;
+    }
+
+    _stores[_storeCount++] = store;
+    return true;
+}
+
+void Scrubber::step() {
+    if (_state == ESCR_IDLE) {
+        if (!_requested && board_millis() - _passAt < _period) {
+            return;
+        }
+    }
+
+    const uint64_t start = time_us_64();
+
+    switch(_state) {
+        case ESCR_IDLE:
+            begin();
+            break;
+
+        case ESCR_REPAIR:
+            repair();
+            break;
+
+        default:
+            // --> low priority: never waits for the other transfer or the chip.
+            if (!_flash->isXferBusy() && !_flash->isBusy()) {
+                slice();
+            }
+
+            break;
+    }
+
+    const uint32_t took = uint32_t(time_us_64() - start);
+    if (took > _report.maxStepUs) {
+        _report.maxStepUs = took;
+    }
+}
+
+void Scrubber::begin() {
+    // --> bytes per second on the read lines, the half of the budget for the transfer.
+    const uint64_t rate = uint64_t(_flash->baudrate()) * _flash->readLines() / 8;
+    uint64_t slice = rate * SCRUBBER_BUDGET_US / 2 / 1000000;
+
+    // --> a header fits the smallest slice.
+    if (slice < sizeof(SFsSector)) {
+        slice = sizeof(SFsSector);
+    }
+
+    if (slice > SCRUBBER_SLICE_MAX) {
+        slice = SCRUBBER_SLICE_MAX;
+    }
+
+    _slice = uint32_t(slice);
+    _requested = false;
+    _found = 0;
+
+    seek(0);
+}
+
+void Scrubber::seek(uint32_t target) {
+    const uint32_t targets = _storeCount + (_fs ? FLASHFS_MAX_FILES : 0);
+
+    for(_target = target; _target < targets; ++_target) {
+        if (open()) {
+            return;
+        }
+    }
+
+    _state = ESCR_IDLE;
+    _passAt = board_millis();
+    _report.passes++;
+    _report.found = _found;
+}
+
+bool Scrubber::open() {
+    if (_target < _storeCount) {
+        ConfStore* store = _stores[_target];
+
+        // --> being saved: the store verifies the new record itself.
+        if (!store->isLoaded() || store->isSaving()) {
+            return false;
+        }
+
+        _state = ESCR_RECORD;
+        _addr = store->recordAddress();
+        _left = store->recordSize();
+        _at = 0;
+        _crc = _expect = 0;
+        _seq = store->sequence();
+        return true;
+    }
+
+    const SFsEntry* file = _fs->entry(_target - _storeCount);
+    if (!file || !file->size) {
+        return false;
+    }
+
+    _state = ESCR_HEADER;
+    _generation = _fs->generation();
+    _sector = file->first;
+    _index = 0;
+    _sectors = (file->size + FlashFs::DATA_SIZE - 1) / FlashFs::DATA_SIZE;
+    _sealed = file->size / FlashFs::DATA_SIZE;
+    return true;
+}
+
+void Scrubber::slice() {
+    if (_state == ESCR_RECORD) {
+        ConfStore* store = _stores[_target];
+
+        // --> saved meanwhile: the record moved.
+        if (store->isSaving() || store->sequence() != _seq) {
+            seek(_target);
+            return;
+        }
+
+        sliceRecord(_left < _slice ? _left : _slice);
+        return;
+    }
+
+    // --> the sectors were freed meanwhile: walk the chain again.
+    if (_fs->generation() != _generation) {
+        seek(_target);
+        return;
+    }
+
+    if (_state == ESCR_HEADER) {
+        sliceHeader();
+    }
+
+    else {
+        sliceData(_left < _slice ? _left : _slice);
+    }
+}
+
+void Scrubber::sliceRecord(uint32_t n) {
+    if (_flash->readUncached(_addr + _at, _buf, n) != n) {
+        seek(_target + 1);
+        return;
+    }
+
+    _report.bytes += n;
+
+    if (!_at) {
+        // --> the header except the `crc` field, then the payload.
+        memcpy(&_expect, _buf + offsetof(SConfRecord, crc), sizeof(_expect));
+
+        _crc = crc32(_buf, offsetof(SConfRecord, crc));
+        _crc = crc32(_buf + sizeof(SConfRecord), n - sizeof(SConfRecord), _crc);
+    }
+
+    else {
+        _crc = crc32(_buf, n, _crc);
+    }
+
+    _at += n;
+    _left -= n;
+
+    if (_left) {
+        return;
+    }
+
+    ConfStore* store = _stores[_target];
+    _report.regions++;
+
+    if (_crc == _expect && _expect == store->recordCrc()) {
+        seek(_target + 1);
+        return;
+    }
+
+    corrupt();
+
+    // --> the copy in RAM was verified: appended again, the App steps it as well.
+    if (store->rewrite()) {
+        _state = ESCR_REPAIR;
+        return;
+    }
+
+    _report.lost++;
+    seek(_target + 1);
+}
+
+void Scrubber::sliceHeader() {
+    const uint32_t addr = _fs->addressOf(_sector);
+    SFsSector hdr;
+
+    if (_flash->readUncached(addr, _buf, sizeof(hdr)) != sizeof(hdr)) {
+        seek(_target + 1);
+        return;
+    }
+
+    _report.bytes += sizeof(hdr);
+    memcpy(&hdr, _buf, sizeof(hdr));
+
+    const bool ok = hdr.magic == FlashFs::MAGIC
+        && hdr.crc == crc32(&hdr, offsetof(SFsSector, crc))
+        && hdr.index == _index && hdr.file == _target - _storeCount;
+
+    if (!ok) {
+        // --> no copy of the file: reported, and the rest of the chain is unreachable.
+        _report.regions++;
+        _report.lost++;
+        corrupt();
+
+        seek(_target + 1);
+        return;
+    }
+
+    // --> an unsealed full sector has nothing to verify against.
+    if (_index < _sealed && hdr.seal != FlashFs::UNSEALED) {
+        _state = ESCR_DATA;
+        _addr = addr + FlashFs::HEADER_SIZE;
+        _left = FlashFs::DATA_SIZE;
+        _at = 0;
+        _crc = 0;
+        _expect = hdr.seal;
+        return;
+    }
+
+    _report.regions++;
+    nextSector();
+}
+
+void Scrubber::sliceData(uint32_t n) {
+    if (_flash->readUncached(_addr + _at, _buf, n) != n) {
+        seek(_target + 1);
+        return;
+    }
+
+    _report.bytes += n;
+    _crc = crc32(_buf, n, _crc);
+    _at += n;
+    _left -= n;
+
+    if (_left) {
+        return;
+    }
+
+    _report.regions++;
+
+    if (_crc != _expect) {
+        _report.lost++;
+        corrupt();
+    }
+
+    nextSector();
+}
+
+void Scrubber::repair() {
+    ConfStore* store = _stores[_target];
+
+    if (store->isSaving()) {
+        store->step();
+        return;
+    }
+
+    // --> a save retries to the next slot until verified.
+    if (store->sequence() != _seq) {
+        _report.repaired++;
+    }
+
+    else {
+        _report.lost++;
+    }
+
+    seek(_target + 1);
+}
+
+void Scrubber::nextSector() {
+    if (++_index >= _sectors) {
+        seek(_target + 1);
+        return;
+    }
+
+    _sector = _fs->nextSector(_sector);
+    _state = ESCR_HEADER;
+
+    if (_sector == FlashFs::NONE) {
+        seek(_target + 1);
+    }
+}
+
+void Scrubber::corrupt() {
+    _report.corrupted++;
+    _found++;
+}
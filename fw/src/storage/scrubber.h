@@ -0,0 +1,175 @@
+#ifndef __STORAGE_SCRUBBER_H__
+#define __STORAGE_SCRUBBER_H__
+
+#include "../drivers/w25qxx.h"
+#include "confstore.h"
+#include "flashfs.h"
+
+/**
+ * Configurations for the Scrubber.
+ * 1. SCRUBBER_BUDGET_US : microseconds a step may take, the slice is sized to fit it.
+ * 2. SCRUBBER_SLICE_MAX : max bytes read by a step, this bounds the RAM.
+ * 3. SCRUBBER_PERIOD_MS : milliseconds from a pass to the next one.
+ * 4. SCRUBBER_MAX_STORES : ConfStores verified by a pass.
+ */
+#ifndef SCRUBBER_BUDGET_US
+#define SCRUBBER_BUDGET_US 50
+#endif
+
+#ifndef SCRUBBER_SLICE_MAX
+#define SCRUBBER_SLICE_MAX 256
+#endif
+
+#ifndef SCRUBBER_PERIOD_MS
+#define SCRUBBER_PERIOD_MS 60000
+#endif
+
+#ifndef SCRUBBER_MAX_STORES
+#define SCRUBBER_MAX_STORES 2
+#endif
+
+/**
+ * Results of the scrubber, all passes.
+ */
+struct SScrubReport {
+    uint32_t passes;        // --> completed passes.
+    uint32_t regions;       // --> regions verified: records and file sectors.
+    uint32_t bytes;         // --> bytes read.
+    uint32_t corrupted;     // --> regions failed to verify.
+    uint32_t repaired;      // --> corrupted regions rewritten from the copy.
+    uint32_t lost;          // --> corrupted regions without a copy.
+    uint32_t found;         // --> corrupted regions of the last pass.
+    uint32_t maxStepUs;     // --> the longest step.
+};
+
+/**
+ * State of the Scrubber.
+ */
+enum EScrubState {
+    ESCR_IDLE = 0,
+    ESCR_RECORD,        // --> verifying the newest record of a store.
+    ESCR_REPAIR,        // --> rewriting the record of a store.
+    ESCR_HEADER,        // --> verifying the header of a file sector.
+    ESCR_DATA           // --> verifying the data of a sealed file sector.
+};
+
+/**
+ * Background scrubber of the flash memory.
+ * Walks the checksummed regions a slice per step, between the main-loop iterations.
+ *
+ * --
+ * 1. the newest record of each ConfStore: its CRC-32 is verified against the
+ *    cells, and a rotten record is rewritten from the copy in RAM.
+ * 2. the sectors of the FlashFs files: the header CRC-32 of all, and the seal
+ *    of the full ones. a file has no copy, so a rotten sector is reported only.
+ *
+ * A step reads a slice at most, sized by the SPI clock to fit `SCRUBBER_BUDGET_US`,
+ * and skips while the other transfer is running or the chip is busy. So the HID
+ * reports are never delayed more than the budget.
+ */
+class Scrubber {
+private:
+    W25QXX* _flash;
+    FlashFs* _fs;
+    ConfStore* _stores[SCRUBBER_MAX_STORES];
+    uint32_t _storeCount;
+
+    uint32_t _period;
+    uint32_t _passAt;       // --> board_millis() of the last pass.
+    bool _requested;
+    uint32_t _slice;
+
+    uint8_t _state;
+    uint32_t _target;       // --> stores first, then the file slots.
+    uint32_t _addr;
+    uint32_t _left;         // --> bytes left in the region.
+    uint32_t _at;           // --> offset in the region.
+    uint32_t _crc;
+    uint32_t _expect;
+
+    uint32_t _seq;          // --> sequence of the record being verified.
+    uint32_t _generation;   // --> generation of the chains being walked.
+    uint16_t _sector;
+    uint32_t _index;        // --> index of the sector in the file.
+    uint32_t _sectors;      // --> sectors of the file.
+    uint32_t _sealed;       // --> full sectors of the file.
+
+    uint32_t _found;
+    SScrubReport _report;
+    uint8_t _buf[SCRUBBER_SLICE_MAX];
+
+public:
+    Scrubber(W25QXX* flash);
+
+public:
+    /**
+     * Add the store to verify, returns false if too many.
+     */
+    bool addStore(ConfStore* store);
+
+    /**
+     * Set the filesystem to verify, null to skip the files.
+     */
+    inline void setFs(FlashFs* fs) { _fs = fs; }
+
+    /**
+     * Set the interval of the passes, in milliseconds.
+     */
+    inline void setPeriod(uint32_t ms) { _period = ms; }
+
+    /**
+     * Start a pass at the next step, unless running already.
+     */
+    inline void request() { _requested = true; }
+
+    /**
+     * Advance the scrubber a step: a slice at most.
+     * A step never waits for the flash memory.
+     */
+    void step();
+
+    /**
+     * Test whether a pass is running or not.
+     */
+    inline bool isRunning() const { return _state != ESCR_IDLE; }
+
+    /**
+     * Get the results.
+     */
+    inline const SScrubReport& report() const { return _report; }
+
+private:
+    /* start a pass: the slice sized by the SPI clock. */
+    void begin();
+
+    /* start to verify the target or the next ones, or end the pass. */
+    void seek(uint32_t target);
+
+    /* start to verify the target, returns false if nothing to verify. */
+    bool open();
+
+    /* advance the current region a slice. */
+    void slice();
+
+    /* verify a slice of the newest record. */
+    void sliceRecord(uint32_t n);
+
+    /* verify the header of the file sector. */
+    void sliceHeader();
+
+    /* verify a slice of the sealed data. */
+    void sliceData(uint32_t n);
+
+    /* step the rewrite of the store, and count it once done. */
+    void repair();
+
+    /* move to the next sector of the file. */
+    void nextSector();
+
+    /* count the corrupted region. */
+    void corrupt();
+};
+
+static_assert(SCRUBBER_SLICE_MAX >= sizeof(SFsSector), "a header must fit a slice.");
+
+#endif